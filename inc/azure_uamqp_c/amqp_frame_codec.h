@@ -34,6 +34,7 @@ typedef void(*AMQP_FRAME_CODEC_ERROR_CALLBACK)(void* context);
 MOCKABLE_FUNCTION(, AMQP_FRAME_CODEC_HANDLE, amqp_frame_codec_create, FRAME_CODEC_HANDLE, frame_codec, AMQP_FRAME_RECEIVED_CALLBACK, frame_received_callback, AMQP_EMPTY_FRAME_RECEIVED_CALLBACK, empty_frame_received_callback, AMQP_FRAME_CODEC_ERROR_CALLBACK, amqp_frame_codec_error_callback, void*, callback_context);
 MOCKABLE_FUNCTION(, void, amqp_frame_codec_destroy, AMQP_FRAME_CODEC_HANDLE, amqp_frame_codec);
 MOCKABLE_FUNCTION(, int, amqp_frame_codec_encode_frame, AMQP_FRAME_CODEC_HANDLE, amqp_frame_codec, uint16_t, channel, AMQP_VALUE, performative, PAYLOAD*, payloads, ON_BYTES_ENCODED, on_bytes_encoded, void*, callback_context);
+MOCKABLE_FUNCTION(, int, amqp_frame_codec_encode_frame_bytes, AMQP_FRAME_CODEC_HANDLE, amqp_frame_codec, uint16_t, channel, const unsigned char*, performative_bytes, size_t, performative_size, PAYLOAD*, payloads, ON_BYTES_ENCODED, on_bytes_encoded, void*, callback_context);
 MOCKABLE_FUNCTION(, int, amqp_frame_codec_encode_empty_frame, AMQP_FRAME_CODEC_HANDLE, amqp_frame_codec, uint16_t, channel, ON_BYTES_ENCODED, on_bytes_encoded, void*, callback_context);
 
 #ifdef __cplusplus
@@ -59,22 +59,26 @@ extern "C" {
     MOCKABLE_FUNCTION(, int, amqpvalue_get_uuid, AMQP_VALUE, value, uuid*, uuid_value);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_create_binary, amqp_binary, binary_value);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_binary, AMQP_VALUE, value, amqp_binary, binary_value);
+    MOCKABLE_FUNCTION(, int, amqpvalue_get_binary_borrowed, AMQP_VALUE, value, amqp_binary, binary_value);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_create_string, const char*, string_value);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_string, AMQP_VALUE, value, const char**, string_value);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_create_symbol, const char*, symbol_value);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_symbol, AMQP_VALUE, value, const char**, symbol_value);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_create_list);
+    MOCKABLE_FUNCTION(, int, amqpvalue_reserve_list, AMQP_VALUE, list, uint32_t, capacity);
     MOCKABLE_FUNCTION(, int, amqpvalue_set_list_item_count, AMQP_VALUE, list, uint32_t, count);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_list_item_count, AMQP_VALUE, list, uint32_t*, count);
     MOCKABLE_FUNCTION(, int, amqpvalue_set_list_item, AMQP_VALUE, list, uint32_t, index, AMQP_VALUE, list_item_value);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_get_list_item, AMQP_VALUE, list, size_t, index);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_create_map);
+    MOCKABLE_FUNCTION(, int, amqpvalue_reserve_map, AMQP_VALUE, map, uint32_t, capacity);
     MOCKABLE_FUNCTION(, int, amqpvalue_set_map_value, AMQP_VALUE, map, AMQP_VALUE, key, AMQP_VALUE, value);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_get_map_value, AMQP_VALUE, map, AMQP_VALUE, key);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_map_pair_count, AMQP_VALUE, map, uint32_t*, pair_count);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_map_key_value_pair, AMQP_VALUE, map, uint32_t, index, AMQP_VALUE*, key, AMQP_VALUE*, value);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_map, AMQP_VALUE, from_value, AMQP_VALUE*, map);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_create_array);
+    MOCKABLE_FUNCTION(, int, amqpvalue_reserve_array, AMQP_VALUE, value, uint32_t, capacity);
     MOCKABLE_FUNCTION(, int, amqpvalue_add_array_item, AMQP_VALUE, value, AMQP_VALUE, array_item_value);
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_get_array_item, AMQP_VALUE, value, uint32_t, index);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_array_item_count, AMQP_VALUE, value, uint32_t*, count);
@@ -90,6 +94,7 @@ extern "C" {
     typedef int (*AMQPVALUE_ENCODER_OUTPUT)(void* context, PAYLOAD* payload);
 
     MOCKABLE_FUNCTION(, int, amqpvalue_encode, AMQP_VALUE, value, AMQPVALUE_ENCODER_OUTPUT, encoder_output, PAYLOAD*, context);
+    MOCKABLE_FUNCTION(, int, amqpvalue_encode_to_payload, AMQP_VALUE, value, PAYLOAD*, payload);
     MOCKABLE_FUNCTION(, int, amqpvalue_get_encoded_size, AMQP_VALUE, value, size_t*, encoded_size);
 
     /* decoding */
@@ -99,6 +104,22 @@ extern "C" {
     MOCKABLE_FUNCTION(, AMQPVALUE_DECODER_HANDLE, amqpvalue_decoder_create, ON_VALUE_DECODED, on_value_decoded, void*, callback_context);
     MOCKABLE_FUNCTION(, void, amqpvalue_decoder_destroy, AMQPVALUE_DECODER_HANDLE, handle);
     MOCKABLE_FUNCTION(, int, amqpvalue_decode_bytes, AMQPVALUE_DECODER_HANDLE, handle, const unsigned char*, buffer, size_t, size);
+    /* decodes the first value held entirely in buffer without a decoder instance; the caller owns the returned value
+    and used_bytes is set to the number of bytes the value took */
+    MOCKABLE_FUNCTION(, int, amqpvalue_decode_buffer, const unsigned char*, buffer, size_t, size, AMQP_VALUE*, value, size_t*, used_bytes);
+    /* same as amqpvalue_decode_buffer, but binary values point into buffer, which must outlive the returned value;
+    amqpvalue_clone on such a value returns a copy that owns its bytes */
+    MOCKABLE_FUNCTION(, int, amqpvalue_decode_buffer_borrowed, const unsigned char*, buffer, size_t, size, AMQP_VALUE*, value, size_t*, used_bytes);
+
+    /* values decoded in an arena are carved out of chunks of chunk_size bytes instead of being allocated one by one;
+    they are used and destroyed like any other value and a chunk is reused once all values decoded in it are gone.
+    An arena must only decode from one thread at a time; values decoded in it may be kept and destroyed on any thread,
+    but each keeps its chunk allocated until it is destroyed. */
+    typedef struct AMQPVALUE_ARENA_HANDLE_DATA_TAG* AMQPVALUE_ARENA_HANDLE;
+
+    MOCKABLE_FUNCTION(, AMQPVALUE_ARENA_HANDLE, amqpvalue_arena_create, size_t, chunk_size);
+    MOCKABLE_FUNCTION(, void, amqpvalue_arena_destroy, AMQPVALUE_ARENA_HANDLE, arena);
+    MOCKABLE_FUNCTION(, int, amqpvalue_decode_buffer_in_arena, AMQPVALUE_ARENA_HANDLE, arena, const unsigned char*, buffer, size_t, size, bool, borrow_binaries, AMQP_VALUE*, value, size_t*, used_bytes);
 
     /* misc for now, not spec'd */
     MOCKABLE_FUNCTION(, AMQP_VALUE, amqpvalue_get_inplace_descriptor, AMQP_VALUE, value);
@@ -14,6 +14,7 @@
 #include "azure_uamqp_c/amqp_definitions_milliseconds.h"
 #include "azure_uamqp_c/amqp_definitions_error.h"
 #include "azure_uamqp_c/amqpvalue.h"
+#include "azure_uamqp_c/timer_queue.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -91,14 +92,22 @@ extern "C" {
     MOCKABLE_FUNCTION(, int, connection_set_properties, CONNECTION_HANDLE, connection, fields, properties);
     MOCKABLE_FUNCTION(, int, connection_get_properties, CONNECTION_HANDLE, connection, fields*, properties);
     MOCKABLE_FUNCTION(, int, connection_get_remote_max_frame_size, CONNECTION_HANDLE, connection, uint32_t*, remote_max_frame_size);
+    MOCKABLE_FUNCTION(, int, connection_set_output_buffer_size, CONNECTION_HANDLE, connection, size_t, output_buffer_size);
+    MOCKABLE_FUNCTION(, int, connection_set_write_coalescing, CONNECTION_HANDLE, connection, size_t, flush_threshold, uint32_t, max_delay_us);
+    /* gathered sends are off by default: the io is only asked for one (OPTION_XIO_SENDV) once they are turned on, so that
+    ios which do not know the option are not handed it */
+    MOCKABLE_FUNCTION(, int, connection_set_gathered_send, CONNECTION_HANDLE, connection, bool, enabled);
     MOCKABLE_FUNCTION(, int, connection_set_remote_idle_timeout_empty_frame_send_ratio, CONNECTION_HANDLE, connection, double, idle_timeout_empty_frame_send_ratio);
     MOCKABLE_FUNCTION(, uint64_t, connection_handle_deadlines, CONNECTION_HANDLE, connection);
+    MOCKABLE_FUNCTION(, TIMER_QUEUE_HANDLE, connection_get_timer_queue, CONNECTION_HANDLE, connection);
     MOCKABLE_FUNCTION(, void, connection_dowork, CONNECTION_HANDLE, connection);
+    MOCKABLE_FUNCTION(, int, connection_flush, CONNECTION_HANDLE, connection);
     MOCKABLE_FUNCTION(, ENDPOINT_HANDLE, connection_create_endpoint, CONNECTION_HANDLE, connection);
     MOCKABLE_FUNCTION(, int, connection_start_endpoint, ENDPOINT_HANDLE, endpoint, ON_ENDPOINT_FRAME_RECEIVED, on_frame_received, ON_CONNECTION_STATE_CHANGED, on_connection_state_changed, void*, context);
     MOCKABLE_FUNCTION(, int, connection_endpoint_get_incoming_channel, ENDPOINT_HANDLE, endpoint, uint16_t*, incoming_channel);
     MOCKABLE_FUNCTION(, void, connection_destroy_endpoint, ENDPOINT_HANDLE, endpoint);
     MOCKABLE_FUNCTION(, int, connection_encode_frame, ENDPOINT_HANDLE, endpoint, AMQP_VALUE, performative, PAYLOAD*, payloads, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
+    MOCKABLE_FUNCTION(, int, connection_encode_frame_bytes, ENDPOINT_HANDLE, endpoint, const unsigned char*, performative_bytes, size_t, performative_size, PAYLOAD*, payloads, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
     MOCKABLE_FUNCTION(, void, connection_set_trace, CONNECTION_HANDLE, connection, bool, trace_on);
 
     MOCKABLE_FUNCTION(, ON_CONNECTION_CLOSED_EVENT_SUBSCRIPTION_HANDLE, connection_subscribe_on_connection_close_received, CONNECTION_HANDLE, connection, ON_CONNECTION_CLOSE_RECEIVED, on_connection_close_received, void*, context);
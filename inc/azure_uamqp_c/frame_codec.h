@@ -31,6 +31,10 @@ extern "C" {
 /* Codes_SRS_FRAME_CODEC_01_019: [A type code of 0x01 indicates that the frame is a SASL frame] */
 #define FRAME_TYPE_SASL    (uint8_t)0x01
 
+/* uint32_t, the largest receive buffer (in bytes) kept around between frames that span frame_codec_receive_bytes calls.
+Bigger buffers are freed once the frame has been dispatched. Defaults to keeping buffers of up to max_frame_size bytes. */
+#define FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT "receive_buffer_retain_limit"
+
     typedef struct FRAME_CODEC_INSTANCE_TAG* FRAME_CODEC_HANDLE;
     typedef void(*ON_FRAME_RECEIVED)(void* context, const unsigned char* type_specific, uint32_t type_specific_size, const unsigned char* frame_body, uint32_t frame_body_size);
     typedef void(*ON_FRAME_CODEC_ERROR)(void* context);
@@ -39,6 +43,7 @@ extern "C" {
     MOCKABLE_FUNCTION(, FRAME_CODEC_HANDLE, frame_codec_create, ON_FRAME_CODEC_ERROR, on_frame_codec_error, void*, callback_context);
     MOCKABLE_FUNCTION(, void, frame_codec_destroy, FRAME_CODEC_HANDLE, frame_codec);
     MOCKABLE_FUNCTION(, int, frame_codec_set_max_frame_size, FRAME_CODEC_HANDLE, frame_codec, uint32_t, max_frame_size);
+    MOCKABLE_FUNCTION(, int, frame_codec_set_option, FRAME_CODEC_HANDLE, frame_codec, const char*, option_name, const void*, value);
     MOCKABLE_FUNCTION(, int, frame_codec_subscribe, FRAME_CODEC_HANDLE, frame_codec, uint8_t, type, ON_FRAME_RECEIVED, on_frame_received, void*, callback_context);
     MOCKABLE_FUNCTION(, int, frame_codec_unsubscribe, FRAME_CODEC_HANDLE, frame_codec, uint8_t, type);
     MOCKABLE_FUNCTION(, int, frame_codec_receive_bytes, FRAME_CODEC_HANDLE, frame_codec, const unsigned char*, buffer, size_t, size); 
@@ -33,7 +33,8 @@ MU_DEFINE_ENUM(LINK_STATE, LINK_STATE_VALUES)
 
 #define LINK_TRANSFER_RESULT_VALUES \
     LINK_TRANSFER_ERROR, \
-    LINK_TRANSFER_BUSY
+    LINK_TRANSFER_BUSY, \
+    LINK_TRANSFER_OK
 
 MU_DEFINE_ENUM(LINK_TRANSFER_RESULT, LINK_TRANSFER_RESULT_VALUES)
 
@@ -73,6 +74,8 @@ MOCKABLE_FUNCTION(, int, link_get_received_message_id, LINK_HANDLE, link, delive
 MOCKABLE_FUNCTION(, int, link_send_disposition, LINK_HANDLE, link, delivery_number, message_number, AMQP_VALUE, delivery_state);
 MOCKABLE_FUNCTION(, int, link_attach, LINK_HANDLE, link, ON_TRANSFER_RECEIVED, on_transfer_received, ON_LINK_STATE_CHANGED, on_link_state_changed, ON_LINK_FLOW_ON, on_link_flow_on, void*, callback_context);
 MOCKABLE_FUNCTION(, int, link_detach, LINK_HANDLE, link, bool, close, const char*, error_condition, const char*, error_description, AMQP_VALUE, info);
+/* link_transfer_async returns NULL with link_transfer_result set to LINK_TRANSFER_OK when the delivery was already settled
+before it returned, which happens on a link that sends settled; on_delivery_settled has then already been called */
 MOCKABLE_FUNCTION(, ASYNC_OPERATION_HANDLE, link_transfer_async, LINK_HANDLE, handle, message_format, message_format, PAYLOAD*, payloads, ON_DELIVERY_SETTLED, on_delivery_settled, void*, callback_context, LINK_TRANSFER_RESULT*, link_transfer_result,tickcounter_ms_t, timeout);
 MOCKABLE_FUNCTION(, void, link_dowork, LINK_HANDLE, link);
 
@@ -53,6 +53,8 @@ extern "C" {
     MOCKABLE_FUNCTION(, int, message_set_footer, MESSAGE_HANDLE, message, annotations, footer);
     MOCKABLE_FUNCTION(, int, message_get_footer, MESSAGE_HANDLE, message, annotations*, footer);
     MOCKABLE_FUNCTION(, int, message_add_body_amqp_data, MESSAGE_HANDLE, message, BINARY_DATA, amqp_data);
+    /* the message references the bytes of amqp_data, which must outlive it; message_clone copies them */
+    MOCKABLE_FUNCTION(, int, message_add_body_amqp_data_borrowed, MESSAGE_HANDLE, message, BINARY_DATA, amqp_data);
     MOCKABLE_FUNCTION(, BINARY_DATA, message_get_body_amqp_data_in_place, MESSAGE_HANDLE, message, size_t, index);
     MOCKABLE_FUNCTION(, int, message_get_body_amqp_data_count, MESSAGE_HANDLE, message, size_t*, count);
     MOCKABLE_FUNCTION(, int, message_set_body_amqp_value, MESSAGE_HANDLE, message, AMQP_VALUE, body_amqp_value);
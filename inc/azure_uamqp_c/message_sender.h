@@ -34,15 +34,48 @@ MU_DEFINE_ENUM(MESSAGE_SEND_RESULT, MESSAGE_SEND_RESULT_VALUES)
 
 MU_DEFINE_ENUM(MESSAGE_SENDER_STATE, MESSAGE_SENDER_STATE_VALUES)
 
+#define BATCHED_MESSAGE_ADD_RESULT_VALUES \
+    BATCHED_MESSAGE_ADD_OK, \
+    BATCHED_MESSAGE_ADD_FULL, \
+    BATCHED_MESSAGE_ADD_TOO_LARGE, \
+    BATCHED_MESSAGE_ADD_ERROR
+
+MU_DEFINE_ENUM(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_RESULT_VALUES)
+
+/* Message format of a batched message: its body is one data section per inner message, each holding the encoded
+inner message. The batched message itself carries no header or properties. */
+#define MESSAGE_FORMAT_BATCHED 0x80013700
+
     typedef struct MESSAGE_SENDER_INSTANCE_TAG* MESSAGE_SENDER_HANDLE;
+    typedef struct BATCHED_MESSAGE_INSTANCE_TAG* BATCHED_MESSAGE_HANDLE;
     typedef void(*ON_MESSAGE_SEND_COMPLETE)(void* context, MESSAGE_SEND_RESULT send_result, AMQP_VALUE delivery_state);
+    /* send_results holds one result per message, in the order the messages were given, and is only valid during the call */
+    typedef void(*ON_MESSAGE_BATCH_SEND_COMPLETE)(void* context, const MESSAGE_SEND_RESULT* send_results, size_t message_count);
     typedef void(*ON_MESSAGE_SENDER_STATE_CHANGED)(void* context, MESSAGE_SENDER_STATE new_state, MESSAGE_SENDER_STATE previous_state);
 
     MOCKABLE_FUNCTION(, MESSAGE_SENDER_HANDLE, messagesender_create, LINK_HANDLE, link, ON_MESSAGE_SENDER_STATE_CHANGED, on_message_sender_state_changed, void*, context);
     MOCKABLE_FUNCTION(, void, messagesender_destroy, MESSAGE_SENDER_HANDLE, message_sender);
     MOCKABLE_FUNCTION(, int, messagesender_open, MESSAGE_SENDER_HANDLE, message_sender);
     MOCKABLE_FUNCTION(, int, messagesender_close, MESSAGE_SENDER_HANDLE, message_sender);
+    /* messagesender_send_async also returns NULL when the message was settled before it returned, which happens on a link
+    that sends settled; on_message_send_complete has then already been called with the result */
     MOCKABLE_FUNCTION(, ASYNC_OPERATION_HANDLE, messagesender_send_async, MESSAGE_SENDER_HANDLE, message_sender, MESSAGE_HANDLE, message, ON_MESSAGE_SEND_COMPLETE, on_message_send_complete, void*, callback_context, tickcounter_ms_t, timeout);
+    /* messagesender_send_batch_async also returns NULL when every message completed before it returned (all settled
+    right away, or all failed); on_message_batch_send_complete has then already been called with the results */
+    MOCKABLE_FUNCTION(, ASYNC_OPERATION_HANDLE, messagesender_send_batch_async, MESSAGE_SENDER_HANDLE, message_sender, const MESSAGE_HANDLE*, messages, size_t, message_count, ON_MESSAGE_BATCH_SEND_COMPLETE, on_message_batch_send_complete, void*, callback_context, tickcounter_ms_t, timeout);
+    /* messagesender_batched_message_add returns BATCHED_MESSAGE_ADD_FULL when the message would take the batched message
+    over the peer max message size, and BATCHED_MESSAGE_ADD_TOO_LARGE when the message alone would, its data section
+    included, whatever the batched message already holds; it returns
+    BATCHED_MESSAGE_ADD_ERROR for a data body with a callback part that has no size hint, size query or materialization,
+    and leaves the batched message as it was whenever it does not return BATCHED_MESSAGE_ADD_OK */
+    MOCKABLE_FUNCTION(, BATCHED_MESSAGE_HANDLE, messagesender_batched_message_create, MESSAGE_SENDER_HANDLE, message_sender);
+    MOCKABLE_FUNCTION(, void, messagesender_batched_message_destroy, BATCHED_MESSAGE_HANDLE, batched_message);
+    MOCKABLE_FUNCTION(, BATCHED_MESSAGE_ADD_RESULT, messagesender_batched_message_add, BATCHED_MESSAGE_HANDLE, batched_message, MESSAGE_HANDLE, message);
+    MOCKABLE_FUNCTION(, int, messagesender_batched_message_get_count, BATCHED_MESSAGE_HANDLE, batched_message, size_t*, message_count);
+    MOCKABLE_FUNCTION(, int, messagesender_batched_message_get_size, BATCHED_MESSAGE_HANDLE, batched_message, uint64_t*, encoded_size);
+    /* sending empties the batched message, so that it can be filled again for the next send; like messagesender_send_async
+    it returns NULL when the batched message was settled before it returned */
+    MOCKABLE_FUNCTION(, ASYNC_OPERATION_HANDLE, messagesender_send_batched_message_async, BATCHED_MESSAGE_HANDLE, batched_message, ON_MESSAGE_SEND_COMPLETE, on_message_send_complete, void*, callback_context, tickcounter_ms_t, timeout);
     MOCKABLE_FUNCTION(, void, messagesender_set_trace, MESSAGE_SENDER_HANDLE, message_sender, bool, traceOn);
 
 #ifdef __cplusplus
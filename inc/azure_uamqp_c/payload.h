@@ -12,14 +12,18 @@ extern "C" {
 #endif /* __cplusplus */
 
 typedef struct PAYLOAD_TAG PAYLOAD;
+typedef struct PAYLOAD_CAPTURE_POOL_TAG PAYLOAD_CAPTURE_POOL;
 typedef bool  (PAYLOAD_WRITE_FUNCTION)(void *context, const unsigned char *buffer, size_t length);
 typedef bool  (PAYLOAD_CALLBACK_FUNCTION)(void *user_context, PAYLOAD_WRITE_FUNCTION *stream_writer, void *stream_context);
+typedef size_t (PAYLOAD_SIZE_FUNCTION)(void *user_context);
 
 typedef struct {
    PAYLOAD_CALLBACK_FUNCTION *callback;
    void *user_context;
 } CALLBACK_HANDLE;
 
+PAYLOAD_CAPTURE_POOL *payload_capture_pool_create(void);   // NB: a pool is used from one thread at a time, like the payloads drawing from it; copies of those payloads never draw from it and may go to other threads
+void     payload_capture_pool_destroy(PAYLOAD_CAPTURE_POOL **pool);   // NB: segments still in use are freed when their last payload releases them
 PAYLOAD *payload_create();
 PAYLOAD* payload_create_and_reserve(size_t expected_length);
 void     payload_destroy(PAYLOAD** payload);
@@ -30,16 +34,25 @@ size_t   payload_get_spare_capacity(const PAYLOAD *payload);
 const unsigned char *payload_peek_bytes(const PAYLOAD *payload);
 size_t   payload_get_parts(const PAYLOAD *payload);
 bool     payload_stream_output(const PAYLOAD *payload, PAYLOAD_WRITE_FUNCTION *stream_writer, void *user_context);
+bool     payload_stream_output_parts(const PAYLOAD *payload, PAYLOAD_WRITE_FUNCTION *byte_array_writer, PAYLOAD_WRITE_FUNCTION *callback_writer, void *user_context);   // NB: byte_array_writer gets the parts' own bytes, valid while the payload is
 size_t   payload_stream_to_heap(const PAYLOAD* payload, unsigned char** output);
 void     payload_append_string(PAYLOAD *payload, const char *buffer);
-void     payload_append_data(PAYLOAD *payload, const unsigned char *buffer, size_t length);
+bool     payload_append_data(PAYLOAD *payload, const unsigned char *buffer, size_t length);   // NB: fails only when the bytes cannot be allocated
+void     payload_append_borrowed_data(PAYLOAD *payload, const unsigned char *buffer, size_t length);   // NB: buffer must outlive the payload, it is not copied
 bool     payload_reserve_data(PAYLOAD *payload, size_t length);
-void     payload_append_callback(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context);
+void     payload_append_callback(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context);   // NB: callback is run once to count its output and again to stream it
+void     payload_append_callback_with_size(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context, size_t size);   // NB: callback must write exactly size bytes, a connection pads shorter output with spaces and fails the frame on longer output
+void     payload_append_callback_with_size_query(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, PAYLOAD_SIZE_FUNCTION *size_callback, void *context);   // NB: size_callback is asked once, when the size is first needed, and its answer then stands like a size hint
+void     payload_append_callback_materialized(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context, PAYLOAD_CAPTURE_POOL *pool);   // NB: callback is run once, on first use, into a buffer from pool (or the heap when NULL) that then backs the part
 void     payload_append_payload_as_copy(PAYLOAD *destination, const PAYLOAD *source);
+void     payload_append_payload_as_borrowed(PAYLOAD *destination, const PAYLOAD *source);   // NB: source bytes must outlive destination
+bool     payload_append_slice_as_borrowed(PAYLOAD *destination, const PAYLOAD *source, size_t offset, size_t length);   // NB: source bytes must outlive destination, fails without appending anything if the window is out of range or covers output of a callback part that is not materialized
 void     payload_move_to_payload_end(PAYLOAD *destination, PAYLOAD **source);   // NB: source payload no longer accessible after call
 bool     payload_is_empty(const PAYLOAD *payload);
 bool     payload_is_valid(const PAYLOAD *payload);
 bool     payload_has_callback_data(const PAYLOAD *payload);
+bool     payload_has_unsized_callback_data(const PAYLOAD *payload);   // NB: true when a callback part has no size hint, size query or materialization, so each run of its producer may write a different number of bytes
+bool     payload_has_borrowed_data(const PAYLOAD *payload);
 bool     payload_are_equal(const PAYLOAD *payload1, const PAYLOAD *payload2);
 
 #ifdef __cplusplus
@@ -18,6 +18,8 @@ typedef struct
    unsigned char* bytes;
    uint32_t size;     // current size
    uint32_t capacity; // total capacity of bytes buffer
+   bool borrowed;     // bytes belong to someone else and are not freed with the payload
+   struct PAYLOAD_SEGMENT_TAG *segment; // refcounted allocation behind owned bytes, shared between copies
 } PAYLOAD_BYTE_ARRAY;
 
 typedef struct
@@ -25,6 +27,10 @@ typedef struct
    void *user_context;
    PAYLOAD_CALLBACK_FUNCTION *writer_callback;   // this callback knows how to stream output to a given writer
    size_t calculated_size;
+   bool size_hinted;                             // calculated_size was given on append, not counted from a run of writer_callback
+   PAYLOAD_SIZE_FUNCTION *size_callback;         // optional, tells the size without running writer_callback
+   bool materialize;                             // output is captured on first use and the part becomes a byte array
+   PAYLOAD_CAPTURE_POOL *capture_pool;           // optional, where a materialized part gets its capture segment
 } PAYLOAD_CALLBACK;
 
 struct PAYLOAD_TAG
@@ -69,8 +69,12 @@ MU_DEFINE_ENUM(SESSION_SEND_TRANSFER_RESULT, SESSION_SEND_TRANSFER_RESULT_VALUES
     MOCKABLE_FUNCTION(, int, session_get_incoming_window, SESSION_HANDLE, session, uint32_t*, incoming_window);
     MOCKABLE_FUNCTION(, int, session_set_outgoing_window, SESSION_HANDLE, session, uint32_t, outgoing_window);
     MOCKABLE_FUNCTION(, int, session_get_outgoing_window, SESSION_HANDLE, session, uint32_t*, outgoing_window);
+    MOCKABLE_FUNCTION(, int, session_set_max_transfer_frame_size, SESSION_HANDLE, session, uint32_t, max_transfer_frame_size);
+    MOCKABLE_FUNCTION(, int, session_get_max_transfer_frame_size, SESSION_HANDLE, session, uint32_t*, max_transfer_frame_size);
     MOCKABLE_FUNCTION(, int, session_set_handle_max, SESSION_HANDLE, session, handle, handle_max);
     MOCKABLE_FUNCTION(, int, session_get_handle_max, SESSION_HANDLE, session, handle*, handle_max);
+    MOCKABLE_FUNCTION(, TIMER_QUEUE_HANDLE, session_get_timer_queue, SESSION_HANDLE, session);
+    MOCKABLE_FUNCTION(, int, session_get_next_delivery_id, SESSION_HANDLE, session, delivery_number*, next_delivery_id);
     MOCKABLE_FUNCTION(, void, session_destroy, SESSION_HANDLE, session);
     MOCKABLE_FUNCTION(, int, session_begin, SESSION_HANDLE, session);
     MOCKABLE_FUNCTION(, int, session_end, SESSION_HANDLE, session, const char*, condition_value, const char*, description);
@@ -79,10 +83,13 @@ MU_DEFINE_ENUM(SESSION_SEND_TRANSFER_RESULT, SESSION_SEND_TRANSFER_RESULT_VALUES
     MOCKABLE_FUNCTION(, void, session_destroy_link_endpoint, LINK_ENDPOINT_HANDLE, link_endpoint);
     MOCKABLE_FUNCTION(, int, session_start_link_endpoint, LINK_ENDPOINT_HANDLE, link_endpoint, ON_ENDPOINT_FRAME_RECEIVED, frame_received_callback, ON_SESSION_STATE_CHANGED, on_session_state_changed, ON_SESSION_FLOW_ON, on_session_flow_on, void*, context);
     MOCKABLE_FUNCTION(, int, session_send_flow, LINK_ENDPOINT_HANDLE, link_endpoint, FLOW_HANDLE, flow);
+    MOCKABLE_FUNCTION(, int, session_send_link_flow, LINK_ENDPOINT_HANDLE, link_endpoint, sequence_no, delivery_count, uint32_t, link_credit);
     MOCKABLE_FUNCTION(, int, session_send_attach, LINK_ENDPOINT_HANDLE, link_endpoint, ATTACH_HANDLE, attach);
     MOCKABLE_FUNCTION(, int, session_send_disposition, LINK_ENDPOINT_HANDLE, link_endpoint, DISPOSITION_HANDLE, disposition);
+    MOCKABLE_FUNCTION(, int, session_send_link_disposition, LINK_ENDPOINT_HANDLE, link_endpoint, role, role, delivery_number, first, delivery_number, last, bool, settled, AMQP_VALUE, delivery_state);
     MOCKABLE_FUNCTION(, int, session_send_detach, LINK_ENDPOINT_HANDLE, link_endpoint, DETACH_HANDLE, detach);
     MOCKABLE_FUNCTION(, SESSION_SEND_TRANSFER_RESULT, session_send_transfer, LINK_ENDPOINT_HANDLE, link_endpoint, TRANSFER_HANDLE, transfer, PAYLOAD*, payloads, delivery_number*, delivery_id, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
+    MOCKABLE_FUNCTION(, SESSION_SEND_TRANSFER_RESULT, session_send_link_transfer, LINK_ENDPOINT_HANDLE, link_endpoint, const unsigned char*, delivery_tag, size_t, delivery_tag_size, message_format, message_format, bool, settled, PAYLOAD*, payloads, delivery_number*, delivery_id, ON_SEND_COMPLETE, on_send_complete, void*, callback_context);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef TIMER_QUEUE_H
+#define TIMER_QUEUE_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#include <cstddef>
+extern "C" {
+#else
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#endif /* __cplusplus */
+
+#include "azure_c_shared_utility/tickcounter.h"
+#include "umock_c/umock_c_prod.h"
+
+typedef struct TIMER_QUEUE_INSTANCE_TAG* TIMER_QUEUE_HANDLE;
+
+typedef void(*ON_TIMER_EXPIRED)(void* context);
+
+/* A timer is embedded in whatever owns the timeout, so starting and stopping it does not allocate. The fields are
+maintained by timer_queue and are only exposed so that timers can be embedded. */
+typedef struct TIMER_TAG
+{
+    ON_TIMER_EXPIRED on_timer_expired;
+    void* context;
+    TIMER_QUEUE_HANDLE timer_queue;
+    tickcounter_ms_t deadline;
+    uint64_t sequence;
+    size_t index;
+} TIMER;
+
+MOCKABLE_FUNCTION(, TIMER_QUEUE_HANDLE, timer_queue_create, TICK_COUNTER_HANDLE, tick_counter);
+MOCKABLE_FUNCTION(, void, timer_queue_destroy, TIMER_QUEUE_HANDLE, timer_queue);
+MOCKABLE_FUNCTION(, void, timer_init, TIMER*, timer, ON_TIMER_EXPIRED, on_timer_expired, void*, context);
+MOCKABLE_FUNCTION(, int, timer_start, TIMER_QUEUE_HANDLE, timer_queue, TIMER*, timer, tickcounter_ms_t, timeout);
+MOCKABLE_FUNCTION(, void, timer_stop, TIMER*, timer);
+MOCKABLE_FUNCTION(, bool, timer_is_running, const TIMER*, timer);
+MOCKABLE_FUNCTION(, int, timer_queue_dowork, TIMER_QUEUE_HANDLE, timer_queue);
+MOCKABLE_FUNCTION(, int, timer_queue_get_time_to_next_deadline, TIMER_QUEUE_HANDLE, timer_queue, tickcounter_ms_t*, time_to_next_deadline);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* TIMER_QUEUE_H */
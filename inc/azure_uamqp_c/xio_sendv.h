@@ -0,0 +1,40 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef XIO_SENDV_H
+#define XIO_SENDV_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C" {
+#else
+#include <stddef.h>
+#endif /* __cplusplus */
+
+/* Option through which an xio advertises scatter/gather sends (writev on sockets, a single record built from
+several buffers on TLS). The value passed to xio_setoption is an XIO_SENDV_QUERY that the xio fills in; an xio that
+does not know the option fails xio_setoption and its users keep sending with xio_send. Most ios log unknown options
+as errors, so a connection only asks once connection_set_gathered_send turns gathered sends on. */
+#define OPTION_XIO_SENDV "xio_sendv"
+
+typedef struct XIO_SEND_BUFFER_TAG
+{
+    const unsigned char* buffer;
+    size_t size;
+} XIO_SEND_BUFFER;
+
+/* Sends the buffers in order as one contiguous byte stream. Like xio_send, the buffers only need to be valid for
+the duration of the call. Returns 0 on success. */
+typedef int(*XIO_SENDV)(void* sendv_context, const XIO_SEND_BUFFER* buffers, size_t buffer_count);
+
+typedef struct XIO_SENDV_QUERY_TAG
+{
+    XIO_SENDV sendv;
+    void* sendv_context;
+} XIO_SENDV_QUERY;
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* XIO_SENDV_H */
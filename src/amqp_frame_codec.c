@@ -12,6 +12,9 @@
 #include "azure_uamqp_c/frame_codec.h"
 #include "azure_uamqp_c/amqpvalue.h"
 
+/* large enough for any performative without big properties maps, so a steady stream of frames reuses one chunk */
+#define PERFORMATIVE_ARENA_CHUNK_SIZE 1024
+
 typedef enum AMQP_FRAME_DECODE_STATE_TAG
 {
     AMQP_FRAME_DECODE_FRAME,
@@ -27,33 +30,10 @@ typedef struct AMQP_FRAME_CODEC_TAG
     AMQP_EMPTY_FRAME_RECEIVED_CALLBACK empty_frame_received_callback;
     AMQP_FRAME_CODEC_ERROR_CALLBACK error_callback;
     void* callback_context;
-    AMQPVALUE_DECODER_HANDLE decoder;
     AMQP_FRAME_DECODE_STATE decode_state;
-    AMQP_VALUE decoded_performative;
+    AMQPVALUE_ARENA_HANDLE performative_arena;
 } AMQP_FRAME_CODEC;
 
-static void amqp_value_decoded(void* context, AMQP_VALUE decoded_value)
-{
-    AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = (AMQP_FRAME_CODEC_HANDLE)context;
-    uint64_t performative_descriptor_ulong;
-    AMQP_VALUE descriptor = amqpvalue_get_inplace_descriptor(decoded_value);
-
-    /* Codes_SRS_AMQP_FRAME_CODEC_01_060: [If any error occurs while decoding a frame, the decoder shall switch to an error state where decoding shall not be possible anymore.] */
-    if ((descriptor == NULL) ||
-        (amqpvalue_get_ulong(descriptor, &performative_descriptor_ulong) != 0) ||
-        /* Codes_SRS_AMQP_FRAME_CODEC_01_003: [The performative MUST be one of those defined in section 2.7 and is encoded as a described type in the AMQP type system.] */
-        (performative_descriptor_ulong < AMQP_OPEN) ||
-        (performative_descriptor_ulong > AMQP_CLOSE))
-    {
-        /* Codes_SRS_AMQP_FRAME_CODEC_01_060: [If any error occurs while decoding a frame, the decoder shall switch to an error state where decoding shall not be possible anymore.] */
-        amqp_frame_codec->decode_state = AMQP_FRAME_DECODE_ERROR;
-    }
-    else
-    {
-        amqp_frame_codec->decoded_performative = decoded_value;
-    }
-}
-
 static void frame_received(void* context, const unsigned char* type_specific, uint32_t type_specific_size, const unsigned char* frame_body, uint32_t frame_body_size)
 {
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = (AMQP_FRAME_CODEC_HANDLE)context;
@@ -91,37 +71,48 @@ static void frame_received(void* context, const unsigned char* type_specific, ui
             {
                 /* Codes_SRS_AMQP_FRAME_CODEC_01_051: [If the frame payload is greater than 0, amqp_frame_codec shall decode the performative as a described AMQP type.] */
                 /* Codes_SRS_AMQP_FRAME_CODEC_01_002: [The frame body is defined as a performative followed by an opaque payload.] */
-                amqp_frame_codec->decoded_performative = NULL;
+                AMQP_VALUE performative;
+                size_t used_bytes;
 
-                while ((frame_body_size > 0) &&
-                       (amqp_frame_codec->decoded_performative == NULL) &&
-                       (amqp_frame_codec->decode_state != AMQP_FRAME_DECODE_ERROR))
+                /* Codes_SRS_AMQP_FRAME_CODEC_01_052: [Decoding the performative shall be done by calling amqpvalue_decode_buffer_in_arena with the performative arena and the frame body bytes.] */
+                if (amqpvalue_decode_buffer_in_arena(amqp_frame_codec->performative_arena, frame_body, frame_body_size, false, &performative, &used_bytes) != 0)
                 {
-                    /* Codes_SRS_AMQP_FRAME_CODEC_01_052: [Decoding the performative shall be done by feeding the bytes to the decoder create in amqp_frame_codec_create.] */
-                    if (amqpvalue_decode_bytes(amqp_frame_codec->decoder, frame_body, 1) != 0)
+                    /* Codes_SRS_AMQP_FRAME_CODEC_01_060: [If any error occurs while decoding a frame, the decoder shall switch to an error state where decoding shall not be possible anymore.] */
+                    LogError("Cannot decode performative");
+                    amqp_frame_codec->decode_state = AMQP_FRAME_DECODE_ERROR;
+
+                    /* Codes_SRS_AMQP_FRAME_CODEC_01_069: [If any error occurs while decoding a frame, the decoder shall indicate the error by calling the amqp_frame_codec_error_callback  and passing to it the callback context argument that was given in amqp_frame_codec_create.] */
+                    amqp_frame_codec->error_callback(amqp_frame_codec->callback_context);
+                }
+                else
+                {
+                    uint64_t performative_descriptor_ulong;
+                    AMQP_VALUE descriptor = amqpvalue_get_inplace_descriptor(performative);
+
+                    /* Codes_SRS_AMQP_FRAME_CODEC_01_060: [If any error occurs while decoding a frame, the decoder shall switch to an error state where decoding shall not be possible anymore.] */
+                    if ((descriptor == NULL) ||
+                        (amqpvalue_get_ulong(descriptor, &performative_descriptor_ulong) != 0) ||
+                        /* Codes_SRS_AMQP_FRAME_CODEC_01_003: [The performative MUST be one of those defined in section 2.7 and is encoded as a described type in the AMQP type system.] */
+                        (performative_descriptor_ulong < AMQP_OPEN) ||
+                        (performative_descriptor_ulong > AMQP_CLOSE))
                     {
-                        /* Codes_SRS_AMQP_FRAME_CODEC_01_060: [If any error occurs while decoding a frame, the decoder shall switch to an error state where decoding shall not be possible anymore.] */
+                        LogError("Invalid performative descriptor");
                         amqp_frame_codec->decode_state = AMQP_FRAME_DECODE_ERROR;
+
+                        /* Codes_SRS_AMQP_FRAME_CODEC_01_069: [If any error occurs while decoding a frame, the decoder shall indicate the error by calling the amqp_frame_codec_error_callback  and passing to it the callback context argument that was given in amqp_frame_codec_create.] */
+                        amqp_frame_codec->error_callback(amqp_frame_codec->callback_context);
                     }
                     else
                     {
-                        frame_body_size--;
-                        frame_body++;
+                        /* Codes_SRS_AMQP_FRAME_CODEC_01_004: [The remaining bytes in the frame body form the payload for that frame.] */
+                        /* Codes_SRS_AMQP_FRAME_CODEC_01_067: [When the performative is decoded, the rest of the frame_bytes shall not be given to the AMQP decoder, but they shall be buffered so that later they are given to the frame_received callback.] */
+                        /* Codes_SRS_AMQP_FRAME_CODEC_01_054: [Once the performative is decoded and all frame payload bytes are received, the callback frame_received_callback shall be called.] */
+                        /* Codes_SRS_AMQP_FRAME_CODEC_01_068: [A pointer to all the payload bytes shall also be passed to frame_received_callback.] */
+                        amqp_frame_codec->frame_received_callback(amqp_frame_codec->callback_context, channel, performative, frame_body + used_bytes, frame_body_size - (uint32_t)used_bytes);
                     }
-                }
 
-                if (amqp_frame_codec->decode_state == AMQP_FRAME_DECODE_ERROR)
-                {
-                    /* Codes_SRS_AMQP_FRAME_CODEC_01_069: [If any error occurs while decoding a frame, the decoder shall indicate the error by calling the amqp_frame_codec_error_callback  and passing to it the callback context argument that was given in amqp_frame_codec_create.] */
-                    amqp_frame_codec->error_callback(amqp_frame_codec->callback_context);
-                }
-                else
-                {
-                    /* Codes_SRS_AMQP_FRAME_CODEC_01_004: [The remaining bytes in the frame body form the payload for that frame.] */
-                    /* Codes_SRS_AMQP_FRAME_CODEC_01_067: [When the performative is decoded, the rest of the frame_bytes shall not be given to the AMQP decoder, but they shall be buffered so that later they are given to the frame_received callback.] */
-                    /* Codes_SRS_AMQP_FRAME_CODEC_01_054: [Once the performative is decoded and all frame payload bytes are received, the callback frame_received_callback shall be called.] */
-                    /* Codes_SRS_AMQP_FRAME_CODEC_01_068: [A pointer to all the payload bytes shall also be passed to frame_received_callback.] */
-                    amqp_frame_codec->frame_received_callback(amqp_frame_codec->callback_context, channel, amqp_frame_codec->decoded_performative, frame_body, frame_body_size);
+                    /* Codes_SRS_AMQP_FRAME_CODEC_01_071: [The decoded performative shall be destroyed once frame_received_callback returns.] */
+                    amqpvalue_destroy(performative);
                 }
             }
         }
@@ -129,13 +120,6 @@ static void frame_received(void* context, const unsigned char* type_specific, ui
     }
 }
 
-static int encode_bytes(void* context, PAYLOAD* to_append)
-{
-    PAYLOAD* payload = (PAYLOAD*)context;
-    payload_append_payload_as_copy(payload, to_append);
-    return 0;
-}
-
 /* Codes_SRS_AMQP_FRAME_CODEC_01_011: [amqp_frame_codec_create shall create an instance of an amqp_frame_codec and return a non-NULL handle to it.] */
 AMQP_FRAME_CODEC_HANDLE amqp_frame_codec_create(FRAME_CODEC_HANDLE frame_codec, AMQP_FRAME_RECEIVED_CALLBACK frame_received_callback,
     AMQP_EMPTY_FRAME_RECEIVED_CALLBACK empty_frame_received_callback, AMQP_FRAME_CODEC_ERROR_CALLBACK amqp_frame_codec_error_callback, void* callback_context)
@@ -169,26 +153,23 @@ AMQP_FRAME_CODEC_HANDLE amqp_frame_codec_create(FRAME_CODEC_HANDLE frame_codec,
             result->callback_context = callback_context;
             result->decode_state = AMQP_FRAME_DECODE_FRAME;
 
-            /* Codes_SRS_AMQP_FRAME_CODEC_01_018: [amqp_frame_codec_create shall create a decoder to be used for decoding AMQP values.] */
-            result->decoder = amqpvalue_decoder_create(amqp_value_decoded, result);
-            if (result->decoder == NULL)
+            /* Codes_SRS_AMQP_FRAME_CODEC_01_072: [amqp_frame_codec_create shall create an arena for decoded performatives by calling amqpvalue_arena_create.] */
+            result->performative_arena = amqpvalue_arena_create(PERFORMATIVE_ARENA_CHUNK_SIZE);
+            if (result->performative_arena == NULL)
             {
-                /* Codes_SRS_AMQP_FRAME_CODEC_01_019: [If creating the decoder fails, amqp_frame_codec_create shall fail and return NULL.] */
-                LogError("Could not create AMQP decoder");
+                /* Codes_SRS_AMQP_FRAME_CODEC_01_073: [If creating the arena fails, amqp_frame_codec_create shall fail and return NULL.] */
+                LogError("Could not create performative arena");
                 free(result);
                 result = NULL;
             }
-            else
+            /* Codes_SRS_AMQP_FRAME_CODEC_01_013: [amqp_frame_codec_create shall subscribe for AMQP frames with the given frame_codec.] */
+            else if (frame_codec_subscribe(frame_codec, FRAME_TYPE_AMQP, frame_received, result) != 0)
             {
-                /* Codes_SRS_AMQP_FRAME_CODEC_01_013: [amqp_frame_codec_create shall subscribe for AMQP frames with the given frame_codec.] */
-                if (frame_codec_subscribe(frame_codec, FRAME_TYPE_AMQP, frame_received, result) != 0)
-                {
-                    /* Codes_SRS_AMQP_FRAME_CODEC_01_014: [If subscribing for AMQP frames fails, amqp_frame_codec_create shall fail and return NULL.] */
-                    LogError("Could not subscribe for received AMQP frames");
-                    amqpvalue_decoder_destroy(result->decoder);
-                    free(result);
-                    result = NULL;
-                }
+                /* Codes_SRS_AMQP_FRAME_CODEC_01_014: [If subscribing for AMQP frames fails, amqp_frame_codec_create shall fail and return NULL.] */
+                LogError("Could not subscribe for received AMQP frames");
+                amqpvalue_arena_destroy(result->performative_arena);
+                free(result);
+                result = NULL;
             }
         }
     }
@@ -208,14 +189,45 @@ void amqp_frame_codec_destroy(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec)
         /* Codes_SRS_AMQP_FRAME_CODEC_01_017: [amqp_frame_codec_destroy shall unsubscribe from receiving AMQP frames from the frame_codec that was passed to amqp_frame_codec_create.] */
         (void)frame_codec_unsubscribe(amqp_frame_codec->frame_codec, FRAME_TYPE_AMQP);
 
-        /* Codes_SRS_AMQP_FRAME_CODEC_01_021: [The decoder created in amqp_frame_codec_create shall be destroyed by amqp_frame_codec_destroy.] */
-        amqpvalue_decoder_destroy(amqp_frame_codec->decoder);
+        /* Codes_SRS_AMQP_FRAME_CODEC_01_074: [amqp_frame_codec_destroy shall destroy the performative arena by calling amqpvalue_arena_destroy.] */
+        amqpvalue_arena_destroy(amqp_frame_codec->performative_arena);
 
         /* Codes_SRS_AMQP_FRAME_CODEC_01_015: [amqp_frame_codec_destroy shall free all resources associated with the amqp_frame_codec instance.] */
         free(amqp_frame_codec);
     }
 }
 
+/* appends payloads to the encoded performative in frame_body and hands the whole frame to frame_codec */
+static int encode_frame_body(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint16_t channel, PAYLOAD* frame_body, PAYLOAD* payloads, ON_BYTES_ENCODED on_bytes_encoded, void* callback_context)
+{
+    int result;
+    unsigned char channel_bytes[2];
+
+    channel_bytes[0] = channel >> 8;
+    channel_bytes[1] = channel & 0xFF;
+
+    /* Codes_SRS_AMQP_FRAME_CODEC_01_070: [The payloads argument for frame_codec_encode_frame shall be made of the payload for the encoded performative and the payloads passed to amqp_frame_codec_encode_frame.] */
+    /* frame_body is destroyed once the frame has been encoded, so the payloads can be referenced */
+    payload_append_payload_as_borrowed(frame_body, payloads);
+
+    /* Codes_SRS_AMQP_FRAME_CODEC_01_005: [Bytes 6 and 7 of an AMQP frame contain the channel number ] */
+    /* Codes_SRS_AMQP_FRAME_CODEC_01_025: [amqp_frame_codec_encode_frame shall encode the frame header by using frame_codec_encode_frame.] */
+    /* Codes_SRS_AMQP_FRAME_CODEC_01_006: [The frame body is defined as a performative followed by an opaque payload.] */
+    if (frame_codec_encode_frame(amqp_frame_codec->frame_codec, FRAME_TYPE_AMQP, frame_body, channel_bytes, sizeof(channel_bytes), on_bytes_encoded, callback_context) != 0)
+    {
+        /* Codes_SRS_AMQP_FRAME_CODEC_01_029: [If any error occurs during encoding, amqp_frame_codec_encode_frame shall fail and return a non-zero value.] */
+        LogError("frame_codec_encode_frame failed");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_SRS_AMQP_FRAME_CODEC_01_022: [amqp_frame_codec_begin_encode_frame shall encode the frame header and AMQP performative in an AMQP frame and on success it shall return 0.] */
+        result = 0;
+    }
+
+    return result;
+}
+
 int amqp_frame_codec_encode_frame(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint16_t channel, AMQP_VALUE performative, PAYLOAD* payloads, ON_BYTES_ENCODED on_bytes_encoded, void* callback_context)
 {
     int result;
@@ -233,7 +245,6 @@ int amqp_frame_codec_encode_frame(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint
     {
         AMQP_VALUE descriptor;
         uint64_t performative_ulong;
-        size_t encoded_size;
 
         if ((descriptor = amqpvalue_get_inplace_descriptor(performative)) == NULL)
         {
@@ -256,13 +267,6 @@ int amqp_frame_codec_encode_frame(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint
                 amqp_frame_codec, performative, on_bytes_encoded);
             result = MU_FAILURE;
         }
-        /* Codes_SRS_AMQP_FRAME_CODEC_01_027: [The encoded size of the performative and its fields shall be obtained by calling amqpvalue_get_encoded_size.] */
-        else if (amqpvalue_get_encoded_size(performative, &encoded_size) != 0)
-        {
-            /* Codes_SRS_AMQP_FRAME_CODEC_01_029: [If any error occurs during encoding, amqp_frame_codec_encode_frame shall fail and return a non-zero value.] */
-            LogError("Getting the encoded size failed");
-            result = MU_FAILURE;
-        }
         else
         {
                 PAYLOAD* new_payloads = payload_create();
@@ -275,37 +279,15 @@ int amqp_frame_codec_encode_frame(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint
                 {
                     /* Codes_SRS_AMQP_FRAME_CODEC_01_070: [The payloads argument for frame_codec_encode_frame shall be made of the payload for the encoded performative and the payloads passed to amqp_frame_codec_encode_frame.] */
                     /* Codes_SRS_AMQP_FRAME_CODEC_01_028: [The encode result for the performative shall be placed in a PAYLOAD structure.] */
-                    payload_reserve_data(new_payloads, encoded_size);
-
-                    if (amqpvalue_encode(performative, encode_bytes, new_payloads) != 0)
+                    /* Codes_SRS_AMQP_FRAME_CODEC_01_027: [The performative and its fields shall be encoded into that PAYLOAD by calling amqpvalue_encode_to_payload, which reserves the encoded size of the performative before writing it.] */
+                    if (amqpvalue_encode_to_payload(performative, new_payloads) != 0)
                     {
-                        LogError("amqpvalue_encode failed");
+                        LogError("amqpvalue_encode_to_payload failed");
                         result = MU_FAILURE;
                     }
                     else
                     {
-                        unsigned char channel_bytes[2];
-
-                        channel_bytes[0] = channel >> 8;
-                        channel_bytes[1] = channel & 0xFF;
-
-                        /* Codes_SRS_AMQP_FRAME_CODEC_01_070: [The payloads argument for frame_codec_encode_frame shall be made of the payload for the encoded performative and the payloads passed to amqp_frame_codec_encode_frame.] */
-                        payload_append_payload_as_copy(new_payloads, payloads);
-
-                        /* Codes_SRS_AMQP_FRAME_CODEC_01_005: [Bytes 6 and 7 of an AMQP frame contain the channel number ] */
-                        /* Codes_SRS_AMQP_FRAME_CODEC_01_025: [amqp_frame_codec_encode_frame shall encode the frame header by using frame_codec_encode_frame.] */
-                        /* Codes_SRS_AMQP_FRAME_CODEC_01_006: [The frame body is defined as a performative followed by an opaque payload.] */
-                        if (frame_codec_encode_frame(amqp_frame_codec->frame_codec, FRAME_TYPE_AMQP, new_payloads, channel_bytes, sizeof(channel_bytes), on_bytes_encoded, callback_context) != 0)
-                        {
-                            /* Codes_SRS_AMQP_FRAME_CODEC_01_029: [If any error occurs during encoding, amqp_frame_codec_encode_frame shall fail and return a non-zero value.] */
-                            LogError("frame_codec_encode_frame failed");
-                            result = MU_FAILURE;
-                        }
-                        else
-                        {
-                            /* Codes_SRS_AMQP_FRAME_CODEC_01_022: [amqp_frame_codec_begin_encode_frame shall encode the frame header and AMQP performative in an AMQP frame and on success it shall return 0.] */
-                            result = 0;
-                        }
+                        result = encode_frame_body(amqp_frame_codec, channel, new_payloads, payloads, on_bytes_encoded, callback_context);
                     }
 
                 }
@@ -317,6 +299,51 @@ int amqp_frame_codec_encode_frame(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint
     return result;
 }
 
+int amqp_frame_codec_encode_frame_bytes(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint16_t channel, const unsigned char* performative_bytes, size_t performative_size, PAYLOAD* payloads, ON_BYTES_ENCODED on_bytes_encoded, void* callback_context)
+{
+    int result;
+
+    /* Codes_SRS_AMQP_FRAME_CODEC_01_075: [If amqp_frame_codec, performative_bytes or on_bytes_encoded is NULL, amqp_frame_codec_encode_frame_bytes shall fail and return a non-zero value.] */
+    if ((amqp_frame_codec == NULL) ||
+        (performative_bytes == NULL) ||
+        (on_bytes_encoded == NULL))
+    {
+        LogError("Bad arguments: amqp_frame_codec = %p, performative_bytes = %p, on_bytes_encoded = %p",
+            amqp_frame_codec, performative_bytes, on_bytes_encoded);
+        result = MU_FAILURE;
+    }
+    /* Codes_SRS_AMQP_FRAME_CODEC_01_076: [If performative_bytes does not start with the small ulong descriptor of one of the performatives defined in section 2.7, amqp_frame_codec_encode_frame_bytes shall fail and return a non-zero value.] */
+    else if ((performative_size < 3) ||
+        (performative_bytes[0] != 0x00) ||
+        (performative_bytes[1] != 0x53) ||
+        (performative_bytes[2] < AMQP_OPEN) ||
+        (performative_bytes[2] > AMQP_CLOSE))
+    {
+        LogError("Bytes do not hold an encoded performative");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        PAYLOAD* new_payloads = payload_create();
+        if (new_payloads == NULL)
+        {
+            /* Codes_SRS_AMQP_FRAME_CODEC_01_078: [If any other error occurs, amqp_frame_codec_encode_frame_bytes shall fail and return a non-zero value.] */
+            LogError("Could not allocate frame payloads");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQP_FRAME_CODEC_01_077: [amqp_frame_codec_encode_frame_bytes shall encode a frame whose body is performative_bytes followed by payloads, without decoding or copying performative_bytes before frame_codec_encode_frame copies the frame.] */
+            payload_append_borrowed_data(new_payloads, performative_bytes, performative_size);
+            result = encode_frame_body(amqp_frame_codec, channel, new_payloads, payloads, on_bytes_encoded, callback_context);
+
+            payload_destroy(&new_payloads);
+        }
+    }
+
+    return result;
+}
+
 /* Codes_SRS_AMQP_FRAME_CODEC_01_042: [amqp_frame_codec_encode_empty_frame shall encode a frame with no payload.] */
 /* Codes_SRS_AMQP_FRAME_CODEC_01_010: [An AMQP frame with no body MAY be used to generate artificial traffic as needed to satisfy any negotiated idle timeout interval ] */
 int amqp_frame_codec_encode_empty_frame(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint16_t channel, ON_BYTES_ENCODED on_bytes_encoded, void* callback_context)
@@ -5,6 +5,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "azure_macro_utils/macro_utils.h"
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/xlogging.h"
@@ -15,22 +16,26 @@
 // max alloc size 100MB
 #define MAX_AMQPVALUE_MALLOC_SIZE_BYTES (100 * 1024 * 1024) 
 #define MAX_AMQPVALUE_ITEM_COUNT 65536
+#define MAX_AMQPVALUE_DECODE_DEPTH 64
 
 /* Requirements satisfied by the current implementation without any code:
 Codes_SRS_AMQPVALUE_01_270: [<encoding code="0x56" category="fixed" width="1" label="boolean with the octet 0x00 being false and octet 0x01 being true"/>]
 Codes_SRS_AMQPVALUE_01_099: [Represents an approximate point in time using the Unix time t [IEEE1003] encoding of UTC, but with a precision of milliseconds.]
 */
 
+/* capacity is the number of allocated items once a list, array or map has grown; decoded and cloned values hold exactly count items and leave it 0 */
 typedef struct AMQP_LIST_VALUE_TAG
 {
     AMQP_VALUE* items;
     uint32_t count;
+    uint32_t capacity;
 } AMQP_LIST_VALUE;
 
 typedef struct AMQP_ARRAY_VALUE_TAG
 {
     AMQP_VALUE* items;
     uint32_t count;
+    uint32_t capacity;
 } AMQP_ARRAY_VALUE;
 
 typedef struct AMQP_MAP_KEY_VALUE_PAIR_TAG
@@ -39,10 +44,19 @@ typedef struct AMQP_MAP_KEY_VALUE_PAIR_TAG
     AMQP_VALUE value;
 } AMQP_MAP_KEY_VALUE_PAIR;
 
+/* open addressed hash index over the keys of a map; each slot holds a pair index + 1, 0 marks an empty slot */
+typedef struct AMQP_MAP_INDEX_TAG
+{
+    uint32_t* slots;
+    uint32_t slot_count;
+} AMQP_MAP_INDEX;
+
 typedef struct AMQP_MAP_VALUE_TAG
 {
     AMQP_MAP_KEY_VALUE_PAIR* pairs;
     uint32_t pair_count;
+    uint32_t pair_capacity;
+    AMQP_MAP_INDEX* index;
 } AMQP_MAP_VALUE;
 
 typedef struct AMQP_STRING_VALUE_TAG
@@ -167,10 +181,248 @@ typedef struct AMQP_VALUE_DATA_TAG
 {
     AMQP_TYPE type;
     AMQP_VALUE_UNION value;
+    /* the value or one of its items references bytes it does not own (see amqpvalue_decode_buffer_borrowed) */
+    bool borrowed;
+    /* the value itself, and the items or pairs of a list, map or array value, were allocated from an arena */
+    bool in_arena;
+    bool arena_items;
 } AMQP_VALUE_DATA;
 
 DEFINE_REFCOUNT_TYPE(AMQP_VALUE_DATA);
 
+/* An arena hands out memory from chunks. Every allocation is preceded by a pointer to its chunk, and a chunk counts
+its live allocations plus one reference held by the arena while the chunk is current. Values decoded in an arena can be
+cloned and destroyed on any thread, so the count is updated atomically: when only the arena's reference is left the
+chunk is reused from its start, and whoever drops the last reference frees it. */
+typedef struct AMQPVALUE_ARENA_CHUNK_TAG
+{
+    size_t size;
+    size_t used;
+    COUNT_TYPE live_count;
+} AMQPVALUE_ARENA_CHUNK;
+
+typedef struct AMQPVALUE_ARENA_HANDLE_DATA_TAG
+{
+    AMQPVALUE_ARENA_CHUNK* current_chunk;
+    size_t chunk_size;
+} AMQPVALUE_ARENA_HANDLE_DATA;
+
+#define ARENA_ALIGNMENT 8
+#define ARENA_ALIGN(size) (((size) + (ARENA_ALIGNMENT - 1)) & ~((size_t)ARENA_ALIGNMENT - 1))
+#define ARENA_CHUNK_HEADER_SIZE ARENA_ALIGN(sizeof(AMQPVALUE_ARENA_CHUNK))
+#define ARENA_ALLOCATION_HEADER_SIZE ARENA_ALIGN(sizeof(AMQPVALUE_ARENA_CHUNK*))
+
+/* the chunk starts with one reference, owned by the arena or, for a chunk of its own, by its single allocation */
+static AMQPVALUE_ARENA_CHUNK* arena_chunk_create(size_t size)
+{
+    AMQPVALUE_ARENA_CHUNK* result = (AMQPVALUE_ARENA_CHUNK*)malloc(ARENA_CHUNK_HEADER_SIZE + size);
+    if (result == NULL)
+    {
+        LogError("Could not allocate arena chunk of %lu bytes", (unsigned long)size);
+    }
+    else
+    {
+        result->size = size;
+        result->used = 0;
+        INIT_REF_VAR(result->live_count);
+    }
+
+    return result;
+}
+
+static void arena_chunk_release(AMQPVALUE_ARENA_CHUNK* chunk)
+{
+    if (DEC_REF_VAR(chunk->live_count) == DEC_RETURN_ZERO)
+    {
+        free(chunk);
+    }
+}
+
+static void arena_detach_current_chunk(AMQPVALUE_ARENA_HANDLE_DATA* arena)
+{
+    AMQPVALUE_ARENA_CHUNK* chunk = arena->current_chunk;
+    if (chunk != NULL)
+    {
+        /* values still allocated from the chunk keep it alive */
+        arena->current_chunk = NULL;
+        arena_chunk_release(chunk);
+    }
+}
+
+static void* arena_allocate(AMQPVALUE_ARENA_HANDLE_DATA* arena, size_t size)
+{
+    void* result;
+    size_t needed = ARENA_ALLOCATION_HEADER_SIZE + ARENA_ALIGN(size);
+    AMQPVALUE_ARENA_CHUNK* chunk = arena->current_chunk;
+    bool own_chunk = false;
+
+    /* only the arena's thread adds references to its current chunk, so once the arena holds the last one nothing can
+    take a new one while the chunk is rewound */
+    if ((chunk != NULL) && (chunk->live_count == 1))
+    {
+        chunk->used = 0;
+    }
+
+    if ((chunk == NULL) || (chunk->size - chunk->used < needed))
+    {
+        if (needed > arena->chunk_size)
+        {
+            /* does not fit any chunk, it gets a chunk of its own that goes away with it */
+            chunk = arena_chunk_create(needed);
+            own_chunk = true;
+        }
+        else
+        {
+            arena_detach_current_chunk(arena);
+            chunk = arena_chunk_create(arena->chunk_size);
+            arena->current_chunk = chunk;
+        }
+    }
+
+    if (chunk == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        unsigned char* allocation = (unsigned char*)chunk + ARENA_CHUNK_HEADER_SIZE + chunk->used;
+        *(AMQPVALUE_ARENA_CHUNK**)allocation = chunk;
+        chunk->used += needed;
+        if (!own_chunk)
+        {
+            (void)INC_REF_VAR(chunk->live_count);
+        }
+
+        result = allocation + ARENA_ALLOCATION_HEADER_SIZE;
+    }
+
+    return result;
+}
+
+static void arena_release(void* allocation)
+{
+    arena_chunk_release(*(AMQPVALUE_ARENA_CHUNK**)((unsigned char*)allocation - ARENA_ALLOCATION_HEADER_SIZE));
+}
+
+static AMQP_VALUE_DATA* create_value_data(void)
+{
+    AMQP_VALUE_DATA* result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    if (result != NULL)
+    {
+        result->borrowed = false;
+        result->in_arena = false;
+        result->arena_items = false;
+    }
+
+    return result;
+}
+
+static AMQP_VALUE_DATA* create_value_data_in_arena(AMQPVALUE_ARENA_HANDLE_DATA* arena)
+{
+    AMQP_VALUE_DATA* result;
+    REFCOUNT_TYPE(AMQP_VALUE_DATA)* ref_counted = (REFCOUNT_TYPE(AMQP_VALUE_DATA)*)arena_allocate(arena, sizeof(REFCOUNT_TYPE(AMQP_VALUE_DATA)));
+    if (ref_counted == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = &ref_counted->counted;
+        INIT_REF(AMQP_VALUE_DATA, result);
+        result->borrowed = false;
+        result->in_arena = true;
+        result->arena_items = false;
+    }
+
+    return result;
+}
+
+static void destroy_value_data(AMQP_VALUE_DATA* value_data)
+{
+    if (value_data->in_arena)
+    {
+        arena_release((unsigned char*)value_data - offsetof(REFCOUNT_TYPE(AMQP_VALUE_DATA), counted));
+    }
+    else
+    {
+        REFCOUNT_TYPE_DESTROY(AMQP_VALUE_DATA, value_data);
+    }
+}
+
+static void free_items(AMQP_VALUE_DATA* value_data, void* items)
+{
+    if (value_data->arena_items)
+    {
+        arena_release(items);
+        value_data->arena_items = false;
+    }
+    else
+    {
+        free(items);
+    }
+}
+
+/* items allocated from an arena cannot be handed to realloc, they move to the heap the first time the value grows */
+static void* realloc_items(AMQP_VALUE_DATA* value_data, void* items, size_t items_size, size_t new_size)
+{
+    void* result;
+
+    if (!value_data->arena_items)
+    {
+        result = realloc(items, new_size);
+    }
+    else
+    {
+        result = malloc(new_size);
+        if (result != NULL)
+        {
+            (void)memcpy(result, items, (items_size < new_size) ? items_size : new_size);
+            arena_release(items);
+            value_data->arena_items = false;
+        }
+    }
+
+    return result;
+}
+
+/* returns the items of a list, array or map grown to hold at least required_count items, or NULL if growing them fails;
+unless exact is set the capacity at least doubles, so that appending one item at a time does not reallocate on every append */
+static void* reserve_items(AMQP_VALUE_DATA* value_data, void* items, uint32_t count, uint32_t* capacity, uint32_t required_count, size_t item_size, bool exact)
+{
+    void* result;
+    uint32_t current_capacity = (*capacity < count) ? count : *capacity;
+
+    if (required_count <= current_capacity)
+    {
+        result = items;
+    }
+    else
+    {
+        uint32_t new_capacity = required_count;
+
+        if ((!exact) && (current_capacity > required_count / 2))
+        {
+            new_capacity = (current_capacity > UINT32_MAX / 2) ? UINT32_MAX : current_capacity * 2;
+        }
+
+        if (new_capacity > SIZE_MAX / item_size)
+        {
+            LogError("Cannot allocate %u items", (unsigned int)new_capacity);
+            result = NULL;
+        }
+        else
+        {
+            result = realloc_items(value_data, items, count * item_size, new_capacity * item_size);
+            if (result != NULL)
+            {
+                *capacity = new_capacity;
+            }
+        }
+    }
+
+    return result;
+}
+
 typedef enum DECODER_STATE_TAG
 {
     DECODER_STATE_CONSTRUCTOR,
@@ -201,13 +453,29 @@ typedef struct AMQPVALUE_DECODER_HANDLE_DATA_TAG
     AMQP_VALUE_DATA* decode_to_value;
 } AMQPVALUE_DECODER_HANDLE_DATA;
 
-static int amqpvalue_encode_array_item(AMQP_VALUE item, bool first_element, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context);
-static int amqpvalue_get_encoded_array_item_size(AMQP_VALUE item, size_t* encoded_size);
+/* amqpvalue_encode first sizes the whole value in one bottom-up pass, recording the content size of every list, map
+and array in pre-order, and then writes the bytes in a second pass that consumes the recorded sizes in the same order.
+The sizes of the first few compound values are kept inline so that encoding a performative does not allocate. */
+#define ENCODED_SIZE_CACHE_INLINE_COUNT 16
+
+typedef struct ENCODED_SIZE_CACHE_TAG
+{
+    uint32_t* sizes;
+    size_t count;
+    size_t capacity;
+    size_t next;
+    /* bytes of binary values produced by payload callbacks, which are linked rather than copied when encoding to a payload */
+    size_t callback_size;
+    uint32_t inline_sizes[ENCODED_SIZE_CACHE_INLINE_COUNT];
+} ENCODED_SIZE_CACHE;
+
+static int encode_value(AMQP_VALUE value, ENCODED_SIZE_CACHE* size_cache, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context);
+static int amqpvalue_encode_array_item(AMQP_VALUE item, bool first_element, ENCODED_SIZE_CACHE* size_cache, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context);
 
 /* Codes_SRS_AMQPVALUE_01_003: [1.6.1 null Indicates an empty value.] */
 AMQP_VALUE amqpvalue_create_null(void)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_002: [If allocating the AMQP_VALUE fails then amqpvalue_create_null shall return NULL.] */
@@ -225,7 +493,7 @@ AMQP_VALUE amqpvalue_create_null(void)
 /* Codes_SRS_AMQPVALUE_01_004: [1.6.2 boolean Represents a true or false value.] */
 AMQP_VALUE amqpvalue_create_boolean(bool value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_007: [If allocating the AMQP_VALUE fails then amqpvalue_create_boolean shall return NULL.] */
@@ -278,7 +546,7 @@ int amqpvalue_get_boolean(AMQP_VALUE value, bool* bool_value)
 /* Codes_SRS_AMQPVALUE_01_005: [1.6.3 ubyte Integer in the range 0 to 28 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_ubyte(unsigned char value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result != NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_032: [amqpvalue_create_ubyte shall return a handle to an AMQP_VALUE that stores a unsigned char value.] */
@@ -326,7 +594,7 @@ int amqpvalue_get_ubyte(AMQP_VALUE value, unsigned char* ubyte_value)
 /* Codes_SRS_AMQPVALUE_01_012: [1.6.4 ushort Integer in the range 0 to 216 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_ushort(uint16_t value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_039: [If allocating the AMQP_VALUE fails then amqpvalue_create_ushort shall return NULL.] */
@@ -379,7 +647,7 @@ int amqpvalue_get_ushort(AMQP_VALUE value, uint16_t* ushort_value)
 /* Codes_SRS_AMQPVALUE_01_013: [1.6.5 uint Integer in the range 0 to 232 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_uint(uint32_t value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_045: [If allocating the AMQP_VALUE fails then amqpvalue_create_uint shall return NULL.] */
@@ -432,7 +700,7 @@ int amqpvalue_get_uint(AMQP_VALUE value, uint32_t* uint_value)
 /* Codes_SRS_AMQPVALUE_01_014: [1.6.6 ulong Integer in the range 0 to 264 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_ulong(uint64_t value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_050: [If allocating the AMQP_VALUE fails then amqpvalue_create_ulong shall return NULL.] */
@@ -485,7 +753,7 @@ int amqpvalue_get_ulong(AMQP_VALUE value, uint64_t* ulong_value)
 /* Codes_SRS_AMQPVALUE_01_015: [1.6.7 byte Integer in the range -(27) to 27 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_byte(char value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_056: [If allocating the AMQP_VALUE fails then amqpvalue_create_byte shall return NULL.] */
@@ -538,7 +806,7 @@ int amqpvalue_get_byte(AMQP_VALUE value, char* byte_value)
 /* Codes_SRS_AMQPVALUE_01_016: [1.6.8 short Integer in the range -(215) to 215 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_short(int16_t value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_062: [If allocating the AMQP_VALUE fails then amqpvalue_create_short shall return NULL.] */
@@ -590,7 +858,7 @@ int amqpvalue_get_short(AMQP_VALUE value, int16_t* short_value)
 /* Codes_SRS_AMQPVALUE_01_017: [1.6.9 int Integer in the range -(231) to 231 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_int(int32_t value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_068: [If allocating the AMQP_VALUE fails then amqpvalue_create_int shall return NULL.] */
@@ -643,7 +911,7 @@ int amqpvalue_get_int(AMQP_VALUE value, int32_t* int_value)
 /* Codes_SRS_AMQPVALUE_01_018: [1.6.10 long Integer in the range -(263) to 263 - 1 inclusive.] */
 AMQP_VALUE amqpvalue_create_long(int64_t value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_074: [If allocating the AMQP_VALUE fails then amqpvalue_create_long shall return NULL.] */
@@ -696,7 +964,7 @@ int amqpvalue_get_long(AMQP_VALUE value, int64_t* long_value)
 /* Codes_SRS_AMQPVALUE_01_019: [1.6.11 float 32-bit floating point number (IEEE 754-2008 binary32).]  */
 AMQP_VALUE amqpvalue_create_float(float value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_081: [If allocating the AMQP_VALUE fails then amqpvalue_create_float shall return NULL.] */
@@ -749,7 +1017,7 @@ int amqpvalue_get_float(AMQP_VALUE value, float* float_value)
 /* Codes_SRS_AMQPVALUE_01_020: [1.6.12 double 64-bit floating point number (IEEE 754-2008 binary64).] */
 AMQP_VALUE amqpvalue_create_double(double value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_087: [If allocating the AMQP_VALUE fails then amqpvalue_create_double shall return NULL.] */
@@ -812,7 +1080,7 @@ AMQP_VALUE amqpvalue_create_char(uint32_t value)
     }
     else
     {
-        result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+        result = create_value_data();
         if (result == NULL)
         {
             /* Codes_SRS_AMQPVALUE_01_093: [If allocating the AMQP_VALUE fails then amqpvalue_create_char shall return NULL.] */
@@ -866,7 +1134,7 @@ int amqpvalue_get_char(AMQP_VALUE value, uint32_t* char_value)
 /* Codes_SRS_AMQPVALUE_01_025: [1.6.17 timestamp An absolute point in time.] */
 AMQP_VALUE amqpvalue_create_timestamp(int64_t value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_108: [If allocating the AMQP_VALUE fails then amqpvalue_create_timestamp shall return NULL.] */
@@ -919,7 +1187,7 @@ int amqpvalue_get_timestamp(AMQP_VALUE value, int64_t* timestamp_value)
 /* Codes_SRS_AMQPVALUE_01_026: [1.6.18 uuid A universally unique identifier as defined by RFC-4122 section 4.1.2 .] */
 AMQP_VALUE amqpvalue_create_uuid(uuid value)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_114: [If allocating the AMQP_VALUE fails then amqpvalue_create_uuid shall return NULL.] */
@@ -981,7 +1249,7 @@ AMQP_VALUE amqpvalue_create_binary(amqp_binary value)
     }
     else
     {
-        result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+        result = create_value_data();
         if (result == NULL)
         {
             /* Codes_SRS_AMQPVALUE_01_128: [If allocating the AMQP_VALUE fails then amqpvalue_create_binary shall return NULL.] */
@@ -1030,6 +1298,39 @@ int amqpvalue_get_binary(AMQP_VALUE value, amqp_binary binary_value)
     return result;
 }
 
+int amqpvalue_get_binary_borrowed(AMQP_VALUE value, amqp_binary binary_value)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_446: [If any of the arguments is NULL then amqpvalue_get_binary_borrowed shall fail and return a non-zero value.] */
+    if ((value == NULL) ||
+        (binary_value == NULL))
+    {
+        LogError("Bad arguments: value = %p, binary_value = %p",
+            value, binary_value);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
+        /* Codes_SRS_AMQPVALUE_01_447: [If the type of the value is not binary, then amqpvalue_get_binary_borrowed shall fail and return a non-zero value.] */
+        if (value_data->type != AMQP_TYPE_BINARY)
+        {
+            LogError("Value is not of type BINARY");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_448: [amqpvalue_get_binary_borrowed shall append to binary_value a reference to the bytes held by the AMQP value, without copying them.] */
+            payload_append_payload_as_borrowed(binary_value, value_data->value.binary_value);
+
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
 /* Codes_SRS_AMQPVALUE_01_135: [amqpvalue_create_string shall return a handle to an AMQP_VALUE that stores a sequence of Unicode characters.] */
 /* Codes_SRS_AMQPVALUE_01_028: [1.6.20 string A sequence of Unicode characters.] */
 AMQP_VALUE amqpvalue_create_string(const char* value)
@@ -1044,7 +1345,7 @@ AMQP_VALUE amqpvalue_create_string(const char* value)
     {
         size_t length = strlen(value);
 
-        result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+        result = create_value_data();
         if (result == NULL)
         {
             /* Codes_SRS_AMQPVALUE_01_136: [If allocating the AMQP_VALUE fails then amqpvalue_create_string shall return NULL.] */
@@ -1128,7 +1429,7 @@ AMQP_VALUE amqpvalue_create_symbol(const char* value)
         else
         {
             /* Codes_SRS_AMQPVALUE_01_143: [If allocating the AMQP_VALUE fails then amqpvalue_create_symbol shall return NULL.] */
-            result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+            result = create_value_data();
             if (result == NULL)
             {
                 LogError("Cannot allocate memory for AMQP value");
@@ -1194,7 +1495,7 @@ int amqpvalue_get_symbol(AMQP_VALUE value, const char** symbol_value)
 /* Codes_SRS_AMQPVALUE_01_030: [1.6.22 list A sequence of polymorphic values.] */
 AMQP_VALUE amqpvalue_create_list(void)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_150: [If allocating the AMQP_VALUE fails then amqpvalue_create_list shall return NULL.] */
@@ -1207,12 +1508,60 @@ AMQP_VALUE amqpvalue_create_list(void)
 
         /* Codes_SRS_AMQPVALUE_01_151: [The list shall have an initial size of zero.] */
         result->value.list_value.count = 0;
+        result->value.list_value.capacity = 0;
         result->value.list_value.items = NULL;
     }
 
     return result;
 }
 
+int amqpvalue_reserve_list(AMQP_VALUE value, uint32_t capacity)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_464: [If value is NULL or is not a list, amqpvalue_reserve_list shall fail and return a non-zero value.] */
+    if (value == NULL)
+    {
+        LogError("NULL list value");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
+        if (value_data->type != AMQP_TYPE_LIST)
+        {
+            /* Codes_SRS_AMQPVALUE_01_464: [If value is NULL or is not a list, amqpvalue_reserve_list shall fail and return a non-zero value.] */
+            LogError("Value is not of type LIST");
+            result = MU_FAILURE;
+        }
+        else if (capacity == 0)
+        {
+            /* Codes_SRS_AMQPVALUE_01_466: [On success amqpvalue_reserve_list shall return 0.] */
+            result = 0;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_463: [amqpvalue_reserve_list shall allocate storage for at least capacity items, without changing the items already in the list.] */
+            AMQP_VALUE* new_items = (AMQP_VALUE*)reserve_items(value_data, value_data->value.list_value.items, value_data->value.list_value.count, &value_data->value.list_value.capacity, capacity, sizeof(AMQP_VALUE), true);
+            if (new_items == NULL)
+            {
+                /* Codes_SRS_AMQPVALUE_01_465: [If allocating memory fails, amqpvalue_reserve_list shall fail and return a non-zero value, leaving the list unaltered.] */
+                LogError("Could not reserve list storage");
+                result = MU_FAILURE;
+            }
+            else
+            {
+                value_data->value.list_value.items = new_items;
+
+                /* Codes_SRS_AMQPVALUE_01_466: [On success amqpvalue_reserve_list shall return 0.] */
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
 int amqpvalue_set_list_item_count(AMQP_VALUE value, uint32_t list_size)
 {
     int result;
@@ -1239,7 +1588,7 @@ int amqpvalue_set_list_item_count(AMQP_VALUE value, uint32_t list_size)
                 AMQP_VALUE* new_list;
 
                 /* Codes_SRS_AMQPVALUE_01_152: [amqpvalue_set_list_item_count shall resize an AMQP list.] */
-                new_list = (AMQP_VALUE*)realloc(value_data->value.list_value.items, list_size * sizeof(AMQP_VALUE));
+                new_list = (AMQP_VALUE*)reserve_items(value_data, value_data->value.list_value.items, value_data->value.list_value.count, &value_data->value.list_value.capacity, list_size, sizeof(AMQP_VALUE), false);
                 if (new_list == NULL)
                 {
                     /* Codes_SRS_AMQPVALUE_01_154: [If allocating memory for the list according to the new size fails, then amqpvalue_set_list_item_count shall return a non-zero value, while preserving the existing list contents.] */
@@ -1292,6 +1641,12 @@ int amqpvalue_set_list_item_count(AMQP_VALUE value, uint32_t list_size)
                     amqpvalue_destroy(value_data->value.list_value.items[i]);
                 }
 
+                /* the items stay allocated for the list to grow back into */
+                if (value_data->value.list_value.capacity < value_data->value.list_value.count)
+                {
+                    value_data->value.list_value.capacity = value_data->value.list_value.count;
+                }
+
                 value_data->value.list_value.count = list_size;
 
                 /* Codes_SRS_AMQPVALUE_01_153: [On success amqpvalue_set_list_item_count shall return 0.] */
@@ -1376,7 +1731,7 @@ int amqpvalue_set_list_item(AMQP_VALUE value, uint32_t index, AMQP_VALUE list_it
             {
                 if (index >= value_data->value.list_value.count)
                 {
-                    AMQP_VALUE* new_list = (AMQP_VALUE*)realloc(value_data->value.list_value.items, (index + 1) * sizeof(AMQP_VALUE));
+                    AMQP_VALUE* new_list = (AMQP_VALUE*)reserve_items(value_data, value_data->value.list_value.items, value_data->value.list_value.count, &value_data->value.list_value.capacity, index + 1, sizeof(AMQP_VALUE), false);
                     if (new_list == NULL)
                     {
                         /* Codes_SRS_AMQPVALUE_01_170: [When amqpvalue_set_list_item fails due to not being able to clone the item or grow the list, the list shall not be altered.] */
@@ -1480,76 +1835,334 @@ AMQP_VALUE amqpvalue_get_list_item(AMQP_VALUE value, size_t index)
     return result;
 }
 
-/* Codes_SRS_AMQPVALUE_01_178: [amqpvalue_create_map shall create an AMQP value that holds a map and return a handle to it.] */
-/* Codes_SRS_AMQPVALUE_01_031: [1.6.23 map A polymorphic mapping from distinct keys to values.] */
-AMQP_VALUE amqpvalue_create_map(void)
+/* maps with more pairs than this get a hash index, built by the first lookup or insert that needs it */
+#define MAP_INDEX_MIN_PAIR_COUNT 8
+#define MAP_INDEX_MIN_SLOT_COUNT 32
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+static uint32_t hash_bytes(uint32_t hash, const void* bytes, size_t length)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
-    if (result == NULL)
-    {
-        /* Codes_SRS_AMQPVALUE_01_179: [If allocating memory for the map fails, then amqpvalue_create_map shall return NULL.] */
-        LogError("Could not allocate memory for AMQP value");
-    }
-    else
-    {
-        result->type = AMQP_TYPE_MAP;
+    const unsigned char* current = (const unsigned char*)bytes;
+    size_t i;
 
-        /* Codes_SRS_AMQPVALUE_01_180: [The number of key/value pairs in the newly created map shall be zero.] */
-        result->value.map_value.pairs = NULL;
-        result->value.map_value.pair_count = 0;
+    for (i = 0; i < length; i++)
+    {
+        hash = (hash ^ current[i]) * FNV_PRIME;
     }
 
-    return result;
+    return hash;
 }
 
-int amqpvalue_set_map_value(AMQP_VALUE map, AMQP_VALUE key, AMQP_VALUE value)
+/* values that amqpvalue_are_equal considers equal hash the same */
+static uint32_t hash_map_key(AMQP_VALUE_DATA* key)
 {
-    int result;
+    unsigned char type = (unsigned char)key->type;
+    uint32_t hash = hash_bytes(FNV_OFFSET_BASIS, &type, sizeof(type));
 
-    /* Codes_SRS_AMQPVALUE_01_183: [If any of the arguments are NULL, amqpvalue_set_map_value shall fail and return a non-zero value.] */
-    if ((map == NULL) ||
-        (key == NULL) ||
-        (value == NULL))
-    {
-        LogError("Bad arguments: map = %p, key = %p, value = %p",
-            map, key, value);
-        result = MU_FAILURE;
-    }
-    else
+    switch (key->type)
     {
-        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)map;
+    default:
+        break;
 
-        /* Codes_SRS_AMQPVALUE_01_196: [If the map argument is not an AMQP value created with the amqpvalue_create_map function than amqpvalue_set_map_value shall fail and return a non-zero value.] */
-        if (value_data->type != AMQP_TYPE_MAP)
+    case AMQP_TYPE_BOOL:
+    {
+        unsigned char bool_value = key->value.bool_value ? 1 : 0;
+        hash = hash_bytes(hash, &bool_value, sizeof(bool_value));
+        break;
+    }
+    case AMQP_TYPE_UBYTE:
+        hash = hash_bytes(hash, &key->value.ubyte_value, sizeof(key->value.ubyte_value));
+        break;
+    case AMQP_TYPE_USHORT:
+        hash = hash_bytes(hash, &key->value.ushort_value, sizeof(key->value.ushort_value));
+        break;
+    case AMQP_TYPE_UINT:
+        hash = hash_bytes(hash, &key->value.uint_value, sizeof(key->value.uint_value));
+        break;
+    case AMQP_TYPE_ULONG:
+        hash = hash_bytes(hash, &key->value.ulong_value, sizeof(key->value.ulong_value));
+        break;
+    case AMQP_TYPE_BYTE:
+        hash = hash_bytes(hash, &key->value.byte_value, sizeof(key->value.byte_value));
+        break;
+    case AMQP_TYPE_SHORT:
+        hash = hash_bytes(hash, &key->value.short_value, sizeof(key->value.short_value));
+        break;
+    case AMQP_TYPE_INT:
+        hash = hash_bytes(hash, &key->value.int_value, sizeof(key->value.int_value));
+        break;
+    case AMQP_TYPE_LONG:
+        hash = hash_bytes(hash, &key->value.long_value, sizeof(key->value.long_value));
+        break;
+    case AMQP_TYPE_FLOAT:
+        /* 0.0 and -0.0 compare equal */
+        if (key->value.float_value != 0)
         {
-            LogError("Value is not of type MAP");
-            result = MU_FAILURE;
+            hash = hash_bytes(hash, &key->value.float_value, sizeof(key->value.float_value));
         }
-        else
+        break;
+    case AMQP_TYPE_DOUBLE:
+        if (key->value.double_value != 0)
         {
-            AMQP_VALUE cloned_value;
-
-            /* Codes_SRS_AMQPVALUE_01_185: [When storing the key or value, their contents shall be cloned.] */
-            cloned_value = amqpvalue_clone(value);
-            if (cloned_value == NULL)
-            {
-                /* Codes_SRS_AMQPVALUE_01_188: [If cloning the value fails, amqpvalue_set_map_value shall fail and return a non-zero value.] */
-                LogError("Could not clone value to set in the map");
-                result = MU_FAILURE;
+            hash = hash_bytes(hash, &key->value.double_value, sizeof(key->value.double_value));
+        }
+        break;
+    case AMQP_TYPE_CHAR:
+        hash = hash_bytes(hash, &key->value.char_value, sizeof(key->value.char_value));
+        break;
+    case AMQP_TYPE_TIMESTAMP:
+        hash = hash_bytes(hash, &key->value.timestamp_value, sizeof(key->value.timestamp_value));
+        break;
+    case AMQP_TYPE_UUID:
+        hash = hash_bytes(hash, key->value.uuid_value, sizeof(key->value.uuid_value));
+        break;
+    case AMQP_TYPE_BINARY:
+    {
+        size_t length = payload_get_length(key->value.binary_value);
+        hash = hash_bytes(hash, &length, sizeof(length));
+        break;
+    }
+    case AMQP_TYPE_STRING:
+        hash = hash_bytes(hash, key->value.string_value.chars, strlen(key->value.string_value.chars));
+        break;
+    case AMQP_TYPE_SYMBOL:
+        hash = hash_bytes(hash, key->value.symbol_value.chars, strlen(key->value.symbol_value.chars));
+        break;
+    case AMQP_TYPE_LIST:
+        hash = hash_bytes(hash, &key->value.list_value.count, sizeof(key->value.list_value.count));
+        break;
+    case AMQP_TYPE_ARRAY:
+        hash = hash_bytes(hash, &key->value.array_value.count, sizeof(key->value.array_value.count));
+        break;
+    case AMQP_TYPE_MAP:
+        hash = hash_bytes(hash, &key->value.map_value.pair_count, sizeof(key->value.map_value.pair_count));
+        break;
+    }
+
+    return hash;
+}
+
+static void map_index_add_pair(AMQP_MAP_VALUE* map_value, uint32_t pair_index)
+{
+    uint32_t mask = map_value->index->slot_count - 1;
+    uint32_t slot = hash_map_key((AMQP_VALUE_DATA*)map_value->pairs[pair_index].key) & mask;
+
+    while (map_value->index->slots[slot] != 0)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    map_value->index->slots[slot] = pair_index + 1;
+}
+
+static void map_index_destroy(AMQP_MAP_VALUE* map_value)
+{
+    free(map_value->index);
+    map_value->index = NULL;
+}
+
+/* sizes the index so that it stays at most half full with pair_capacity pairs */
+static int map_index_build(AMQP_MAP_VALUE* map_value, uint32_t pair_capacity)
+{
+    int result;
+    uint32_t slot_count = MAP_INDEX_MIN_SLOT_COUNT;
+
+    while ((slot_count / 2 < pair_capacity) && (slot_count <= UINT32_MAX / 4))
+    {
+        slot_count *= 2;
+    }
+
+    if (slot_count / 2 < pair_capacity)
+    {
+        LogError("Too many pairs to index: %u", (unsigned int)pair_capacity);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        AMQP_MAP_INDEX* new_index = (AMQP_MAP_INDEX*)calloc(1, sizeof(AMQP_MAP_INDEX) + (slot_count * sizeof(uint32_t)));
+        if (new_index == NULL)
+        {
+            LogError("Could not allocate memory for map index");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            uint32_t i;
+
+            map_index_destroy(map_value);
+            new_index->slots = (uint32_t*)(new_index + 1);
+            new_index->slot_count = slot_count;
+            map_value->index = new_index;
+
+            for (i = 0; i < map_value->pair_count; i++)
+            {
+                map_index_add_pair(map_value, i);
+            }
+
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+/* returns the index of the pair holding key, or pair_count if there is none */
+static uint32_t map_find_pair(AMQP_MAP_VALUE* map_value, AMQP_VALUE key)
+{
+    uint32_t result;
+
+    /* Codes_SRS_AMQPVALUE_01_460: [Once a map holds more than 8 pairs, amqpvalue_set_map_value and amqpvalue_get_map_value shall look up keys through a hash index, built the first time it is needed.] */
+    /* Codes_SRS_AMQPVALUE_01_462: [The hash index shall not change the order of the key/value pairs.] */
+    if ((map_value->index == NULL) &&
+        (map_value->pair_count > MAP_INDEX_MIN_PAIR_COUNT))
+    {
+        /* Codes_SRS_AMQPVALUE_01_461: [If allocating the hash index fails, the map shall be searched linearly.] */
+        (void)map_index_build(map_value, map_value->pair_count + 1);
+    }
+
+    if (map_value->index == NULL)
+    {
+        for (result = 0; result < map_value->pair_count; result++)
+        {
+            if (amqpvalue_are_equal(map_value->pairs[result].key, key))
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        uint32_t mask = map_value->index->slot_count - 1;
+        uint32_t slot = hash_map_key((AMQP_VALUE_DATA*)key) & mask;
+
+        result = map_value->pair_count;
+        while (map_value->index->slots[slot] != 0)
+        {
+            uint32_t pair_index = map_value->index->slots[slot] - 1;
+            if (amqpvalue_are_equal(map_value->pairs[pair_index].key, key))
+            {
+                result = pair_index;
+                break;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    return result;
+}
+
+/* Codes_SRS_AMQPVALUE_01_178: [amqpvalue_create_map shall create an AMQP value that holds a map and return a handle to it.] */
+/* Codes_SRS_AMQPVALUE_01_031: [1.6.23 map A polymorphic mapping from distinct keys to values.] */
+AMQP_VALUE amqpvalue_create_map(void)
+{
+    AMQP_VALUE result = create_value_data();
+    if (result == NULL)
+    {
+        /* Codes_SRS_AMQPVALUE_01_179: [If allocating memory for the map fails, then amqpvalue_create_map shall return NULL.] */
+        LogError("Could not allocate memory for AMQP value");
+    }
+    else
+    {
+        result->type = AMQP_TYPE_MAP;
+
+        /* Codes_SRS_AMQPVALUE_01_180: [The number of key/value pairs in the newly created map shall be zero.] */
+        result->value.map_value.pairs = NULL;
+        result->value.map_value.pair_count = 0;
+        result->value.map_value.pair_capacity = 0;
+        result->value.map_value.index = NULL;
+    }
+
+    return result;
+}
+
+int amqpvalue_reserve_map(AMQP_VALUE value, uint32_t capacity)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_468: [If value is NULL or is not a map, amqpvalue_reserve_map shall fail and return a non-zero value.] */
+    if (value == NULL)
+    {
+        LogError("NULL map value");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
+        if (value_data->type != AMQP_TYPE_MAP)
+        {
+            /* Codes_SRS_AMQPVALUE_01_468: [If value is NULL or is not a map, amqpvalue_reserve_map shall fail and return a non-zero value.] */
+            LogError("Value is not of type MAP");
+            result = MU_FAILURE;
+        }
+        else if (capacity == 0)
+        {
+            /* Codes_SRS_AMQPVALUE_01_470: [On success amqpvalue_reserve_map shall return 0.] */
+            result = 0;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_467: [amqpvalue_reserve_map shall allocate storage for at least capacity key/value pairs, without changing the key/value pairs already in the map.] */
+            AMQP_MAP_KEY_VALUE_PAIR* new_items = (AMQP_MAP_KEY_VALUE_PAIR*)reserve_items(value_data, value_data->value.map_value.pairs, value_data->value.map_value.pair_count, &value_data->value.map_value.pair_capacity, capacity, sizeof(AMQP_MAP_KEY_VALUE_PAIR), true);
+            if (new_items == NULL)
+            {
+                /* Codes_SRS_AMQPVALUE_01_469: [If allocating memory fails, amqpvalue_reserve_map shall fail and return a non-zero value, leaving the map unaltered.] */
+                LogError("Could not reserve map storage");
+                result = MU_FAILURE;
             }
             else
             {
-                uint32_t i;
-                AMQP_VALUE cloned_key;
+                value_data->value.map_value.pairs = new_items;
 
-                for (i = 0; i < value_data->value.map_value.pair_count; i++)
-                {
-                    if (amqpvalue_are_equal(value_data->value.map_value.pairs[i].key, key))
-                    {
-                        LogError("Could not allocate NULL value for map entries");
-                        break;
-                    }
-                }
+                /* Codes_SRS_AMQPVALUE_01_470: [On success amqpvalue_reserve_map shall return 0.] */
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+int amqpvalue_set_map_value(AMQP_VALUE map, AMQP_VALUE key, AMQP_VALUE value)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_183: [If any of the arguments are NULL, amqpvalue_set_map_value shall fail and return a non-zero value.] */
+    if ((map == NULL) ||
+        (key == NULL) ||
+        (value == NULL))
+    {
+        LogError("Bad arguments: map = %p, key = %p, value = %p",
+            map, key, value);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)map;
+
+        /* Codes_SRS_AMQPVALUE_01_196: [If the map argument is not an AMQP value created with the amqpvalue_create_map function than amqpvalue_set_map_value shall fail and return a non-zero value.] */
+        if (value_data->type != AMQP_TYPE_MAP)
+        {
+            LogError("Value is not of type MAP");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            AMQP_VALUE cloned_value;
+
+            /* Codes_SRS_AMQPVALUE_01_185: [When storing the key or value, their contents shall be cloned.] */
+            cloned_value = amqpvalue_clone(value);
+            if (cloned_value == NULL)
+            {
+                /* Codes_SRS_AMQPVALUE_01_188: [If cloning the value fails, amqpvalue_set_map_value shall fail and return a non-zero value.] */
+                LogError("Could not clone value to set in the map");
+                result = MU_FAILURE;
+            }
+            else
+            {
+                AMQP_VALUE cloned_key;
+                uint32_t i = map_find_pair(&value_data->value.map_value, key);
 
                 if (i < value_data->value.map_value.pair_count)
                 {
@@ -1574,7 +2187,7 @@ int amqpvalue_set_map_value(AMQP_VALUE map, AMQP_VALUE key, AMQP_VALUE value)
                     }
                     else
                     {
-                        AMQP_MAP_KEY_VALUE_PAIR* new_pairs = (AMQP_MAP_KEY_VALUE_PAIR*)realloc(value_data->value.map_value.pairs, (value_data->value.map_value.pair_count + 1) * sizeof(AMQP_MAP_KEY_VALUE_PAIR));
+                        AMQP_MAP_KEY_VALUE_PAIR* new_pairs = (AMQP_MAP_KEY_VALUE_PAIR*)reserve_items(value_data, value_data->value.map_value.pairs, value_data->value.map_value.pair_count, &value_data->value.map_value.pair_capacity, value_data->value.map_value.pair_count + 1, sizeof(AMQP_MAP_KEY_VALUE_PAIR), false);
                         if (new_pairs == NULL)
                         {
                             /* Codes_SRS_AMQPVALUE_01_186: [If allocating memory to hold a new key/value pair fails, amqpvalue_set_map_value shall fail and return a non-zero value.] */
@@ -1592,6 +2205,22 @@ int amqpvalue_set_map_value(AMQP_VALUE map, AMQP_VALUE key, AMQP_VALUE value)
                             value_data->value.map_value.pairs[value_data->value.map_value.pair_count].value = cloned_value;
                             value_data->value.map_value.pair_count++;
 
+                            if (value_data->value.map_value.index != NULL)
+                            {
+                                if (value_data->value.map_value.pair_count > value_data->value.map_value.index->slot_count / 2)
+                                {
+                                    if (map_index_build(&value_data->value.map_value, value_data->value.map_value.pair_count * 2) != 0)
+                                    {
+                                        /* Codes_SRS_AMQPVALUE_01_461: [If allocating the hash index fails, the map shall be searched linearly.] */
+                                        map_index_destroy(&value_data->value.map_value);
+                                    }
+                                }
+                                else
+                                {
+                                    map_index_add_pair(&value_data->value.map_value, value_data->value.map_value.pair_count - 1);
+                                }
+                            }
+
                             /* Codes_SRS_AMQPVALUE_01_182: [On success amqpvalue_set_map_value shall return 0.] */
                             result = 0;
                         }
@@ -1628,15 +2257,7 @@ AMQP_VALUE amqpvalue_get_map_value(AMQP_VALUE map, AMQP_VALUE key)
         }
         else
         {
-            uint32_t i;
-
-            for (i = 0; i < value_data->value.map_value.pair_count; i++)
-            {
-                if (amqpvalue_are_equal(value_data->value.map_value.pairs[i].key, key))
-                {
-                    break;
-                }
-            }
+            uint32_t i = map_find_pair(&value_data->value.map_value, key);
 
             if (i == value_data->value.map_value.pair_count)
             {
@@ -1783,7 +2404,7 @@ int amqpvalue_get_map(AMQP_VALUE value, AMQP_VALUE* map_value)
 /* Codes_SRS_AMQPVALUE_01_397: [1.6.24 array A sequence of values of a single type.] */
 AMQP_VALUE amqpvalue_create_array(void)
 {
-    AMQP_VALUE result = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE result = create_value_data();
     if (result == NULL)
     {
         /* Codes_SRS_AMQPVALUE_01_405: [ If allocating memory for the array fails, then `amqpvalue_create_array` shall return NULL. ] */
@@ -1797,6 +2418,54 @@ AMQP_VALUE amqpvalue_create_array(void)
         /* Codes_SRS_AMQPVALUE_01_406: [ The array shall have an initial size of zero. ] */
         result->value.array_value.items = NULL;
         result->value.array_value.count = 0;
+        result->value.array_value.capacity = 0;
+    }
+
+    return result;
+}
+
+int amqpvalue_reserve_array(AMQP_VALUE value, uint32_t capacity)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_472: [If value is NULL or is not an array, amqpvalue_reserve_array shall fail and return a non-zero value.] */
+    if (value == NULL)
+    {
+        LogError("NULL array value");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
+        if (value_data->type != AMQP_TYPE_ARRAY)
+        {
+            /* Codes_SRS_AMQPVALUE_01_472: [If value is NULL or is not an array, amqpvalue_reserve_array shall fail and return a non-zero value.] */
+            LogError("Value is not of type ARRAY");
+            result = MU_FAILURE;
+        }
+        else if (capacity == 0)
+        {
+            /* Codes_SRS_AMQPVALUE_01_474: [On success amqpvalue_reserve_array shall return 0.] */
+            result = 0;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_471: [amqpvalue_reserve_array shall allocate storage for at least capacity items, without changing the items already in the array.] */
+            AMQP_VALUE* new_items = (AMQP_VALUE*)reserve_items(value_data, value_data->value.array_value.items, value_data->value.array_value.count, &value_data->value.array_value.capacity, capacity, sizeof(AMQP_VALUE), true);
+            if (new_items == NULL)
+            {
+                /* Codes_SRS_AMQPVALUE_01_473: [If allocating memory fails, amqpvalue_reserve_array shall fail and return a non-zero value, leaving the array unaltered.] */
+                LogError("Could not reserve array storage");
+                result = MU_FAILURE;
+            }
+            else
+            {
+                value_data->value.array_value.items = new_items;
+
+                /* Codes_SRS_AMQPVALUE_01_474: [On success amqpvalue_reserve_array shall return 0.] */
+                result = 0;
+            }
+        }
     }
 
     return result;
@@ -1879,7 +2548,7 @@ int amqpvalue_add_array_item(AMQP_VALUE value, AMQP_VALUE array_item_value)
                 }
                 else
                 {
-                    AMQP_VALUE* new_array = (AMQP_VALUE*)realloc(value_data->value.array_value.items, (value_data->value.array_value.count + 1) * sizeof(AMQP_VALUE));
+                    AMQP_VALUE* new_array = (AMQP_VALUE*)reserve_items(value_data, value_data->value.array_value.items, value_data->value.array_value.count, &value_data->value.array_value.capacity, value_data->value.array_value.count + 1, sizeof(AMQP_VALUE), false);
                     if (new_array == NULL)
                     {
                         /* Codes_SRS_AMQPVALUE_01_423: [ When `amqpvalue_add_array_item` fails due to not being able to clone the item or grow the array, the array shall not be altered. ] */
@@ -2186,39 +2855,205 @@ bool amqpvalue_are_equal(AMQP_VALUE value1, AMQP_VALUE value2)
     return result;
 }
 
-AMQP_VALUE amqpvalue_clone(AMQP_VALUE value)
+/* copies a value that references borrowed bytes; items that do not reference borrowed bytes are shared */
+static AMQP_VALUE_DATA* clone_borrowed_value(AMQP_VALUE_DATA* value_data)
 {
-    AMQP_VALUE result;
-
-    if (value == NULL)
+    AMQP_VALUE_DATA* result = create_value_data();
+    if (result == NULL)
     {
-        /* Codes_SRS_AMQPVALUE_01_402: [ If `value` is NULL, `amqpvalue_clone` shall return NULL. ]*/
-        LogError("NULL value");
-        result = NULL;
+        LogError("Could not allocate memory for cloned value");
     }
     else
     {
-        /* Codes_SRS_AMQPVALUE_01_235: [amqpvalue_clone shall clone the value passed as argument and return a new non-NULL handle to the cloned AMQP value.] */
-        INC_REF(AMQP_VALUE_DATA, value);
-        result = value;
-    }
+        bool is_error = false;
+        uint32_t i;
 
-    return result;
-}
+        memset(result, 0, sizeof(AMQP_VALUE_DATA));
+        result->type = AMQP_TYPE_UNKNOWN;
 
-AMQP_TYPE amqpvalue_get_type(AMQP_VALUE value)
-{
-    AMQP_VALUE_DATA* amqpvalue_data = (AMQP_VALUE_DATA*)value;
-    return amqpvalue_data->type;
-}
+        switch (value_data->type)
+        {
+        default:
+            LogError("Unexpected borrowed value type %d", (int)value_data->type);
+            is_error = true;
+            break;
+
+        case AMQP_TYPE_BINARY:
+            result->value.binary_value = payload_clone(value_data->value.binary_value);
+            if (result->value.binary_value == NULL)
+            {
+                LogError("Could not copy binary value");
+                is_error = true;
+            }
+            else
+            {
+                result->type = AMQP_TYPE_BINARY;
+            }
+            break;
+
+        case AMQP_TYPE_LIST:
+        case AMQP_TYPE_ARRAY:
+        {
+            /* lists and arrays share the same layout */
+            uint32_t count = (value_data->type == AMQP_TYPE_LIST) ? value_data->value.list_value.count : value_data->value.array_value.count;
+            AMQP_VALUE* items = (value_data->type == AMQP_TYPE_LIST) ? value_data->value.list_value.items : value_data->value.array_value.items;
+            AMQP_VALUE* cloned_items = (AMQP_VALUE*)calloc(count, sizeof(AMQP_VALUE));
+            if (cloned_items == NULL)
+            {
+                LogError("Could not allocate memory for cloned items");
+                is_error = true;
+            }
+            else
+            {
+                result->type = value_data->type;
+                if (value_data->type == AMQP_TYPE_LIST)
+                {
+                    result->value.list_value.items = cloned_items;
+                    result->value.list_value.count = count;
+                    result->value.list_value.capacity = 0;
+                }
+                else
+                {
+                    result->value.array_value.items = cloned_items;
+                    result->value.array_value.count = count;
+                    result->value.array_value.capacity = 0;
+                }
+
+                for (i = 0; i < count; i++)
+                {
+                    cloned_items[i] = amqpvalue_clone(items[i]);
+                    if (cloned_items[i] == NULL)
+                    {
+                        LogError("Could not clone item %u", (unsigned int)i);
+                        is_error = true;
+                        break;
+                    }
+                }
+            }
+            break;
+        }
+
+        case AMQP_TYPE_MAP:
+            result->value.map_value.index = NULL;
+            result->value.map_value.pair_capacity = 0;
+            result->value.map_value.pairs = (AMQP_MAP_KEY_VALUE_PAIR*)calloc(value_data->value.map_value.pair_count, sizeof(AMQP_MAP_KEY_VALUE_PAIR));
+            if (result->value.map_value.pairs == NULL)
+            {
+                LogError("Could not allocate memory for cloned map pairs");
+                is_error = true;
+            }
+            else
+            {
+                result->type = AMQP_TYPE_MAP;
+                result->value.map_value.pair_count = value_data->value.map_value.pair_count;
+
+                for (i = 0; i < value_data->value.map_value.pair_count; i++)
+                {
+                    result->value.map_value.pairs[i].key = amqpvalue_clone(value_data->value.map_value.pairs[i].key);
+                    result->value.map_value.pairs[i].value = amqpvalue_clone(value_data->value.map_value.pairs[i].value);
+                    if ((result->value.map_value.pairs[i].key == NULL) ||
+                        (result->value.map_value.pairs[i].value == NULL))
+                    {
+                        LogError("Could not clone map pair %u", (unsigned int)i);
+                        is_error = true;
+                        break;
+                    }
+                }
+            }
+            break;
+
+        case AMQP_TYPE_DESCRIBED:
+        case AMQP_TYPE_COMPOSITE:
+            result->type = value_data->type;
+            result->value.described_value.descriptor = amqpvalue_clone(value_data->value.described_value.descriptor);
+            result->value.described_value.value = amqpvalue_clone(value_data->value.described_value.value);
+            if ((result->value.described_value.descriptor == NULL) ||
+                (result->value.described_value.value == NULL))
+            {
+                LogError("Could not clone described value");
+                is_error = true;
+            }
+            break;
+        }
+
+        if (is_error)
+        {
+            amqpvalue_destroy(result);
+            result = NULL;
+        }
+    }
+
+    return result;
+}
+
+AMQP_VALUE amqpvalue_clone(AMQP_VALUE value)
+{
+    AMQP_VALUE result;
+
+    if (value == NULL)
+    {
+        /* Codes_SRS_AMQPVALUE_01_402: [ If `value` is NULL, `amqpvalue_clone` shall return NULL. ]*/
+        LogError("NULL value");
+        result = NULL;
+    }
+    else if (((AMQP_VALUE_DATA*)value)->borrowed)
+    {
+        /* Codes_SRS_AMQPVALUE_01_444: [If value references bytes it does not own, amqpvalue_clone shall return a new value that holds its own copy of those bytes.] */
+        /* Codes_SRS_AMQPVALUE_01_445: [If copying the borrowed bytes fails, amqpvalue_clone shall fail and return NULL.] */
+        result = clone_borrowed_value((AMQP_VALUE_DATA*)value);
+    }
+    else
+    {
+        /* Codes_SRS_AMQPVALUE_01_235: [amqpvalue_clone shall clone the value passed as argument and return a new non-NULL handle to the cloned AMQP value.] */
+        INC_REF(AMQP_VALUE_DATA, value);
+        result = value;
+    }
+
+    return result;
+}
+
+AMQP_TYPE amqpvalue_get_type(AMQP_VALUE value)
+{
+    AMQP_VALUE_DATA* amqpvalue_data = (AMQP_VALUE_DATA*)value;
+    return amqpvalue_data->type;
+}
+
+/* Encoder output used by amqpvalue_encode_to_payload. output_byte and output_bytes recognise it and append straight to
+the destination payload, so only binary values (which are already payloads) are ever passed to it. */
+static int append_to_payload(void* context, PAYLOAD* payload)
+{
+   payload_append_payload_as_copy((PAYLOAD*)context, payload);
+   return 0;
+}
 
 static int output_to_encoder_via_payload(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, const void* bytes, size_t length)
 {
    int result = 0;
-   PAYLOAD* payload = payload_create();
-   payload_append_data(payload, (const unsigned char*)bytes, length);
-   result = encoder_output(context, payload);
-   payload_destroy(&payload);
+
+   if (encoder_output == append_to_payload)
+   {
+      /* Codes_SRS_AMQPVALUE_01_481: [amqpvalue_encode_to_payload shall append the encoded bytes to payload without creating a payload for each encoded field.] */
+      if (!payload_append_data(context, (const unsigned char*)bytes, length))
+      {
+         LogError("Cannot append encoded bytes to payload");
+         result = MU_FAILURE;
+      }
+   }
+   else
+   {
+      PAYLOAD* payload = payload_create();
+      if (!payload_append_data(payload, (const unsigned char*)bytes, length))
+      {
+         LogError("Cannot copy encoded bytes");
+         result = MU_FAILURE;
+      }
+      else
+      {
+         result = encoder_output(context, payload);
+      }
+      payload_destroy(&payload);
+   }
+
    return result;
 }
 
@@ -3661,172 +4496,344 @@ static int encode_symbol(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* conte
     return result;
 }
 
-static int encode_list_constructor(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, bool use_smallest)
+static void size_cache_init(ENCODED_SIZE_CACHE* size_cache)
+{
+    size_cache->sizes = size_cache->inline_sizes;
+    size_cache->count = 0;
+    size_cache->capacity = ENCODED_SIZE_CACHE_INLINE_COUNT;
+    size_cache->next = 0;
+    size_cache->callback_size = 0;
+}
+
+static void size_cache_deinit(ENCODED_SIZE_CACHE* size_cache)
+{
+    if (size_cache->sizes != size_cache->inline_sizes)
+    {
+        free(size_cache->sizes);
+    }
+}
+
+/* reserves the slot for a compound value before its items are sized, so that slots end up in pre-order */
+static int size_cache_add_slot(ENCODED_SIZE_CACHE* size_cache, size_t* slot)
 {
     int result;
 
-    if (use_smallest)
+    if (size_cache->count == size_cache->capacity)
     {
-        /* Codes_SRS_AMQPVALUE_01_304: [<encoding name="list8" code="0xc0" category="compound" width="1" label="up to 2^8 - 1 list elements with total size less than 2^8 octets"/>] */
-        if (output_byte(encoder_output, context, 0xC0) != 0)
+        size_t new_capacity = size_cache->capacity * 2;
+        uint32_t* new_sizes;
+
+        if (size_cache->sizes == size_cache->inline_sizes)
         {
-            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-            LogError("Failed encoding list constructor");
-            result = MU_FAILURE;
+            new_sizes = (uint32_t*)malloc(new_capacity * sizeof(uint32_t));
+            if (new_sizes != NULL)
+            {
+                (void)memcpy(new_sizes, size_cache->inline_sizes, sizeof(size_cache->inline_sizes));
+            }
         }
         else
         {
-            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-            result = 0;
+            new_sizes = (uint32_t*)realloc(size_cache->sizes, new_capacity * sizeof(uint32_t));
         }
-    }
-    else
-    {
-        /* Codes_SRS_AMQPVALUE_01_305: [<encoding name="list32" code="0xd0" category="compound" width="4" label="up to 2^32 - 1 list elements with total size less than 2^32 octets"/>] */
-        if (output_byte(encoder_output, context, 0xD0) != 0)
+
+        if (new_sizes == NULL)
         {
-            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-            LogError("Failed encoding large list constructor");
-            result = MU_FAILURE;
+            LogError("Could not grow encoded size cache to %u entries", (unsigned int)new_capacity);
         }
         else
         {
-            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-            result = 0;
+            size_cache->sizes = new_sizes;
+            size_cache->capacity = new_capacity;
         }
     }
 
+    if (size_cache->count == size_cache->capacity)
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        *slot = size_cache->count;
+        size_cache->count++;
+        result = 0;
+    }
+
     return result;
 }
 
-static int amqpvalue_get_encoded_list_size(AMQP_VALUE* items, uint32_t count, uint32_t* encoded_size)
+static uint32_t size_cache_next(ENCODED_SIZE_CACHE* size_cache)
+{
+    return size_cache->sizes[size_cache->next++];
+}
+
+static int get_value_encoded_size(AMQP_VALUE value, bool is_array_item, ENCODED_SIZE_CACHE* size_cache, size_t* encoded_size);
+
+static int add_item_encoded_size(AMQP_VALUE item, bool is_array_item, ENCODED_SIZE_CACHE* size_cache, uint32_t* content_size)
 {
     int result;
-    size_t i;
+    size_t item_size;
 
-    if (encoded_size == NULL)
+    if (get_value_encoded_size(item, is_array_item, size_cache, &item_size) != 0)
+    {
+        result = MU_FAILURE;
+    }
+    else if ((item_size > UINT32_MAX) ||
+        (*content_size + (uint32_t)item_size < *content_size))
     {
-        LogError("Bad arguments: encoded_size = %p", encoded_size);
+        LogError("Overflow in compound value size computation");
         result = MU_FAILURE;
     }
     else
     {
-        *encoded_size = 0;
+        *content_size += (uint32_t)item_size;
+        result = 0;
+    }
 
-        /* Get the size of all items in the list */
-        for (i = 0; i < count; i++)
+    return result;
+}
+
+/* Sizes a list, map or array. The content size written in the size field (the encoded items, without the size and count
+fields) is recorded in the cache unless size_cache is NULL; encoded_size receives the size of the whole encoding,
+constructor included unless it is an array item. */
+static int get_compound_encoded_size(AMQP_VALUE_DATA* value_data, bool is_array_item, ENCODED_SIZE_CACHE* size_cache, size_t* encoded_size)
+{
+    int result;
+    size_t slot = 0;
+
+    if ((size_cache != NULL) &&
+        (size_cache_add_slot(size_cache, &slot) != 0))
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        uint32_t content_size = 0;
+        uint32_t written_size;
+        uint32_t element_count;
+        uint32_t i;
+
+        result = 0;
+
+        switch (value_data->type)
         {
-            size_t item_size;
-            if (amqpvalue_get_encoded_size(items[i], &item_size) != 0)
+        default:
+        case AMQP_TYPE_LIST:
+            element_count = value_data->value.list_value.count;
+            for (i = 0; (result == 0) && (i < value_data->value.list_value.count); i++)
             {
-                LogError("Could not get encoded size for element %u of the list", (unsigned int)i);
-                break;
+                result = add_item_encoded_size(value_data->value.list_value.items[i], false, size_cache, &content_size);
             }
+            written_size = content_size;
+            break;
 
-            if ((item_size > UINT32_MAX) ||
-                *encoded_size + (uint32_t)item_size < *encoded_size)
+        case AMQP_TYPE_MAP:
+            /* Codes_SRS_AMQPVALUE_01_124: [Map encodings MUST contain an even number of items (i.e. an equal number of keys and values).] */
+            element_count = value_data->value.map_value.pair_count * 2;
+            for (i = 0; (result == 0) && (i < value_data->value.map_value.pair_count); i++)
             {
-                LogError("Overflow in list size computation");
-                break;
+                result = add_item_encoded_size(value_data->value.map_value.pairs[i].key, false, size_cache, &content_size);
+                if (result == 0)
+                {
+                    result = add_item_encoded_size(value_data->value.map_value.pairs[i].value, false, size_cache, &content_size);
+                }
+            }
+            written_size = content_size;
+            break;
+
+        case AMQP_TYPE_ARRAY:
+            element_count = value_data->value.array_value.count;
+            for (i = 0; (result == 0) && (i < value_data->value.array_value.count); i++)
+            {
+                result = add_item_encoded_size(value_data->value.array_value.items[i], true, size_cache, &content_size);
             }
 
-            *encoded_size = (uint32_t)(*encoded_size + item_size);
-        }
+            /* the element constructor is written once ahead of the first item, even when the size field leaves it out */
+            written_size = (element_count > 0) ? content_size + 1 : 0;
 
-        if (i < count)
-        {
-            result = MU_FAILURE;
+            if (content_size > element_count)
+            {
+                /* Include a single constructor byte in the size calculation where array items require a constructor. */
+                content_size++;
+            }
+            break;
         }
-        else
+
+        if (result == 0)
         {
-            result = 0;
+            if (size_cache != NULL)
+            {
+                size_cache->sizes[slot] = content_size;
+            }
+
+            if (is_array_item)
+            {
+                /* array items always use the 32 bit size and count */
+                *encoded_size = (size_t)written_size + 8;
+            }
+            else if ((value_data->type == AMQP_TYPE_LIST) && (element_count == 0))
+            {
+                /* Codes_SRS_AMQPVALUE_01_303: [<encoding name="list0" code="0x45" category="fixed" width="0" label="the empty list (i.e. the list with no elements)"/>] */
+                *encoded_size = 1;
+            }
+            else if ((element_count <= 255) && (content_size < 255))
+            {
+                *encoded_size = (size_t)written_size + 3;
+            }
+            else
+            {
+                *encoded_size = (size_t)written_size + 9;
+            }
         }
     }
+
     return result;
 }
 
-static int encode_list_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, uint32_t size, AMQP_VALUE* items, bool use_smallest)
+/* Computes the number of bytes amqpvalue_encode (or amqpvalue_encode_array_item when is_array_item is true) writes for a
+value without producing any output, and records the content sizes of its compound values in size_cache. With a NULL
+size_cache nothing is recorded and nothing is allocated. */
+static int get_value_encoded_size(AMQP_VALUE value, bool is_array_item, ENCODED_SIZE_CACHE* size_cache, size_t* encoded_size)
 {
     int result;
-    size_t i;
 
-    if (use_smallest)
+    if (value == NULL)
     {
-        size++;
-
-        /* Codes_SRS_AMQPVALUE_01_304: [<encoding name="list8" code="0xc0" category="compound" width="1" label="up to 2^8 - 1 list elements with total size less than 2^8 octets"/>] */
-        if ((output_byte(encoder_output, context, (size & 0xFF)) != 0) ||
-            (output_byte(encoder_output, context, (count & 0xFF)) != 0))
-        {
-            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-            LogError("Failed encoding list value");
-            result = MU_FAILURE;
-        }
-        else
-        {
-            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-            result = 0;
-        }
+        LogError("NULL value in compound value");
+        result = MU_FAILURE;
     }
     else
     {
-        size += 4;
+        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
+        /* the constructor byte is written once for a whole array, not for each item */
+        size_t constructor_size = is_array_item ? 0 : 1;
 
-        /* Codes_SRS_AMQPVALUE_01_305: [<encoding name="list32" code="0xd0" category="compound" width="4" label="up to 2^32 - 1 list elements with total size less than 2^32 octets"/>] */
-        if ((output_byte(encoder_output, context, (size >> 24) & 0xFF) != 0) ||
-            (output_byte(encoder_output, context, (size >> 16) & 0xFF) != 0) ||
-            (output_byte(encoder_output, context, (size >> 8) & 0xFF) != 0) ||
-            (output_byte(encoder_output, context, size & 0xFF) != 0) ||
-            (output_byte(encoder_output, context, (count >> 24) & 0xFF) != 0) ||
-            (output_byte(encoder_output, context, (count >> 16) & 0xFF) != 0) ||
-            (output_byte(encoder_output, context, (count >> 8) & 0xFF) != 0) ||
-            (output_byte(encoder_output, context, count & 0xFF) != 0))
+        result = 0;
+
+        switch (value_data->type)
         {
-            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-            LogError("Failed encoding large list value");
+        default:
+            /* Codes_SRS_AMQPVALUE_01_271: [If encoding fails due to any error not specifically mentioned here, it shall return a non-zero value.] */
+            LogError("Invalid type: %d", (int)value_data->type);
             result = MU_FAILURE;
-        }
-        else
-        {
-            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-            result = 0;
-        }
-    }
+            break;
 
-    if (result == 0)
-    {
-        for (i = 0; i < count; i++)
-        {
-            if (amqpvalue_encode(items[i], encoder_output, context) != 0)
-            {
-                break;
+        case AMQP_TYPE_NULL:
+            *encoded_size = constructor_size;
+            break;
+
+        case AMQP_TYPE_BOOL:
+        case AMQP_TYPE_UBYTE:
+        case AMQP_TYPE_BYTE:
+            /* true and false have their own constructors, array items need the 0x56 value byte */
+            *encoded_size = ((value_data->type == AMQP_TYPE_BOOL) && !is_array_item) ? 1 : constructor_size + 1;
+            break;
+
+        case AMQP_TYPE_USHORT:
+        case AMQP_TYPE_SHORT:
+            *encoded_size = constructor_size + 2;
+            break;
+
+        case AMQP_TYPE_UINT:
+            *encoded_size = is_array_item ? 4 :
+                (value_data->value.uint_value == 0) ? 1 :
+                (value_data->value.uint_value <= 255) ? 2 : 5;
+            break;
+
+        case AMQP_TYPE_ULONG:
+            *encoded_size = is_array_item ? 8 :
+                (value_data->value.ulong_value == 0) ? 1 :
+                (value_data->value.ulong_value <= 255) ? 2 : 9;
+            break;
+
+        case AMQP_TYPE_INT:
+            *encoded_size = is_array_item ? 4 :
+                ((value_data->value.int_value <= 127) && (value_data->value.int_value >= -128)) ? 2 : 5;
+            break;
+
+        case AMQP_TYPE_LONG:
+            *encoded_size = is_array_item ? 8 :
+                ((value_data->value.long_value <= 127) && (value_data->value.long_value >= -128)) ? 2 : 9;
+            break;
+
+        case AMQP_TYPE_FLOAT:
+            *encoded_size = constructor_size + 4;
+            break;
+
+        case AMQP_TYPE_DOUBLE:
+        case AMQP_TYPE_TIMESTAMP:
+            *encoded_size = constructor_size + 8;
+            break;
+
+        case AMQP_TYPE_UUID:
+            *encoded_size = constructor_size + 16;
+            break;
+
+        case AMQP_TYPE_BINARY:
+        case AMQP_TYPE_STRING:
+        case AMQP_TYPE_SYMBOL:
+        {
+            size_t length = (value_data->type == AMQP_TYPE_BINARY) ? payload_get_length(value_data->value.binary_value) :
+                (value_data->type == AMQP_TYPE_STRING) ? strlen(value_data->value.string_value.chars) :
+                strlen(value_data->value.symbol_value.chars);
+
+            /* vbin8/str8/sym8 carry a 1 byte length, vbin32/str32/sym32 (always used in arrays) a 4 byte one */
+            *encoded_size = ((!is_array_item) && (length <= 255)) ? (1 + 1 + length) : (constructor_size + 4 + length);
+
+            if ((size_cache != NULL) &&
+                (value_data->type == AMQP_TYPE_BINARY) &&
+                payload_has_callback_data(value_data->value.binary_value))
+            {
+                size_cache->callback_size += length;
             }
+            break;
         }
 
-        if (i < count)
+        case AMQP_TYPE_LIST:
+        case AMQP_TYPE_MAP:
+        case AMQP_TYPE_ARRAY:
+            result = get_compound_encoded_size(value_data, is_array_item, size_cache, encoded_size);
+            break;
+
+        case AMQP_TYPE_COMPOSITE:
+        case AMQP_TYPE_DESCRIBED:
         {
-            LogError("Failed encoding element %u of the list", (unsigned int)i);
-            result = MU_FAILURE;
+            size_t descriptor_size;
+            size_t described_value_size;
+
+            if (is_array_item)
+            {
+                LogError("Unsupported array type: %d", (int)value_data->type);
+                result = MU_FAILURE;
+            }
+            else if ((get_value_encoded_size(value_data->value.described_value.descriptor, false, size_cache, &descriptor_size) != 0) ||
+                (get_value_encoded_size(value_data->value.described_value.value, false, size_cache, &described_value_size) != 0))
+            {
+                LogError("Failed sizing described or composite type");
+                result = MU_FAILURE;
+            }
+            else
+            {
+                *encoded_size = 1 + descriptor_size + described_value_size;
+            }
+            break;
         }
-        else
-        {
-            result = 0;
         }
     }
+
     return result;
 }
 
-static int encode_list(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, AMQP_VALUE* items)
+static int encode_list_constructor(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, bool use_smallest)
 {
     int result;
 
-    if (count == 0)
+    if (use_smallest)
     {
-        /* Codes_SRS_AMQPVALUE_01_303: [<encoding name="list0" code="0x45" category="fixed" width="0" label="the empty list (i.e. the list with no elements)"/>] */
-        if (output_byte(encoder_output, context, 0x45) != 0)
+        /* Codes_SRS_AMQPVALUE_01_304: [<encoding name="list8" code="0xc0" category="compound" width="1" label="up to 2^8 - 1 list elements with total size less than 2^8 octets"/>] */
+        if (output_byte(encoder_output, context, 0xC0) != 0)
         {
             /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-            LogError("Could not output list constructor byte");
+            LogError("Failed encoding list constructor");
             result = MU_FAILURE;
         }
         else
@@ -3837,64 +4844,38 @@ static int encode_list(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context
     }
     else
     {
-        uint32_t size;
-
-        if (amqpvalue_get_encoded_list_size(items, count, &size) != 0)
+        /* Codes_SRS_AMQPVALUE_01_305: [<encoding name="list32" code="0xd0" category="compound" width="4" label="up to 2^32 - 1 list elements with total size less than 2^32 octets"/>] */
+        if (output_byte(encoder_output, context, 0xD0) != 0)
         {
             /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Failed encoding large list constructor");
             result = MU_FAILURE;
         }
         else
         {
-            if ((count <= 255) && (size < 255))
-            {
-                /* Codes_SRS_AMQPVALUE_01_304: [<encoding name="list8" code="0xc0" category="compound" width="1" label="up to 2^8 - 1 list elements with total size less than 2^8 octets"/>] */
-                if ((encode_list_constructor(encoder_output, context, true) != 0) ||
-                    (encode_list_value(encoder_output, context, count, size, items, true) != 0))
-                {
-                    /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-                    LogError("Failed encoding small list");
-                    result = MU_FAILURE;
-                }
-                else
-                {
-                    /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-                    result = 0;
-                }
-            }
-            else
-            {
-                /* Codes_SRS_AMQPVALUE_01_305: [<encoding name="list32" code="0xd0" category="compound" width="4" label="up to 2^32 - 1 list elements with total size less than 2^32 octets"/>] */
-                if ((encode_list_constructor(encoder_output, context, false) != 0) ||
-                    (encode_list_value(encoder_output, context, count, size, items, false) != 0))
-                {
-                    /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-                    LogError("Failed encoding large list");
-                    result = MU_FAILURE;
-                }
-                else
-                {
-                    /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-                    result = 0;
-                }
-            }
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
         }
     }
 
     return result;
 }
 
-static int encode_map_constructor(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, bool use_smallest)
+static int encode_list_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, uint32_t size, AMQP_VALUE* items, bool use_smallest, ENCODED_SIZE_CACHE* size_cache)
 {
     int result;
+    size_t i;
 
     if (use_smallest)
     {
-        /* Codes_SRS_AMQPVALUE_01_306: [<encoding name="map8" code="0xc1" category="compound" width="1" label="up to 2^8 - 1 octets of encoded map data"/>] */
-        if (output_byte(encoder_output, context, 0xC1) != 0)
+        size++;
+
+        /* Codes_SRS_AMQPVALUE_01_304: [<encoding name="list8" code="0xc0" category="compound" width="1" label="up to 2^8 - 1 list elements with total size less than 2^8 octets"/>] */
+        if ((output_byte(encoder_output, context, (size & 0xFF)) != 0) ||
+            (output_byte(encoder_output, context, (count & 0xFF)) != 0))
         {
             /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-            LogError("Could not encode small map constructor");
+            LogError("Failed encoding list value");
             result = MU_FAILURE;
         }
         else
@@ -3905,11 +4886,20 @@ static int encode_map_constructor(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLO
     }
     else
     {
-        /* Codes_SRS_AMQPVALUE_01_307: [<encoding name="map32" code="0xd1" category="compound" width="4" label="up to 2^32 - 1 octets of encoded map data"/>] */
-        if (output_byte(encoder_output, context, 0xD1) != 0)
+        size += 4;
+
+        /* Codes_SRS_AMQPVALUE_01_305: [<encoding name="list32" code="0xd0" category="compound" width="4" label="up to 2^32 - 1 list elements with total size less than 2^32 octets"/>] */
+        if ((output_byte(encoder_output, context, (size >> 24) & 0xFF) != 0) ||
+            (output_byte(encoder_output, context, (size >> 16) & 0xFF) != 0) ||
+            (output_byte(encoder_output, context, (size >> 8) & 0xFF) != 0) ||
+            (output_byte(encoder_output, context, size & 0xFF) != 0) ||
+            (output_byte(encoder_output, context, (count >> 24) & 0xFF) != 0) ||
+            (output_byte(encoder_output, context, (count >> 16) & 0xFF) != 0) ||
+            (output_byte(encoder_output, context, (count >> 8) & 0xFF) != 0) ||
+            (output_byte(encoder_output, context, count & 0xFF) != 0))
         {
             /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-            LogError("Could not encode large map constructor");
+            LogError("Failed encoding large list value");
             result = MU_FAILURE;
         }
         else
@@ -3919,71 +4909,124 @@ static int encode_map_constructor(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLO
         }
     }
 
+    if (result == 0)
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (encode_value(items[i], size_cache, encoder_output, context) != 0)
+            {
+                break;
+            }
+        }
+
+        if (i < count)
+        {
+            LogError("Failed encoding element %u of the list", (unsigned int)i);
+            result = MU_FAILURE;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
     return result;
 }
 
-static int amqpvalue_get_encoded_map_size(AMQP_MAP_KEY_VALUE_PAIR* pairs, uint32_t count, uint32_t* encoded_size)
+static int encode_list(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, AMQP_VALUE* items, ENCODED_SIZE_CACHE* size_cache)
 {
-    size_t i;
     int result;
+    uint32_t size = size_cache_next(size_cache);
 
-    if (encoded_size == NULL)
+    if (count == 0)
     {
-        LogError("Bad arguments: encoded_size = %p", encoded_size);
-        result = MU_FAILURE;
+        /* Codes_SRS_AMQPVALUE_01_303: [<encoding name="list0" code="0x45" category="fixed" width="0" label="the empty list (i.e. the list with no elements)"/>] */
+        if (output_byte(encoder_output, context, 0x45) != 0)
+        {
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Could not output list constructor byte");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
+        }
+    }
+    else if ((count <= 255) && (size < 255))
+    {
+        /* Codes_SRS_AMQPVALUE_01_304: [<encoding name="list8" code="0xc0" category="compound" width="1" label="up to 2^8 - 1 list elements with total size less than 2^8 octets"/>] */
+        if ((encode_list_constructor(encoder_output, context, true) != 0) ||
+            (encode_list_value(encoder_output, context, count, size, items, true, size_cache) != 0))
+        {
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Failed encoding small list");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
+        }
     }
     else
     {
-        *encoded_size = 0;
-
-        /* Get the size of all items in the map */
-        for (i = 0; i < count; i++)
+        /* Codes_SRS_AMQPVALUE_01_305: [<encoding name="list32" code="0xd0" category="compound" width="4" label="up to 2^32 - 1 list elements with total size less than 2^32 octets"/>] */
+        if ((encode_list_constructor(encoder_output, context, false) != 0) ||
+            (encode_list_value(encoder_output, context, count, size, items, false, size_cache) != 0))
         {
-            size_t item_size;
-            if (amqpvalue_get_encoded_size(pairs[i].key, &item_size) != 0)
-            {
-                LogError("Could not get encoded size for key element %u of the map", (unsigned int)i);
-                break;
-            }
-
-            if ((item_size > UINT32_MAX) ||
-                *encoded_size + (uint32_t)item_size < *encoded_size)
-            {
-                LogError("Encoded data is more than the max size for a map");
-                break;
-            }
-
-            *encoded_size = (uint32_t)(*encoded_size + item_size);
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Failed encoding large list");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
+        }
+    }
 
-            if (amqpvalue_get_encoded_size(pairs[i].value, &item_size) != 0)
-            {
-                LogError("Could not get encoded size for value element %u of the map", (unsigned int)i);
-                break;
-            }
+    return result;
+}
 
-            if ((item_size > UINT32_MAX) ||
-                *encoded_size + (uint32_t)item_size < *encoded_size)
-            {
-                LogError("Encoded data is more than the max size for a map");
-                break;
-            }
+static int encode_map_constructor(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, bool use_smallest)
+{
+    int result;
 
-            *encoded_size = (uint32_t)(*encoded_size + item_size);
+    if (use_smallest)
+    {
+        /* Codes_SRS_AMQPVALUE_01_306: [<encoding name="map8" code="0xc1" category="compound" width="1" label="up to 2^8 - 1 octets of encoded map data"/>] */
+        if (output_byte(encoder_output, context, 0xC1) != 0)
+        {
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Could not encode small map constructor");
+            result = MU_FAILURE;
         }
-
-        if (i < count)
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
+        }
+    }
+    else
+    {
+        /* Codes_SRS_AMQPVALUE_01_307: [<encoding name="map32" code="0xd1" category="compound" width="4" label="up to 2^32 - 1 octets of encoded map data"/>] */
+        if (output_byte(encoder_output, context, 0xD1) != 0)
         {
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Could not encode large map constructor");
             result = MU_FAILURE;
         }
         else
         {
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
             result = 0;
         }
     }
+
     return result;
 }
 
-static int encode_map_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, uint32_t size, AMQP_MAP_KEY_VALUE_PAIR* pairs, bool use_smallest)
+static int encode_map_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, uint32_t size, AMQP_MAP_KEY_VALUE_PAIR* pairs, bool use_smallest, ENCODED_SIZE_CACHE* size_cache)
 {
     int result;
     size_t i;
@@ -4039,8 +5082,8 @@ static int encode_map_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* co
         /* Codes_SRS_AMQPVALUE_01_123: [A map is encoded as a compound value where the constituent elements form alternating key value pairs.] */
         for (i = 0; i < count; i++)
         {
-            if ((amqpvalue_encode(pairs[i].key, encoder_output, context) != 0) ||
-                (amqpvalue_encode(pairs[i].value, encoder_output, context) != 0))
+            if ((encode_value(pairs[i].key, size_cache, encoder_output, context) != 0) ||
+                (encode_value(pairs[i].value, size_cache, encoder_output, context) != 0))
             {
                 LogError("Failed encoding map element %u", (unsigned int)i);
                 break;
@@ -4060,52 +5103,44 @@ static int encode_map_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* co
     return result;
 }
 
-static int encode_map(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, AMQP_MAP_KEY_VALUE_PAIR* pairs)
+static int encode_map(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, AMQP_MAP_KEY_VALUE_PAIR* pairs, ENCODED_SIZE_CACHE* size_cache)
 {
     int result;
-    uint32_t size;
+    uint32_t size = size_cache_next(size_cache);
 
     /* Codes_SRS_AMQPVALUE_01_124: [Map encodings MUST contain an even number of items (i.e. an equal number of keys and values).] */
     uint32_t elements = count * 2;
 
-    if (amqpvalue_get_encoded_map_size(pairs, count, &size) != 0)
+    if ((elements <= 255) && (size < 255))
     {
-        /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-        result = MU_FAILURE;
+        /* Codes_SRS_AMQPVALUE_01_306: [<encoding name="map8" code="0xc1" category="compound" width="1" label="up to 2^8 - 1 octets of encoded map data"/>] */
+        if ((encode_map_constructor(encoder_output, context, true) != 0) ||
+            (encode_map_value(encoder_output, context, count, size, pairs, true, size_cache) != 0))
+        {
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Could not encode small map");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
+        }
     }
     else
     {
-        if ((elements <= 255) && (size < 255))
+        /* Codes_SRS_AMQPVALUE_01_307: [<encoding name="map32" code="0xd1" category="compound" width="4" label="up to 2^32 - 1 octets of encoded map data"/>] */
+        if ((encode_map_constructor(encoder_output, context, false) != 0) ||
+            (encode_map_value(encoder_output, context, count, size, pairs, false, size_cache) != 0))
         {
-            /* Codes_SRS_AMQPVALUE_01_306: [<encoding name="map8" code="0xc1" category="compound" width="1" label="up to 2^8 - 1 octets of encoded map data"/>] */
-            if ((encode_map_constructor(encoder_output, context, true) != 0) ||
-                (encode_map_value(encoder_output, context, count, size, pairs, true) != 0))
-            {
-                /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-                LogError("Could not encode small map");
-                result = MU_FAILURE;
-            }
-            else
-            {
-                /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-                result = 0;
-            }
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Could not encode large map");
+            result = MU_FAILURE;
         }
         else
         {
-            /* Codes_SRS_AMQPVALUE_01_307: [<encoding name="map32" code="0xd1" category="compound" width="4" label="up to 2^32 - 1 octets of encoded map data"/>] */
-            if ((encode_map_constructor(encoder_output, context, false) != 0) ||
-                (encode_map_value(encoder_output, context, count, size, pairs, false) != 0))
-            {
-                /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-                LogError("Could not encode large map");
-                result = MU_FAILURE;
-            }
-            else
-            {
-                /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-                result = 0;
-            }
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
         }
     }
 
@@ -4150,58 +5185,7 @@ static int encode_array_constructor(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAY
     return result;
 }
 
-static int amqpvalue_get_encoded_array_size(AMQP_VALUE* items, uint32_t count, uint32_t* encoded_size)
-{
-    size_t i;
-    int result;
-
-    if (encoded_size == NULL)
-    {
-        LogError("Bad arguments: encoded_size = %p", encoded_size);
-        result = MU_FAILURE;
-    }
-    else
-    {
-        *encoded_size = 0;
-
-        /* Get the size of all items in the array */
-        for (i = 0; i < count; i++)
-        {
-            size_t item_size;
-            if (amqpvalue_get_encoded_array_item_size(items[i], &item_size) != 0)
-            {
-                LogError("Could not get encoded size for element %u of the array", (unsigned int)i);
-                break;
-            }
-
-            if ((item_size > UINT32_MAX) ||
-                *encoded_size + (uint32_t)item_size < *encoded_size)
-            {
-                LogError("Overflow in array size computation");
-                break;
-            }
-
-            *encoded_size = (uint32_t)(*encoded_size + item_size);
-        }
-
-        if (i < count)
-        {
-            result = MU_FAILURE;
-        }
-        else
-        {
-            if (*encoded_size > count)
-            {
-                /* Include a single constructor byte in the size calculation where array items require a constructor. */
-                (*encoded_size)++;
-            }
-            result = 0;
-        }
-    }
-    return result;
-}
-
-static int encode_array_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, uint32_t size, AMQP_VALUE* items, bool use_smallest)
+static int encode_array_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, uint32_t size, AMQP_VALUE* items, bool use_smallest, ENCODED_SIZE_CACHE* size_cache)
 {
     int result;
     size_t i;
@@ -4255,7 +5239,7 @@ static int encode_array_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD*
 
         for (i = 0; i < count; i++)
         {
-            if (amqpvalue_encode_array_item(items[i], first_element, encoder_output, context) != 0)
+            if (amqpvalue_encode_array_item(items[i], first_element, size_cache, encoder_output, context) != 0)
             {
                 LogError("Failed encoding element %u of the array", (unsigned int)i);
                 break;
@@ -4276,49 +5260,41 @@ static int encode_array_value(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD*
     return result;
 }
 
-static int encode_array(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, AMQP_VALUE* items)
+static int encode_array(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context, uint32_t count, AMQP_VALUE* items, ENCODED_SIZE_CACHE* size_cache)
 {
     int result;
-    uint32_t size;
+    uint32_t size = size_cache_next(size_cache);
 
-    if (amqpvalue_get_encoded_array_size(items, count, &size) != 0)
+    if ((count <= 255) && (size < 255))
     {
-        /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-        result = MU_FAILURE;
+        /* Codes_SRS_AMQPVALUE_01_306: [<encoding name="map8" code="0xE0" category="compound" width="1" label="up to 2^8 - 1 octets of encoded map data"/>] */
+        if ((encode_array_constructor(encoder_output, context, true) != 0) ||
+            (encode_array_value(encoder_output,context, count, size, items, true, size_cache) != 0))
+        {
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Could not encode small array");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
+        }
     }
     else
     {
-        if ((count <= 255) && (size < 255))
+        /* Codes_SRS_AMQPVALUE_01_307: [<encoding name="map32" code="0xF0" category="compound" width="4" label="up to 2^32 - 1 octets of encoded map data"/>] */
+        if ((encode_array_constructor(encoder_output, context, false) != 0) ||
+            (encode_array_value(encoder_output, context, count, size, items, false, size_cache) != 0))
         {
-            /* Codes_SRS_AMQPVALUE_01_306: [<encoding name="map8" code="0xE0" category="compound" width="1" label="up to 2^8 - 1 octets of encoded map data"/>] */
-            if ((encode_array_constructor(encoder_output, context, true) != 0) ||
-                (encode_array_value(encoder_output,context, count, size, items, true) != 0))
-            {
-                /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-                LogError("Could not encode small array");
-                result = MU_FAILURE;
-            }
-            else
-            {
-                /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-                result = 0;
-            }
+            /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
+            LogError("Could not encode large array");
+            result = MU_FAILURE;
         }
         else
         {
-            /* Codes_SRS_AMQPVALUE_01_307: [<encoding name="map32" code="0xF0" category="compound" width="4" label="up to 2^32 - 1 octets of encoded map data"/>] */
-            if ((encode_array_constructor(encoder_output, context, false) != 0) ||
-                (encode_array_value(encoder_output, context, count, size, items, false) != 0))
-            {
-                /* Codes_SRS_AMQPVALUE_01_274: [When the encoder output function fails, amqpvalue_encode shall fail and return a non-zero value.] */
-                LogError("Could not encode large array");
-                result = MU_FAILURE;
-            }
-            else
-            {
-                /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-                result = 0;
-            }
+            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+            result = 0;
         }
     }
 
@@ -4343,135 +5319,208 @@ static int encode_descriptor_header(AMQPVALUE_ENCODER_OUTPUT encoder_output, PAY
 }
 
 /* Codes_SRS_AMQPVALUE_01_265: [amqpvalue_encode shall encode the value per the ISO.] */
-int amqpvalue_encode(AMQP_VALUE value, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context)
+static int encode_value(AMQP_VALUE value, ENCODED_SIZE_CACHE* size_cache, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context)
 {
     int result;
+    AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
 
-    /* Codes_SRS_AMQPVALUE_01_269: [If value or encoder_output are NULL, amqpvalue_encode shall fail and return a non-zero value.] */
-    if ((value == NULL) ||
-        (encoder_output == NULL))
+    switch (value_data->type)
     {
-        LogError("Bad arguments: value = %p, encoder_output = %p",
-            value, encoder_output);
+    default:
+        /* Codes_SRS_AMQPVALUE_01_271: [If encoding fails due to any error not specifically mentioned here, it shall return a non-zero value.] */
+        LogError("Invalid type: %d", (int)value_data->type);
         result = MU_FAILURE;
-    }
-    else
-    {
-        AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
+        break;
 
-        switch (value_data->type)
-        {
-        default:
-            /* Codes_SRS_AMQPVALUE_01_271: [If encoding fails due to any error not specifically mentioned here, it shall return a non-zero value.] */
-            LogError("Invalid type: %d", (int)value_data->type);
-            result = MU_FAILURE;
-            break;
+    case AMQP_TYPE_NULL:
+        /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
+        result = encode_null(encoder_output, context);
+        break;
 
-        case AMQP_TYPE_NULL:
-            /* Codes_SRS_AMQPVALUE_01_266: [On success amqpvalue_encode shall return 0.] */
-            result = encode_null(encoder_output, context);
-            break;
+    case AMQP_TYPE_BOOL:
+        result = encode_boolean(encoder_output, context, value_data->value.bool_value);
+        break;
 
-        case AMQP_TYPE_BOOL:
-            result = encode_boolean(encoder_output, context, value_data->value.bool_value);
-            break;
+    case AMQP_TYPE_UBYTE:
+        result = encode_ubyte(encoder_output, context, value_data->value.ubyte_value);
+        break;
 
-        case AMQP_TYPE_UBYTE:
-            result = encode_ubyte(encoder_output, context, value_data->value.ubyte_value);
-            break;
+    case AMQP_TYPE_USHORT:
+        result = encode_ushort(encoder_output, context, value_data->value.ushort_value);
+        break;
 
-        case AMQP_TYPE_USHORT:
-            result = encode_ushort(encoder_output, context, value_data->value.ushort_value);
-            break;
+    case AMQP_TYPE_UINT:
+        result = encode_uint(encoder_output, context, value_data->value.uint_value);
+        break;
 
-        case AMQP_TYPE_UINT:
-            result = encode_uint(encoder_output, context, value_data->value.uint_value);
-            break;
+    case AMQP_TYPE_ULONG:
+        result = encode_ulong(encoder_output, context, value_data->value.ulong_value);
+        break;
 
-        case AMQP_TYPE_ULONG:
-            result = encode_ulong(encoder_output, context, value_data->value.ulong_value);
-            break;
+    case AMQP_TYPE_BYTE:
+        result = encode_byte(encoder_output, context, value_data->value.byte_value);
+        break;
 
-        case AMQP_TYPE_BYTE:
-            result = encode_byte(encoder_output, context, value_data->value.byte_value);
-            break;
+    case AMQP_TYPE_SHORT:
+        result = encode_short(encoder_output, context, value_data->value.short_value);
+        break;
 
-        case AMQP_TYPE_SHORT:
-            result = encode_short(encoder_output, context, value_data->value.short_value);
-            break;
+    case AMQP_TYPE_INT:
+        result = encode_int(encoder_output, context, value_data->value.int_value);
+        break;
 
-        case AMQP_TYPE_INT:
-            result = encode_int(encoder_output, context, value_data->value.int_value);
-            break;
+    case AMQP_TYPE_LONG:
+        result = encode_long(encoder_output, context, value_data->value.long_value);
+        break;
 
-        case AMQP_TYPE_LONG:
-            result = encode_long(encoder_output, context, value_data->value.long_value);
-            break;
+    case AMQP_TYPE_FLOAT:
+        result = encode_float(encoder_output, context, value_data->value.float_value);
+        break;
 
-        case AMQP_TYPE_FLOAT:
-            result = encode_float(encoder_output, context, value_data->value.float_value);
-            break;
+    case AMQP_TYPE_DOUBLE:
+        result = encode_double(encoder_output, context, value_data->value.double_value);
+        break;
 
-        case AMQP_TYPE_DOUBLE:
-            result = encode_double(encoder_output, context, value_data->value.double_value);
-            break;
+    case AMQP_TYPE_TIMESTAMP:
+        result = encode_timestamp(encoder_output, context, value_data->value.timestamp_value);
+        break;
 
-        case AMQP_TYPE_TIMESTAMP:
-            result = encode_timestamp(encoder_output, context, value_data->value.timestamp_value);
-            break;
+    case AMQP_TYPE_UUID:
+        result = encode_uuid(encoder_output, context, value_data->value.uuid_value);
+        break;
 
-        case AMQP_TYPE_UUID:
-            result = encode_uuid(encoder_output, context, value_data->value.uuid_value);
-            break;
+    case AMQP_TYPE_BINARY:
+        result = encode_binary(encoder_output, context, value_data->value.binary_value);
+        break;
 
-        case AMQP_TYPE_BINARY:
-            result = encode_binary(encoder_output, context, value_data->value.binary_value);
-            break;
+    case AMQP_TYPE_STRING:
+        result = encode_string(encoder_output, context, value_data->value.string_value.chars);
+        break;
 
-        case AMQP_TYPE_STRING:
-            result = encode_string(encoder_output, context, value_data->value.string_value.chars);
-            break;
+    case AMQP_TYPE_SYMBOL:
+        result = encode_symbol(encoder_output, context, value_data->value.symbol_value.chars);
+        break;
 
-        case AMQP_TYPE_SYMBOL:
-            result = encode_symbol(encoder_output, context, value_data->value.symbol_value.chars);
-            break;
+    case AMQP_TYPE_LIST:
+        result = encode_list(encoder_output, context, value_data->value.list_value.count, value_data->value.list_value.items, size_cache);
+        break;
 
-        case AMQP_TYPE_LIST:
-            result = encode_list(encoder_output, context, value_data->value.list_value.count, value_data->value.list_value.items);
-            break;
+    case AMQP_TYPE_ARRAY:
+        result = encode_array(encoder_output, context, value_data->value.array_value.count, value_data->value.array_value.items, size_cache);
+        break;
 
-        case AMQP_TYPE_ARRAY:
-            result = encode_array(encoder_output, context, value_data->value.array_value.count, value_data->value.array_value.items);
-            break;
+    case AMQP_TYPE_MAP:
+        result = encode_map(encoder_output, context, value_data->value.map_value.pair_count, value_data->value.map_value.pairs, size_cache);
+        break;
 
-        case AMQP_TYPE_MAP:
-            result = encode_map(encoder_output, context, value_data->value.map_value.pair_count, value_data->value.map_value.pairs);
-            break;
+    case AMQP_TYPE_COMPOSITE:
+    case AMQP_TYPE_DESCRIBED:
+    {
+        if ((encode_descriptor_header(encoder_output, context) != 0) ||
+            (encode_value(value_data->value.described_value.descriptor, size_cache, encoder_output, context) != 0) ||
+            (encode_value(value_data->value.described_value.value, size_cache, encoder_output, context) != 0))
+        {
+            LogError("Failed encoding described or composite type");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            result = 0;
+        }
 
-        case AMQP_TYPE_COMPOSITE:
-        case AMQP_TYPE_DESCRIBED:
+        break;
+    }
+    }
+
+    return result;
+}
+
+int amqpvalue_encode(AMQP_VALUE value, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_269: [If value or encoder_output are NULL, amqpvalue_encode shall fail and return a non-zero value.] */
+    if ((value == NULL) ||
+        (encoder_output == NULL))
+    {
+        LogError("Bad arguments: value = %p, encoder_output = %p",
+            value, encoder_output);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        ENCODED_SIZE_CACHE size_cache;
+        size_t encoded_size;
+
+        size_cache_init(&size_cache);
+
+        /* Codes_SRS_AMQPVALUE_01_475: [amqpvalue_encode shall compute the sizes of all lists, maps and arrays contained in value in a single pass before producing any output.] */
+        if (get_value_encoded_size(value, false, &size_cache, &encoded_size) != 0)
         {
-            if ((encode_descriptor_header(encoder_output, context) != 0) ||
-                (amqpvalue_encode(value_data->value.described_value.descriptor, encoder_output, context) != 0) ||
-                (amqpvalue_encode(value_data->value.described_value.value, encoder_output, context) != 0))
-            {
-                LogError("Failed encoding described or composite type");
-                result = MU_FAILURE;
-            }
-            else
-            {
-                result = 0;
-            }
+            /* Codes_SRS_AMQPVALUE_01_476: [If computing the sizes fails, amqpvalue_encode shall fail and return a non-zero value without calling encoder_output.] */
+            LogError("Could not compute encoded sizes");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_477: [amqpvalue_encode shall then write the encoded bytes in a second pass that uses the computed sizes and does not size any value again.] */
+            result = encode_value(value, &size_cache, encoder_output, context);
+        }
 
-            break;
+        size_cache_deinit(&size_cache);
+    }
+
+    return result;
+}
+
+int amqpvalue_encode_to_payload(AMQP_VALUE value, PAYLOAD* payload)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_479: [If value or payload is NULL, amqpvalue_encode_to_payload shall fail and return a non-zero value.] */
+    if ((value == NULL) ||
+        (payload == NULL))
+    {
+        LogError("Bad arguments: value = %p, payload = %p",
+            value, payload);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        ENCODED_SIZE_CACHE size_cache;
+        size_t encoded_size;
+
+        size_cache_init(&size_cache);
+
+        if (get_value_encoded_size(value, false, &size_cache, &encoded_size) != 0)
+        {
+            /* Codes_SRS_AMQPVALUE_01_482: [If any error occurs, amqpvalue_encode_to_payload shall fail and return a non-zero value.] */
+            LogError("Could not compute encoded sizes");
+            result = MU_FAILURE;
+        }
+        /* Codes_SRS_AMQPVALUE_01_480: [If the spare capacity at the end of payload is smaller than the encoded size of value, amqpvalue_encode_to_payload shall reserve the encoded size of value in payload before writing to it.] */
+        /* Codes_SRS_AMQPVALUE_01_484: [Binary values that hold payload callbacks shall not be counted in the reserved size, since they are appended as callbacks and not copied.] */
+        else if ((payload_get_spare_capacity(payload) < encoded_size - size_cache.callback_size) &&
+            (!payload_reserve_data(payload, encoded_size - size_cache.callback_size)))
+        {
+            /* Codes_SRS_AMQPVALUE_01_482: [If any error occurs, amqpvalue_encode_to_payload shall fail and return a non-zero value.] */
+            LogError("Could not reserve %u bytes for encoding", (unsigned int)encoded_size);
+            result = MU_FAILURE;
         }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_478: [amqpvalue_encode_to_payload shall encode value per the ISO and append the encoded bytes to payload.] */
+            /* Codes_SRS_AMQPVALUE_01_483: [On success amqpvalue_encode_to_payload shall return 0.] */
+            result = encode_value(value, &size_cache, append_to_payload, payload);
         }
+
+        size_cache_deinit(&size_cache);
     }
 
     return result;
 }
 
-static int amqpvalue_encode_array_item(AMQP_VALUE item, bool first_element, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context)
+static int amqpvalue_encode_array_item(AMQP_VALUE item, bool first_element, ENCODED_SIZE_CACHE* size_cache, AMQPVALUE_ENCODER_OUTPUT encoder_output, PAYLOAD* context)
 {
     int result;
 
@@ -4647,57 +5696,45 @@ static int amqpvalue_encode_array_item(AMQP_VALUE item, bool first_element, AMQP
 
             case AMQP_TYPE_LIST:
             {
-                uint32_t list_size;
+                uint32_t list_size = size_cache_next(size_cache);
 
                 if ((first_element) && (encode_list_constructor(encoder_output, context, false) != 0))
                 {
                     result = MU_FAILURE;
                 }
-                else if (amqpvalue_get_encoded_list_size(value_data->value.list_value.items, value_data->value.list_value.count, &list_size) != 0)
-                {
-                    result = MU_FAILURE;
-                }
                 else
                 {
-                    result = encode_list_value(encoder_output, context, value_data->value.list_value.count, list_size, value_data->value.list_value.items, false);
+                    result = encode_list_value(encoder_output, context, value_data->value.list_value.count, list_size, value_data->value.list_value.items, false, size_cache);
                 }
                 break;
             }
 
             case AMQP_TYPE_MAP:
             {
-                uint32_t map_size;
+                uint32_t map_size = size_cache_next(size_cache);
 
                 if ((first_element) && (encode_map_constructor(encoder_output, context, false) != 0))
                 {
                     result = MU_FAILURE;
                 }
-                else if (amqpvalue_get_encoded_map_size(value_data->value.map_value.pairs, value_data->value.map_value.pair_count, &map_size) != 0)
-                {
-                    result = MU_FAILURE;
-                }
                 else
                 {
-                    result = encode_map_value(encoder_output, context, value_data->value.map_value.pair_count, map_size, value_data->value.map_value.pairs, false);
+                    result = encode_map_value(encoder_output, context, value_data->value.map_value.pair_count, map_size, value_data->value.map_value.pairs, false, size_cache);
                 }
                 break;
             }
 
             case AMQP_TYPE_ARRAY:
             {
-                uint32_t array_size;
+                uint32_t array_size = size_cache_next(size_cache);
 
                 if ((first_element) && (encode_array_constructor(encoder_output, context, false) != 0))
                 {
                     result = MU_FAILURE;
                 }
-                else if (amqpvalue_get_encoded_array_size(value_data->value.array_value.items, value_data->value.array_value.count, &array_size) != 0)
-                {
-                    result = MU_FAILURE;
-                }
                 else
                 {
-                    result = encode_array_value(encoder_output, context, value_data->value.array_value.count, array_size, value_data->value.array_value.items, false);
+                    result = encode_array_value(encoder_output, context, value_data->value.array_value.count, array_size, value_data->value.array_value.items, false, size_cache);
                 }
                 break;
             }
@@ -4706,14 +5743,6 @@ static int amqpvalue_encode_array_item(AMQP_VALUE item, bool first_element, AMQP
     return result;
 }
 
-static int count_bytes(void* context, PAYLOAD* payload)
-{
-    size_t* byte_count = (size_t*)context;
-    *byte_count += payload_get_length(payload);
-
-    return 0;
-}
-
 /* Codes_SRS_AMQPVALUE_01_308: [amqpvalue_get_encoded_size shall fill in the encoded_size argument the number of bytes required to encode the given AMQP value.] */
 int amqpvalue_get_encoded_size(AMQP_VALUE value, size_t* encoded_size)
 {
@@ -4729,35 +5758,16 @@ int amqpvalue_get_encoded_size(AMQP_VALUE value, size_t* encoded_size)
     }
     else
     {
-        *encoded_size = 0;
-        result = amqpvalue_encode(value, count_bytes, (PAYLOAD*)encoded_size);
+        /* Codes_SRS_AMQPVALUE_01_485: [amqpvalue_get_encoded_size shall compute the encoded size from the types and lengths of value and its items, without encoding value and without allocating memory.] */
+        result = get_value_encoded_size(value, false, NULL, encoded_size);
     }
 
     return result;
 }
 
-static int amqpvalue_get_encoded_array_item_size(AMQP_VALUE item, size_t* encoded_size)
+static void amqpvalue_clear(AMQP_VALUE_DATA* value_data)
 {
-    int result;
-
-    if ((item == NULL) ||
-        (encoded_size == NULL))
-    {
-        LogError("Bad arguments: item = %p, encoded_size = %p", item, encoded_size);
-        result = MU_FAILURE;
-    }
-    else
-    {
-        *encoded_size = 0;
-        result = amqpvalue_encode_array_item(item, false, count_bytes, (PAYLOAD*)encoded_size);
-    }
-
-    return result;
-}
-
-static void amqpvalue_clear(AMQP_VALUE_DATA* value_data)
-{
-    switch (value_data->type)
+    switch (value_data->type)
     {
     default:
         break;
@@ -4787,7 +5797,7 @@ static void amqpvalue_clear(AMQP_VALUE_DATA* value_data)
                 amqpvalue_destroy(value_data->value.list_value.items[i]);
             }
 
-            free(value_data->value.list_value.items);
+            free_items(value_data, value_data->value.list_value.items);
             value_data->value.list_value.items = NULL;
         }
         break;
@@ -4803,9 +5813,11 @@ static void amqpvalue_clear(AMQP_VALUE_DATA* value_data)
                 amqpvalue_destroy(value_data->value.map_value.pairs[i].value);
             }
 
-            free(value_data->value.map_value.pairs);
+            free_items(value_data, value_data->value.map_value.pairs);
             value_data->value.map_value.pairs = NULL;
         }
+
+        map_index_destroy(&value_data->value.map_value);
         break;
     }
     case AMQP_TYPE_ARRAY:
@@ -4818,7 +5830,7 @@ static void amqpvalue_clear(AMQP_VALUE_DATA* value_data)
                 amqpvalue_destroy(value_data->value.array_value.items[i]);
             }
 
-            free(value_data->value.array_value.items);
+            free_items(value_data, value_data->value.array_value.items);
             value_data->value.array_value.items = NULL;
         }
         break;
@@ -4843,7 +5855,7 @@ void amqpvalue_destroy(AMQP_VALUE value)
             /* Codes_SRS_AMQPVALUE_01_314: [amqpvalue_destroy shall free all resources allocated by any of the amqpvalue_create_xxx functions or amqpvalue_clone.] */
             AMQP_VALUE_DATA* value_data = (AMQP_VALUE_DATA*)value;
             amqpvalue_clear(value_data);
-            REFCOUNT_TYPE_DESTROY(AMQP_VALUE_DATA, value);
+            destroy_value_data(value_data);
         }
     }
 }
@@ -4921,7 +5933,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
 
                 if (internal_decoder_data->decode_to_value == NULL)
                 {
-                    internal_decoder_data->decode_to_value = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+                    internal_decoder_data->decode_to_value = create_value_data();
                 }
 
                 if (internal_decoder_data->decode_to_value == NULL)
@@ -4949,7 +5961,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                     AMQP_VALUE_DATA* descriptor;
                     internal_decoder_data->decode_to_value->type = AMQP_TYPE_DESCRIBED;
                     internal_decoder_data->decode_to_value->value.described_value.value = NULL;
-                    descriptor = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+                    descriptor = create_value_data();
                     if (descriptor == NULL)
                     {
                         internal_decoder_data->decoder_state = DECODER_STATE_ERROR;
@@ -5311,6 +6323,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                     internal_decoder_data->decode_to_value->type = AMQP_TYPE_LIST;
                     internal_decoder_data->decoder_state = DECODER_STATE_CONSTRUCTOR;
                     internal_decoder_data->decode_to_value->value.list_value.count = 0;
+                    internal_decoder_data->decode_to_value->value.list_value.capacity = 0;
                     internal_decoder_data->decode_to_value->value.list_value.items = NULL;
 
                     /* Codes_SRS_AMQPVALUE_01_323: [When enough bytes have been processed for a valid amqp value, the on_value_decoded passed in amqpvalue_decoder_create shall be called.] */
@@ -5326,6 +6339,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                     internal_decoder_data->decode_to_value->type = AMQP_TYPE_LIST;
                     internal_decoder_data->decoder_state = DECODER_STATE_TYPE_DATA;
                     internal_decoder_data->decode_to_value->value.list_value.count = 0;
+                    internal_decoder_data->decode_to_value->value.list_value.capacity = 0;
                     internal_decoder_data->decode_to_value->value.list_value.items = NULL;
                     internal_decoder_data->bytes_decoded = 0;
                     internal_decoder_data->decode_value_state.list_value_state.list_value_state = DECODE_LIST_STEP_SIZE;
@@ -5340,6 +6354,8 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                     internal_decoder_data->decoder_state = DECODER_STATE_TYPE_DATA;
                     internal_decoder_data->decode_to_value->value.map_value.pair_count = 0;
                     internal_decoder_data->decode_to_value->value.map_value.pairs = NULL;
+                    internal_decoder_data->decode_to_value->value.map_value.pair_capacity = 0;
+                    internal_decoder_data->decode_to_value->value.map_value.index = NULL;
                     internal_decoder_data->bytes_decoded = 0;
                     internal_decoder_data->decode_value_state.map_value_state.map_value_state = DECODE_MAP_STEP_SIZE;
 
@@ -5351,6 +6367,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                     internal_decoder_data->decode_to_value->type = AMQP_TYPE_ARRAY;
                     internal_decoder_data->decoder_state = DECODER_STATE_TYPE_DATA;
                     internal_decoder_data->decode_to_value->value.array_value.count = 0;
+                    internal_decoder_data->decode_to_value->value.array_value.capacity = 0;
                     internal_decoder_data->decode_to_value->value.array_value.items = NULL;
                     internal_decoder_data->bytes_decoded = 0;
                     internal_decoder_data->decode_value_state.array_value_state.array_value_state = DECODE_ARRAY_STEP_SIZE;
@@ -5400,7 +6417,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                                 AMQP_VALUE described_value;
                                 internal_decoder_destroy(inner_decoder);
 
-                                described_value = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+                                described_value = create_value_data();
                                 if (described_value == NULL)
                                 {
                                     internal_decoder_data->decoder_state = DECODER_STATE_ERROR;
@@ -6333,7 +7350,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
 
                         if (internal_decoder_data->bytes_decoded == 0)
                         {
-                            AMQP_VALUE_DATA* list_item = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+                            AMQP_VALUE_DATA* list_item = create_value_data();
                             if (list_item == NULL)
                             {
                                 internal_decoder_data->decoder_state = DECODER_STATE_ERROR;
@@ -6550,7 +7567,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                                 break;
                             }
 
-                            AMQP_VALUE_DATA* map_item = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+                            AMQP_VALUE_DATA* map_item = create_value_data();
                             if (map_item == NULL)
                             {
                                 LogError("Could not allocate memory for map item");
@@ -6767,7 +7784,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                             AMQP_VALUE_DATA* array_item;
                             internal_decoder_data->decode_value_state.array_value_state.constructor_byte = buffer[0];
 
-                            array_item = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+                            array_item = create_value_data();
                             if (array_item == NULL)
                             {
                                 LogError("Could not allocate memory for array item to be decoded");
@@ -6838,7 +7855,7 @@ static int internal_decoder_decode_bytes(INTERNAL_DECODER_DATA* internal_decoder
                                         buffer += inner_used_bytes;
                                     }
 
-                                    array_item = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+                                    array_item = create_value_data();
                                     if (array_item == NULL)
                                     {
                                         LogError("Could not allocate memory for array item");
@@ -6924,7 +7941,7 @@ AMQPVALUE_DECODER_HANDLE amqpvalue_decoder_create(ON_VALUE_DECODED on_value_deco
         }
         else
         {
-            decoder_instance->decode_to_value = REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+            decoder_instance->decode_to_value = create_value_data();
             if (decoder_instance->decode_to_value == NULL)
             {
                 /* Codes_SRS_AMQPVALUE_01_313: [If creating the decoder fails, amqpvalue_decoder_create shall return NULL.] */
@@ -7005,6 +8022,859 @@ int amqpvalue_decode_bytes(AMQPVALUE_DECODER_HANDLE handle, const unsigned char*
     return result;
 }
 
+static uint16_t read_uint16_be(const unsigned char* buffer)
+{
+    return (uint16_t)(((uint16_t)buffer[0] << 8) | buffer[1]);
+}
+
+static uint32_t read_uint32_be(const unsigned char* buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+static uint64_t read_uint64_be(const unsigned char* buffer)
+{
+    return ((uint64_t)read_uint32_be(buffer) << 32) | read_uint32_be(buffer + 4);
+}
+
+typedef struct DECODE_BUFFER_OPTIONS_TAG
+{
+    /* binary values reference the decoded bytes instead of copying them */
+    bool borrow;
+    /* values, items and pairs are allocated from this arena when not NULL */
+    AMQPVALUE_ARENA_HANDLE_DATA* arena;
+} DECODE_BUFFER_OPTIONS;
+
+static AMQP_VALUE_DATA* decode_buffer_create_value_data(const DECODE_BUFFER_OPTIONS* options)
+{
+    AMQP_VALUE_DATA* result = (options->arena != NULL) ? create_value_data_in_arena(options->arena) : create_value_data();
+    if (result != NULL)
+    {
+        bool in_arena = result->in_arena;
+
+        memset(result, 0, sizeof(AMQP_VALUE_DATA));
+        result->type = AMQP_TYPE_UNKNOWN;
+        result->in_arena = in_arena;
+    }
+
+    return result;
+}
+
+/* allocates zeroed items or pairs for value_data, which is expected to hold none yet */
+static void* decode_buffer_allocate_items(const DECODE_BUFFER_OPTIONS* options, AMQP_VALUE_DATA* value_data, uint32_t count, size_t item_size)
+{
+    void* result;
+
+    if (options->arena == NULL)
+    {
+        result = calloc(count, item_size);
+    }
+    else
+    {
+        result = arena_allocate(options->arena, (size_t)count * item_size);
+        if (result != NULL)
+        {
+            (void)memset(result, 0, (size_t)count * item_size);
+            value_data->arena_items = true;
+        }
+    }
+
+    return result;
+}
+
+static int decode_buffer_value_data(const unsigned char* buffer, size_t size, unsigned char constructor_byte, AMQP_VALUE_DATA* value_data, size_t* used_bytes, uint32_t depth, const DECODE_BUFFER_OPTIONS* options);
+
+static AMQP_VALUE_DATA* decode_buffer_new_value(const unsigned char* buffer, size_t size, size_t* used_bytes, uint32_t depth, const DECODE_BUFFER_OPTIONS* options)
+{
+    AMQP_VALUE_DATA* result;
+
+    if (size == 0)
+    {
+        LogError("Not enough bytes for a constructor");
+        result = NULL;
+    }
+    else
+    {
+        result = decode_buffer_create_value_data(options);
+        if (result == NULL)
+        {
+            LogError("Cannot allocate decode value");
+        }
+        else
+        {
+            size_t data_used_bytes;
+
+            if (decode_buffer_value_data(buffer + 1, size - 1, buffer[0], result, &data_used_bytes, depth, options) != 0)
+            {
+                amqpvalue_destroy(result);
+                result = NULL;
+            }
+            else
+            {
+                *used_bytes = data_used_bytes + 1;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int decode_buffer_compound_header(const unsigned char* buffer, size_t size, bool is_small, uint32_t* compound_size, uint32_t* count, size_t* header_size)
+{
+    int result;
+
+    if (is_small)
+    {
+        if ((size < 2) || (buffer[0] < 1) || ((size_t)buffer[0] > size - 1))
+        {
+            LogError("Invalid compound8 header");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            *compound_size = buffer[0] - 1;
+            *count = buffer[1];
+            *header_size = 2;
+            result = 0;
+        }
+    }
+    else
+    {
+        uint32_t declared_size;
+
+        if ((size < 8) ||
+            ((declared_size = read_uint32_be(buffer)) < 4) ||
+            ((size_t)declared_size > size - 4))
+        {
+            LogError("Invalid compound32 header");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            *compound_size = declared_size - 4;
+            *count = read_uint32_be(buffer + 4);
+            *header_size = 8;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int decode_buffer_list(const unsigned char* buffer, size_t size, bool is_small, AMQP_VALUE_DATA* value_data, size_t* used_bytes, uint32_t depth, const DECODE_BUFFER_OPTIONS* options)
+{
+    int result;
+    uint32_t list_size;
+    uint32_t count;
+    size_t header_size;
+
+    if (decode_buffer_compound_header(buffer, size, is_small, &list_size, &count, &header_size) != 0)
+    {
+        result = MU_FAILURE;
+    }
+    /* every item takes at least its constructor byte */
+    else if ((count > MAX_AMQPVALUE_ITEM_COUNT) || (count > list_size))
+    {
+        LogError("Invalid list item count %u for a list of %u bytes", (unsigned int)count, (unsigned int)list_size);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        value_data->type = AMQP_TYPE_LIST;
+        value_data->value.list_value.count = 0;
+        value_data->value.list_value.items = NULL;
+
+        if (count == 0)
+        {
+            result = 0;
+        }
+        else if ((value_data->value.list_value.items = (AMQP_VALUE*)decode_buffer_allocate_items(options, value_data, count, sizeof(AMQP_VALUE))) == NULL)
+        {
+            LogError("Could not allocate memory for decoded list value");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            const unsigned char* items_buffer = buffer + header_size;
+            size_t remaining = list_size;
+            uint32_t i;
+
+            value_data->value.list_value.count = count;
+
+            for (i = 0; i < count; i++)
+            {
+                size_t item_used_bytes;
+                value_data->value.list_value.items[i] = decode_buffer_new_value(items_buffer, remaining, &item_used_bytes, depth + 1, options);
+                if (value_data->value.list_value.items[i] == NULL)
+                {
+                    LogError("Decoding list item %u failed", (unsigned int)i);
+                    break;
+                }
+
+                value_data->borrowed |= value_data->value.list_value.items[i]->borrowed;
+
+                items_buffer += item_used_bytes;
+                remaining -= item_used_bytes;
+            }
+
+            result = (i < count) ? MU_FAILURE : 0;
+        }
+
+        *used_bytes = header_size + list_size;
+    }
+
+    return result;
+}
+
+static int decode_buffer_map(const unsigned char* buffer, size_t size, bool is_small, AMQP_VALUE_DATA* value_data, size_t* used_bytes, uint32_t depth, const DECODE_BUFFER_OPTIONS* options)
+{
+    int result;
+    uint32_t map_size;
+    uint32_t count;
+    size_t header_size;
+
+    if (decode_buffer_compound_header(buffer, size, is_small, &map_size, &count, &header_size) != 0)
+    {
+        result = MU_FAILURE;
+    }
+    else if (((count % 2) != 0) || (count / 2 > MAX_AMQPVALUE_ITEM_COUNT) || (count > map_size))
+    {
+        LogError("Invalid map item count %u for a map of %u bytes", (unsigned int)count, (unsigned int)map_size);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        uint32_t pair_count = count / 2;
+
+        value_data->type = AMQP_TYPE_MAP;
+        value_data->value.map_value.pair_count = 0;
+        value_data->value.map_value.pairs = NULL;
+        value_data->value.map_value.index = NULL;
+
+        if (pair_count == 0)
+        {
+            result = 0;
+        }
+        else if ((value_data->value.map_value.pairs = (AMQP_MAP_KEY_VALUE_PAIR*)decode_buffer_allocate_items(options, value_data, pair_count, sizeof(AMQP_MAP_KEY_VALUE_PAIR))) == NULL)
+        {
+            LogError("Could not allocate memory for map value items");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            const unsigned char* items_buffer = buffer + header_size;
+            size_t remaining = map_size;
+            uint32_t i;
+
+            value_data->value.map_value.pair_count = pair_count;
+
+            for (i = 0; i < pair_count; i++)
+            {
+                size_t key_used_bytes;
+                size_t value_used_bytes;
+
+                value_data->value.map_value.pairs[i].key = decode_buffer_new_value(items_buffer, remaining, &key_used_bytes, depth + 1, options);
+                if (value_data->value.map_value.pairs[i].key == NULL)
+                {
+                    LogError("Decoding map key %u failed", (unsigned int)i);
+                    break;
+                }
+
+                value_data->borrowed |= value_data->value.map_value.pairs[i].key->borrowed;
+
+                items_buffer += key_used_bytes;
+                remaining -= key_used_bytes;
+
+                value_data->value.map_value.pairs[i].value = decode_buffer_new_value(items_buffer, remaining, &value_used_bytes, depth + 1, options);
+                if (value_data->value.map_value.pairs[i].value == NULL)
+                {
+                    LogError("Decoding map value %u failed", (unsigned int)i);
+                    break;
+                }
+
+                value_data->borrowed |= value_data->value.map_value.pairs[i].value->borrowed;
+
+                items_buffer += value_used_bytes;
+                remaining -= value_used_bytes;
+            }
+
+            result = (i < pair_count) ? MU_FAILURE : 0;
+        }
+
+        *used_bytes = header_size + map_size;
+    }
+
+    return result;
+}
+
+static int decode_buffer_array(const unsigned char* buffer, size_t size, bool is_small, AMQP_VALUE_DATA* value_data, size_t* used_bytes, uint32_t depth, const DECODE_BUFFER_OPTIONS* options)
+{
+    int result;
+    uint32_t array_size;
+    uint32_t count;
+    size_t header_size;
+
+    if (decode_buffer_compound_header(buffer, size, is_small, &array_size, &count, &header_size) != 0)
+    {
+        result = MU_FAILURE;
+    }
+    else if (count > MAX_AMQPVALUE_ITEM_COUNT)
+    {
+        LogError("AMQP array item count exceeded MAX_AMQPVALUE_ITEM_COUNT");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        value_data->type = AMQP_TYPE_ARRAY;
+        value_data->value.array_value.count = 0;
+        value_data->value.array_value.items = NULL;
+
+        if (count == 0)
+        {
+            /* an empty array may still carry the element constructor, it is covered by the array size */
+            *used_bytes = header_size + array_size;
+            result = 0;
+        }
+        else if ((value_data->value.array_value.items = (AMQP_VALUE*)decode_buffer_allocate_items(options, value_data, count, sizeof(AMQP_VALUE))) == NULL)
+        {
+            LogError("Could not allocate memory for array items");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* items are not bounded by the array size: constructor-only elements are not counted in it by every encoder */
+            const unsigned char* items_buffer = buffer + header_size;
+            size_t remaining = size - header_size;
+            AMQP_VALUE_DATA* element_descriptor = NULL;
+            unsigned char element_constructor;
+            uint32_t i;
+
+            value_data->value.array_value.count = count;
+
+            if ((remaining > 0) && (items_buffer[0] == 0x00))
+            {
+                /* described elements share one descriptor that precedes the element constructor */
+                size_t descriptor_used_bytes;
+                element_descriptor = decode_buffer_new_value(items_buffer + 1, remaining - 1, &descriptor_used_bytes, depth + 1, options);
+                if (element_descriptor != NULL)
+                {
+                    items_buffer += descriptor_used_bytes + 1;
+                    remaining -= descriptor_used_bytes + 1;
+                }
+            }
+
+            if ((remaining == 0) ||
+                ((items_buffer[0] == 0x00) && ((element_descriptor == NULL) || (remaining < 2))))
+            {
+                LogError("Invalid array element constructor");
+                i = 0;
+            }
+            else
+            {
+                element_constructor = items_buffer[0];
+                items_buffer++;
+                remaining--;
+
+                for (i = 0; i < count; i++)
+                {
+                    AMQP_VALUE_DATA* item = decode_buffer_create_value_data(options);
+                    size_t item_used_bytes;
+
+                    if (item == NULL)
+                    {
+                        LogError("Could not allocate memory for array item");
+                        break;
+                    }
+
+                    value_data->value.array_value.items[i] = item;
+
+                    if (decode_buffer_value_data(items_buffer, remaining, element_constructor, item, &item_used_bytes, depth + 1, options) != 0)
+                    {
+                        LogError("Could not decode array item %u", (unsigned int)i);
+                        break;
+                    }
+
+                    value_data->borrowed |= item->borrowed;
+
+                    if (element_descriptor != NULL)
+                    {
+                        AMQP_VALUE_DATA* described_item = decode_buffer_create_value_data(options);
+                        if (described_item == NULL)
+                        {
+                            LogError("Could not allocate memory for described array item");
+                            break;
+                        }
+
+                        described_item->type = AMQP_TYPE_DESCRIBED;
+                        described_item->value.described_value.descriptor = amqpvalue_clone(element_descriptor);
+                        described_item->value.described_value.value = item;
+                        described_item->borrowed = element_descriptor->borrowed || item->borrowed;
+                        value_data->value.array_value.items[i] = described_item;
+                        value_data->borrowed |= described_item->borrowed;
+                    }
+
+                    items_buffer += item_used_bytes;
+                    remaining -= item_used_bytes;
+                }
+            }
+
+            if (element_descriptor != NULL)
+            {
+                amqpvalue_destroy(element_descriptor);
+            }
+
+            if (i < count)
+            {
+                result = MU_FAILURE;
+            }
+            else
+            {
+                size_t items_end = size - remaining;
+                *used_bytes = (items_end > header_size + array_size) ? items_end : header_size + array_size;
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int decode_buffer_value_data(const unsigned char* buffer, size_t size, unsigned char constructor_byte, AMQP_VALUE_DATA* value_data, size_t* used_bytes, uint32_t depth, const DECODE_BUFFER_OPTIONS* options)
+{
+    int result;
+    size_t fixed_width;
+
+    /* fixed width types are checked against the remaining bytes once, before reading them */
+    switch (constructor_byte)
+    {
+    default:
+        fixed_width = 0;
+        break;
+    case 0x50: case 0x51: case 0x52: case 0x53: case 0x54: case 0x55: case 0x56: case 0xA0: case 0xA1: case 0xA3:
+        fixed_width = 1;
+        break;
+    case 0x60: case 0x61:
+        fixed_width = 2;
+        break;
+    case 0x70: case 0x71: case 0x72: case 0xB0: case 0xB1: case 0xB3:
+        fixed_width = 4;
+        break;
+    case 0x80: case 0x81: case 0x82: case 0x83:
+        fixed_width = 8;
+        break;
+    case 0x98:
+        fixed_width = 16;
+        break;
+    }
+
+    if (depth > MAX_AMQPVALUE_DECODE_DEPTH)
+    {
+        LogError("AMQP value nesting exceeded MAX_AMQPVALUE_DECODE_DEPTH");
+        result = MU_FAILURE;
+    }
+    else if (fixed_width > size)
+    {
+        LogError("Not enough bytes to decode value with constructor 0x%02x", constructor_byte);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        *used_bytes = fixed_width;
+        result = 0;
+
+        switch (constructor_byte)
+        {
+        default:
+            LogError("Invalid constructor byte: 0x%02x", constructor_byte);
+            result = MU_FAILURE;
+            break;
+
+        case 0x00: /* descriptor */
+        {
+            size_t descriptor_used_bytes;
+            size_t value_used_bytes;
+            AMQP_VALUE_DATA* descriptor = decode_buffer_new_value(buffer, size, &descriptor_used_bytes, depth + 1, options);
+            if (descriptor == NULL)
+            {
+                LogError("Decoding descriptor failed");
+                result = MU_FAILURE;
+            }
+            else
+            {
+                AMQP_VALUE_DATA* described_value = decode_buffer_new_value(buffer + descriptor_used_bytes, size - descriptor_used_bytes, &value_used_bytes, depth + 1, options);
+                if (described_value == NULL)
+                {
+                    LogError("Decoding described value failed");
+                    amqpvalue_destroy(descriptor);
+                    result = MU_FAILURE;
+                }
+                else
+                {
+                    value_data->type = AMQP_TYPE_DESCRIBED;
+                    value_data->value.described_value.descriptor = descriptor;
+                    value_data->value.described_value.value = described_value;
+                    value_data->borrowed = descriptor->borrowed || described_value->borrowed;
+                    *used_bytes = descriptor_used_bytes + value_used_bytes;
+                }
+            }
+            break;
+        }
+
+        case 0x40:
+            value_data->type = AMQP_TYPE_NULL;
+            break;
+        case 0x41:
+            value_data->type = AMQP_TYPE_BOOL;
+            value_data->value.bool_value = true;
+            break;
+        case 0x42:
+            value_data->type = AMQP_TYPE_BOOL;
+            value_data->value.bool_value = false;
+            break;
+        case 0x56:
+            value_data->type = AMQP_TYPE_BOOL;
+            value_data->value.bool_value = (buffer[0] == 0) ? false : true;
+            break;
+        case 0x50:
+            value_data->type = AMQP_TYPE_UBYTE;
+            value_data->value.ubyte_value = buffer[0];
+            break;
+        case 0x60:
+            value_data->type = AMQP_TYPE_USHORT;
+            value_data->value.ushort_value = read_uint16_be(buffer);
+            break;
+        case 0x43:
+            value_data->type = AMQP_TYPE_UINT;
+            value_data->value.uint_value = 0;
+            break;
+        case 0x52:
+            value_data->type = AMQP_TYPE_UINT;
+            value_data->value.uint_value = buffer[0];
+            break;
+        case 0x70:
+            value_data->type = AMQP_TYPE_UINT;
+            value_data->value.uint_value = read_uint32_be(buffer);
+            break;
+        case 0x44:
+            value_data->type = AMQP_TYPE_ULONG;
+            value_data->value.ulong_value = 0;
+            break;
+        case 0x53:
+            value_data->type = AMQP_TYPE_ULONG;
+            value_data->value.ulong_value = buffer[0];
+            break;
+        case 0x80:
+            value_data->type = AMQP_TYPE_ULONG;
+            value_data->value.ulong_value = read_uint64_be(buffer);
+            break;
+        case 0x51:
+            value_data->type = AMQP_TYPE_BYTE;
+            value_data->value.byte_value = (char)buffer[0];
+            break;
+        case 0x61:
+            value_data->type = AMQP_TYPE_SHORT;
+            value_data->value.short_value = (int16_t)read_uint16_be(buffer);
+            break;
+        case 0x54:
+            value_data->type = AMQP_TYPE_INT;
+            value_data->value.int_value = (int32_t)((int8_t)buffer[0]);
+            break;
+        case 0x71:
+            value_data->type = AMQP_TYPE_INT;
+            value_data->value.int_value = (int32_t)read_uint32_be(buffer);
+            break;
+        case 0x55:
+            value_data->type = AMQP_TYPE_LONG;
+            value_data->value.long_value = (int64_t)((int8_t)buffer[0]);
+            break;
+        case 0x81:
+            value_data->type = AMQP_TYPE_LONG;
+            value_data->value.long_value = (int64_t)read_uint64_be(buffer);
+            break;
+        case 0x72:
+        {
+            uint32_t float_bits = read_uint32_be(buffer);
+            value_data->type = AMQP_TYPE_FLOAT;
+            (void)memcpy(&value_data->value.float_value, &float_bits, sizeof(float_bits));
+            break;
+        }
+        case 0x82:
+        {
+            uint64_t double_bits = read_uint64_be(buffer);
+            value_data->type = AMQP_TYPE_DOUBLE;
+            (void)memcpy(&value_data->value.double_value, &double_bits, sizeof(double_bits));
+            break;
+        }
+        case 0x83:
+            value_data->type = AMQP_TYPE_TIMESTAMP;
+            value_data->value.timestamp_value = (int64_t)read_uint64_be(buffer);
+            break;
+        case 0x98:
+            value_data->type = AMQP_TYPE_UUID;
+            (void)memcpy(value_data->value.uuid_value, buffer, 16);
+            break;
+
+        case 0xA0:
+        case 0xB0:
+        {
+            size_t length = (constructor_byte == 0xA0) ? buffer[0] : read_uint32_be(buffer);
+            if (length > size - fixed_width)
+            {
+                LogError("Binary length %lu exceeds the remaining bytes", (unsigned long)length);
+                result = MU_FAILURE;
+            }
+            else
+            {
+                PAYLOAD* binary_value = options->borrow ? payload_create() : payload_create_and_reserve(length);
+                if (binary_value == NULL)
+                {
+                    LogError("Could not allocate memory for decoded binary value");
+                    result = MU_FAILURE;
+                }
+                else
+                {
+                    if (length > 0)
+                    {
+                        if (options->borrow)
+                        {
+                            payload_append_borrowed_data(binary_value, buffer + fixed_width, length);
+                            value_data->borrowed = true;
+                        }
+                        else
+                        {
+                            payload_append_data(binary_value, buffer + fixed_width, length);
+                        }
+                    }
+
+                    value_data->type = AMQP_TYPE_BINARY;
+                    value_data->value.binary_value = binary_value;
+                    *used_bytes = fixed_width + length;
+                }
+            }
+            break;
+        }
+
+        case 0xA1:
+        case 0xB1:
+        case 0xA3:
+        case 0xB3:
+        {
+            size_t length = ((constructor_byte == 0xA1) || (constructor_byte == 0xA3)) ? buffer[0] : read_uint32_be(buffer);
+            if (length > size - fixed_width)
+            {
+                LogError("String length %lu exceeds the remaining bytes", (unsigned long)length);
+                result = MU_FAILURE;
+            }
+            else
+            {
+                char* chars = (char*)malloc(length + 1);
+                if (chars == NULL)
+                {
+                    LogError("Could not allocate memory for decoded string value");
+                    result = MU_FAILURE;
+                }
+                else
+                {
+                    (void)memcpy(chars, buffer + fixed_width, length);
+                    chars[length] = '\0';
+
+                    if ((constructor_byte == 0xA1) || (constructor_byte == 0xB1))
+                    {
+                        value_data->type = AMQP_TYPE_STRING;
+                        value_data->value.string_value.chars = chars;
+                    }
+                    else
+                    {
+                        value_data->type = AMQP_TYPE_SYMBOL;
+                        value_data->value.symbol_value.chars = chars;
+                    }
+
+                    *used_bytes = fixed_width + length;
+                }
+            }
+            break;
+        }
+
+        case 0x45:
+            value_data->type = AMQP_TYPE_LIST;
+            value_data->value.list_value.count = 0;
+            value_data->value.list_value.items = NULL;
+            break;
+        case 0xC0:
+        case 0xD0:
+            result = decode_buffer_list(buffer, size, constructor_byte == 0xC0, value_data, used_bytes, depth, options);
+            break;
+        case 0xC1:
+        case 0xD1:
+            result = decode_buffer_map(buffer, size, constructor_byte == 0xC1, value_data, used_bytes, depth, options);
+            break;
+        case 0xE0:
+        case 0xF0:
+            result = decode_buffer_array(buffer, size, constructor_byte == 0xE0, value_data, used_bytes, depth, options);
+            break;
+        }
+    }
+
+    return result;
+}
+
+int amqpvalue_decode_buffer(const unsigned char* buffer, size_t size, AMQP_VALUE* value, size_t* used_bytes)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_434: [If buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+    if ((buffer == NULL) ||
+        (size == 0) ||
+        (value == NULL) ||
+        (used_bytes == NULL))
+    {
+        LogError("Bad arguments: buffer = %p, size = %lu, value = %p, used_bytes = %p",
+            buffer, (unsigned long)size, value, used_bytes);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_SRS_AMQPVALUE_01_435: [amqpvalue_decode_buffer shall decode the first AMQP value encoded in buffer and return it in value.] */
+        /* Codes_SRS_AMQPVALUE_01_436: [The number of bytes taken by the value shall be returned in used_bytes.] */
+        DECODE_BUFFER_OPTIONS options = { false, NULL };
+        *value = decode_buffer_new_value(buffer, size, used_bytes, 0, &options);
+        if (*value == NULL)
+        {
+            /* Codes_SRS_AMQPVALUE_01_437: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+            LogError("Decoding buffer failed");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_438: [On success, amqpvalue_decode_buffer shall return 0.] */
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+int amqpvalue_decode_buffer_borrowed(const unsigned char* buffer, size_t size, AMQP_VALUE* value, size_t* used_bytes)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_439: [If buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer_borrowed shall fail and return a non-zero value.] */
+    if ((buffer == NULL) ||
+        (size == 0) ||
+        (value == NULL) ||
+        (used_bytes == NULL))
+    {
+        LogError("Bad arguments: buffer = %p, size = %lu, value = %p, used_bytes = %p",
+            buffer, (unsigned long)size, value, used_bytes);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_SRS_AMQPVALUE_01_440: [amqpvalue_decode_buffer_borrowed shall decode the first AMQP value encoded in buffer, return it in value and return the number of bytes taken by the value in used_bytes.] */
+        /* Codes_SRS_AMQPVALUE_01_441: [Binary values with a non-zero length shall reference their bytes in buffer instead of copying them.] */
+        DECODE_BUFFER_OPTIONS options = { true, NULL };
+        *value = decode_buffer_new_value(buffer, size, used_bytes, 0, &options);
+        if (*value == NULL)
+        {
+            /* Codes_SRS_AMQPVALUE_01_442: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer_borrowed shall fail and return a non-zero value.] */
+            LogError("Decoding buffer failed");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_443: [On success, amqpvalue_decode_buffer_borrowed shall return 0.] */
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+AMQPVALUE_ARENA_HANDLE amqpvalue_arena_create(size_t chunk_size)
+{
+    AMQPVALUE_ARENA_HANDLE_DATA* result;
+
+    /* Codes_SRS_AMQPVALUE_01_449: [If chunk_size is 0, amqpvalue_arena_create shall fail and return NULL.] */
+    if (chunk_size == 0)
+    {
+        LogError("Invalid arena chunk size 0");
+        result = NULL;
+    }
+    else
+    {
+        /* Codes_SRS_AMQPVALUE_01_450: [amqpvalue_arena_create shall create an arena that allocates decoded values from chunks of chunk_size bytes and return a non-NULL handle to it.] */
+        result = (AMQPVALUE_ARENA_HANDLE_DATA*)malloc(sizeof(AMQPVALUE_ARENA_HANDLE_DATA));
+        if (result == NULL)
+        {
+            /* Codes_SRS_AMQPVALUE_01_451: [If allocating memory for the arena fails, amqpvalue_arena_create shall fail and return NULL.] */
+            LogError("Could not allocate memory for arena");
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_452: [amqpvalue_arena_create shall not allocate the first chunk, it shall be allocated by the first decode.] */
+            result->current_chunk = NULL;
+            result->chunk_size = chunk_size;
+        }
+    }
+
+    return result;
+}
+
+void amqpvalue_arena_destroy(AMQPVALUE_ARENA_HANDLE arena)
+{
+    /* Codes_SRS_AMQPVALUE_01_453: [If arena is NULL, amqpvalue_arena_destroy shall do nothing.] */
+    if (arena == NULL)
+    {
+        LogError("NULL arena");
+    }
+    else
+    {
+        /* Codes_SRS_AMQPVALUE_01_454: [amqpvalue_arena_destroy shall free the arena; chunks that still hold live values shall be freed when the last of those values is destroyed.] */
+        arena_detach_current_chunk(arena);
+        free(arena);
+    }
+}
+
+int amqpvalue_decode_buffer_in_arena(AMQPVALUE_ARENA_HANDLE arena, const unsigned char* buffer, size_t size, bool borrow_binaries, AMQP_VALUE* value, size_t* used_bytes)
+{
+    int result;
+
+    /* Codes_SRS_AMQPVALUE_01_455: [If arena, buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer_in_arena shall fail and return a non-zero value.] */
+    if ((arena == NULL) ||
+        (buffer == NULL) ||
+        (size == 0) ||
+        (value == NULL) ||
+        (used_bytes == NULL))
+    {
+        LogError("Bad arguments: arena = %p, buffer = %p, size = %lu, value = %p, used_bytes = %p",
+            arena, buffer, (unsigned long)size, value, used_bytes);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_SRS_AMQPVALUE_01_456: [amqpvalue_decode_buffer_in_arena shall decode the first AMQP value encoded in buffer like amqpvalue_decode_buffer, or like amqpvalue_decode_buffer_borrowed when borrow_binaries is true.] */
+        /* Codes_SRS_AMQPVALUE_01_457: [The decoded values and the items of decoded lists, maps and arrays shall be allocated from arena.] */
+        DECODE_BUFFER_OPTIONS options;
+        options.borrow = borrow_binaries;
+        options.arena = arena;
+
+        *value = decode_buffer_new_value(buffer, size, used_bytes, 0, &options);
+        if (*value == NULL)
+        {
+            /* Codes_SRS_AMQPVALUE_01_458: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer_in_arena shall fail and return a non-zero value.] */
+            LogError("Decoding buffer failed");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_SRS_AMQPVALUE_01_459: [On success, amqpvalue_decode_buffer_in_arena shall return 0.] */
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
 AMQP_VALUE amqpvalue_get_inplace_descriptor(AMQP_VALUE value)
 {
     AMQP_VALUE result;
@@ -7061,7 +8931,7 @@ AMQP_VALUE amqpvalue_get_inplace_described_value(AMQP_VALUE value)
 
 AMQP_VALUE amqpvalue_create_described(AMQP_VALUE descriptor, AMQP_VALUE value)
 {
-    AMQP_VALUE_DATA* result = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE_DATA* result = create_value_data();
     if (result == NULL)
     {
         LogError("Cannot allocate memory for described type");
@@ -7078,7 +8948,7 @@ AMQP_VALUE amqpvalue_create_described(AMQP_VALUE descriptor, AMQP_VALUE value)
 
 AMQP_VALUE amqpvalue_create_composite(AMQP_VALUE descriptor, uint32_t list_size)
 {
-    AMQP_VALUE_DATA* result = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE_DATA* result = create_value_data();
     if (result == NULL)
     {
         LogError("Cannot allocate memory for composite type");
@@ -7122,7 +8992,7 @@ AMQP_VALUE amqpvalue_create_composite(AMQP_VALUE descriptor, uint32_t list_size)
 
 AMQP_VALUE amqpvalue_create_composite_with_ulong_descriptor(uint64_t descriptor)
 {
-    AMQP_VALUE_DATA* result = (AMQP_VALUE_DATA*)REFCOUNT_TYPE_CREATE(AMQP_VALUE_DATA);
+    AMQP_VALUE_DATA* result = create_value_data();
     if (result == NULL)
     {
         LogError("Cannot allocate memory for composite type");
@@ -16,6 +16,8 @@
 #include "azure_uamqp_c/amqp_frame_codec.h"
 #include "azure_uamqp_c/amqp_definitions.h"
 #include "azure_uamqp_c/amqpvalue_to_string.h"
+#include "azure_uamqp_c/xio_sendv.h"
+#include "azure_uamqp_c/timer_queue.h"
 
 /* Requirements satisfied by the virtue of implementing the ISO:*/
 /* Codes_S_R_S_CONNECTION_01_088: [Any data appearing beyond the protocol header MUST match the version indicated by the protocol header.] */
@@ -24,6 +26,9 @@
 /* Codes_S_R_S_CONNECTION_01_087: [The protocol header consists of the upper case ASCII letters "AMQP" followed by a protocol id of zero, followed by three unsigned bytes representing the major, minor, and revision of the protocol version (currently 1 (MAJOR), 0 (MINOR), 0 (REVISION)). In total this is an 8-octet sequence] */
 static const unsigned char amqp_header[] = { 'A', 'M', 'Q', 'P', 0, 1, 0, 0 };
 
+/* every frame starts with its size, as a 4 byte big endian unsigned integer */
+#define FRAME_SIZE_BYTE_COUNT 4
+
 typedef enum RECEIVE_FRAME_STATE_TAG
 {
     RECEIVE_FRAME_STATE_FRAME_SIZE,
@@ -50,6 +55,10 @@ typedef struct CONNECTION_INSTANCE_TAG
 {
     XIO_HANDLE io;
     size_t header_bytes_received;
+    /* where the incoming byte stream is within the current frame, so received bytes are handed to the frame codec one frame at a time */
+    uint32_t incoming_frame_size;
+    uint32_t incoming_frame_bytes_left;
+    unsigned char incoming_frame_size_bytes_received;
     CONNECTION_STATE connection_state;
     FRAME_CODEC_HANDLE frame_codec;
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec;
@@ -84,9 +93,34 @@ typedef struct CONNECTION_INSTANCE_TAG
     tickcounter_ms_t last_frame_sent_time;
     fields properties;
 
+    /* idle timeouts and the timeouts of everything running on the connection (deliveries, sends) are kept here */
+    TIMER_QUEUE_HANDLE timer_queue;
+    /* these only look at the last frame times when they expire, so receiving or sending a frame does not touch them */
+    TIMER idle_timer;
+    TIMER empty_frame_timer;
+
+    /* scatter/gather send of the underlying io, if it has one */
+    XIO_SENDV sendv;
+    void* sendv_context;
+
+    /* encoded frames are coalesced here and handed to the io once per connection_dowork or on connection_flush */
+    unsigned char* output_buffer;
+    size_t output_buffer_capacity;
+    size_t output_buffer_used;
+    size_t output_buffer_size;
+
+    /* write coalescing: when the threshold is not 0, the output buffer is only flushed by connection_dowork once it
+    holds threshold bytes or its oldest frame has waited max_delay_us */
+    size_t coalescing_flush_threshold;
+    uint32_t coalescing_max_delay_us;
+    tickcounter_ms_t output_pending_since;
+
     unsigned int is_underlying_io_open : 1;
+    unsigned int is_gathered_send_enabled : 1;
+    unsigned int is_sendv_queried : 1;
     unsigned int idle_timeout_specified : 1;
     unsigned int is_remote_frame_received : 1;
+    unsigned int is_idle_timeout_expired : 1;
     unsigned int is_trace_on : 1;
 } CONNECTION_INSTANCE;
 
@@ -269,16 +303,21 @@ static void log_outgoing_frame(AMQP_VALUE performative)
 typedef struct
 {
    CONNECTION_HANDLE connection;
-   struct
-   {
-      unsigned char *data;
-      size_t         size;
-      size_t         capacity;
-   } buffer;
    size_t number_of_bytes_expected;
    bool error_free;
 } StreamingContext;
 
+#define MAX_SENDV_BUFFERS 64
+
+typedef struct
+{
+   CONNECTION_HANDLE connection;
+   XIO_SEND_BUFFER buffers[MAX_SENDV_BUFFERS];
+   size_t buffer_count;
+   size_t number_of_bytes_expected;
+   bool error_free;
+} GatheringContext;
+
 // [JEP] use this low level debug for getting insight into the AMQP byte data
 // #define AMQP_LOW_LEVEL_DEBUG
 #if defined(AMQP_LOW_LEVEL_DEBUG)
@@ -330,83 +369,279 @@ void DebugOutput(const uint8_t* buffer, size_t length)
 }
 #endif
 
-static bool connection_stream_flush_buffer(StreamingContext *context)
+// output buffer size used until connection_set_output_buffer_size is called, if the remote max frame size is larger
+static const size_t MAX_DEFAULT_OUTPUT_BUFFER_SIZE = 64 * 1024;
+
+static size_t get_output_buffer_size(CONNECTION_HANDLE connection)
 {
-   CONNECTION_HANDLE connection = context->connection;
-   DebugOutput(context->buffer.data, context->buffer.size);
-   return xio_send(connection->io, context->buffer.data, context->buffer.size, NULL, NULL) == 0;
+   size_t result;
+
+   if (connection->output_buffer_size != 0)
+   {
+      result = connection->output_buffer_size;
+   }
+   /* Codes_S_R_S_CONNECTION_01_295: [If connection_set_output_buffer_size has not been called, the output buffer size shall be the remote max frame size, capped at 64 KB.] */
+   else if (connection->remote_max_frame_size > MAX_DEFAULT_OUTPUT_BUFFER_SIZE)
+   {
+      result = MAX_DEFAULT_OUTPUT_BUFFER_SIZE;
+   }
+   else
+   {
+      result = connection->remote_max_frame_size;
+   }
+
+   return result;
 }
 
-static bool connection_stream_payload(void *generic_context, const unsigned char *buffer, size_t length)
+static bool ensure_output_buffer(CONNECTION_HANDLE connection)
 {
-   size_t bytes_written = 0;
-   StreamingContext *context = (StreamingContext*)generic_context;
+   size_t output_buffer_size = get_output_buffer_size(connection);
 
-   if (context->number_of_bytes_expected < length)
+   // the buffer is only resized while it holds no pending bytes
+   if ((connection->output_buffer_used == 0) &&
+       (connection->output_buffer_capacity != output_buffer_size))
+   {
+      unsigned char *new_output_buffer = (unsigned char *)realloc(connection->output_buffer, output_buffer_size);
+      if (new_output_buffer == NULL)
+      {
+         LogError("Could not allocate output buffer of %lu bytes", (unsigned long)output_buffer_size);
+      }
+      else
+      {
+         connection->output_buffer = new_output_buffer;
+         connection->output_buffer_capacity = output_buffer_size;
+      }
+   }
+
+   return connection->output_buffer != NULL;
+}
+
+static bool flush_output_buffer(CONNECTION_HANDLE connection)
+{
+   bool result;
+
+   if (connection->output_buffer_used == 0)
+   {
+      result = true;
+   }
+   else
+   {
+      DebugOutput(connection->output_buffer, connection->output_buffer_used);
+
+      /* Codes_S_R_S_CONNECTION_01_296: [Encoded frames shall be copied into the output buffer and its contents shall be sent with xio_send when it is full or flushed.] */
+      result = (xio_send(connection->io, connection->output_buffer, connection->output_buffer_used, NULL, NULL) == 0);
+      if (!result)
+      {
+         LogError("Sending the output buffer failed");
+      }
+
+      // on failure the pending bytes are dropped, the connection is closed by the caller
+      connection->output_buffer_used = 0;
+   }
+
+   return result;
+}
+
+static bool take_expected_bytes(size_t *number_of_bytes_expected, size_t length)
+{
+   bool result;
+
+   if (*number_of_bytes_expected < length)
    {
       //DPRINTF_ALWAYS("[amqp] WARNING: message callback has outgrown its original length calculation");
-      context->error_free = false;
-      context->number_of_bytes_expected = 0; // no more bytes allowed due to error
+      *number_of_bytes_expected = 0; // no more bytes allowed due to error
+      result = false;
    }
    else
    {
       // by the end of this call we should expect "length" less bytes to come
-      context->number_of_bytes_expected -= length;
+      *number_of_bytes_expected -= length;
+      result = true;
    }
 
-   size_t spare_capacity = context->buffer.capacity - context->buffer.size;
+   return result;
+}
+
+static bool connection_stream_payload(void *generic_context, const unsigned char *buffer, size_t length)
+{
+   StreamingContext *context = (StreamingContext*)generic_context;
+   CONNECTION_HANDLE connection = context->connection;
 
-   // keep filling the buffer and writing the data 
-   while (context->error_free && length > spare_capacity)
+   if (!take_expected_bytes(&context->number_of_bytes_expected, length))
    {
-      memcpy(&context->buffer.data[context->buffer.size], buffer, spare_capacity);
-      context->buffer.size += spare_capacity;
-      bytes_written += spare_capacity;
+      context->error_free = false;
+   }
 
-      if (connection_stream_flush_buffer(context))
+   // keep filling the buffer and writing the data
+   while (context->error_free && length > 0)
+   {
+      if (connection->output_buffer_used == connection->output_buffer_capacity)
       {
-         length -= spare_capacity;
-         buffer += spare_capacity;
-         context->buffer.size = 0;
-         spare_capacity = context->buffer.capacity;
+         context->error_free = flush_output_buffer(connection);
       }
       else
       {
+         size_t chunk_size = connection->output_buffer_capacity - connection->output_buffer_used;
+         if (chunk_size > length)
+         {
+            chunk_size = length;
+         }
+
+         memcpy(connection->output_buffer + connection->output_buffer_used, buffer, chunk_size);
+         connection->output_buffer_used += chunk_size;
+         buffer += chunk_size;
+         length -= chunk_size;
+      }
+   }
+
+   return context->error_free;
+}
+
+static bool connection_gather_flush(GatheringContext *context)
+{
+   CONNECTION_HANDLE connection = context->connection;
+   size_t i;
+
+   if (context->error_free && (context->buffer_count > 0))
+   {
+      for (i = 0; i < context->buffer_count; i++)
+      {
+         DebugOutput(context->buffers[i].buffer, context->buffers[i].size);
+      }
+
+      /* Codes_S_R_S_CONNECTION_01_289: [If the underlying io provided a sendv function, the encoded frame bytes shall be sent by calling it with the byte array parts of the frame payload as XIO_SEND_BUFFER entries, without copying them.] */
+      if (connection->sendv(connection->sendv_context, context->buffers, context->buffer_count) != 0)
+      {
+         LogError("Gathered send failed");
          context->error_free = false;
       }
    }
 
-   if (context->error_free)
+   context->buffer_count = 0;
+   connection->output_buffer_used = 0;
+   return context->error_free;
+}
+
+static bool connection_gather_bytes(void *generic_context, const unsigned char *buffer, size_t length)
+{
+   GatheringContext *context = (GatheringContext*)generic_context;
+
+   if (!take_expected_bytes(&context->number_of_bytes_expected, length))
    {
-      // finally copy the last remnant onto the buffer
-      memcpy(&context->buffer.data[context->buffer.size], buffer, length);
-      context->buffer.size += length;
-      bytes_written += length;
+      context->error_free = false;
+   }
+   else if (length > 0)
+   {
+      if (context->buffer_count == MAX_SENDV_BUFFERS)
+      {
+         (void)connection_gather_flush(context);
+      }
+
+      if (context->error_free)
+      {
+         context->buffers[context->buffer_count].buffer = buffer;
+         context->buffers[context->buffer_count].size = length;
+         context->buffer_count++;
+      }
    }
 
    return context->error_free;
 }
 
-static const size_t BUFFER_SIZE = 1024;
+/* Codes_S_R_S_CONNECTION_01_290: [Output of callback parts of the frame payload shall be copied into the output buffer and sent from there.] */
+static bool connection_gather_callback_output(void *generic_context, const unsigned char *buffer, size_t length)
+{
+   GatheringContext *context = (GatheringContext*)generic_context;
+   CONNECTION_HANDLE connection = context->connection;
 
-static void on_bytes_encoded(void* context, PAYLOAD *payload, bool encode_complete)
+   if (!take_expected_bytes(&context->number_of_bytes_expected, length))
+   {
+      context->error_free = false;
+   }
+
+   while (context->error_free && length > 0)
+   {
+      unsigned char *buffered_end = connection->output_buffer + connection->output_buffer_used;
+      bool extends_last_buffer = (context->buffer_count > 0) &&
+         (context->buffers[context->buffer_count - 1].buffer + context->buffers[context->buffer_count - 1].size == buffered_end);
+
+      if ((connection->output_buffer_used == connection->output_buffer_capacity) ||
+          (!extends_last_buffer && (context->buffer_count == MAX_SENDV_BUFFERS)))
+      {
+         (void)connection_gather_flush(context);
+      }
+      else
+      {
+         size_t chunk_size = connection->output_buffer_capacity - connection->output_buffer_used;
+         if (chunk_size > length)
+         {
+            chunk_size = length;
+         }
+
+         memcpy(buffered_end, buffer, chunk_size);
+         if (extends_last_buffer)
+         {
+            context->buffers[context->buffer_count - 1].size += chunk_size;
+         }
+         else
+         {
+            context->buffers[context->buffer_count].buffer = buffered_end;
+            context->buffers[context->buffer_count].size = chunk_size;
+            context->buffer_count++;
+         }
+
+         connection->output_buffer_used += chunk_size;
+         buffer += chunk_size;
+         length -= chunk_size;
+      }
+   }
+
+   return context->error_free;
+}
+
+static bool send_payload_gathered(CONNECTION_HANDLE connection, PAYLOAD *payload, size_t frame_size)
+{
+   bool success;
+   GatheringContext gathering_context;
+   gathering_context.connection = connection;
+   gathering_context.buffer_count = 0;
+   gathering_context.number_of_bytes_expected = frame_size;
+   gathering_context.error_free = true;
+
+   // frames coalesced so far go out in front of this one, in the same call
+   if (connection->output_buffer_used > 0)
+   {
+      gathering_context.buffers[0].buffer = connection->output_buffer;
+      gathering_context.buffers[0].size = connection->output_buffer_used;
+      gathering_context.buffer_count = 1;
+   }
+
+   success = payload_stream_output_parts(payload, connection_gather_bytes, connection_gather_callback_output, &gathering_context);
+   if (success)
+   {
+      // If the length has shrunk since we calculated it we should pad to honour our length field
+      while (success && gathering_context.number_of_bytes_expected > 0)
+      {
+         unsigned char spaceToPad = (unsigned char)' ';
+         success = connection_gather_callback_output(&gathering_context, &spaceToPad, 1);
+      }
+
+      success = connection_gather_flush(&gathering_context);
+   }
+
+   return success;
+}
+
+static bool send_payload_buffered(CONNECTION_HANDLE connection, PAYLOAD *payload, size_t frame_size)
 {
-   CONNECTION_HANDLE connection = (CONNECTION_HANDLE)context;
-   
-   unsigned char *buffer = (unsigned char *)malloc(BUFFER_SIZE);
    StreamingContext streaming_context =
    {
       .connection = connection,
-      .buffer = {
-         .data = buffer,
-         .size = 0,
-         .capacity = BUFFER_SIZE
-      },
-      .number_of_bytes_expected = payload_get_length(payload),
+      .number_of_bytes_expected = frame_size,
       .error_free = true
    };
 
-   // stream all payload output to the socket
+   // stream all payload output into the output buffer, whatever is left in it goes out on the next flush
    bool success = payload_stream_output(payload, connection_stream_payload, &streaming_context);
    if (success)
    {
@@ -421,11 +656,113 @@ static void on_bytes_encoded(void* context, PAYLOAD *payload, bool encode_comple
             success = connection_stream_payload(&streaming_context, &spaceToPad, 1);
          }
       }
-      success = connection_stream_flush_buffer(&streaming_context);
    }
-   DebugCompleteLine();
 
-   free(buffer);
+   return success;
+}
+
+static void query_sendv(CONNECTION_HANDLE connection)
+{
+   XIO_SENDV_QUERY sendv_query = { NULL, NULL };
+
+   /* Codes_S_R_S_CONNECTION_01_288: [If gathered sends were turned on with connection_set_gathered_send, before sending the first encoded frame the connection shall ask the underlying io for a scatter/gather send by calling xio_setoption with OPTION_XIO_SENDV and an XIO_SENDV_QUERY.] */
+   /* Codes_S_R_S_CONNECTION_01_291: [If xio_setoption fails or does not fill in a sendv function, encoded frames shall be sent with xio_send.] */
+   if ((xio_setoption(connection->io, OPTION_XIO_SENDV, &sendv_query) == 0) &&
+       (sendv_query.sendv != NULL))
+   {
+      connection->sendv = sendv_query.sendv;
+      connection->sendv_context = sendv_query.sendv_context;
+   }
+   else if (connection->is_trace_on == 1)
+   {
+      // not an error, most ios do not have a gathered send
+      LOG(AZ_LOG_TRACE, LOG_LINE, "Underlying io has no gathered send, frames are sent with xio_send");
+   }
+
+   connection->is_sendv_queried = 1;
+}
+
+static bool is_output_flush_due(CONNECTION_HANDLE connection)
+{
+   bool result;
+   tickcounter_ms_t current_ms;
+
+   if (connection->output_buffer_used == 0)
+   {
+      result = false;
+   }
+   else if ((connection->coalescing_flush_threshold == 0) ||
+      (connection->output_buffer_used >= connection->coalescing_flush_threshold))
+   {
+      result = true;
+   }
+   else if (tickcounter_get_current_ms(connection->tick_counter, &current_ms) != 0)
+   {
+      LogError("Could not get tick counter value");
+      result = true;
+   }
+   else
+   {
+      // the tick counter has millisecond resolution, so the delay is effectively rounded up to a whole millisecond
+      result = ((current_ms - connection->output_pending_since) * 1000 >= connection->coalescing_max_delay_us);
+   }
+
+   return result;
+}
+
+static void on_bytes_encoded(void* context, PAYLOAD *payload, bool encode_complete)
+{
+   CONNECTION_HANDLE connection = (CONNECTION_HANDLE)context;
+   bool was_output_pending = (connection->output_buffer_used > 0);
+   bool success;
+
+   if (connection->is_gathered_send_enabled &&
+       !connection->is_sendv_queried)
+   {
+      query_sendv(connection);
+   }
+
+   if (!ensure_output_buffer(connection))
+   {
+      success = false;
+   }
+   else
+   {
+      size_t frame_size = payload_get_length(payload);
+
+      /* Codes_S_R_S_CONNECTION_01_297: [Frames that do not fit in the space left in the output buffer shall be sent with the gathered send, together with the pending output buffer contents, if the underlying io provided one.] */
+      if ((connection->sendv != NULL) &&
+          (frame_size > connection->output_buffer_capacity - connection->output_buffer_used))
+      {
+         success = send_payload_gathered(connection, payload, frame_size);
+      }
+      else
+      {
+         success = send_payload_buffered(connection, payload, frame_size);
+      }
+
+      if (success && encode_complete && (connection->on_send_complete != NULL))
+      {
+         /* Codes_S_R_S_CONNECTION_01_318: [A frame sent with an on_send_complete callback shall be sent with the output buffer before the callback is called, so that the send result reported is the result of handing its bytes to the io.] */
+         success = flush_output_buffer(connection);
+      }
+      else if (success && (connection->coalescing_flush_threshold != 0))
+      {
+         /* Codes_S_R_S_CONNECTION_01_308: [When write coalescing is on, the output buffer shall be sent as soon as it holds flush_threshold bytes or more.] */
+         if (connection->output_buffer_used >= connection->coalescing_flush_threshold)
+         {
+            success = flush_output_buffer(connection);
+         }
+         else if (!was_output_pending &&
+            (connection->output_buffer_used > 0) &&
+            (tickcounter_get_current_ms(connection->tick_counter, &connection->output_pending_since) != 0))
+         {
+            LogError("Could not get tick counter value");
+            success = flush_output_buffer(connection);
+         }
+      }
+   }
+   DebugCompleteLine();
 
    // was this the end of the data? if so do it one last time
    if (encode_complete)
@@ -443,6 +780,7 @@ static void on_bytes_encoded(void* context, PAYLOAD *payload, bool encode_comple
       connection_set_state(connection, CONNECTION_STATE_END);
    }
 }
+
 static int send_open_frame(CONNECTION_HANDLE connection)
 {
     int result;
@@ -655,6 +993,12 @@ static int send_close_frame(CONNECTION_HANDLE connection, ERROR_HANDLE error_han
                     LogError("amqp_frame_codec_encode_frame failed");
                     result = MU_FAILURE;
                 }
+                /* Codes_S_R_S_CONNECTION_01_299: [The CLOSE frame shall be sent from the output buffer right away, as the io is closed right after it.] */
+                else if (!flush_output_buffer(connection))
+                {
+                    LogError("Sending the CLOSE frame failed");
+                    result = MU_FAILURE;
+                }
                 else
                 {
                     if (connection->is_trace_on == 1)
@@ -793,7 +1137,7 @@ static ENDPOINT_INSTANCE* find_session_endpoint_by_incoming_channel(CONNECTION_H
     return result;
 }
 
-static int connection_byte_received(CONNECTION_HANDLE connection, unsigned char b)
+static int connection_bytes_received(CONNECTION_HANDLE connection, const unsigned char* buffer, size_t size, size_t* bytes_consumed)
 {
     int result;
 
@@ -809,7 +1153,10 @@ static int connection_byte_received(CONNECTION_HANDLE connection, unsigned char
 
     /* Codes_S_R_S_CONNECTION_01_041: [HDR SENT In this state the connection header has been sent to the peer but no connection header has been received.] */
     case CONNECTION_STATE_HDR_SENT:
-        if (b != amqp_header[connection->header_bytes_received])
+        /* the protocol header is matched one byte at a time, as the state changes once it is complete */
+        *bytes_consumed = 1;
+
+        if (buffer[0] != amqp_header[connection->header_bytes_received])
         {
             /* Codes_S_R_S_CONNECTION_01_089: [If the incoming and outgoing protocol headers do not match, both peers MUST close their outgoing stream] */
             if (xio_close(connection->io, NULL, NULL) != 0)
@@ -858,13 +1205,51 @@ static int connection_byte_received(CONNECTION_HANDLE connection, unsigned char
 
     /* Codes_S_R_S_CONNECTION_01_048: [OPENED In this state the connection header and the open frame have been both sent and received.] */
     case CONNECTION_STATE_OPENED:
+    {
+        size_t frame_chunk_size = 0;
+
+        /* Codes_S_R_S_CONNECTION_01_319: [Received bytes shall be passed to the frame_codec at most one frame at a time, so that once a frame (such as CLOSE) moves the connection out of the states in which frames are received, the bytes that follow it are not decoded.] */
+        while ((connection->incoming_frame_size_bytes_received < FRAME_SIZE_BYTE_COUNT) &&
+            (frame_chunk_size < size))
+        {
+            connection->incoming_frame_size = (connection->incoming_frame_size << 8) + buffer[frame_chunk_size];
+            connection->incoming_frame_size_bytes_received++;
+            frame_chunk_size++;
+
+            if (connection->incoming_frame_size_bytes_received == FRAME_SIZE_BYTE_COUNT)
+            {
+                /* a size too small for a frame is left to the frame codec to reject */
+                connection->incoming_frame_bytes_left = (connection->incoming_frame_size > FRAME_SIZE_BYTE_COUNT) ? (connection->incoming_frame_size - FRAME_SIZE_BYTE_COUNT) : 0;
+            }
+        }
+
+        if (size - frame_chunk_size < connection->incoming_frame_bytes_left)
+        {
+            connection->incoming_frame_bytes_left -= (uint32_t)(size - frame_chunk_size);
+            frame_chunk_size = size;
+        }
+        else
+        {
+            frame_chunk_size += connection->incoming_frame_bytes_left;
+            connection->incoming_frame_bytes_left = 0;
+        }
+
+        if ((connection->incoming_frame_size_bytes_received == FRAME_SIZE_BYTE_COUNT) &&
+            (connection->incoming_frame_bytes_left == 0))
+        {
+            connection->incoming_frame_size = 0;
+            connection->incoming_frame_size_bytes_received = 0;
+        }
+
+        *bytes_consumed = frame_chunk_size;
+
         /* Codes_S_R_S_CONNECTION_01_212: [After the initial handshake has been done all bytes received from the io instance shall be passed to the frame_codec for decoding by calling frame_codec_receive_bytes.] */
-        if (frame_codec_receive_bytes(connection->frame_codec, &b, 1) != 0)
+        if (frame_codec_receive_bytes(connection->frame_codec, buffer, frame_chunk_size) != 0)
         {
             LogError("Cannot process received bytes");
             /* Codes_S_R_S_CONNECTION_01_218: [The error amqp:internal-error shall be set in the error.condition field of the CLOSE frame.] */
             /* Codes_S_R_S_CONNECTION_01_219: [The error description shall be set to an implementation defined string.] */
-            close_connection_with_error(connection, "amqp:internal-error", "connection_byte_received::frame_codec_receive_bytes failed", NULL);
+            close_connection_with_error(connection, "amqp:internal-error", "connection_bytes_received::frame_codec_receive_bytes failed", NULL);
             result = MU_FAILURE;
         }
         else
@@ -874,21 +1259,27 @@ static int connection_byte_received(CONNECTION_HANDLE connection, unsigned char
 
         break;
     }
+    }
 
     return result;
 }
 
 static void connection_on_bytes_received(void* context, const unsigned char* buffer, size_t size)
 {
-    size_t i;
+    CONNECTION_HANDLE connection = (CONNECTION_HANDLE)context;
 
-    for (i = 0; i < size; i++)
+    while (size > 0)
     {
-        if (connection_byte_received((CONNECTION_HANDLE)context, buffer[i]) != 0)
+        size_t bytes_consumed = 0;
+
+        if (connection_bytes_received(connection, buffer, size, &bytes_consumed) != 0)
         {
             LogError("Cannot process received bytes");
             break;
         }
+
+        buffer += bytes_consumed;
+        size -= bytes_consumed;
     }
 }
 
@@ -953,6 +1344,7 @@ static void connection_on_io_error(void* context)
     if (connection->connection_state != CONNECTION_STATE_END)
     {
         /* Codes_S_R_S_CONNECTION_01_202: [If the io notifies the connection instance of an IO_STATE_ERROR state the connection shall be closed and the state set to END.] */
+        connection->output_buffer_used = 0;
         connection_set_state(connection, CONNECTION_STATE_ERROR);
         if (xio_close(connection->io, NULL, NULL) != 0)
         {
@@ -1273,6 +1665,128 @@ static void on_amqp_frame_received(void* context, uint16_t channel, AMQP_VALUE p
     }
 }
 
+/* Codes_S_R_S_CONNECTION_01_312: [The idle timeout and the sending of empty frames for the remote idle timeout shall be run as timers on the connection timer queue.] */
+static bool start_idle_timers(CONNECTION_HANDLE connection, tickcounter_ms_t current_ms)
+{
+    bool result = true;
+
+    if (connection->idle_timeout_specified &&
+        (connection->idle_timeout != 0) &&
+        !timer_is_running(&connection->idle_timer))
+    {
+        tickcounter_ms_t time_since_last_received = current_ms - connection->last_frame_received_time;
+        tickcounter_ms_t time_left = (time_since_last_received < connection->idle_timeout) ? (connection->idle_timeout - time_since_last_received) : 0;
+
+        if (timer_start(connection->timer_queue, &connection->idle_timer, time_left) != 0)
+        {
+            LogError("Cannot start the idle timer");
+            result = false;
+        }
+    }
+
+    if (result &&
+        (connection->remote_idle_timeout != 0) &&
+        !timer_is_running(&connection->empty_frame_timer))
+    {
+        tickcounter_ms_t time_since_last_sent = current_ms - connection->last_frame_sent_time;
+        tickcounter_ms_t time_left = (time_since_last_sent < connection->remote_idle_timeout_send_frame_millisecond) ? (connection->remote_idle_timeout_send_frame_millisecond - time_since_last_sent) : 0;
+
+        if (timer_start(connection->timer_queue, &connection->empty_frame_timer, time_left) != 0)
+        {
+            LogError("Cannot start the empty frame timer");
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+static void on_idle_timer_expired(void* context)
+{
+    CONNECTION_HANDLE connection = (CONNECTION_HANDLE)context;
+    tickcounter_ms_t current_ms;
+
+    if (tickcounter_get_current_ms(connection->tick_counter, &current_ms) != 0)
+    {
+        LogError("Could not get tick counter value");
+        close_connection_with_error(connection, "amqp:internal-error", "Could not get tick count", NULL);
+    }
+    else
+    {
+        tickcounter_ms_t time_since_last_received = current_ms - connection->last_frame_received_time;
+
+        if (time_since_last_received < connection->idle_timeout)
+        {
+            /* a frame came in since the timer was started, wait for the rest of the timeout */
+            if (timer_start(connection->timer_queue, &connection->idle_timer, connection->idle_timeout - time_since_last_received) != 0)
+            {
+                LogError("Cannot restart the idle timer");
+                close_connection_with_error(connection, "amqp:internal-error", "Cannot restart the idle timer", NULL);
+            }
+        }
+        else
+        {
+            connection->is_idle_timeout_expired = 1;
+            timer_stop(&connection->empty_frame_timer);
+
+            /* close connection */
+            close_connection_with_error(connection, "amqp:internal-error", "No frame received for the idle timeout", NULL);
+        }
+    }
+}
+
+static void on_empty_frame_timer_expired(void* context)
+{
+    CONNECTION_HANDLE connection = (CONNECTION_HANDLE)context;
+    tickcounter_ms_t current_ms;
+
+    if (tickcounter_get_current_ms(connection->tick_counter, &current_ms) != 0)
+    {
+        LogError("Could not get tick counter value");
+        close_connection_with_error(connection, "amqp:internal-error", "Could not get tick count", NULL);
+    }
+    else
+    {
+        tickcounter_ms_t remote_idle_timeout = connection->remote_idle_timeout_send_frame_millisecond;
+        tickcounter_ms_t time_since_last_sent = current_ms - connection->last_frame_sent_time;
+        tickcounter_ms_t time_left;
+
+        if (time_since_last_sent < remote_idle_timeout)
+        {
+            /* a frame went out since the timer was started */
+            time_left = remote_idle_timeout - time_since_last_sent;
+        }
+        else
+        {
+            connection->on_send_complete = NULL;
+            if (amqp_frame_codec_encode_empty_frame(connection->amqp_frame_codec, 0, on_bytes_encoded, connection) != 0)
+            {
+                LogError("Encoding the empty frame failed");
+                /* close connection */
+                close_connection_with_error(connection, "amqp:internal-error", "Cannot send empty frame", NULL);
+                time_left = 0;
+            }
+            else
+            {
+                if (connection->is_trace_on == 1)
+                {
+                    LOG(AZ_LOG_TRACE, LOG_LINE, "-> Empty frame");
+                }
+
+                connection->last_frame_sent_time = current_ms;
+                time_left = remote_idle_timeout;
+            }
+        }
+
+        if ((time_left > 0) &&
+            (timer_start(connection->timer_queue, &connection->empty_frame_timer, time_left) != 0))
+        {
+            LogError("Cannot restart the empty frame timer");
+            close_connection_with_error(connection, "amqp:internal-error", "Cannot restart the empty frame timer", NULL);
+        }
+    }
+}
+
 static void frame_codec_error(void* context)
 {
     /* Bug: some error handling should happen here
@@ -1395,47 +1909,12 @@ CONNECTION_HANDLE connection_create2(XIO_HANDLE xio, const char* hostname, const
                             }
                             else
                             {
-                                (void)memcpy(connection->container_id, container_id, container_id_length + 1);
-
-                                /* Codes_S_R_S_CONNECTION_01_173: [<field name="max-frame-size" type="uint" default="4294967295"/>] */
-                                connection->max_frame_size = 4294967295u;
-                                /* Codes: [<field name="channel-max" type="ushort" default="65535"/>] */
-                                connection->channel_max = 65535;
-
-                                /* Codes_S_R_S_CONNECTION_01_175: [<field name="idle-time-out" type="milliseconds"/>] */
-                                /* Codes_S_R_S_CONNECTION_01_192: [A value of zero is the same as if it was not set (null).] */
-                                connection->idle_timeout = 0;
-                                connection->remote_idle_timeout = 0;
-                                connection->remote_idle_timeout_send_frame_millisecond = 0;
-                                connection->idle_timeout_empty_frame_send_ratio = 0.5;
-
-                                connection->endpoint_count = 0;
-                                connection->endpoints = NULL;
-                                connection->header_bytes_received = 0;
-                                connection->is_remote_frame_received = 0;
-                                connection->properties = NULL;
-
-                                connection->is_underlying_io_open = 0;
-                                connection->remote_max_frame_size = 512;
-                                connection->is_trace_on = 0;
-
-                                /* Mark that settings have not yet been set by the user */
-                                connection->idle_timeout_specified = 0;
-
-                                connection->on_new_endpoint = on_new_endpoint;
-                                connection->on_new_endpoint_callback_context = callback_context;
-
-                                connection->on_connection_close_received_event_subscription.on_connection_close_received = NULL;
-                                connection->on_connection_close_received_event_subscription.context = NULL;
-
-                                connection->on_io_error = on_io_error;
-                                connection->on_io_error_callback_context = on_io_error_context;
-                                connection->on_connection_state_changed = on_connection_state_changed;
-                                connection->on_connection_state_changed_callback_context = on_connection_state_changed_context;
-
-                                if (tickcounter_get_current_ms(connection->tick_counter, &connection->last_frame_received_time) != 0)
+                                /* Codes_S_R_S_CONNECTION_01_309: [connection_create shall create a timer queue that reads the time from the connection tick counter by calling timer_queue_create.] */
+                                connection->timer_queue = timer_queue_create(connection->tick_counter);
+                                if (connection->timer_queue == NULL)
                                 {
-                                    LogError("Could not retrieve time for last frame received time");
+                                    /* Codes_S_R_S_CONNECTION_01_310: [If timer_queue_create fails, connection_create shall return NULL.] */
+                                    LogError("Cannot create timer queue");
                                     tickcounter_destroy(connection->tick_counter);
                                     free(connection->container_id);
                                     free(connection->host_name);
@@ -1446,10 +1925,70 @@ CONNECTION_HANDLE connection_create2(XIO_HANDLE xio, const char* hostname, const
                                 }
                                 else
                                 {
-                                    connection->last_frame_sent_time = connection->last_frame_received_time;
+                                    (void)memcpy(connection->container_id, container_id, container_id_length + 1);
+
+                                    /* Codes_S_R_S_CONNECTION_01_173: [<field name="max-frame-size" type="uint" default="4294967295"/>] */
+                                    connection->max_frame_size = 4294967295u;
+                                    /* Codes: [<field name="channel-max" type="ushort" default="65535"/>] */
+                                    connection->channel_max = 65535;
+
+                                    /* Codes_S_R_S_CONNECTION_01_175: [<field name="idle-time-out" type="milliseconds"/>] */
+                                    /* Codes_S_R_S_CONNECTION_01_192: [A value of zero is the same as if it was not set (null).] */
+                                    connection->idle_timeout = 0;
+                                    connection->remote_idle_timeout = 0;
+                                    connection->remote_idle_timeout_send_frame_millisecond = 0;
+                                    connection->idle_timeout_empty_frame_send_ratio = 0.5;
+
+                                    connection->endpoint_count = 0;
+                                    connection->endpoints = NULL;
+                                    connection->header_bytes_received = 0;
+                                    connection->incoming_frame_size = 0;
+                                    connection->incoming_frame_bytes_left = 0;
+                                    connection->incoming_frame_size_bytes_received = 0;
+                                    connection->is_remote_frame_received = 0;
+                                    connection->properties = NULL;
+
+                                    connection->is_underlying_io_open = 0;
+                                    connection->remote_max_frame_size = 512;
+                                    connection->is_trace_on = 0;
+
+                                    /* Mark that settings have not yet been set by the user */
+                                    connection->idle_timeout_specified = 0;
+                                    connection->is_idle_timeout_expired = 0;
+
+                                    timer_init(&connection->idle_timer, on_idle_timer_expired, connection);
+                                    timer_init(&connection->empty_frame_timer, on_empty_frame_timer_expired, connection);
+
+                                    connection->on_new_endpoint = on_new_endpoint;
+                                    connection->on_new_endpoint_callback_context = callback_context;
+
+                                    connection->on_connection_close_received_event_subscription.on_connection_close_received = NULL;
+                                    connection->on_connection_close_received_event_subscription.context = NULL;
+
+                                    connection->on_io_error = on_io_error;
+                                    connection->on_io_error_callback_context = on_io_error_context;
+                                    connection->on_connection_state_changed = on_connection_state_changed;
+                                    connection->on_connection_state_changed_callback_context = on_connection_state_changed_context;
+
+                                    if (tickcounter_get_current_ms(connection->tick_counter, &connection->last_frame_received_time) != 0)
+                                    {
+                                        LogError("Could not retrieve time for last frame received time");
+                                        timer_queue_destroy(connection->timer_queue);
+                                        tickcounter_destroy(connection->tick_counter);
+                                        free(connection->container_id);
+                                        free(connection->host_name);
+                                        amqp_frame_codec_destroy(connection->amqp_frame_codec);
+                                        frame_codec_destroy(connection->frame_codec);
+                                        free(connection);
+                                        connection = NULL;
+                                    }
+                                    else
+                                    {
+                                        connection->last_frame_sent_time = connection->last_frame_received_time;
 
-                                    /* Codes_S_R_S_CONNECTION_01_072: [When connection_create succeeds, the state of the connection shall be CONNECTION_STATE_START.] */
-                                    connection_set_state(connection, CONNECTION_STATE_START);
+                                        /* Codes_S_R_S_CONNECTION_01_072: [When connection_create succeeds, the state of the connection shall be CONNECTION_STATE_START.] */
+                                        connection_set_state(connection, CONNECTION_STATE_START);
+                                    }
                                 }
                             }
                         }
@@ -1479,6 +2018,8 @@ void connection_destroy(CONNECTION_HANDLE connection)
 
         amqp_frame_codec_destroy(connection->amqp_frame_codec);
         frame_codec_destroy(connection->frame_codec);
+        /* Codes_S_R_S_CONNECTION_01_311: [connection_destroy shall destroy the connection timer queue by calling timer_queue_destroy.] */
+        timer_queue_destroy(connection->timer_queue);
         tickcounter_destroy(connection->tick_counter);
         if (connection->properties != NULL)
         {
@@ -1487,6 +2028,7 @@ void connection_destroy(CONNECTION_HANDLE connection)
 
         free(connection->host_name);
         free(connection->container_id);
+        free(connection->output_buffer);
 
         /* Codes_S_R_S_CONNECTION_01_074: [connection_destroy shall close the socket connection.] */
         free(connection);
@@ -1919,10 +2461,78 @@ int connection_get_remote_max_frame_size(CONNECTION_HANDLE connection, uint32_t*
     return result;
 }
 
+int connection_set_output_buffer_size(CONNECTION_HANDLE connection, size_t output_buffer_size)
+{
+    int result;
+
+    /* Codes_S_R_S_CONNECTION_01_293: [If connection is NULL or output_buffer_size is 0, connection_set_output_buffer_size shall fail and return a non-zero value.] */
+    if ((connection == NULL) ||
+        (output_buffer_size == 0))
+    {
+        LogError("Bad arguments: connection = %p, output_buffer_size = %lu",
+            connection, (unsigned long)output_buffer_size);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_S_R_S_CONNECTION_01_292: [connection_set_output_buffer_size shall set the size of the buffer in which encoded frames are coalesced before being handed to the io. The new size shall take effect once the buffer holds no pending bytes.] */
+        connection->output_buffer_size = output_buffer_size;
+
+        /* Codes_S_R_S_CONNECTION_01_294: [On success connection_set_output_buffer_size shall return 0.] */
+        result = 0;
+    }
+
+    return result;
+}
+
+int connection_set_write_coalescing(CONNECTION_HANDLE connection, size_t flush_threshold, uint32_t max_delay_us)
+{
+    int result;
+
+    /* Codes_S_R_S_CONNECTION_01_305: [If connection is NULL, connection_set_write_coalescing shall fail and return a non-zero value.] */
+    if (connection == NULL)
+    {
+        LogError("NULL connection");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_S_R_S_CONNECTION_01_304: [connection_set_write_coalescing shall hold encoded frames in the output buffer across connection_dowork calls until flush_threshold bytes are pending or the oldest pending frame has waited max_delay_us. A flush_threshold of 0 shall turn write coalescing off.] */
+        connection->coalescing_flush_threshold = flush_threshold;
+        connection->coalescing_max_delay_us = max_delay_us;
+
+        /* Codes_S_R_S_CONNECTION_01_306: [On success connection_set_write_coalescing shall return 0.] */
+        result = 0;
+    }
+
+    return result;
+}
+
+int connection_set_gathered_send(CONNECTION_HANDLE connection, bool enabled)
+{
+    int result;
+
+    /* Codes_S_R_S_CONNECTION_01_321: [If connection is NULL, connection_set_gathered_send shall fail and return a non-zero value.] */
+    if (connection == NULL)
+    {
+        LogError("NULL connection");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_S_R_S_CONNECTION_01_320: [connection_set_gathered_send shall turn on or off asking the underlying io for a scatter/gather send. It shall be off by default.] */
+        connection->is_gathered_send_enabled = enabled ? 1 : 0;
+
+        /* Codes_S_R_S_CONNECTION_01_322: [On success connection_set_gathered_send shall return 0.] */
+        result = 0;
+    }
+
+    return result;
+}
+
 uint64_t connection_handle_deadlines(CONNECTION_HANDLE connection)
 {
-    uint64_t local_deadline = (uint64_t)-1;
-    uint64_t remote_deadline = (uint64_t)-1;
+    uint64_t result = (uint64_t)-1;
 
     if (connection == NULL)
     {
@@ -1937,64 +2547,60 @@ uint64_t connection_handle_deadlines(CONNECTION_HANDLE connection)
             LogError("Could not get tick counter value");
             close_connection_with_error(connection, "amqp:internal-error", "Could not get tick count", NULL);
         }
+        else if (!connection->is_idle_timeout_expired &&
+            !start_idle_timers(connection, current_ms))
+        {
+            close_connection_with_error(connection, "amqp:internal-error", "Cannot start idle timers", NULL);
+        }
         else
         {
-            if (connection->idle_timeout_specified && (connection->idle_timeout != 0))
-            {
-                /* Calculate time until configured idle timeout expires */
+            bool was_idle_timeout_expired = connection->is_idle_timeout_expired;
+            tickcounter_ms_t time_to_next_deadline;
 
-                uint64_t time_since_last_received = current_ms - connection->last_frame_received_time;
-                if (time_since_last_received < connection->idle_timeout)
-                {
-                    local_deadline = connection->idle_timeout - time_since_last_received;
-                }
-                else
-                {
-                    local_deadline = 0;
-
-                    /* close connection */
-                    close_connection_with_error(connection, "amqp:internal-error", "No frame received for the idle timeout", NULL);
-                }
+            /* Codes_S_R_S_CONNECTION_01_313: [connection_handle_deadlines shall expire the due timers of the connection timer queue by calling timer_queue_dowork.] */
+            if (timer_queue_dowork(connection->timer_queue) != 0)
+            {
+                LogError("Cannot run the timer queue");
+                close_connection_with_error(connection, "amqp:internal-error", "Cannot run the timer queue", NULL);
             }
-
-            if (local_deadline != 0 && connection->remote_idle_timeout != 0)
+            else if (connection->is_idle_timeout_expired && !was_idle_timeout_expired)
             {
-                /* Calculate time until remote idle timeout expires */
-
-                uint64_t remote_idle_timeout = connection->remote_idle_timeout_send_frame_millisecond;
-                uint64_t time_since_last_sent = current_ms - connection->last_frame_sent_time;
+                /* Codes_S_R_S_CONNECTION_01_315: [If the connection was closed because no frame was received for the idle timeout, connection_handle_deadlines shall return 0.] */
+                result = 0;
+            }
+            else if (timer_queue_get_time_to_next_deadline(connection->timer_queue, &time_to_next_deadline) != 0)
+            {
+                LogError("Cannot get the time to the next deadline");
+            }
+            else
+            {
+                /* Codes_S_R_S_CONNECTION_01_314: [connection_handle_deadlines shall return the number of milliseconds until the next timer on the connection timer queue expires.] */
+                /* 0 means the connection closed, a timer that became due meanwhile is reported as 1 ms away */
+                result = (time_to_next_deadline == 0) ? 1 : time_to_next_deadline;
+            }
+        }
+    }
 
-                if (time_since_last_sent < remote_idle_timeout)
-                {
-                    remote_deadline = remote_idle_timeout - time_since_last_sent;
-                }
-                else
-                {
-                    connection->on_send_complete = NULL;
-                    if (amqp_frame_codec_encode_empty_frame(connection->amqp_frame_codec, 0, on_bytes_encoded, connection) != 0)
-                    {
-                        LogError("Encoding the empty frame failed");
-                        /* close connection */
-                        close_connection_with_error(connection, "amqp:internal-error", "Cannot send empty frame", NULL);
-                    }
-                    else
-                    {
-                        if (connection->is_trace_on == 1)
-                        {
-                            LOG(AZ_LOG_TRACE, LOG_LINE, "-> Empty frame");
-                        }
+    return result;
+}
 
-                        connection->last_frame_sent_time = current_ms;
+TIMER_QUEUE_HANDLE connection_get_timer_queue(CONNECTION_HANDLE connection)
+{
+    TIMER_QUEUE_HANDLE result;
 
-                        remote_deadline = remote_idle_timeout;
-                    }
-                }
-            }
-        }
+    if (connection == NULL)
+    {
+        /* Codes_S_R_S_CONNECTION_01_317: [If connection is NULL, connection_get_timer_queue shall return NULL.] */
+        LogError("NULL connection");
+        result = NULL;
+    }
+    else
+    {
+        /* Codes_S_R_S_CONNECTION_01_316: [connection_get_timer_queue shall return the timer queue of the connection, on which timers are expired by connection_dowork.] */
+        result = connection->timer_queue;
     }
 
-    /* Return the shorter of each deadline, or 0 to indicate connection closed */
-    return local_deadline > remote_deadline ? remote_deadline : local_deadline;
+    return result;
 }
 
 void connection_dowork(CONNECTION_HANDLE connection)
@@ -2010,10 +2616,48 @@ void connection_dowork(CONNECTION_HANDLE connection)
         {
             /* Codes_S_R_S_CONNECTION_01_076: [connection_dowork shall schedule the underlying IO interface to do its work by calling xio_dowork.] */
             xio_dowork(connection->io);
+
+            /* Codes_S_R_S_CONNECTION_01_298: [After xio_dowork, connection_dowork shall send the frames coalesced in the output buffer as if connection_flush was called.] */
+            /* Codes_S_R_S_CONNECTION_01_307: [When write coalescing is on, connection_dowork shall only send the output buffer once its oldest frame has been waiting for at least max_delay_us.] */
+            if (is_output_flush_due(connection))
+            {
+                (void)connection_flush(connection);
+            }
         }
     }
 }
 
+int connection_flush(CONNECTION_HANDLE connection)
+{
+    int result;
+
+    /* Codes_S_R_S_CONNECTION_01_300: [If connection is NULL, connection_flush shall fail and return a non-zero value.] */
+    if (connection == NULL)
+    {
+        LogError("NULL connection");
+        result = MU_FAILURE;
+    }
+    /* Codes_S_R_S_CONNECTION_01_301: [connection_flush shall send the contents of the output buffer by calling xio_send.] */
+    else if (!flush_output_buffer(connection))
+    {
+        /* Codes_S_R_S_CONNECTION_01_302: [If xio_send fails, connection_flush shall close the io, set the connection state to END and return a non-zero value.] */
+        if (xio_close(connection->io, NULL, NULL) != 0)
+        {
+            LogError("xio_close failed");
+        }
+
+        connection_set_state(connection, CONNECTION_STATE_END);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_S_R_S_CONNECTION_01_303: [On success connection_flush shall return 0.] */
+        result = 0;
+    }
+
+    return result;
+}
+
 ENDPOINT_HANDLE connection_create_endpoint(CONNECTION_HANDLE connection)
 {
     ENDPOINT_HANDLE result;
@@ -2253,6 +2897,72 @@ int connection_encode_frame(ENDPOINT_HANDLE endpoint, AMQP_VALUE performative, P
     return result;
 }
 
+int connection_encode_frame_bytes(ENDPOINT_HANDLE endpoint, const unsigned char* performative_bytes, size_t performative_size, PAYLOAD* payloads, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    int result;
+
+    /* Codes_S_R_S_CONNECTION_01_283: [If endpoint or performative_bytes are NULL, connection_encode_frame_bytes shall fail and return a non-zero value.] */
+    if ((endpoint == NULL) ||
+        (performative_bytes == NULL))
+    {
+        LogError("Bad arguments: endpoint = %p, performative_bytes = %p",
+            endpoint, performative_bytes);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        CONNECTION_HANDLE connection = (CONNECTION_HANDLE)endpoint->connection;
+        AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = connection->amqp_frame_codec;
+
+        /* Codes_S_R_S_CONNECTION_01_284: [If connection_encode_frame_bytes is called before the connection is in the OPENED state, connection_encode_frame_bytes shall fail and return a non-zero value.] */
+        if (connection->connection_state != CONNECTION_STATE_OPENED)
+        {
+            LogError("Connection not open");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            /* Codes_S_R_S_CONNECTION_01_285: [connection_encode_frame_bytes shall send the frame by calling amqp_frame_codec_encode_frame_bytes with the outgoing channel number of the endpoint, performative_bytes, performative_size and payloads.] */
+            connection->on_send_complete = on_send_complete;
+            connection->on_send_complete_callback_context = callback_context;
+            if (amqp_frame_codec_encode_frame_bytes(amqp_frame_codec, endpoint->outgoing_channel, performative_bytes, performative_size, payloads, on_bytes_encoded, connection) != 0)
+            {
+                /* Codes_S_R_S_CONNECTION_01_286: [If amqp_frame_codec_encode_frame_bytes fails, then connection_encode_frame_bytes shall fail and return a non-zero value.] */
+                LogError("Encoding AMQP frame failed");
+                result = MU_FAILURE;
+            }
+            else
+            {
+                if (connection->is_trace_on == 1)
+                {
+                    /* only decoded for tracing, the frame itself is sent from the bytes */
+                    AMQP_VALUE performative;
+                    size_t used_bytes;
+
+                    if (amqpvalue_decode_buffer(performative_bytes, performative_size, &performative, &used_bytes) == 0)
+                    {
+                        log_outgoing_frame(performative);
+                        amqpvalue_destroy(performative);
+                    }
+                }
+
+                if (tickcounter_get_current_ms(connection->tick_counter, &connection->last_frame_sent_time) != 0)
+                {
+                    LogError("Getting tick counter value failed");
+                    result = MU_FAILURE;
+                }
+                else
+                {
+                    /* Codes_S_R_S_CONNECTION_01_287: [On success connection_encode_frame_bytes shall return 0.] */
+                    result = 0;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
 void connection_set_trace(CONNECTION_HANDLE connection, bool trace_on)
 {
     /* Codes_S_R_S_CONNECTION_07_002: [If connection is NULL then connection_set_trace shall do nothing.] */
@@ -48,11 +48,13 @@ typedef struct FRAME_CODEC_INSTANCE_TAG
     uint8_t receive_frame_type;
     SUBSCRIPTION* receive_frame_subscription;
     unsigned char* receive_frame_bytes;
+    uint32_t receive_frame_capacity;
     ON_FRAME_CODEC_ERROR on_frame_codec_error;
     void* on_frame_codec_error_callback_context;
 
     /* configuration */
     uint32_t max_frame_size;
+    uint32_t receive_buffer_retain_limit;
 } FRAME_CODEC_INSTANCE;
 
 static bool find_subscription_by_frame_type(LIST_ITEM_HANDLE list_item, const void* match_context)
@@ -73,6 +75,18 @@ static bool find_subscription_by_frame_type(LIST_ITEM_HANDLE list_item, const vo
     return result;
 }
 
+static void release_receive_frame_bytes(FRAME_CODEC_INSTANCE* frame_codec_data)
+{
+    /* the receive buffer is kept for the next frame unless it grew past what we are allowed to hold on to */
+    if ((frame_codec_data->receive_frame_capacity > frame_codec_data->receive_buffer_retain_limit) ||
+        (frame_codec_data->receive_frame_capacity > frame_codec_data->max_frame_size))
+    {
+        free(frame_codec_data->receive_frame_bytes);
+        frame_codec_data->receive_frame_bytes = NULL;
+        frame_codec_data->receive_frame_capacity = 0;
+    }
+}
+
 FRAME_CODEC_HANDLE frame_codec_create(ON_FRAME_CODEC_ERROR on_frame_codec_error, void* callback_context)
 {
     FRAME_CODEC_INSTANCE* result;
@@ -102,10 +116,14 @@ FRAME_CODEC_HANDLE frame_codec_create(ON_FRAME_CODEC_ERROR on_frame_codec_error,
             result->receive_frame_size = 0;
             result->receive_frame_malloc_size = 0;
             result->receive_frame_bytes = NULL;
+            result->receive_frame_capacity = 0;
             result->subscription_list = singlylinkedlist_create();
 
             /* Codes_SRS_FRAME_CODEC_01_082: [The initial max_frame_size_shall be 512.] */
             result->max_frame_size = 512;
+
+            /* by default the receive buffer is reused for any frame size allowed by max_frame_size */
+            result->receive_buffer_retain_limit = UINT32_MAX;
         }
     }
 
@@ -163,6 +181,11 @@ int frame_codec_set_max_frame_size(FRAME_CODEC_HANDLE frame_codec, uint32_t max_
         /* Codes_SRS_FRAME_CODEC_01_079: [The new frame size shall take effect immediately, even for a frame that is being decoded at the time of the call.] */
         frame_codec_data->max_frame_size = max_frame_size;
 
+        if (frame_codec_data->receive_frame_state == RECEIVE_FRAME_STATE_FRAME_SIZE)
+        {
+            release_receive_frame_bytes(frame_codec_data);
+        }
+
         /* Codes_SRS_FRAME_CODEC_01_076: [On success, frame_codec_set_max_frame_size shall return 0.] */
         result = 0;
     }
@@ -170,6 +193,90 @@ int frame_codec_set_max_frame_size(FRAME_CODEC_HANDLE frame_codec, uint32_t max_
     return result;
 }
 
+static size_t receive_complete_frame(FRAME_CODEC_INSTANCE* frame_codec_data, const unsigned char* buffer, size_t size)
+{
+    size_t result;
+    uint32_t frame_size = ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | (uint32_t)buffer[3];
+    uint8_t doff = buffer[4];
+
+    /* anything that is not a well formed frame fully contained in the buffer goes through the state machine,
+    which also takes care of reporting decode errors */
+    if ((frame_size < FRAME_HEADER_SIZE) ||
+        (frame_size > frame_codec_data->max_frame_size) ||
+        (frame_size > size) ||
+        (doff < 2) ||
+        ((uint32_t)doff * 4 > frame_size))
+    {
+        result = 0;
+    }
+    else
+    {
+        uint8_t frame_type = buffer[5];
+        LIST_ITEM_HANDLE item_handle = singlylinkedlist_find(frame_codec_data->subscription_list, find_subscription_by_frame_type, &frame_type);
+        if (item_handle != NULL)
+        {
+            SUBSCRIPTION* subscription = (SUBSCRIPTION*)singlylinkedlist_item_get_value(item_handle);
+            if (subscription != NULL)
+            {
+                uint32_t frame_body_offset = (uint32_t)doff * 4;
+                uint32_t frame_body_size = frame_size - frame_body_offset;
+
+                /* Codes_SRS_FRAME_CODEC_01_031: [When a complete frame is successfully decoded it shall be indicated to the upper layer by invoking the on_frame_received passed to frame_codec_subscribe.] */
+                /* Codes_SRS_FRAME_CODEC_01_032: [Besides passing the frame information, the callback_context value passed to frame_codec_data_subscribe shall be passed to the on_frame_received function.] */
+                /* Codes_SRS_FRAME_CODEC_01_100: [If the frame body size is 0, the frame_body pointer passed to on_frame_received shall be NULL.] */
+                /* the frame is handed out straight from the caller's buffer, no copy needed */
+                subscription->on_frame_received(subscription->callback_context, buffer + 6, frame_body_offset - 6, (frame_body_size == 0) ? NULL : buffer + frame_body_offset, frame_body_size);
+            }
+        }
+
+        result = frame_size;
+    }
+
+    return result;
+}
+
+int frame_codec_set_option(FRAME_CODEC_HANDLE frame_codec, const char* option_name, const void* value)
+{
+    int result;
+
+    /* Codes_SRS_FRAME_CODEC_01_112: [If any of the arguments frame_codec, option_name or value is NULL, frame_codec_set_option shall return a non-zero value.] */
+    if ((frame_codec == NULL) ||
+        (option_name == NULL) ||
+        (value == NULL))
+    {
+        LogError("Bad arguments: frame_codec = %p, option_name = %p, value = %p",
+            frame_codec, option_name, value);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        FRAME_CODEC_INSTANCE* frame_codec_data = (FRAME_CODEC_INSTANCE*)frame_codec;
+
+        /* Codes_SRS_FRAME_CODEC_01_113: [If option_name is `receive_buffer_retain_limit` (FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT), value shall be a pointer to a uint32_t holding the largest receive buffer size that is kept between frames.] */
+        if (strcmp(FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT, option_name) == 0)
+        {
+            frame_codec_data->receive_buffer_retain_limit = *((const uint32_t*)value);
+
+            /* a buffer in use by a partially received frame is released once that frame is dispatched */
+            if (frame_codec_data->receive_frame_state == RECEIVE_FRAME_STATE_FRAME_SIZE)
+            {
+                release_receive_frame_bytes(frame_codec_data);
+            }
+
+            /* Codes_SRS_FRAME_CODEC_01_115: [On success, frame_codec_set_option shall return 0.] */
+            result = 0;
+        }
+        else
+        {
+            /* Codes_SRS_FRAME_CODEC_01_114: [If option_name is not known, frame_codec_set_option shall return a non-zero value.] */
+            LogError("Unknown option: %s", option_name);
+            result = MU_FAILURE;
+        }
+    }
+
+    return result;
+}
+
 /* Codes_SRS_FRAME_CODEC_01_001: [Frames are divided into three distinct areas: a fixed width frame header, a variable width extended header, and a variable width frame body.] */
 /* Codes_SRS_FRAME_CODEC_01_002: [frame header The frame header is a fixed size (8 byte) structure that precedes each frame.] */
 /* Codes_SRS_FRAME_CODEC_01_003: [The frame header includes mandatory information necessary to parse the rest of the frame including size and type information.] */
@@ -198,6 +305,21 @@ int frame_codec_receive_bytes(FRAME_CODEC_HANDLE frame_codec, const unsigned cha
     {
         while (size > 0)
         {
+            /* whole frames sitting in the buffer are dispatched directly, only frames spanning calls are accumulated */
+            if ((frame_codec_data->receive_frame_state == RECEIVE_FRAME_STATE_FRAME_SIZE) &&
+                (frame_codec_data->receive_frame_pos == 0) &&
+                (size >= FRAME_HEADER_SIZE))
+            {
+                size_t frame_bytes = receive_complete_frame(frame_codec_data, buffer, size);
+                if (frame_bytes > 0)
+                {
+                    buffer += frame_bytes;
+                    size -= frame_bytes;
+                    result = 0;
+                    continue;
+                }
+            }
+
             switch (frame_codec_data->receive_frame_state)
             {
             default:
@@ -275,6 +397,7 @@ int frame_codec_receive_bytes(FRAME_CODEC_HANDLE frame_codec, const unsigned cha
             {
                 LIST_ITEM_HANDLE item_handle;
                 frame_codec_data->type_specific_size = (frame_codec_data->receive_frame_doff * 4) - 6;
+                frame_codec_data->receive_frame_pos = 0;
 
                 /* Codes_SRS_FRAME_CODEC_01_015: [TYPE Byte 5 of the frame header is a type code.] */
                 frame_codec_data->receive_frame_type = buffer[0];
@@ -301,11 +424,16 @@ int frame_codec_receive_bytes(FRAME_CODEC_HANDLE frame_codec, const unsigned cha
                     }
                     else
                     {
-                        frame_codec_data->receive_frame_pos = 0;
-
                         /* Codes_SRS_FRAME_CODEC_01_102: [frame_codec_receive_bytes shall allocate memory to hold the frame_body bytes.] */
                         frame_codec_data->receive_frame_malloc_size = frame_codec_data->receive_frame_size - 6;
-                        frame_codec_data->receive_frame_bytes = (unsigned char*)malloc(frame_codec_data->receive_frame_malloc_size);
+                        if (frame_codec_data->receive_frame_malloc_size > frame_codec_data->receive_frame_capacity)
+                        {
+                            /* the previous contents are not needed, so there is no point in paying for a realloc copy */
+                            free(frame_codec_data->receive_frame_bytes);
+                            frame_codec_data->receive_frame_bytes = (unsigned char*)malloc(frame_codec_data->receive_frame_malloc_size);
+                            frame_codec_data->receive_frame_capacity = (frame_codec_data->receive_frame_bytes == NULL) ? 0 : frame_codec_data->receive_frame_malloc_size;
+                        }
+
                         if (frame_codec_data->receive_frame_bytes == NULL)
                         {
                             /* Codes_SRS_FRAME_CODEC_01_101: [If the memory for the frame_body bytes cannot be allocated, frame_codec_receive_bytes shall fail and return a non-zero value.] */
@@ -378,8 +506,7 @@ int frame_codec_receive_bytes(FRAME_CODEC_HANDLE frame_codec, const unsigned cha
                             /* Codes_SRS_FRAME_CODEC_01_006: [The treatment of this area depends on the frame type.] */
                             /* Codes_SRS_FRAME_CODEC_01_100: [If the frame body size is 0, the frame_body pointer passed to on_frame_received shall be NULL.] */
                             frame_codec_data->receive_frame_subscription->on_frame_received(frame_codec_data->receive_frame_subscription->callback_context, frame_codec_data->receive_frame_bytes, frame_codec_data->type_specific_size, NULL, 0);
-                            free(frame_codec_data->receive_frame_bytes);
-                            frame_codec_data->receive_frame_bytes = NULL;
+                            release_receive_frame_bytes(frame_codec_data);
                         }
 
                         frame_codec_data->receive_frame_state = RECEIVE_FRAME_STATE_FRAME_SIZE;
@@ -407,14 +534,17 @@ int frame_codec_receive_bytes(FRAME_CODEC_HANDLE frame_codec, const unsigned cha
                     to_copy = size;
                 }
 
-                if (frame_codec_data->receive_frame_bytes == NULL)
+                if (frame_codec_data->receive_frame_subscription != NULL)
                 {
-                    result = MU_FAILURE;
-                    size = 0;
-                    break;
-                }
+                    if (frame_codec_data->receive_frame_bytes == NULL)
+                    {
+                        result = MU_FAILURE;
+                        size = 0;
+                        break;
+                    }
 
-                (void)memcpy(frame_codec_data->receive_frame_bytes + frame_codec_data->receive_frame_pos + frame_codec_data->type_specific_size, buffer, to_copy);
+                    (void)memcpy(frame_codec_data->receive_frame_bytes + frame_codec_data->receive_frame_pos + frame_codec_data->type_specific_size, buffer, to_copy);
+                }
 
                 buffer += to_copy;
                 size -= to_copy;
@@ -430,8 +560,7 @@ int frame_codec_receive_bytes(FRAME_CODEC_HANDLE frame_codec, const unsigned cha
                         /* Codes_SRS_FRAME_CODEC_01_006: [The treatment of this area depends on the frame type.] */
                         /* Codes_SRS_FRAME_CODEC_01_099: [A pointer to the frame_body bytes shall also be passed to the on_frame_received.] */
                         frame_codec_data->receive_frame_subscription->on_frame_received(frame_codec_data->receive_frame_subscription->callback_context, frame_codec_data->receive_frame_bytes, frame_codec_data->type_specific_size, frame_codec_data->receive_frame_bytes + frame_codec_data->type_specific_size, frame_body_size);
-                        free(frame_codec_data->receive_frame_bytes);
-                        frame_codec_data->receive_frame_bytes = NULL;
+                        release_receive_frame_bytes(frame_codec_data);
                     }
 
                     frame_codec_data->receive_frame_state = RECEIVE_FRAME_STATE_FRAME_SIZE;
@@ -674,7 +803,8 @@ int frame_codec_encode_frame(FRAME_CODEC_HANDLE frame_codec, uint8_t type, PAYLO
                     }
 
                     /* Codes_SRS_FRAME_CODEC_01_106: [All payloads shall be encoded in order as part of the frame.] */
-                    payload_append_payload_as_copy(encoded_frame_payload, payloads);
+                    /* the encoded frame does not outlive this call, so the payloads are referenced rather than copied */
+                    payload_append_payload_as_borrowed(encoded_frame_payload, payloads);
 
                     /* Codes_SRS_FRAME_CODEC_01_088: [Encoded bytes shall be passed to the `on_bytes_encoded` callback in a single call, while setting the `encode complete` argument to true.] */
                     on_bytes_encoded(callback_context, encoded_frame_payload, true);
@@ -8,7 +8,6 @@
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_macro_utils/macro_utils.h"
 #include "azure_c_shared_utility/xlogging.h"
-#include "azure_c_shared_utility/singlylinkedlist.h"
 #include "azure_c_shared_utility/tickcounter.h"
 #include "azure_uamqp_c/link.h"
 #include "azure_uamqp_c/session.h"
@@ -16,8 +15,10 @@
 #include "azure_uamqp_c/amqp_definitions.h"
 #include "azure_uamqp_c/amqp_frame_codec.h"
 #include "azure_uamqp_c/async_operation.h"
+#include "azure_uamqp_c/timer_queue.h"
 
 #define DEFAULT_LINK_CREDIT 10000
+#define INITIAL_PENDING_DELIVERIES_CAPACITY 16
 
 typedef struct DELIVERY_INSTANCE_TAG
 {
@@ -25,10 +26,25 @@ typedef struct DELIVERY_INSTANCE_TAG
     ON_DELIVERY_SETTLED on_delivery_settled;
     void* callback_context;
     void* link;
-    tickcounter_ms_t start_tick;
-    tickcounter_ms_t timeout;
+    /* runs on the timer queue of the connection */
+    TIMER timeout_timer;
 } DELIVERY_INSTANCE;
 
+/* Unsettled deliveries, indexed by delivery_id - first_id. The session hands out delivery ids in increasing order,
+so new deliveries go at the end and settlement mostly happens at the front. Slots for ids that were settled or that
+belong to other links of the same session are NULL, so the span also counts the ids other links took since the oldest
+delivery still pending here: one delivery left unsettled while other links keep sending grows the ring by a slot per
+id until it is settled, times out or the link detaches. */
+typedef struct PENDING_DELIVERIES_TAG
+{
+    ASYNC_OPERATION_HANDLE* slots;
+    uint32_t capacity;
+    uint32_t first_slot;
+    uint32_t span;
+    uint32_t count;
+    delivery_number first_id;
+} PENDING_DELIVERIES;
+
 typedef struct ON_LINK_DETACH_EVENT_SUBSCRIPTION_TAG
 {
     ON_LINK_DETACH_RECEIVED on_link_detach_received;
@@ -45,7 +61,8 @@ typedef struct LINK_INSTANCE_TAG
     handle handle;
     LINK_ENDPOINT_HANDLE link_endpoint;
     char* name;
-    SINGLYLINKEDLIST_HANDLE pending_deliveries;
+    PENDING_DELIVERIES pending_deliveries;
+    ASYNC_OPERATION_HANDLE sending_delivery;
     sequence_no delivery_count;
     role role;
     ON_LINK_STATE_CHANGED on_link_state_changed;
@@ -66,12 +83,132 @@ typedef struct LINK_INSTANCE_TAG
     unsigned char* received_payload;
     uint32_t received_payload_size;
     delivery_number received_delivery_id;
-    TICK_COUNTER_HANDLE tick_counter;
     ON_LINK_DETACH_EVENT_SUBSCRIPTION on_link_detach_received_event_subscription;
 } LINK_INSTANCE;
 
 DEFINE_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE);
 
+static ASYNC_OPERATION_HANDLE* get_pending_delivery_slot(PENDING_DELIVERIES* pending_deliveries, uint32_t offset)
+{
+    return &pending_deliveries->slots[(pending_deliveries->first_slot + offset) & (pending_deliveries->capacity - 1)];
+}
+
+static int reserve_pending_deliveries(PENDING_DELIVERIES* pending_deliveries, uint32_t span)
+{
+    int result;
+
+    if (span <= pending_deliveries->capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        uint32_t new_capacity = (pending_deliveries->capacity == 0) ? INITIAL_PENDING_DELIVERIES_CAPACITY : pending_deliveries->capacity;
+        ASYNC_OPERATION_HANDLE* new_slots;
+
+        while ((new_capacity < span) && (new_capacity <= UINT32_MAX / 2))
+        {
+            new_capacity *= 2;
+        }
+
+        if ((new_capacity < span) ||
+            ((new_slots = (ASYNC_OPERATION_HANDLE*)calloc(new_capacity, sizeof(ASYNC_OPERATION_HANDLE))) == NULL))
+        {
+            LogError("Cannot grow pending deliveries to %u entries", (unsigned int)span);
+            result = MU_FAILURE;
+        }
+        else
+        {
+            uint32_t i;
+
+            /* unwrap the ring so that the first delivery sits in slot 0 */
+            for (i = 0; i < pending_deliveries->span; i++)
+            {
+                new_slots[i] = *get_pending_delivery_slot(pending_deliveries, i);
+            }
+
+            free(pending_deliveries->slots);
+            pending_deliveries->slots = new_slots;
+            pending_deliveries->capacity = new_capacity;
+            pending_deliveries->first_slot = 0;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+/* makes room for delivery_id, which has to be newer than every pending delivery */
+static int reserve_pending_delivery(PENDING_DELIVERIES* pending_deliveries, delivery_number delivery_id)
+{
+    uint32_t span = (pending_deliveries->count == 0) ? 1 : (delivery_id - pending_deliveries->first_id + 1);
+    return reserve_pending_deliveries(pending_deliveries, span);
+}
+
+/* cannot fail, room for delivery_id was made by reserve_pending_delivery before its transfer was sent */
+static void add_pending_delivery(PENDING_DELIVERIES* pending_deliveries, delivery_number delivery_id, ASYNC_OPERATION_HANDLE delivery)
+{
+    uint32_t offset;
+
+    if (pending_deliveries->count == 0)
+    {
+        pending_deliveries->first_id = delivery_id;
+        pending_deliveries->first_slot = 0;
+        pending_deliveries->span = 0;
+    }
+
+    offset = delivery_id - pending_deliveries->first_id;
+    *get_pending_delivery_slot(pending_deliveries, offset) = delivery;
+    pending_deliveries->span = offset + 1;
+    pending_deliveries->count++;
+}
+
+static ASYNC_OPERATION_HANDLE find_pending_delivery(PENDING_DELIVERIES* pending_deliveries, delivery_number delivery_id)
+{
+    uint32_t offset = delivery_id - pending_deliveries->first_id;
+    return (offset < pending_deliveries->span) ? *get_pending_delivery_slot(pending_deliveries, offset) : NULL;
+}
+
+static void remove_pending_delivery(PENDING_DELIVERIES* pending_deliveries, delivery_number delivery_id)
+{
+    uint32_t offset = delivery_id - pending_deliveries->first_id;
+
+    if ((offset < pending_deliveries->span) &&
+        (*get_pending_delivery_slot(pending_deliveries, offset) != NULL))
+    {
+        *get_pending_delivery_slot(pending_deliveries, offset) = NULL;
+        pending_deliveries->count--;
+
+        if (pending_deliveries->count == 0)
+        {
+            pending_deliveries->span = 0;
+        }
+        else
+        {
+            /* move the front up to the oldest delivery still pending */
+            while (*get_pending_delivery_slot(pending_deliveries, 0) == NULL)
+            {
+                pending_deliveries->first_slot = (pending_deliveries->first_slot + 1) & (pending_deliveries->capacity - 1);
+                pending_deliveries->first_id++;
+                pending_deliveries->span--;
+            }
+        }
+    }
+}
+
+/* takes a delivery out of the pending deliveries and their timeouts, the caller settles and destroys it */
+static void forget_pending_delivery(LINK_INSTANCE* link, ASYNC_OPERATION_HANDLE delivery)
+{
+    DELIVERY_INSTANCE* delivery_instance = (DELIVERY_INSTANCE*)GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, delivery);
+
+    if (find_pending_delivery(&link->pending_deliveries, delivery_instance->delivery_id) == delivery)
+    {
+        remove_pending_delivery(&link->pending_deliveries, delivery_instance->delivery_id);
+    }
+
+    timer_stop(&delivery_instance->timeout_timer);
+}
+
 static void set_link_state(LINK_INSTANCE* link_instance, LINK_STATE link_state)
 {
     link_instance->previous_link_state = link_instance->link_state;
@@ -85,73 +222,83 @@ static void set_link_state(LINK_INSTANCE* link_instance, LINK_STATE link_state)
 
 static void remove_all_pending_deliveries(LINK_INSTANCE* link, bool indicate_settled)
 {
-    if (link->pending_deliveries != NULL)
+    /* detach the deliveries first, settlement callbacks may start new transfers on this link */
+    PENDING_DELIVERIES pending_deliveries = link->pending_deliveries;
+    uint32_t i;
+
+    (void)memset(&link->pending_deliveries, 0, sizeof(link->pending_deliveries));
+
+    for (i = 0; i < pending_deliveries.span; i++)
     {
-        LIST_ITEM_HANDLE item = singlylinkedlist_get_head_item(link->pending_deliveries);
-        while (item != NULL)
+        ASYNC_OPERATION_HANDLE pending_delivery_operation = *get_pending_delivery_slot(&pending_deliveries, i);
+        if (pending_delivery_operation != NULL)
         {
-            LIST_ITEM_HANDLE next_item = singlylinkedlist_get_next_item(item);
-            ASYNC_OPERATION_HANDLE pending_delivery_operation = (ASYNC_OPERATION_HANDLE)singlylinkedlist_item_get_value(item);
-            if (pending_delivery_operation != NULL)
-            {
-                DELIVERY_INSTANCE* delivery_instance = (DELIVERY_INSTANCE*)GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, pending_delivery_operation);
-                if (indicate_settled && (delivery_instance->on_delivery_settled != NULL))
-                {
-                    delivery_instance->on_delivery_settled(delivery_instance->callback_context, delivery_instance->delivery_id, LINK_DELIVERY_SETTLE_REASON_NOT_DELIVERED, NULL);
-                }
+            DELIVERY_INSTANCE* delivery_instance = (DELIVERY_INSTANCE*)GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, pending_delivery_operation);
 
-                async_operation_destroy(pending_delivery_operation);
+            timer_stop(&delivery_instance->timeout_timer);
+            if (indicate_settled && (delivery_instance->on_delivery_settled != NULL))
+            {
+                delivery_instance->on_delivery_settled(delivery_instance->callback_context, delivery_instance->delivery_id, LINK_DELIVERY_SETTLE_REASON_NOT_DELIVERED, NULL);
             }
 
-            item = next_item;
+            async_operation_destroy(pending_delivery_operation);
         }
+    }
+
+    free(pending_deliveries.slots);
+}
 
-        singlylinkedlist_destroy(link->pending_deliveries);
-        link->pending_deliveries = NULL;
+static void settle_pending_deliveries(LINK_INSTANCE* link, delivery_number first, delivery_number last, AMQP_VALUE delivery_state)
+{
+    PENDING_DELIVERIES* pending_deliveries = &link->pending_deliveries;
+    delivery_number newest_id = pending_deliveries->first_id + pending_deliveries->span - 1;
+    delivery_number delivery_id;
+    uint32_t remaining;
+
+    /* only the part of [first, last] that overlaps the pending deliveries needs to be visited */
+    if (pending_deliveries->count == 0 ||
+        (int32_t)(last - pending_deliveries->first_id) < 0 ||
+        (int32_t)(newest_id - first) < 0)
+    {
+        remaining = 0;
+        delivery_id = first;
+    }
+    else
+    {
+        delivery_id = ((int32_t)(first - pending_deliveries->first_id) < 0) ? pending_deliveries->first_id : first;
+        remaining = (((int32_t)(newest_id - last) < 0) ? newest_id : last) - delivery_id + 1;
+    }
+
+    while (remaining > 0)
+    {
+        /* looked up again each time, the callback may have added or settled deliveries */
+        ASYNC_OPERATION_HANDLE pending_delivery_operation = find_pending_delivery(pending_deliveries, delivery_id);
+        if (pending_delivery_operation != NULL)
+        {
+            DELIVERY_INSTANCE* delivery_instance = (DELIVERY_INSTANCE*)GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, pending_delivery_operation);
+
+            forget_pending_delivery(link, pending_delivery_operation);
+            delivery_instance->on_delivery_settled(delivery_instance->callback_context, delivery_instance->delivery_id, LINK_DELIVERY_SETTLE_REASON_DISPOSITION_RECEIVED, delivery_state);
+            async_operation_destroy(pending_delivery_operation);
+        }
+
+        delivery_id++;
+        remaining--;
     }
 }
 
 static int send_flow(LINK_INSTANCE* link)
 {
     int result;
-    FLOW_HANDLE flow = flow_create(0, 0, 0);
 
-    if (flow == NULL)
+    if (session_send_link_flow(link->link_endpoint, link->delivery_count, link->current_link_credit) != 0)
     {
-        LogError("NULL flow performative");
+        LogError("Sending flow frame failed in session send");
         result = MU_FAILURE;
     }
     else
     {
-        if (flow_set_link_credit(flow, link->current_link_credit) != 0)
-        {
-            LogError("Cannot set link credit on flow performative");
-            result = MU_FAILURE;
-        }
-        else if (flow_set_handle(flow, link->handle) != 0)
-        {
-            LogError("Cannot set handle on flow performative");
-            result = MU_FAILURE;
-        }
-        else if (flow_set_delivery_count(flow, link->delivery_count) != 0)
-        {
-            LogError("Cannot set delivery count on flow performative");
-            result = MU_FAILURE;
-        }
-        else
-        {
-            if (session_send_flow(link->link_endpoint, flow) != 0)
-            {
-                LogError("Sending flow frame failed in session send");
-                result = MU_FAILURE;
-            }
-            else
-            {
-                result = 0;
-            }
-        }
-
-        flow_destroy(flow);
+        result = 0;
     }
 
     return result;
@@ -161,43 +308,14 @@ static int send_disposition(LINK_INSTANCE* link_instance, delivery_number delive
 {
     int result;
 
-    DISPOSITION_HANDLE disposition = disposition_create(link_instance->role, delivery_number);
-    if (disposition == NULL)
+    if (session_send_link_disposition(link_instance->link_endpoint, link_instance->role, delivery_number, delivery_number, true, delivery_state) != 0)
     {
-        LogError("NULL disposition performative");
+        LogError("Sending disposition failed in session send");
         result = MU_FAILURE;
     }
     else
     {
-        if (disposition_set_last(disposition, delivery_number) != 0)
-        {
-            LogError("Failed setting last on disposition performative");
-            result = MU_FAILURE;
-        }
-        else if (disposition_set_settled(disposition, true) != 0)
-        {
-            LogError("Failed setting settled on disposition performative");
-            result = MU_FAILURE;
-        }
-        else if ((delivery_state != NULL) && (disposition_set_state(disposition, delivery_state) != 0))
-        {
-            LogError("Failed setting state on disposition performative");
-            result = MU_FAILURE;
-        }
-        else
-        {
-            if (session_send_disposition(link_instance->link_endpoint, disposition) != 0)
-            {
-                LogError("Sending disposition failed in session send");
-                result = MU_FAILURE;
-            }
-            else
-            {
-                result = 0;
-            }
-        }
-
-        disposition_destroy(disposition);
+        result = 0;
     }
 
     return result;
@@ -535,45 +653,16 @@ static void link_frame_received(void* context, AMQP_VALUE performative, uint32_t
                     settled = false;
                 }
 
-                if (settled && 
-                    link_instance->pending_deliveries != NULL)
+                if (settled)
                 {
-                    LIST_ITEM_HANDLE pending_delivery = singlylinkedlist_get_head_item(link_instance->pending_deliveries);
-                    while (pending_delivery != NULL)
+                    AMQP_VALUE delivery_state;
+                    if (disposition_get_state(disposition, &delivery_state) != 0)
                     {
-                        LIST_ITEM_HANDLE next_pending_delivery = singlylinkedlist_get_next_item(pending_delivery);
-                        ASYNC_OPERATION_HANDLE pending_delivery_operation = (ASYNC_OPERATION_HANDLE)singlylinkedlist_item_get_value(pending_delivery);
-                        if (pending_delivery_operation == NULL)
-                        {
-                            LogError("Cannot obtain pending delivery");
-                            break;
-                        }
-                        else
-                        {
-                            DELIVERY_INSTANCE* delivery_instance = (DELIVERY_INSTANCE*)GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, pending_delivery_operation);
-
-                            if ((delivery_instance->delivery_id >= first) && (delivery_instance->delivery_id <= last))
-                            {
-                                AMQP_VALUE delivery_state;
-                                if (disposition_get_state(disposition, &delivery_state) == 0)
-                                {
-                                    delivery_instance->on_delivery_settled(delivery_instance->callback_context, delivery_instance->delivery_id, LINK_DELIVERY_SETTLE_REASON_DISPOSITION_RECEIVED, delivery_state);
-                                    async_operation_destroy(pending_delivery_operation);
-                                }
-                                else
-                                {
-                                    LogError("Failed getting the disposition state");
-                                }
-
-                                if (singlylinkedlist_remove(link_instance->pending_deliveries, pending_delivery) != 0)
-                                {
-                                    LogError("Cannot remove pending delivery");
-                                    break;
-                                }
-                            }
-
-                            pending_delivery = next_pending_delivery;
-                        }
+                        LogError("Failed getting the disposition state");
+                    }
+                    else
+                    {
+                        settle_pending_deliveries(link_instance, first, last, delivery_state);
                     }
                 }
             }
@@ -688,8 +777,7 @@ static void on_session_flow_on(void* context)
 
 static void on_send_complete(void* context, IO_SEND_RESULT send_result)
 {
-    LIST_ITEM_HANDLE delivery_instance_list_item = (LIST_ITEM_HANDLE)context;
-    ASYNC_OPERATION_HANDLE pending_delivery_operation = (ASYNC_OPERATION_HANDLE)singlylinkedlist_item_get_value(delivery_instance_list_item);
+    ASYNC_OPERATION_HANDLE pending_delivery_operation = (ASYNC_OPERATION_HANDLE)context;
     if (pending_delivery_operation != NULL)
     {
         DELIVERY_INSTANCE* delivery_instance = (DELIVERY_INSTANCE*)GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, pending_delivery_operation);
@@ -697,13 +785,19 @@ static void on_send_complete(void* context, IO_SEND_RESULT send_result)
         {
             LINK_HANDLE link = (LINK_HANDLE)delivery_instance->link;
 
-            (void)send_result;
             if (link != NULL && 
                 link->snd_settle_mode == sender_settle_mode_settled)
             {
+                if (link->sending_delivery == pending_delivery_operation)
+                {
+                    /* completed while link_transfer_async is still sending it, before it was added to the pending deliveries */
+                    link->sending_delivery = NULL;
+                }
+
+                forget_pending_delivery(link, pending_delivery_operation);
+
                 delivery_instance->on_delivery_settled(delivery_instance->callback_context, delivery_instance->delivery_id, send_result == IO_SEND_OK ? LINK_DELIVERY_SETTLE_REASON_SETTLED : LINK_DELIVERY_SETTLE_REASON_NOT_DELIVERED, NULL);
                 async_operation_destroy(pending_delivery_operation);
-                (void)singlylinkedlist_remove(link->pending_deliveries, delivery_instance_list_item);
             }
         }
     }
@@ -732,6 +826,8 @@ LINK_HANDLE link_create(SESSION_HANDLE session, const char* name, role role, AMQ
     }
     else
     {
+        size_t name_length = strlen(name);
+
         result->link_state = LINK_STATE_DETACHED;
         result->previous_link_state = LINK_STATE_DETACHED;
         result->role = role;
@@ -755,59 +851,33 @@ LINK_HANDLE link_create(SESSION_HANDLE session, const char* name, role role, AMQ
         result->on_link_detach_received_event_subscription.on_link_detach_received = NULL;
         result->on_link_detach_received_event_subscription.context = NULL;
 
-        result->tick_counter = tickcounter_create();
-        if (result->tick_counter == NULL)
+        result->name = (char*)malloc(name_length + 1);
+        if (result->name == NULL)
         {
-            LogError("Cannot create tick counter for link");
+            LogError("Cannot allocate memory for link name");
             free(result);
             result = NULL;
         }
         else
         {
-            result->pending_deliveries = singlylinkedlist_create();
-            if (result->pending_deliveries == NULL)
+            result->on_link_state_changed = NULL;
+            result->callback_context = NULL;
+            set_link_state(result, LINK_STATE_DETACHED);
+
+            (void)memcpy(result->name, name, name_length + 1);
+            result->link_endpoint = session_create_link_endpoint(session, name);
+            if (result->link_endpoint == NULL)
             {
-                LogError("Cannot create pending deliveries list");
-                tickcounter_destroy(result->tick_counter);
+                LogError("Cannot create link endpoint");
+                free(result->name);
                 free(result);
                 result = NULL;
             }
             else
             {
-                size_t name_length = strlen(name);
-                result->name = (char*)malloc(name_length + 1);
-                if (result->name == NULL)
-                {
-                    LogError("Cannot allocate memory for link name");
-                    tickcounter_destroy(result->tick_counter);
-                    singlylinkedlist_destroy(result->pending_deliveries);
-                    free(result);
-                    result = NULL;
-                }
-                else
-                {
-                    result->on_link_state_changed = NULL;
-                    result->callback_context = NULL;
-                    set_link_state(result, LINK_STATE_DETACHED);
-
-                    (void)memcpy(result->name, name, name_length + 1);
-                    result->link_endpoint = session_create_link_endpoint(session, name);
-                    if (result->link_endpoint == NULL)
-                    {
-                        LogError("Cannot create link endpoint");
-                        tickcounter_destroy(result->tick_counter);
-                        singlylinkedlist_destroy(result->pending_deliveries);
-                        free(result->name);
-                        free(result);
-                        result = NULL;
-                    }
-                    else
-                    {
-                        // This ensures link.c gets notified if the link endpoint is destroyed
-                        // by uamqp (due to a DETACH from the hub, e.g.) to prevent a double free.
-                        session_set_link_endpoint_callback(result->link_endpoint, on_link_endpoint_destroyed, result);
-                    }
-                }
+                // This ensures link.c gets notified if the link endpoint is destroyed
+                // by uamqp (due to a DETACH from the hub, e.g.) to prevent a double free.
+                session_set_link_endpoint_callback(result->link_endpoint, on_link_endpoint_destroyed, result);
             }
         }
     }
@@ -824,6 +894,8 @@ LINK_HANDLE link_create_from_endpoint(SESSION_HANDLE session, LINK_ENDPOINT_HAND
     }
     else
     {
+        size_t name_length = strlen(name);
+
         result->link_state = LINK_STATE_DETACHED;
         result->previous_link_state = LINK_STATE_DETACHED;
         result->session = session;
@@ -855,43 +927,19 @@ LINK_HANDLE link_create_from_endpoint(SESSION_HANDLE session, LINK_ENDPOINT_HAND
             result->role = role_sender;
         }
 
-        result->tick_counter = tickcounter_create();
-        if (result->tick_counter == NULL)
+        result->name = (char*)malloc(name_length + 1);
+        if (result->name == NULL)
         {
-            LogError("Cannot create tick counter for link");
+            LogError("Cannot allocate memory for link name");
             free(result);
             result = NULL;
         }
         else
         {
-            result->pending_deliveries = singlylinkedlist_create();
-            if (result->pending_deliveries == NULL)
-            {
-                LogError("Cannot create pending deliveries list");
-                tickcounter_destroy(result->tick_counter);
-                free(result);
-                result = NULL;
-            }
-            else
-            {
-                size_t name_length = strlen(name);
-                result->name = (char*)malloc(name_length + 1);
-                if (result->name == NULL)
-                {
-                    LogError("Cannot allocate memory for link name");
-                    tickcounter_destroy(result->tick_counter);
-                    singlylinkedlist_destroy(result->pending_deliveries);
-                    free(result);
-                    result = NULL;
-                }
-                else
-                {
-                    (void)memcpy(result->name, name, name_length + 1);
-                    result->on_link_state_changed = NULL;
-                    result->callback_context = NULL;
-                    result->link_endpoint = link_endpoint;
-                }
-            }
+            (void)memcpy(result->name, name, name_length + 1);
+            result->on_link_state_changed = NULL;
+            result->callback_context = NULL;
+            result->link_endpoint = link_endpoint;
         }
     }
 
@@ -907,7 +955,6 @@ void link_destroy(LINK_HANDLE link)
     else
     {
         remove_all_pending_deliveries((LINK_INSTANCE*)link, false);
-        tickcounter_destroy(link->tick_counter);
 
         link->on_link_state_changed = NULL;
         (void)link_detach(link, true, NULL, NULL, NULL);
@@ -1317,34 +1364,32 @@ int link_detach(LINK_HANDLE link, bool close, const char* error_condition, const
     return result;
 }
 
-static bool remove_pending_delivery_condition_function(const void* item, const void* match_context, bool* continue_processing)
+static void link_transfer_cancel_handler(ASYNC_OPERATION_HANDLE link_transfer_operation)
 {
-    bool result;
+    DELIVERY_INSTANCE* pending_delivery = GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, link_transfer_operation);
 
-    if (item == match_context)
-    {
-        result = true;
-        *continue_processing = false;
-    }
-    else
+    forget_pending_delivery((LINK_INSTANCE*)pending_delivery->link, link_transfer_operation);
+
+    if (pending_delivery->on_delivery_settled != NULL)
     {
-        result = false;
-        *continue_processing = true;
+        pending_delivery->on_delivery_settled(pending_delivery->callback_context, pending_delivery->delivery_id, LINK_DELIVERY_SETTLE_REASON_CANCELLED, NULL);
     }
 
-    return result;
+    async_operation_destroy(link_transfer_operation);
 }
 
-static void link_transfer_cancel_handler(ASYNC_OPERATION_HANDLE link_transfer_operation)
+static void on_delivery_timeout(void* context)
 {
+    ASYNC_OPERATION_HANDLE link_transfer_operation = (ASYNC_OPERATION_HANDLE)context;
     DELIVERY_INSTANCE* pending_delivery = GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, link_transfer_operation);
+
+    forget_pending_delivery((LINK_INSTANCE*)pending_delivery->link, link_transfer_operation);
+
     if (pending_delivery->on_delivery_settled != NULL)
     {
-        pending_delivery->on_delivery_settled(pending_delivery->callback_context, pending_delivery->delivery_id, LINK_DELIVERY_SETTLE_REASON_CANCELLED, NULL);
+        pending_delivery->on_delivery_settled(pending_delivery->callback_context, pending_delivery->delivery_id, LINK_DELIVERY_SETTLE_REASON_TIMEOUT, NULL);
     }
 
-    (void)singlylinkedlist_remove_if(((LINK_HANDLE)pending_delivery->link)->pending_deliveries, remove_pending_delivery_condition_function, pending_delivery);
-
     async_operation_destroy(link_transfer_operation);
 }
 
@@ -1393,145 +1438,99 @@ ASYNC_OPERATION_HANDLE link_transfer_async(LINK_HANDLE link, message_format mess
             }
             else
             {
-                TRANSFER_HANDLE transfer = transfer_create(0);
-                if (transfer == NULL)
+                DELIVERY_INSTANCE* pending_delivery = GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, result);
+                sequence_no delivery_count = link->delivery_count + 1;
+                unsigned char delivery_tag[sizeof(delivery_count)];
+                delivery_number next_delivery_id;
+                bool settled;
+
+                (void)memcpy(delivery_tag, &delivery_count, sizeof(delivery_count));
+
+                if (link->snd_settle_mode == sender_settle_mode_unsettled)
+                {
+                    settled = false;
+                }
+                else
                 {
-                    LogError("Error creating transfer");
+                    settled = true;
+                }
+
+                if (pending_delivery == NULL)
+                {
+                    LogError("Failed getting pending delivery");
                     *link_transfer_error = LINK_TRANSFER_ERROR;
                     async_operation_destroy(result);
                     result = NULL;
                 }
                 else
                 {
-                    sequence_no delivery_count = link->delivery_count + 1;
-                    delivery_tag delivery_tag = payload_create();
-                    bool settled;
-
-                    payload_reserve_data(delivery_tag, sizeof(delivery_count));
-                    payload_append_data(delivery_tag, (const unsigned char *)&delivery_count, sizeof(delivery_count));
-
-
-                    if (link->snd_settle_mode == sender_settle_mode_unsettled)
-                    {
-                        settled = false;
-                    }
-                    else
+                    pending_delivery->on_delivery_settled = on_delivery_settled;
+                    pending_delivery->callback_context = callback_context;
+                    pending_delivery->link = link;
+                    timer_init(&pending_delivery->timeout_timer, on_delivery_timeout, result);
+
+                    /* the transfer takes the next delivery id of the session, make room for it before it goes out so that
+                    tracking the delivery cannot fail once the peer knows about it */
+                    if ((session_get_next_delivery_id(link->session, &next_delivery_id) != 0) ||
+                        (reserve_pending_delivery(&link->pending_deliveries, next_delivery_id) != 0))
                     {
-                        settled = true;
-                    }
-
-                    if (transfer_set_delivery_tag(transfer, delivery_tag) != 0)
-                    {
-                        LogError("Failed setting delivery tag");
+                        LogError("Failed reserving room for the pending delivery");
                         *link_transfer_error = LINK_TRANSFER_ERROR;
                         async_operation_destroy(result);
                         result = NULL;
                     }
-                    else if (transfer_set_message_format(transfer, message_format) != 0)
+                    else if ((timeout != 0) &&
+                        (timer_start(session_get_timer_queue(link->session), &pending_delivery->timeout_timer, timeout) != 0))
                     {
-                        LogError("Failed setting message format");
-                        *link_transfer_error = LINK_TRANSFER_ERROR;
-                        async_operation_destroy(result);
-                        result = NULL;
-                    }
-                    else if (transfer_set_settled(transfer, settled) != 0)
-                    {
-                        LogError("Failed setting settled flag");
+                        LogError("Failed starting the delivery timeout");
                         *link_transfer_error = LINK_TRANSFER_ERROR;
                         async_operation_destroy(result);
                         result = NULL;
                     }
                     else
                     {
-                        AMQP_VALUE transfer_value = amqpvalue_create_transfer(transfer);
-                        if (transfer_value == NULL)
+                        SESSION_SEND_TRANSFER_RESULT send_transfer_result;
+
+                        link->sending_delivery = result;
+
+                        /* here we should feed data to the transfer frame */
+                        send_transfer_result = session_send_link_transfer(link->link_endpoint, delivery_tag, sizeof(delivery_tag), message_format, settled, payloads, &pending_delivery->delivery_id, (settled) ? on_send_complete : NULL, result);
+
+                        if (link->sending_delivery != result)
                         {
-                            LogError("Failed creating transfer performative AMQP value");
-                            *link_transfer_error = LINK_TRANSFER_ERROR;
-                            async_operation_destroy(result);
+                            /* settled by on_send_complete while it was being sent: its last frame went out, on_delivery_settled
+                            has been called and the operation is destroyed, so there is no handle to return */
+                            link->delivery_count = delivery_count;
+                            link->current_link_credit--;
+                            *link_transfer_error = LINK_TRANSFER_OK;
                             result = NULL;
                         }
                         else
                         {
-                            DELIVERY_INSTANCE* pending_delivery = GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, result);
-                            if (pending_delivery == NULL)
+                            link->sending_delivery = NULL;
+
+                            switch (send_transfer_result)
                             {
-                                LogError("Failed getting pending delivery");
-                                *link_transfer_error = LINK_TRANSFER_ERROR;
+                            default:
+                            case SESSION_SEND_TRANSFER_ERROR:
+                            case SESSION_SEND_TRANSFER_BUSY:
+                                /* BUSY: the sender will attempt to transfer again on flow on */
+                                LogError("Failed session send transfer");
+                                *link_transfer_error = (send_transfer_result == SESSION_SEND_TRANSFER_BUSY) ? LINK_TRANSFER_BUSY : LINK_TRANSFER_ERROR;
+                                timer_stop(&pending_delivery->timeout_timer);
                                 async_operation_destroy(result);
                                 result = NULL;
+                                break;
+
+                            case SESSION_SEND_TRANSFER_OK:
+                                link->delivery_count = delivery_count;
+                                link->current_link_credit--;
+                                *link_transfer_error = LINK_TRANSFER_OK;
+                                add_pending_delivery(&link->pending_deliveries, pending_delivery->delivery_id, result);
+                                break;
                             }
-                            else
-                            {
-                                if (tickcounter_get_current_ms(link->tick_counter, &pending_delivery->start_tick) != 0)
-                                {
-                                    LogError("Failed getting current tick");
-                                    *link_transfer_error = LINK_TRANSFER_ERROR;
-                                    async_operation_destroy(result);
-                                    result = NULL;
-                                }
-                                else
-                                {
-                                    LIST_ITEM_HANDLE delivery_instance_list_item;
-                                    pending_delivery->timeout = timeout;
-                                    pending_delivery->on_delivery_settled = on_delivery_settled;
-                                    pending_delivery->callback_context = callback_context;
-                                    pending_delivery->link = link;
-                                    delivery_instance_list_item = singlylinkedlist_add(link->pending_deliveries, result);
-
-                                    if (delivery_instance_list_item == NULL)
-                                    {
-                                        LogError("Failed adding delivery to list");
-                                        *link_transfer_error = LINK_TRANSFER_ERROR;
-                                        async_operation_destroy(result);
-                                        result = NULL;
-                                    }
-                                    else
-                                    {
-                                        /* here we should feed data to the transfer frame */
-                                        switch (session_send_transfer(link->link_endpoint, transfer, payloads, &pending_delivery->delivery_id, (settled) ? on_send_complete : NULL, delivery_instance_list_item))
-                                        {
-                                        default:
-                                        case SESSION_SEND_TRANSFER_ERROR:
-                                            LogError("Failed session send transfer");
-                                            if (singlylinkedlist_remove(link->pending_deliveries, delivery_instance_list_item) != 0)
-                                            {
-                                                LogError("Error removing pending delivery from the list");
-                                            }
-
-                                            *link_transfer_error = LINK_TRANSFER_ERROR;
-                                            async_operation_destroy(result);
-                                            result = NULL;
-                                            break;
-
-                                        case SESSION_SEND_TRANSFER_BUSY:
-                                            /* Ensure we remove from list again since sender will attempt to transfer again on flow on */
-                                            LogError("Failed session send transfer");
-                                            if (singlylinkedlist_remove(link->pending_deliveries, delivery_instance_list_item) != 0)
-                                            {
-                                                LogError("Error removing pending delivery from the list");
-                                            }
-
-                                            *link_transfer_error = LINK_TRANSFER_BUSY;
-                                            async_operation_destroy(result);
-                                            result = NULL;
-                                            break;
-
-                                        case SESSION_SEND_TRANSFER_OK:
-                                            link->delivery_count = delivery_count;
-                                            link->current_link_credit--;
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
-
-                            amqpvalue_destroy(transfer_value);
                         }
                     }
-                    
-                    payload_destroy(&delivery_tag);
-                    transfer_destroy(transfer);
                 }
             }
         }
@@ -1603,48 +1602,9 @@ void link_dowork(LINK_HANDLE link)
     {
         LogError("NULL link");
     }
-    else
-    {
-        tickcounter_ms_t current_tick;
-
-        if (tickcounter_get_current_ms(link->tick_counter, &current_tick) != 0)
-        {
-            LogError("Cannot get tick counter value");
-        }
-        else
-        {
-            // go through all and find timed out deliveries
-            LIST_ITEM_HANDLE item = singlylinkedlist_get_head_item(link->pending_deliveries);
-            while (item != NULL)
-            {
-                LIST_ITEM_HANDLE next_item = singlylinkedlist_get_next_item(item);
-                ASYNC_OPERATION_HANDLE delivery_instance_async_operation = (ASYNC_OPERATION_HANDLE)singlylinkedlist_item_get_value(item);
-                if (delivery_instance_async_operation != NULL)
-                {
-                    DELIVERY_INSTANCE* delivery_instance = (DELIVERY_INSTANCE*)GET_ASYNC_OPERATION_CONTEXT(DELIVERY_INSTANCE, delivery_instance_async_operation);
-
-                    if ((delivery_instance != NULL) &&
-                        (delivery_instance->timeout != 0) &&
-                        (current_tick - delivery_instance->start_tick >= delivery_instance->timeout))
-                    {
-                        if (delivery_instance->on_delivery_settled != NULL)
-                        {
-                            delivery_instance->on_delivery_settled(delivery_instance->callback_context, delivery_instance->delivery_id, LINK_DELIVERY_SETTLE_REASON_TIMEOUT, NULL);
-                        }
 
-                        if (singlylinkedlist_remove(link->pending_deliveries, item) != 0)
-                        {
-                            LogError("Cannot remove item from list");
-                        }
-
-                        async_operation_destroy(delivery_instance_async_operation);
-                    }
-                }
-
-                item = next_item;
-            }
-        }
-    }
+    // delivery timeouts are timers on the timer queue of the connection and expire from connection_dowork; that queue
+    // must not be run from here, it also holds the connection's own timers, which may close the connection under the link
 }
 
 ON_LINK_DETACH_EVENT_SUBSCRIPTION_HANDLE link_subscribe_on_link_detach_received(LINK_HANDLE link, ON_LINK_DETACH_RECEIVED on_link_detach_received, void* context)
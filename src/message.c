@@ -972,7 +972,7 @@ int message_get_footer(MESSAGE_HANDLE message, annotations* footer)
     return result;
 }
 
-int message_add_body_amqp_data(MESSAGE_HANDLE message, BINARY_DATA amqp_data)
+static int add_body_amqp_data(MESSAGE_HANDLE message, BINARY_DATA amqp_data, bool borrow)
 {
     int result;
 
@@ -1008,7 +1008,16 @@ int message_add_body_amqp_data(MESSAGE_HANDLE message, BINARY_DATA amqp_data)
             else
             {
                 message->body_amqp_data_items = new_body_amqp_data_items;
-                message->body_amqp_data_items[message->body_amqp_data_count] = payload_clone(amqp_data);
+                if (borrow)
+                {
+                    /* Codes_SRS_MESSAGE_01_162: [ `message_add_body_amqp_data_borrowed` shall reference the bytes of `amqp_data` instead of copying them. ]*/
+                    message->body_amqp_data_items[message->body_amqp_data_count] = payload_create();
+                    payload_append_payload_as_borrowed(message->body_amqp_data_items[message->body_amqp_data_count], amqp_data);
+                }
+                else
+                {
+                    message->body_amqp_data_items[message->body_amqp_data_count] = payload_clone(amqp_data);
+                }
                 message->body_amqp_data_count++;
 
                 /* Codes_SRS_MESSAGE_01_087: [ On success it shall return 0. ]*/
@@ -1020,6 +1029,17 @@ int message_add_body_amqp_data(MESSAGE_HANDLE message, BINARY_DATA amqp_data)
     return result;
 }
 
+int message_add_body_amqp_data(MESSAGE_HANDLE message, BINARY_DATA amqp_data)
+{
+    return add_body_amqp_data(message, amqp_data, false);
+}
+
+/* Codes_SRS_MESSAGE_01_161: [ `message_add_body_amqp_data_borrowed` shall behave like `message_add_body_amqp_data`, except for how the bytes of `amqp_data` are stored. ]*/
+int message_add_body_amqp_data_borrowed(MESSAGE_HANDLE message, BINARY_DATA amqp_data)
+{
+    return add_body_amqp_data(message, amqp_data, true);
+}
+
 BINARY_DATA message_get_body_amqp_data_in_place(MESSAGE_HANDLE message, size_t index)
 {
     BINARY_DATA result = NULL;
@@ -12,6 +12,9 @@
 #include "azure_uamqp_c/message_receiver.h"
 #include "azure_uamqp_c/amqpvalue.h"
 
+/* received message sections are decoded in this arena, so a data section costs no allocations once the arena is warm */
+#define SECTION_ARENA_CHUNK_SIZE 4096
+
 typedef struct MESSAGE_RECEIVER_INSTANCE_TAG
 {
     LINK_HANDLE link;
@@ -22,6 +25,7 @@ typedef struct MESSAGE_RECEIVER_INSTANCE_TAG
     const void* callback_context;
     MESSAGE_HANDLE decoded_message;
     bool decode_error;
+    AMQPVALUE_ARENA_HANDLE section_arena;
 } MESSAGE_RECEIVER_INSTANCE;
 
 static void set_message_receiver_state(MESSAGE_RECEIVER_INSTANCE* message_receiver, MESSAGE_RECEIVER_STATE new_state)
@@ -189,16 +193,17 @@ static void decode_message_value_callback(void* context, AMQP_VALUE decoded_valu
             }
             else
             {
+               /* the data bytes stay in the transfer payload, which outlives the message handed to on_message_received */
                AMQP_VALUE body_data_value = amqpvalue_get_inplace_described_value(decoded_value);
                data data_value = payload_create();
                if ((body_data_value == NULL) ||
-                  (amqpvalue_get_data(body_data_value, data_value) != 0))
+                  (amqpvalue_get_binary_borrowed(body_data_value, data_value) != 0))
                {
                   message_receiver->decode_error = true;
                }
                else
                {
-                  if (message_add_body_amqp_data(decoded_message, data_value) != 0)
+                  if (message_add_body_amqp_data_borrowed(decoded_message, data_value) != 0)
                   {
                      message_receiver->decode_error = true;
                   }
@@ -226,35 +231,57 @@ static AMQP_VALUE on_transfer_received(void* context, TRANSFER_HANDLE transfer,
         }
         else
         {
-            AMQPVALUE_DECODER_HANDLE amqpvalue_decoder = amqpvalue_decoder_create(decode_message_value_callback, message_receiver);
-            if (amqpvalue_decoder == NULL)
+            size_t offset = 0;
+            bool is_error = false;
+
+            message_receiver->decoded_message = message;
+            message_receiver->decode_error = false;
+
+            /* the payload holds the whole message, so each section is decoded straight from it */
+            do
+            {
+                AMQP_VALUE section;
+                size_t used_bytes;
+
+                if (amqpvalue_decode_buffer_in_arena(message_receiver->section_arena, payload_bytes + offset, payload_size - offset, true, &section, &used_bytes) != 0)
+                {
+                    is_error = true;
+                }
+                else if (!is_data_type_by_descriptor(amqpvalue_get_inplace_descriptor(section)))
+                {
+                    /* the message keeps the values of every other section and the application may keep the message past
+                    this call, on any thread, so those are decoded again on the heap rather than pinning arena chunks */
+                    amqpvalue_destroy(section);
+                    if (amqpvalue_decode_buffer_borrowed(payload_bytes + offset, payload_size - offset, &section, &used_bytes) != 0)
+                    {
+                        is_error = true;
+                    }
+                }
+
+                if (!is_error)
+                {
+                    decode_message_value_callback(message_receiver, section);
+                    amqpvalue_destroy(section);
+                    offset += used_bytes;
+                }
+            } while ((!is_error) && (!message_receiver->decode_error) && (offset < payload_size));
+
+            if (is_error)
             {
-                LogError("Cannot create AMQP value decoder");
+                LogError("Cannot decode bytes");
                 set_message_receiver_state(message_receiver, MESSAGE_RECEIVER_STATE_ERROR);
             }
             else
             {
-                message_receiver->decoded_message = message;
-                message_receiver->decode_error = false;
-                if (amqpvalue_decode_bytes(amqpvalue_decoder, payload_bytes, payload_size) != 0)
+                if (message_receiver->decode_error)
                 {
-                    LogError("Cannot decode bytes");
+                    LogError("Error decoding message");
                     set_message_receiver_state(message_receiver, MESSAGE_RECEIVER_STATE_ERROR);
                 }
                 else
                 {
-                    if (message_receiver->decode_error)
-                    {
-                        LogError("Error decoding message");
-                        set_message_receiver_state(message_receiver, MESSAGE_RECEIVER_STATE_ERROR);
-                    }
-                    else
-                    {
-                        result = message_receiver->on_message_received(message_receiver->callback_context, message);
-                    }
+                    result = message_receiver->on_message_received(message_receiver->callback_context, message);
                 }
-
-                amqpvalue_decoder_destroy(amqpvalue_decoder);
             }
 
             message_destroy(message);
@@ -315,6 +342,14 @@ MESSAGE_RECEIVER_HANDLE messagereceiver_create(LINK_HANDLE link, ON_MESSAGE_RECE
         message_receiver->on_message_receiver_state_changed = on_message_receiver_state_changed;
         message_receiver->on_message_receiver_state_changed_context = context;
         message_receiver->message_receiver_state = MESSAGE_RECEIVER_STATE_IDLE;
+
+        message_receiver->section_arena = amqpvalue_arena_create(SECTION_ARENA_CHUNK_SIZE);
+        if (message_receiver->section_arena == NULL)
+        {
+            LogError("Error creating message section arena");
+            free(message_receiver);
+            message_receiver = NULL;
+        }
     }
 
     return message_receiver;
@@ -329,6 +364,7 @@ void messagereceiver_destroy(MESSAGE_RECEIVER_HANDLE message_receiver)
     else
     {
         (void)messagereceiver_close(message_receiver);
+        amqpvalue_arena_destroy(message_receiver->section_arena);
         free(message_receiver);
     }
 }
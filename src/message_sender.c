@@ -19,16 +19,26 @@
 typedef enum MESSAGE_SEND_STATE_TAG
 {
     MESSAGE_SEND_STATE_NOT_SENT,
-    MESSAGE_SEND_STATE_PENDING
+    MESSAGE_SEND_STATE_PENDING,
+    MESSAGE_SEND_STATE_COMPLETED
 } MESSAGE_SEND_STATE;
 
 typedef enum SEND_ONE_MESSAGE_RESULT_TAG
 {
     SEND_ONE_MESSAGE_OK,
+    /* sent and settled before the send returned, the message has been completed and freed */
+    SEND_ONE_MESSAGE_COMPLETED,
     SEND_ONE_MESSAGE_ERROR,
     SEND_ONE_MESSAGE_BUSY
 } SEND_ONE_MESSAGE_RESULT;
 
+typedef enum ENCODE_MESSAGE_RESULT_TAG
+{
+    ENCODE_MESSAGE_OK,
+    ENCODE_MESSAGE_ERROR,
+    ENCODE_MESSAGE_TOO_LARGE
+} ENCODE_MESSAGE_RESULT;
+
 typedef struct MESSAGE_WITH_CALLBACK_TAG
 {
     MESSAGE_HANDLE message;
@@ -37,25 +47,147 @@ typedef struct MESSAGE_WITH_CALLBACK_TAG
     MESSAGE_SENDER_HANDLE message_sender;
     MESSAGE_SEND_STATE message_send_state;
     tickcounter_ms_t timeout;
+    /* set instead of message for a batched message, which is encoded while it is built */
+    PAYLOAD* encoded_message;
+    message_format message_format;
+    /* the operation given to the caller, which is the batch operation when batch is not NULL */
+    ASYNC_OPERATION_HANDLE send_operation;
+    struct MESSAGE_BATCH_TAG* batch;
+    /* the link transfer while the message is in flight, so that it can be taken back from the link */
+    ASYNC_OPERATION_HANDLE transfer_operation;
+    /* links in the queue picked by message_send_state */
+    struct MESSAGE_WITH_CALLBACK_TAG* previous;
+    struct MESSAGE_WITH_CALLBACK_TAG* next;
 } MESSAGE_WITH_CALLBACK;
 
 DEFINE_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK);
 
+typedef struct MESSAGE_BATCH_TAG
+{
+    ON_MESSAGE_BATCH_SEND_COMPLETE on_message_batch_send_complete;
+    void* context;
+    size_t message_count;
+    /* messages not completed yet, plus one while the batch is being started or cancelled */
+    size_t pending_count;
+    /* both arrays live in the same allocation as the batch operation */
+    MESSAGE_WITH_CALLBACK* messages;
+    MESSAGE_SEND_RESULT* send_results;
+} MESSAGE_BATCH;
+
+DEFINE_ASYNC_OPERATION_CONTEXT(MESSAGE_BATCH);
+
+typedef struct MESSAGE_QUEUE_TAG
+{
+    MESSAGE_WITH_CALLBACK* head;
+    MESSAGE_WITH_CALLBACK* tail;
+} MESSAGE_QUEUE;
+
 typedef struct MESSAGE_SENDER_INSTANCE_TAG
 {
     LINK_HANDLE link;
-    size_t message_count;
-    ASYNC_OPERATION_HANDLE* messages;
+    /* messages waiting for link credit, oldest first */
+    MESSAGE_QUEUE unsent_messages;
+    /* messages handed to the link and waiting to be settled; the link gives back the message
+    as the settlement context, so settling one is an unlink rather than a search */
+    MESSAGE_QUEUE in_flight_messages;
     MESSAGE_SENDER_STATE message_sender_state;
     ON_MESSAGE_SENDER_STATE_CHANGED on_message_sender_state_changed;
     void* on_message_sender_state_changed_context;
     unsigned int is_trace_on : 1;
 } MESSAGE_SENDER_INSTANCE;
 
-static void remove_pending_message_by_index(MESSAGE_SENDER_HANDLE message_sender, size_t index)
+typedef struct BATCHED_MESSAGE_INSTANCE_TAG
+{
+    MESSAGE_SENDER_INSTANCE* message_sender;
+    /* the data sections added so far, created on the first add */
+    PAYLOAD* encoded_messages;
+    size_t message_count;
+    uint64_t encoded_size;
+} BATCHED_MESSAGE_INSTANCE;
+
+static MESSAGE_QUEUE* get_message_queue(MESSAGE_SENDER_INSTANCE* message_sender, MESSAGE_WITH_CALLBACK* message_with_callback)
+{
+    return (message_with_callback->message_send_state == MESSAGE_SEND_STATE_NOT_SENT) ? &message_sender->unsent_messages : &message_sender->in_flight_messages;
+}
+
+static void message_queue_append(MESSAGE_QUEUE* message_queue, MESSAGE_WITH_CALLBACK* message_with_callback)
+{
+    message_with_callback->previous = message_queue->tail;
+    message_with_callback->next = NULL;
+
+    if (message_queue->tail == NULL)
+    {
+        message_queue->head = message_with_callback;
+    }
+    else
+    {
+        message_queue->tail->next = message_with_callback;
+    }
+
+    message_queue->tail = message_with_callback;
+}
+
+static void message_queue_prepend(MESSAGE_QUEUE* message_queue, MESSAGE_WITH_CALLBACK* message_with_callback)
+{
+    message_with_callback->previous = NULL;
+    message_with_callback->next = message_queue->head;
+
+    if (message_queue->head == NULL)
+    {
+        message_queue->tail = message_with_callback;
+    }
+    else
+    {
+        message_queue->head->previous = message_with_callback;
+    }
+
+    message_queue->head = message_with_callback;
+}
+
+static void message_queue_remove(MESSAGE_QUEUE* message_queue, MESSAGE_WITH_CALLBACK* message_with_callback)
+{
+    if (message_with_callback->previous == NULL)
+    {
+        message_queue->head = message_with_callback->next;
+    }
+    else
+    {
+        message_with_callback->previous->next = message_with_callback->next;
+    }
+
+    if (message_with_callback->next == NULL)
+    {
+        message_queue->tail = message_with_callback->previous;
+    }
+    else
+    {
+        message_with_callback->next->previous = message_with_callback->previous;
+    }
+
+    message_with_callback->previous = NULL;
+    message_with_callback->next = NULL;
+}
+
+static void release_batch(ASYNC_OPERATION_HANDLE batch_operation)
+{
+    MESSAGE_BATCH* batch = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_BATCH, batch_operation);
+
+    batch->pending_count--;
+    if (batch->pending_count == 0)
+    {
+        if (batch->on_message_batch_send_complete != NULL)
+        {
+            batch->on_message_batch_send_complete(batch->context, batch->send_results, batch->message_count);
+        }
+
+        async_operation_destroy(batch_operation);
+    }
+}
+
+/* reports the outcome of a message that is no longer on any queue and frees it, or records it in its batch */
+static void complete_message(MESSAGE_WITH_CALLBACK* message_with_callback, MESSAGE_SEND_RESULT send_result, AMQP_VALUE delivery_state)
 {
-    ASYNC_OPERATION_HANDLE* new_messages;
-    MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, message_sender->messages[index]);
+    MESSAGE_SENDER_INSTANCE* message_sender = (MESSAGE_SENDER_INSTANCE*)message_with_callback->message_sender;
 
     if (message_with_callback->message != NULL)
     {
@@ -63,108 +195,103 @@ static void remove_pending_message_by_index(MESSAGE_SENDER_HANDLE message_sender
         message_with_callback->message = NULL;
     }
 
-    async_operation_destroy(message_sender->messages[index]);
-
-    if (message_sender->message_count - index > 1)
+    if (message_with_callback->encoded_message != NULL)
     {
-        (void)memmove(&message_sender->messages[index], &message_sender->messages[index + 1], sizeof(ASYNC_OPERATION_HANDLE) * (message_sender->message_count - index - 1));
+        payload_destroy(&message_with_callback->encoded_message);
     }
 
-    message_sender->message_count--;
+    message_with_callback->transfer_operation = NULL;
 
-    if (message_sender->message_count > 0)
+    if (message_with_callback->batch == NULL)
     {
-        new_messages = (ASYNC_OPERATION_HANDLE*)realloc(message_sender->messages, sizeof(ASYNC_OPERATION_HANDLE) * (message_sender->message_count));
-        if (new_messages != NULL)
+        if (message_with_callback->on_message_send_complete != NULL)
         {
-            message_sender->messages = new_messages;
+            message_with_callback->on_message_send_complete(message_with_callback->context, send_result, delivery_state);
         }
+
+        async_operation_destroy(message_with_callback->send_operation);
     }
     else
     {
-        free(message_sender->messages);
-        message_sender->messages = NULL;
+        MESSAGE_BATCH* batch = message_with_callback->batch;
+
+        batch->send_results[message_with_callback - batch->messages] = send_result;
+        message_with_callback->message_send_state = MESSAGE_SEND_STATE_COMPLETED;
+        release_batch(message_with_callback->send_operation);
     }
 }
 
-static void remove_pending_message(MESSAGE_SENDER_INSTANCE* message_sender, ASYNC_OPERATION_HANDLE pending_send)
+static void remove_pending_message(MESSAGE_SENDER_INSTANCE* message_sender, MESSAGE_WITH_CALLBACK* message_with_callback, MESSAGE_SEND_RESULT send_result, AMQP_VALUE delivery_state)
 {
-    size_t i;
+    message_queue_remove(get_message_queue(message_sender, message_with_callback), message_with_callback);
+    complete_message(message_with_callback, send_result, delivery_state);
+}
 
-    for (i = 0; i < message_sender->message_count; i++)
+/* completes a message that is no longer on any queue, taking its delivery back from the link first so that the link
+does not settle it later */
+static void abort_message(MESSAGE_WITH_CALLBACK* message_with_callback, MESSAGE_SEND_RESULT send_result)
+{
+    if (message_with_callback->transfer_operation != NULL)
     {
-        if (message_sender->messages[i] == pending_send)
-        {
-            remove_pending_message_by_index(message_sender, i);
-            break;
-        }
+        /* the link reports this as LINK_DELIVERY_SETTLE_REASON_CANCELLED, which on_delivery_settled ignores */
+        (void)async_operation_cancel(message_with_callback->transfer_operation);
     }
+
+    complete_message(message_with_callback, send_result, NULL);
 }
 
 static void on_delivery_settled(void* context, delivery_number delivery_no, LINK_DELIVERY_SETTLE_REASON reason, AMQP_VALUE delivery_state)
 {
-    ASYNC_OPERATION_HANDLE pending_send = (ASYNC_OPERATION_HANDLE)context;
-    MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, pending_send);
+    MESSAGE_WITH_CALLBACK* message_with_callback = (MESSAGE_WITH_CALLBACK*)context;
     MESSAGE_SENDER_INSTANCE* message_sender = (MESSAGE_SENDER_INSTANCE*)message_with_callback->message_sender;
     (void)delivery_no;
 
-    if (message_with_callback != NULL && 
-        message_with_callback->on_message_send_complete != NULL)
+    switch (reason)
     {
-        switch (reason)
+    case LINK_DELIVERY_SETTLE_REASON_DISPOSITION_RECEIVED:
+        if (delivery_state == NULL)
+        {
+            LogError("delivery state not provided");
+            remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_ERROR, NULL);
+        }
+        else
         {
-        case LINK_DELIVERY_SETTLE_REASON_DISPOSITION_RECEIVED:
-            if (delivery_state == NULL)
+            AMQP_VALUE descriptor = amqpvalue_get_inplace_descriptor(delivery_state);
+            AMQP_VALUE described = amqpvalue_get_inplace_described_value(delivery_state);
+
+            if (descriptor == NULL)
             {
-                LogError("delivery state not provided");
+                LogError("Error getting descriptor for delivery state");
+                remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_ERROR, NULL);
             }
             else
             {
-                AMQP_VALUE descriptor = amqpvalue_get_inplace_descriptor(delivery_state);
-                AMQP_VALUE described = amqpvalue_get_inplace_described_value(delivery_state);
-
-                if (descriptor == NULL)
+                if (is_accepted_type_by_descriptor(descriptor))
                 {
-                    LogError("Error getting descriptor for delivery state");
+                    remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_OK, described);
                 }
                 else
                 {
-                    if (is_accepted_type_by_descriptor(descriptor))
-                    {
-                        message_with_callback->on_message_send_complete(message_with_callback->context, MESSAGE_SEND_OK, described);
-                    }
-                    else
-                    {
-                        message_with_callback->on_message_send_complete(message_with_callback->context, MESSAGE_SEND_ERROR, described);
-                    }
-
-                    remove_pending_message(message_sender, pending_send);
+                    remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_ERROR, described);
                 }
             }
-
-            break;
-        case LINK_DELIVERY_SETTLE_REASON_SETTLED:
-            message_with_callback->on_message_send_complete(message_with_callback->context, MESSAGE_SEND_OK, NULL);
-            remove_pending_message(message_sender, pending_send);
-            break;
-        case LINK_DELIVERY_SETTLE_REASON_TIMEOUT:
-            message_with_callback->on_message_send_complete(message_with_callback->context, MESSAGE_SEND_TIMEOUT, NULL);
-            remove_pending_message(message_sender, pending_send);
-            break;
-        case LINK_DELIVERY_SETTLE_REASON_NOT_DELIVERED:
-        default:
-            message_with_callback->on_message_send_complete(message_with_callback->context, MESSAGE_SEND_ERROR, NULL);
-            remove_pending_message(message_sender, pending_send);
-            break;
         }
-    }
-}
 
-static int encode_bytes(void* context, PAYLOAD *to_append)
-{
-    PAYLOAD* payload = (PAYLOAD*)context;
-    payload_append_payload_as_copy(payload, to_append);
-    return 0;
+        break;
+    case LINK_DELIVERY_SETTLE_REASON_SETTLED:
+        remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_OK, NULL);
+        break;
+    case LINK_DELIVERY_SETTLE_REASON_TIMEOUT:
+        remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_TIMEOUT, NULL);
+        break;
+    case LINK_DELIVERY_SETTLE_REASON_CANCELLED:
+        /* only abort_message cancels link transfers, and it completes the message itself */
+        break;
+    case LINK_DELIVERY_SETTLE_REASON_NOT_DELIVERED:
+    default:
+        remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_ERROR, NULL);
+        break;
+    }
 }
 
 static void log_message_chunk(MESSAGE_SENDER_INSTANCE* message_sender, const char* name, AMQP_VALUE value)
@@ -197,21 +324,67 @@ static bool count_bytes(void *context, const unsigned char *buffer, size_t lengt
    return true;
 }
 
-static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message_sender, ASYNC_OPERATION_HANDLE pending_send, MESSAGE_HANDLE message)
+/* a data section is the descriptor 0x00 0x53 0x75 followed by a vbin8 or vbin32 holding the data */
+static size_t get_data_section_header_size(size_t data_size)
 {
-    SEND_ONE_MESSAGE_RESULT result;
+    return (data_size <= UINT8_MAX) ? 5 : 8;
+}
+
+static int append_data_section_header(PAYLOAD* payload, uint32_t data_size)
+{
+    int result;
+    unsigned char section_header[8];
+    size_t section_header_size;
+
+    section_header[0] = 0x00;
+    section_header[1] = 0x53;
+    section_header[2] = 0x75;
+
+    if (data_size <= UINT8_MAX)
+    {
+        section_header[3] = 0xA0;
+        section_header[4] = (unsigned char)data_size;
+        section_header_size = 5;
+    }
+    else
+    {
+        section_header[3] = 0xB0;
+        section_header[4] = (unsigned char)((data_size >> 24) & 0xFF);
+        section_header[5] = (unsigned char)((data_size >> 16) & 0xFF);
+        section_header[6] = (unsigned char)((data_size >> 8) & 0xFF);
+        section_header[7] = (unsigned char)(data_size & 0xFF);
+        section_header_size = 8;
+    }
+
+    if (!payload_append_data(payload, section_header, section_header_size))
+    {
+        LogError("Cannot append data section header");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+/* appends the encoded sections of message to payload, wrapped in a single data section when as_data_section is true;
+nothing is appended and ENCODE_MESSAGE_TOO_LARGE is returned if the encoding would take more than max_encoded_size bytes,
+with encoded_message_size set to the size the encoding would have (SIZE_MAX if it cannot be encoded at any size) */
+static ENCODE_MESSAGE_RESULT encode_message(MESSAGE_SENDER_INSTANCE* message_sender, MESSAGE_HANDLE message, bool as_data_section, uint64_t max_encoded_size, PAYLOAD* payload, size_t* encoded_message_size)
+{
+    ENCODE_MESSAGE_RESULT result;
 
     size_t encoded_size;
     size_t encoded_size_before_body = 0;
     size_t total_encoded_size = 0;
     MESSAGE_BODY_TYPE message_body_type;
-    message_format message_format;
 
-    if ((message_get_body_type(message, &message_body_type) != 0) ||
-        (message_get_message_format(message, &message_format) != 0))
+    if (message_get_body_type(message, &message_body_type) != 0)
     {
-        LogError("Failure getting message body type and/or message format");
-        result = SEND_ONE_MESSAGE_ERROR;
+        LogError("Failure getting message body type");
+        result = ENCODE_MESSAGE_ERROR;
     }
     else
     {
@@ -324,18 +497,18 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
         
         if (is_error)
         {
-            result = SEND_ONE_MESSAGE_ERROR;
+            result = ENCODE_MESSAGE_ERROR;
         }
         else
         {
-            result = SEND_ONE_MESSAGE_OK;
+            result = ENCODE_MESSAGE_OK;
 
             // body - amqp data
             switch (message_body_type)
             {
             default:
                 LogError("Unknown body type");
-                result = SEND_ONE_MESSAGE_ERROR;
+                result = ENCODE_MESSAGE_ERROR;
                 break;
 
             case MESSAGE_BODY_TYPE_VALUE:
@@ -344,7 +517,7 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                 if (message_get_body_amqp_value_in_place(message, &message_body_amqp_value) != 0)
                 {
                     LogError("Cannot obtain AMQP value from body");
-                    result = SEND_ONE_MESSAGE_ERROR;
+                    result = ENCODE_MESSAGE_ERROR;
                 }
                 else
                 {
@@ -352,14 +525,14 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                     if (body_amqp_value == NULL)
                     {
                         LogError("Cannot create body AMQP value");
-                        result = SEND_ONE_MESSAGE_ERROR;
+                        result = ENCODE_MESSAGE_ERROR;
                     }
                     else
                     {
                         if (amqpvalue_get_encoded_size(body_amqp_value, &encoded_size) != 0)
                         {
                             LogError("Cannot get body AMQP value encoded size");
-                            result = SEND_ONE_MESSAGE_ERROR;
+                            result = ENCODE_MESSAGE_ERROR;
                         }
                         else
                         {
@@ -378,14 +551,14 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                 if (message_get_body_amqp_data_count(message, &body_data_count) != 0)
                 {
                     LogError("Cannot get body AMQP data count");
-                    result = SEND_ONE_MESSAGE_ERROR;
+                    result = ENCODE_MESSAGE_ERROR;
                 }
                 else
                 {
                     if (body_data_count == 0)
                     {
                         LogError("Body data count is zero");
-                        result = SEND_ONE_MESSAGE_ERROR;
+                        result = ENCODE_MESSAGE_ERROR;
                     }
                     else
                     {
@@ -396,7 +569,13 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                             if (!payload_is_valid(binary_data))
                             {
                                 LogError("Cannot get body AMQP data %u", (unsigned int)i);
-                                result = SEND_ONE_MESSAGE_ERROR;
+                                result = ENCODE_MESSAGE_ERROR;
+                            }
+                            else if (as_data_section && payload_has_unsized_callback_data(binary_data))
+                            {
+                                /* the data section header carries the size from this pass, which a producer that is run again may not honour */
+                                LogError("Cannot wrap body AMQP data %u with a callback part of unknown size in a data section", (unsigned int)i);
+                                result = ENCODE_MESSAGE_ERROR;
                             }
                             else
                             {
@@ -410,14 +589,14 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                                 if (body_amqp_data == NULL)
                                 {
                                     LogError("Cannot create body AMQP data");
-                                    result = SEND_ONE_MESSAGE_ERROR;
+                                    result = ENCODE_MESSAGE_ERROR;
                                 }
                                 else
                                 {
                                     if (amqpvalue_get_encoded_size(body_amqp_data, &encoded_size) != 0)
                                     {
                                         LogError("Cannot get body AMQP data encoded size");
-                                        result = SEND_ONE_MESSAGE_ERROR;
+                                        result = ENCODE_MESSAGE_ERROR;
                                     }
                                     else
                                     {
@@ -434,80 +613,109 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
             }
             }
 
-            if (result == 0)
+            if (result == ENCODE_MESSAGE_OK)
             {
-                PAYLOAD *payload = payload_create();
-                if (callback_found)
+                size_t section_header_size = as_data_section ? get_data_section_header_size(total_encoded_size) : 0;
+
+                if (total_encoded_size > UINT32_MAX)
                 {
-                    const size_t padding_for_encoded_size = 8;   // this stops us getting lots of little payloads elements in the linked list
-                    payload_reserve_data(payload, encoded_size_before_body + padding_for_encoded_size);
+                    *encoded_message_size = SIZE_MAX;
+                    result = ENCODE_MESSAGE_TOO_LARGE;
                 }
-                else
+                else if ((uint64_t)section_header_size + total_encoded_size > max_encoded_size)
                 {
-                    payload_reserve_data(payload, total_encoded_size);
+                    *encoded_message_size = section_header_size + total_encoded_size;
+                    result = ENCODE_MESSAGE_TOO_LARGE;
                 }
+                else
+                {
+                    bool reserved;
+
+                    if (callback_found)
+                    {
+                        const size_t padding_for_encoded_size = 8;   // this stops us getting lots of little payloads elements in the linked list
+                        reserved = payload_reserve_data(payload, section_header_size + encoded_size_before_body + padding_for_encoded_size);
+                    }
+                    else
+                    {
+                        reserved = payload_reserve_data(payload, section_header_size + total_encoded_size);
+                    }
 
-                result = SEND_ONE_MESSAGE_OK;
+                    if (!reserved)
+                    {
+                        LogError("Cannot reserve payload for the encoded message");
+                        result = ENCODE_MESSAGE_ERROR;
+                    }
+                    else if (as_data_section &&
+                        (append_data_section_header(payload, (uint32_t)total_encoded_size) != 0))
+                    {
+                        result = ENCODE_MESSAGE_ERROR;
+                    }
+                    else
+                    {
+                        *encoded_message_size = section_header_size + total_encoded_size;
+                    }
+                }
 
-                if (header != NULL)
+                if ((result == ENCODE_MESSAGE_OK) && (header != NULL))
                 {
-                    if (amqpvalue_encode(header_amqp_value, encode_bytes, payload) != 0)
+                    if (amqpvalue_encode_to_payload(header_amqp_value, payload) != 0)
                     {
                         LogError("Cannot encode header value");
-                        result = SEND_ONE_MESSAGE_ERROR;
+                        result = ENCODE_MESSAGE_ERROR;
                     }
 
                     log_message_chunk(message_sender, "Header:", header_amqp_value);
                 }
 
-                if ((result == SEND_ONE_MESSAGE_OK) && (msg_annotations != NULL))
+                if ((result == ENCODE_MESSAGE_OK) && (msg_annotations != NULL))
                 {
-                    if (amqpvalue_encode(msg_annotations, encode_bytes, payload) != 0)
+                    if (amqpvalue_encode_to_payload(msg_annotations, payload) != 0)
                     {
                         LogError("Cannot encode message annotations value");
-                        result = SEND_ONE_MESSAGE_ERROR;
+                        result = ENCODE_MESSAGE_ERROR;
                     }
 
                     log_message_chunk(message_sender, "Message Annotations:", msg_annotations);
                 }
 
-                if ((result == SEND_ONE_MESSAGE_OK) && (properties != NULL))
+                if ((result == ENCODE_MESSAGE_OK) && (properties != NULL))
                 {
-                    if (amqpvalue_encode(properties_amqp_value, encode_bytes, payload) != 0)
+                    if (amqpvalue_encode_to_payload(properties_amqp_value, payload) != 0)
                     {
                         LogError("Cannot encode message properties value");
-                        result = SEND_ONE_MESSAGE_ERROR;
+                        result = ENCODE_MESSAGE_ERROR;
                     }
 
                     log_message_chunk(message_sender, "Properties:", properties_amqp_value);
                 }
 
-                if ((result == SEND_ONE_MESSAGE_OK) && (application_properties != NULL))
+                if ((result == ENCODE_MESSAGE_OK) && (application_properties != NULL))
                 {
-                    if (amqpvalue_encode(application_properties_value, encode_bytes, payload) != 0)
+                    if (amqpvalue_encode_to_payload(application_properties_value, payload) != 0)
                     {
                         LogError("Cannot encode application properties value");
-                        result = SEND_ONE_MESSAGE_ERROR;
+                        result = ENCODE_MESSAGE_ERROR;
                     }
 
                     log_message_chunk(message_sender, "Application properties:", application_properties_value);
                 }
 
-                if (result == SEND_ONE_MESSAGE_OK)
+                if (result == ENCODE_MESSAGE_OK)
                 {
                     switch (message_body_type)
                     {
                     default:
                         LogError("Unknown message type");
-                        result = SEND_ONE_MESSAGE_ERROR;
+                        result = ENCODE_MESSAGE_ERROR;
                         break;
 
                     case MESSAGE_BODY_TYPE_VALUE:
                     {
-                        if (amqpvalue_encode(body_amqp_value, encode_bytes, payload) != 0)
+                        if (amqpvalue_encode_to_payload(body_amqp_value, payload) != 0)
                         {
                             LogError("Cannot encode body AMQP value");
-                            result = SEND_ONE_MESSAGE_ERROR;
+                            result = ENCODE_MESSAGE_ERROR;
                         }
 
                         log_message_chunk(message_sender, "Body - amqp value:", body_amqp_value);
@@ -523,7 +731,7 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                             if (!payload_is_valid(binary_data))
                             {
                                 LogError("Cannot get AMQP data %u", (unsigned int)i);
-                                result = SEND_ONE_MESSAGE_ERROR;
+                                result = ENCODE_MESSAGE_ERROR;
                             }
                             else
                             {
@@ -531,15 +739,15 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                                 if (body_amqp_data == NULL)
                                 {
                                     LogError("Cannot create body AMQP data %u", (unsigned int)i);
-                                    result = SEND_ONE_MESSAGE_ERROR;
+                                    result = ENCODE_MESSAGE_ERROR;
                                 }
                                 else
                                 {
-                                    if (amqpvalue_encode(body_amqp_data, encode_bytes, payload) != 0)
+                                    if (amqpvalue_encode_to_payload(body_amqp_data, payload) != 0)
                                     {
                                         LogError("Cannot encode body AMQP data %u", (unsigned int)i);
-                                        result = SEND_ONE_MESSAGE_ERROR;
-                                        payload_destroy(&binary_data);
+                                        result = ENCODE_MESSAGE_ERROR;
+                                        amqpvalue_destroy(body_amqp_data);
                                         break;
                                     }
 
@@ -552,35 +760,6 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
                     }
                 }
 
-                if (result == SEND_ONE_MESSAGE_OK)
-                {
-                    ASYNC_OPERATION_HANDLE transfer_async_operation;
-                    LINK_TRANSFER_RESULT link_transfer_error;
-                    MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, pending_send);
-                    message_with_callback->message_send_state = MESSAGE_SEND_STATE_PENDING;
-
-                    transfer_async_operation = link_transfer_async(message_sender->link, message_format, payload, on_delivery_settled, pending_send, &link_transfer_error, message_with_callback->timeout);
-                    if (transfer_async_operation == NULL)
-                    {
-                        if (link_transfer_error == LINK_TRANSFER_BUSY)
-                        {
-                            message_with_callback->message_send_state = MESSAGE_SEND_STATE_NOT_SENT;
-                            result = SEND_ONE_MESSAGE_BUSY;
-                        }
-                        else
-                        {
-                            LogError("Error in link transfer");
-                            result = SEND_ONE_MESSAGE_ERROR;
-                        }
-                    }
-                    else
-                    {
-                        result = SEND_ONE_MESSAGE_OK;
-                    }
-                }
-
-                payload_destroy(&payload);
-
                 if (body_amqp_value != NULL)
                 {
                     amqpvalue_destroy(body_amqp_value);
@@ -627,44 +806,127 @@ static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message
     return result;
 }
 
-static void send_all_pending_messages(MESSAGE_SENDER_HANDLE message_sender)
+static SEND_ONE_MESSAGE_RESULT transfer_message(MESSAGE_SENDER_INSTANCE* message_sender, MESSAGE_WITH_CALLBACK* message_with_callback, message_format message_format, PAYLOAD* payload)
 {
-    size_t i;
+    SEND_ONE_MESSAGE_RESULT result;
+    ASYNC_OPERATION_HANDLE transfer_async_operation;
+    LINK_TRANSFER_RESULT link_transfer_error;
 
-    for (i = 0; i < message_sender->message_count; i++)
+    /* the link may settle the delivery before link_transfer_async returns, so the message has to be in flight by then */
+    message_queue_remove(&message_sender->unsent_messages, message_with_callback);
+    message_with_callback->message_send_state = MESSAGE_SEND_STATE_PENDING;
+    message_queue_append(&message_sender->in_flight_messages, message_with_callback);
+
+    transfer_async_operation = link_transfer_async(message_sender->link, message_format, payload, on_delivery_settled, message_with_callback, &link_transfer_error, message_with_callback->timeout);
+    if (transfer_async_operation == NULL)
     {
-        MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, message_sender->messages[i]);
-        if (message_with_callback->message_send_state == MESSAGE_SEND_STATE_NOT_SENT)
+        if (link_transfer_error == LINK_TRANSFER_OK)
         {
-            switch (send_one_message(message_sender, message_sender->messages[i], message_with_callback->message))
-            {
-            default:
-                LogError("Invalid send one message result");
-                break;
+            /* settled while the link was sending it, on_delivery_settled has completed the message */
+            result = SEND_ONE_MESSAGE_COMPLETED;
+        }
+        else if (link_transfer_error == LINK_TRANSFER_BUSY)
+        {
+            /* only the oldest unsent message is ever sent, so it goes back to the head of the queue */
+            message_queue_remove(&message_sender->in_flight_messages, message_with_callback);
+            message_with_callback->message_send_state = MESSAGE_SEND_STATE_NOT_SENT;
+            message_queue_prepend(&message_sender->unsent_messages, message_with_callback);
+            result = SEND_ONE_MESSAGE_BUSY;
+        }
+        else
+        {
+            LogError("Error in link transfer");
+            result = SEND_ONE_MESSAGE_ERROR;
+        }
+    }
+    else
+    {
+        message_with_callback->transfer_operation = transfer_async_operation;
 
-            case SEND_ONE_MESSAGE_ERROR:
-            {
-                ON_MESSAGE_SEND_COMPLETE on_message_send_complete = message_with_callback->on_message_send_complete;
-                void* context = message_with_callback->context;
-                remove_pending_message_by_index(message_sender, i);
+        /* the link does not keep the payload once the transfer is sent */
+        if (message_with_callback->encoded_message != NULL)
+        {
+            payload_destroy(&message_with_callback->encoded_message);
+        }
 
-                if (on_message_send_complete != NULL)
-                {
-                    on_message_send_complete(context, MESSAGE_SEND_ERROR, NULL);
-                }
+        result = SEND_ONE_MESSAGE_OK;
+    }
 
-                i = message_sender->message_count;
-                break;
-            }
-            case SEND_ONE_MESSAGE_BUSY:
-                i = message_sender->message_count + 1;
-                break;
+    return result;
+}
 
-            case SEND_ONE_MESSAGE_OK:
-                break;
+static SEND_ONE_MESSAGE_RESULT send_one_message(MESSAGE_SENDER_INSTANCE* message_sender, MESSAGE_WITH_CALLBACK* message_with_callback, MESSAGE_HANDLE message)
+{
+    SEND_ONE_MESSAGE_RESULT result;
+
+    if (message_with_callback->encoded_message != NULL)
+    {
+        result = transfer_message(message_sender, message_with_callback, message_with_callback->message_format, message_with_callback->encoded_message);
+    }
+    else
+    {
+        message_format message_format;
+        PAYLOAD* payload;
+
+        if (message_get_message_format(message, &message_format) != 0)
+        {
+            LogError("Failure getting message format");
+            result = SEND_ONE_MESSAGE_ERROR;
+        }
+        else if ((payload = payload_create()) == NULL)
+        {
+            LogError("Cannot create payload for message");
+            result = SEND_ONE_MESSAGE_ERROR;
+        }
+        else
+        {
+            size_t encoded_message_size;
+
+            if (encode_message(message_sender, message, false, UINT64_MAX, payload, &encoded_message_size) != ENCODE_MESSAGE_OK)
+            {
+                LogError("Cannot encode message");
+                result = SEND_ONE_MESSAGE_ERROR;
+            }
+            else
+            {
+                result = transfer_message(message_sender, message_with_callback, message_format, payload);
             }
 
-            i--;
+            payload_destroy(&payload);
+        }
+    }
+
+    return result;
+}
+
+static void send_all_pending_messages(MESSAGE_SENDER_HANDLE message_sender)
+{
+    bool keep_sending = true;
+
+    while (keep_sending &&
+        (message_sender->unsent_messages.head != NULL))
+    {
+        MESSAGE_WITH_CALLBACK* message_with_callback = message_sender->unsent_messages.head;
+
+        switch (send_one_message(message_sender, message_with_callback, message_with_callback->message))
+        {
+        default:
+            LogError("Invalid send one message result");
+            keep_sending = false;
+            break;
+
+        case SEND_ONE_MESSAGE_ERROR:
+            remove_pending_message(message_sender, message_with_callback, MESSAGE_SEND_ERROR, NULL);
+            keep_sending = false;
+            break;
+
+        case SEND_ONE_MESSAGE_BUSY:
+            keep_sending = false;
+            break;
+
+        case SEND_ONE_MESSAGE_OK:
+        case SEND_ONE_MESSAGE_COMPLETED:
+            break;
         }
     }
 }
@@ -679,34 +941,36 @@ static void set_message_sender_state(MESSAGE_SENDER_INSTANCE* message_sender, ME
     }
 }
 
-static void indicate_all_messages_as_error(MESSAGE_SENDER_INSTANCE* message_sender)
+static void indicate_queue_as_error(MESSAGE_WITH_CALLBACK* message_with_callback)
 {
-    size_t i;
-
-    for (i = 0; i < message_sender->message_count; i++)
+    while (message_with_callback != NULL)
     {
-        MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, message_sender->messages[i]);
-        if (message_with_callback->on_message_send_complete != NULL)
-        {
-            message_with_callback->on_message_send_complete(message_with_callback->context, MESSAGE_SEND_ERROR, NULL);
-        }
+        MESSAGE_WITH_CALLBACK* next = message_with_callback->next;
 
-        if (message_with_callback->message != NULL)
-        {
-            message_destroy(message_with_callback->message);
-        }
-        async_operation_destroy(message_sender->messages[i]);
-    }
-
-    if (message_sender->messages != NULL)
-    {
-        message_sender->message_count = 0;
+        message_with_callback->previous = NULL;
+        message_with_callback->next = NULL;
+        abort_message(message_with_callback, MESSAGE_SEND_ERROR);
 
-        free(message_sender->messages);
-        message_sender->messages = NULL;
+        message_with_callback = next;
     }
 }
 
+static void indicate_all_messages_as_error(MESSAGE_SENDER_INSTANCE* message_sender)
+{
+    /* detach both queues first so that callbacks sending new messages do not see the ones being failed */
+    MESSAGE_WITH_CALLBACK* in_flight_messages = message_sender->in_flight_messages.head;
+    MESSAGE_WITH_CALLBACK* unsent_messages = message_sender->unsent_messages.head;
+
+    message_sender->in_flight_messages.head = NULL;
+    message_sender->in_flight_messages.tail = NULL;
+    message_sender->unsent_messages.head = NULL;
+    message_sender->unsent_messages.tail = NULL;
+
+    /* in flight messages were queued before any unsent one */
+    indicate_queue_as_error(in_flight_messages);
+    indicate_queue_as_error(unsent_messages);
+}
+
 static void on_link_state_changed(void* context, LINK_STATE new_link_state, LINK_STATE previous_link_state)
 {
     MESSAGE_SENDER_INSTANCE* message_sender = (MESSAGE_SENDER_INSTANCE*)context;
@@ -762,8 +1026,10 @@ MESSAGE_SENDER_HANDLE messagesender_create(LINK_HANDLE link, ON_MESSAGE_SENDER_S
     }
     else
     {
-        message_sender->messages = NULL;
-        message_sender->message_count = 0;
+        message_sender->unsent_messages.head = NULL;
+        message_sender->unsent_messages.tail = NULL;
+        message_sender->in_flight_messages.head = NULL;
+        message_sender->in_flight_messages.tail = NULL;
         message_sender->link = link;
         message_sender->on_message_sender_state_changed = on_message_sender_state_changed;
         message_sender->on_message_sender_state_changed_context = context;
@@ -859,15 +1125,132 @@ int messagesender_close(MESSAGE_SENDER_HANDLE message_sender)
     return result;
 }
 
+static void cancel_message(MESSAGE_SENDER_INSTANCE* message_sender, MESSAGE_WITH_CALLBACK* message_with_callback)
+{
+    message_queue_remove(get_message_queue(message_sender, message_with_callback), message_with_callback);
+    abort_message(message_with_callback, MESSAGE_SEND_CANCELLED);
+}
+
 static void messagesender_send_cancel_handler(ASYNC_OPERATION_HANDLE send_operation)
 {
     MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, send_operation);
-    if (message_with_callback->on_message_send_complete != NULL)
+
+    cancel_message(message_with_callback->message_sender, message_with_callback);
+}
+
+static void messagesender_send_batch_cancel_handler(ASYNC_OPERATION_HANDLE send_operation)
+{
+    MESSAGE_BATCH* batch = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_BATCH, send_operation);
+    size_t i;
+
+    /* hold the batch so that completing its last message does not free it under this loop */
+    batch->pending_count++;
+
+    for (i = 0; i < batch->message_count; i++)
+    {
+        MESSAGE_WITH_CALLBACK* message_with_callback = &batch->messages[i];
+        if (message_with_callback->message_send_state != MESSAGE_SEND_STATE_COMPLETED)
+        {
+            cancel_message(message_with_callback->message_sender, message_with_callback);
+        }
+    }
+
+    release_batch(send_operation);
+}
+
+static void init_message_with_callback(MESSAGE_WITH_CALLBACK* message_with_callback, MESSAGE_SENDER_HANDLE message_sender, ASYNC_OPERATION_HANDLE send_operation, MESSAGE_BATCH* batch, tickcounter_ms_t timeout)
+{
+    message_with_callback->message = NULL;
+    message_with_callback->on_message_send_complete = NULL;
+    message_with_callback->context = NULL;
+    message_with_callback->message_sender = message_sender;
+    message_with_callback->message_send_state = MESSAGE_SEND_STATE_NOT_SENT;
+    message_with_callback->timeout = timeout;
+    message_with_callback->encoded_message = NULL;
+    message_with_callback->message_format = 0;
+    message_with_callback->send_operation = send_operation;
+    message_with_callback->batch = batch;
+    message_with_callback->transfer_operation = NULL;
+    message_with_callback->previous = NULL;
+    message_with_callback->next = NULL;
+}
+
+/* queues a message that has not been cloned yet, sending it right away when nothing is queued ahead of it so that
+messages go out in order; returns false, with the message back off the queues, if it could neither be sent nor queued.
+is_completed is set when the message was settled during the call, in which case it has been completed and freed.
+A batched message is already encoded, so message is NULL for it and there is nothing to clone. */
+static bool send_or_queue_message(MESSAGE_SENDER_INSTANCE* message_sender, MESSAGE_WITH_CALLBACK* message_with_callback, MESSAGE_HANDLE message, bool* is_completed)
+{
+    bool result;
+
+    *is_completed = false;
+    message_queue_append(&message_sender->unsent_messages, message_with_callback);
+
+    if ((message_sender->message_sender_state == MESSAGE_SENDER_STATE_OPEN) &&
+        (message_sender->unsent_messages.head == message_with_callback))
+    {
+        switch (send_one_message(message_sender, message_with_callback, message))
+        {
+        default:
+        case SEND_ONE_MESSAGE_ERROR:
+            LogError("Error sending message");
+            result = false;
+            break;
+
+        case SEND_ONE_MESSAGE_BUSY:
+            if (message == NULL)
+            {
+                result = true;
+            }
+            else
+            {
+                message_with_callback->message = message_clone(message);
+                if (message_with_callback->message == NULL)
+                {
+                    LogError("Error cloning message for placing it in the pending sends list");
+                    result = false;
+                }
+                else
+                {
+                    result = true;
+                }
+            }
+            break;
+
+        case SEND_ONE_MESSAGE_OK:
+            result = true;
+            break;
+
+        case SEND_ONE_MESSAGE_COMPLETED:
+            *is_completed = true;
+            result = true;
+            break;
+        }
+    }
+    else if (message == NULL)
+    {
+        result = true;
+    }
+    else
+    {
+        message_with_callback->message = message_clone(message);
+        if (message_with_callback->message == NULL)
+        {
+            LogError("Cannot clone message for placing it in the pending sends list");
+            result = false;
+        }
+        else
+        {
+            result = true;
+        }
+    }
+
+    if (!result)
     {
-        message_with_callback->on_message_send_complete(message_with_callback->context, MESSAGE_SEND_CANCELLED, NULL);
+        message_queue_remove(get_message_queue(message_sender, message_with_callback), message_with_callback);
     }
 
-    remove_pending_message(message_with_callback->message_sender, send_operation);
+    return result;
 }
 
 ASYNC_OPERATION_HANDLE messagesender_send_async(MESSAGE_SENDER_HANDLE message_sender, MESSAGE_HANDLE message, ON_MESSAGE_SEND_COMPLETE on_message_send_complete, void* callback_context, tickcounter_ms_t timeout)
@@ -897,73 +1280,343 @@ ASYNC_OPERATION_HANDLE messagesender_send_async(MESSAGE_SENDER_HANDLE message_se
             else
             {
                 MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, result);
-                ASYNC_OPERATION_HANDLE* new_messages = (ASYNC_OPERATION_HANDLE*)realloc(message_sender->messages, sizeof(ASYNC_OPERATION_HANDLE) * (message_sender->message_count + 1));
-                if (new_messages == NULL)
+                bool is_completed;
+                init_message_with_callback(message_with_callback, message_sender, result, NULL, timeout);
+                message_with_callback->on_message_send_complete = on_message_send_complete;
+                message_with_callback->context = callback_context;
+
+                if (!send_or_queue_message(message_sender, message_with_callback, message, &is_completed))
                 {
-                    LogError("Failed allocating memory for pending sends");
-                    async_operation_destroy(result);
+                    /* the caller only sees the NULL handle, the callback is not called */
+                    message_with_callback->on_message_send_complete = NULL;
+                    complete_message(message_with_callback, MESSAGE_SEND_ERROR, NULL);
                     result = NULL;
                 }
-                else
+                else if (is_completed)
                 {
-                    message_with_callback->timeout = timeout;
-                    message_sender->messages = new_messages;
-                    if (message_sender->message_sender_state != MESSAGE_SENDER_STATE_OPEN)
-                    {
-                        message_with_callback->message = message_clone(message);
-                        if (message_with_callback->message == NULL)
-                        {
-                            LogError("Cannot clone message for placing it in the pending sends list");
-                            async_operation_destroy(result);
-                            result = NULL;
-                        }
+                    /* settled while it was sent, the callback has run and the operation is gone */
+                    result = NULL;
+                }
+            }
+        }
+    }
 
-                        message_with_callback->message_send_state = MESSAGE_SEND_STATE_NOT_SENT;
-                    }
-                    else
+    return result;
+}
+
+ASYNC_OPERATION_HANDLE messagesender_send_batch_async(MESSAGE_SENDER_HANDLE message_sender, const MESSAGE_HANDLE* messages, size_t message_count, ON_MESSAGE_BATCH_SEND_COMPLETE on_message_batch_send_complete, void* callback_context, tickcounter_ms_t timeout)
+{
+    ASYNC_OPERATION_HANDLE result;
+    size_t i;
+
+    if ((message_sender == NULL) ||
+        (messages == NULL) ||
+        (message_count == 0))
+    {
+        LogError("Bad parameters: message_sender=%p, messages=%p, message_count=%lu, on_message_batch_send_complete=%p, callback_context=%p, timeout=%" PRIu64, message_sender, messages, (unsigned long)message_count, on_message_batch_send_complete, callback_context, (uint64_t)timeout);
+        result = NULL;
+    }
+    else if (message_count > (SIZE_MAX - sizeof(MU_C2(ASYNC_OPERATION_CONTEXT_STRUCT_, MESSAGE_BATCH))) / (sizeof(MESSAGE_WITH_CALLBACK) + sizeof(MESSAGE_SEND_RESULT)))
+    {
+        LogError("Too many messages in batch: %lu", (unsigned long)message_count);
+        result = NULL;
+    }
+    else
+    {
+        for (i = 0; i < message_count; i++)
+        {
+            if (messages[i] == NULL)
+            {
+                break;
+            }
+        }
+
+        if (i < message_count)
+        {
+            LogError("NULL message at index %lu in batch", (unsigned long)i);
+            result = NULL;
+        }
+        else if (message_sender->message_sender_state == MESSAGE_SENDER_STATE_ERROR)
+        {
+            LogError("Message sender in ERROR state");
+            result = NULL;
+        }
+        else
+        {
+            /* one allocation holds the batch, a queue entry per message and the per message results */
+            result = async_operation_create(messagesender_send_batch_cancel_handler, sizeof(MU_C2(ASYNC_OPERATION_CONTEXT_STRUCT_, MESSAGE_BATCH)) + (message_count * (sizeof(MESSAGE_WITH_CALLBACK) + sizeof(MESSAGE_SEND_RESULT))));
+            if (result == NULL)
+            {
+                LogError("Failed allocating batch send");
+            }
+            else
+            {
+                MESSAGE_BATCH* batch = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_BATCH, result);
+                /* batched messages are completed through the batch, which tracks them in pending_count */
+                bool is_completed;
+
+                batch->on_message_batch_send_complete = on_message_batch_send_complete;
+                batch->context = callback_context;
+                batch->message_count = message_count;
+                /* the extra count is released once all messages are queued, so the callback cannot run before that */
+                batch->pending_count = message_count + 1;
+                batch->messages = (MESSAGE_WITH_CALLBACK*)((unsigned char*)result + sizeof(MU_C2(ASYNC_OPERATION_CONTEXT_STRUCT_, MESSAGE_BATCH)));
+                batch->send_results = (MESSAGE_SEND_RESULT*)(batch->messages + message_count);
+
+                for (i = 0; i < message_count; i++)
+                {
+                    init_message_with_callback(&batch->messages[i], message_sender, result, batch, timeout);
+                    batch->send_results[i] = MESSAGE_SEND_ERROR;
+                }
+
+                /* the transfers are encoded back to back into the connection output buffer; on an unsettled link they reach the
+                io together on the next flush, while a settled transfer is flushed on its own so that its send result is known */
+                for (i = 0; i < message_count; i++)
+                {
+                    /* a message that fails is reported in send_results, the others still go */
+                    if (!send_or_queue_message(message_sender, &batch->messages[i], messages[i], &is_completed))
                     {
-                        message_with_callback->message = NULL;
-                        message_with_callback->message_send_state = MESSAGE_SEND_STATE_PENDING;
+                        complete_message(&batch->messages[i], MESSAGE_SEND_ERROR, NULL);
                     }
+                }
 
-                    if (result != NULL)
-                    {
-                        message_with_callback->on_message_send_complete = on_message_send_complete;
-                        message_with_callback->context = callback_context;
-                        message_with_callback->message_sender = message_sender;
+                if (batch->pending_count == 1)
+                {
+                    /* every message completed during the call, so releasing the batch reports it and frees the
+                    operation; the caller gets NULL rather than a handle it could cancel after it is gone */
+                    release_batch(result);
+                    result = NULL;
+                }
+                else
+                {
+                    release_batch(result);
+                }
+            }
+        }
+    }
 
-                        message_sender->messages[message_sender->message_count] = result;
-                        message_sender->message_count++;
+    return result;
+}
 
-                        if (message_sender->message_sender_state == MESSAGE_SENDER_STATE_OPEN)
-                        {
-                            switch (send_one_message(message_sender, result, message))
-                            {
-                            default:
-                            case SEND_ONE_MESSAGE_ERROR:
-                                LogError("Error sending message");
-                                remove_pending_message_by_index(message_sender, message_sender->message_count - 1);
-                                result = NULL;
-                                break;
-
-                            case SEND_ONE_MESSAGE_BUSY:
-                                message_with_callback->message = message_clone(message);
-                                if (message_with_callback->message == NULL)
-                                {
-                                    LogError("Error cloning message for placing it in the pending sends list");
-                                    async_operation_destroy(result);
-                                    result = NULL;
-                                }
-                                else
-                                {
-                                    message_with_callback->message_send_state = MESSAGE_SEND_STATE_NOT_SENT;
-                                }
-                                break;
+BATCHED_MESSAGE_HANDLE messagesender_batched_message_create(MESSAGE_SENDER_HANDLE message_sender)
+{
+    BATCHED_MESSAGE_INSTANCE* result;
 
-                            case SEND_ONE_MESSAGE_OK:
-                                break;
-                            }
-                        }
+    if (message_sender == NULL)
+    {
+        LogError("NULL message_sender");
+        result = NULL;
+    }
+    else
+    {
+        result = (BATCHED_MESSAGE_INSTANCE*)calloc(1, sizeof(BATCHED_MESSAGE_INSTANCE));
+        if (result == NULL)
+        {
+            LogError("Could not allocate memory for batched message");
+        }
+        else
+        {
+            result->message_sender = message_sender;
+            result->encoded_messages = NULL;
+            result->message_count = 0;
+            result->encoded_size = 0;
+        }
+    }
+
+    return result;
+}
+
+void messagesender_batched_message_destroy(BATCHED_MESSAGE_HANDLE batched_message)
+{
+    if (batched_message == NULL)
+    {
+        LogError("NULL batched_message");
+    }
+    else
+    {
+        if (batched_message->encoded_messages != NULL)
+        {
+            payload_destroy(&batched_message->encoded_messages);
+        }
+
+        free(batched_message);
+    }
+}
+
+BATCHED_MESSAGE_ADD_RESULT messagesender_batched_message_add(BATCHED_MESSAGE_HANDLE batched_message, MESSAGE_HANDLE message)
+{
+    BATCHED_MESSAGE_ADD_RESULT result;
+
+    if ((batched_message == NULL) ||
+        (message == NULL))
+    {
+        LogError("Bad parameters: batched_message=%p, message=%p", batched_message, message);
+        result = BATCHED_MESSAGE_ADD_ERROR;
+    }
+    else
+    {
+        uint64_t max_message_size;
+        PAYLOAD* payload;
+
+        if (link_get_peer_max_message_size(batched_message->message_sender->link, &max_message_size) != 0)
+        {
+            LogError("Could not get peer max message size");
+            result = BATCHED_MESSAGE_ADD_ERROR;
+        }
+        else if ((payload = payload_create()) == NULL)
+        {
+            LogError("Cannot create payload for batched message");
+            result = BATCHED_MESSAGE_ADD_ERROR;
+        }
+        else
+        {
+            size_t encoded_message_size;
+
+            /* a peer max message size of 0 means there is no limit */
+            if (max_message_size == 0)
+            {
+                max_message_size = UINT64_MAX;
+            }
+
+            /* the size check happens on the sizing pass of the encoder, so a message that does not fit is never encoded */
+            switch (encode_message(batched_message->message_sender, message, true, (batched_message->encoded_size < max_message_size) ? (max_message_size - batched_message->encoded_size) : 0, payload, &encoded_message_size))
+            {
+            default:
+            case ENCODE_MESSAGE_ERROR:
+                LogError("Cannot encode message into batched message");
+                result = BATCHED_MESSAGE_ADD_ERROR;
+                payload_destroy(&payload);
+                break;
+
+            case ENCODE_MESSAGE_TOO_LARGE:
+                /* only FULL when the message would fit in an empty batched message, so that the caller does not send this
+                batched message just to find the message does not fit in the next one either */
+                result = ((encoded_message_size == SIZE_MAX) || ((uint64_t)encoded_message_size > max_message_size)) ? BATCHED_MESSAGE_ADD_TOO_LARGE : BATCHED_MESSAGE_ADD_FULL;
+                payload_destroy(&payload);
+                break;
+
+            case ENCODE_MESSAGE_OK:
+                if (batched_message->encoded_messages == NULL)
+                {
+                    batched_message->encoded_messages = payload;
+                }
+                else
+                {
+                    payload_move_to_payload_end(batched_message->encoded_messages, &payload);
+                }
+
+                batched_message->message_count++;
+                batched_message->encoded_size += encoded_message_size;
+                result = BATCHED_MESSAGE_ADD_OK;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+int messagesender_batched_message_get_count(BATCHED_MESSAGE_HANDLE batched_message, size_t* message_count)
+{
+    int result;
+
+    if ((batched_message == NULL) ||
+        (message_count == NULL))
+    {
+        LogError("Bad parameters: batched_message=%p, message_count=%p", batched_message, message_count);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        *message_count = batched_message->message_count;
+        result = 0;
+    }
+
+    return result;
+}
+
+int messagesender_batched_message_get_size(BATCHED_MESSAGE_HANDLE batched_message, uint64_t* encoded_size)
+{
+    int result;
+
+    if ((batched_message == NULL) ||
+        (encoded_size == NULL))
+    {
+        LogError("Bad parameters: batched_message=%p, encoded_size=%p", batched_message, encoded_size);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        *encoded_size = batched_message->encoded_size;
+        result = 0;
+    }
+
+    return result;
+}
+
+ASYNC_OPERATION_HANDLE messagesender_send_batched_message_async(BATCHED_MESSAGE_HANDLE batched_message, ON_MESSAGE_SEND_COMPLETE on_message_send_complete, void* callback_context, tickcounter_ms_t timeout)
+{
+    ASYNC_OPERATION_HANDLE result;
+
+    if (batched_message == NULL)
+    {
+        LogError("Bad parameters: batched_message=%p, on_message_send_complete=%p, callback_context=%p, timeout=%" PRIu64, batched_message, on_message_send_complete, callback_context, (uint64_t)timeout);
+        result = NULL;
+    }
+    else if (batched_message->message_count == 0)
+    {
+        LogError("Cannot send an empty batched message");
+        result = NULL;
+    }
+    else
+    {
+        MESSAGE_SENDER_INSTANCE* message_sender = batched_message->message_sender;
+
+        if (message_sender->message_sender_state == MESSAGE_SENDER_STATE_ERROR)
+        {
+            LogError("Message sender in ERROR state");
+            result = NULL;
+        }
+        else
+        {
+            result = CREATE_ASYNC_OPERATION(MESSAGE_WITH_CALLBACK, messagesender_send_cancel_handler);
+            if (result == NULL)
+            {
+                LogError("Failed allocating context for send");
+            }
+            else
+            {
+                MESSAGE_WITH_CALLBACK* message_with_callback = GET_ASYNC_OPERATION_CONTEXT(MESSAGE_WITH_CALLBACK, result);
+                bool is_completed;
+                init_message_with_callback(message_with_callback, message_sender, result, NULL, timeout);
+                message_with_callback->on_message_send_complete = on_message_send_complete;
+                message_with_callback->context = callback_context;
+                message_with_callback->message_format = MESSAGE_FORMAT_BATCHED;
+
+                /* the send takes the encoded messages, leaving the batched message empty for the next batch */
+                message_with_callback->encoded_message = batched_message->encoded_messages;
+                batched_message->encoded_messages = NULL;
+
+                if (!send_or_queue_message(message_sender, message_with_callback, NULL, &is_completed))
+                {
+                    /* the encoded messages go back to the batched message so that the caller can retry */
+                    batched_message->encoded_messages = message_with_callback->encoded_message;
+                    message_with_callback->encoded_message = NULL;
+
+                    /* the caller only sees the NULL handle, the callback is not called */
+                    message_with_callback->on_message_send_complete = NULL;
+                    complete_message(message_with_callback, MESSAGE_SEND_ERROR, NULL);
+                    result = NULL;
+                }
+                else
+                {
+                    batched_message->message_count = 0;
+                    batched_message->encoded_size = 0;
+
+                    if (is_completed)
+                    {
+                        /* settled while it was sent, the callback has run and the operation is gone */
+                        result = NULL;
                     }
                 }
             }
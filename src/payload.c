@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "azure_c_shared_utility/refcount.h"
 
 #ifdef WISER
 #include "Logger.h"
@@ -19,6 +20,145 @@
 
 static const size_t UNCALCULATED_SIZE = 0xFFFFFFFF;
 int32_t payloadCount = 0;
+int32_t payloadSegmentCount = 0;
+
+// parts smaller than this are copied rather than shared
+#define SHARE_THRESHOLD 64
+
+// Owned bytes live in a refcounted segment so that copies of a payload can share them. Bytes that have been
+// written are never modified again: only the part that allocated the segment keeps spare capacity and it only
+// writes beyond its own size, which no sharer can see. Copies may be released on other threads than their source,
+// so the count is updated atomically.
+typedef struct PAYLOAD_SEGMENT_TAG
+{
+   COUNT_TYPE ref_count;
+   uint32_t capacity;
+   PAYLOAD_CAPTURE_POOL *pool;   // goes back to this capture pool rather than to the heap
+   unsigned char bytes[];
+} PAYLOAD_SEGMENT;
+
+// Materialized callbacks capture their output into segments that their owner's pool keeps for reuse once released,
+// so that producers streaming similar documents over and over do not hit the allocator for every message. The free
+// list is only touched from the pool's thread: a segment leaves its pool as soon as it is shared, so only a segment
+// held by the one part that captured into it ever goes back to the pool.
+#define CAPTURE_POOL_SIZE 4
+#define MAX_POOLED_CAPTURE_SIZE (256 * 1024)
+#define INITIAL_CAPTURE_SIZE 1024
+
+struct PAYLOAD_CAPTURE_POOL_TAG
+{
+   COUNT_TYPE ref_count;   // the owner, plus every segment in use and every unmaterialized part drawing from the pool
+   bool closed;          // the owner destroyed the pool, segments released from now on go back to the heap
+   size_t count;
+   PAYLOAD_SEGMENT *segments[CAPTURE_POOL_SIZE];
+};
+
+static void capture_pool_release(PAYLOAD_CAPTURE_POOL *pool)
+{
+   if (pool != NULL && DEC_REF_VAR(pool->ref_count) == DEC_RETURN_ZERO)
+   {
+      free(pool);
+   }
+}
+
+static PAYLOAD_SEGMENT* segment_create(size_t capacity)
+{
+   PAYLOAD_SEGMENT* segment = (PAYLOAD_SEGMENT*)malloc(sizeof(PAYLOAD_SEGMENT) + capacity);
+   if (segment != NULL)
+   {
+      ++payloadSegmentCount;
+      INIT_REF_VAR(segment->ref_count);
+      segment->capacity = (uint32_t)capacity;
+      segment->pool = NULL;
+   }
+   return segment;
+}
+
+static PAYLOAD_SEGMENT* segment_resize(PAYLOAD_SEGMENT* segment, size_t capacity)
+{
+   PAYLOAD_SEGMENT* resized = (PAYLOAD_SEGMENT*)realloc(segment, sizeof(PAYLOAD_SEGMENT) + capacity);
+   if (resized != NULL)
+   {
+      resized->capacity = (uint32_t)capacity;
+   }
+   return resized;
+}
+
+static void segment_release(PAYLOAD_SEGMENT* segment)
+{
+   if (segment != NULL && DEC_REF_VAR(segment->ref_count) == DEC_RETURN_ZERO)
+   {
+      PAYLOAD_CAPTURE_POOL *pool = segment->pool;
+
+      if (pool != NULL && !pool->closed && pool->count < CAPTURE_POOL_SIZE && segment->capacity <= MAX_POOLED_CAPTURE_SIZE)
+      {
+         // a segment kept by the pool holds no reference, the owner's reference keeps the pool alive
+         pool->segments[pool->count++] = segment;
+      }
+      else
+      {
+         --payloadSegmentCount;
+         free(segment);
+      }
+
+      capture_pool_release(pool);
+   }
+}
+
+static PAYLOAD_SEGMENT* capture_segment_acquire(PAYLOAD_CAPTURE_POOL *pool)
+{
+   PAYLOAD_SEGMENT* segment;
+
+   if (pool != NULL && pool->count > 0)
+   {
+      segment = pool->segments[--pool->count];
+      INIT_REF_VAR(segment->ref_count);
+   }
+   else
+   {
+      segment = segment_create(INITIAL_CAPTURE_SIZE);
+   }
+
+   if (segment != NULL && pool != NULL)
+   {
+      segment->pool = pool;
+      (void)INC_REF_VAR(pool->ref_count);
+   }
+
+   return segment;
+}
+
+PAYLOAD_CAPTURE_POOL *payload_capture_pool_create(void)
+{
+   PAYLOAD_CAPTURE_POOL *pool = (PAYLOAD_CAPTURE_POOL *)calloc(1, sizeof(PAYLOAD_CAPTURE_POOL));
+   if (pool != NULL)
+   {
+      INIT_REF_VAR(pool->ref_count);
+      pool->closed = false;
+      pool->count = 0;
+   }
+   return pool;
+}
+
+void payload_capture_pool_destroy(PAYLOAD_CAPTURE_POOL **pool)
+{
+   if (pool != NULL && *pool != NULL)
+   {
+      size_t i;
+
+      // segments and parts still out keep the pool until they are released, their segments then go to the heap
+      (*pool)->closed = true;
+      for (i = 0; i < (*pool)->count; i++)
+      {
+         --payloadSegmentCount;
+         free((*pool)->segments[i]);
+      }
+      (*pool)->count = 0;
+
+      capture_pool_release(*pool);
+      *pool = NULL;
+   }
+}
 
 static bool count_bytes(void *context, const unsigned char *buffer, size_t length)
 {
@@ -35,6 +175,75 @@ static bool count_bytes(void *context, const unsigned char *buffer, size_t lengt
    }
 }
 
+typedef struct
+{
+   PAYLOAD_SEGMENT *segment;
+   size_t size;
+} CAPTURE_CONTEXT;
+
+static bool capture_bytes(void *context, const unsigned char *buffer, size_t length)
+{
+   CAPTURE_CONTEXT *capture = (CAPTURE_CONTEXT *)context;
+
+   if (capture->size + length > capture->segment->capacity)
+   {
+      size_t new_capacity = capture->segment->capacity * 2;
+      if (new_capacity < capture->size + length)
+      {
+         new_capacity = capture->size + length;
+      }
+
+      PAYLOAD_SEGMENT *resized = segment_resize(capture->segment, new_capacity);
+      if (resized == NULL)
+      {
+         return false;
+      }
+      capture->segment = resized;
+   }
+
+   memcpy(capture->segment->bytes + capture->size, buffer, length);
+   capture->size += length;
+   return true;
+}
+
+static bool payload_is_unmaterialized(const PAYLOAD *payload)
+{
+   return payload->type == PAYLOAD_TYPE_CALLBACK && payload->x.callback.materialize;
+}
+
+// Runs the producer of a materialized callback part once and turns the part into a byte array that owns the output.
+static bool materialize_callback(PAYLOAD *payload)
+{
+   bool success;
+   PAYLOAD_CAPTURE_POOL *pool = payload->x.callback.capture_pool;
+   CAPTURE_CONTEXT capture = { capture_segment_acquire(pool), 0 };
+
+   if (capture.segment == NULL)
+   {
+      success = false;
+   }
+   else if (payload->x.callback.writer_callback(payload->x.callback.user_context, capture_bytes, &capture) != true)
+   {
+      segment_release(capture.segment);
+      success = false;
+   }
+   else
+   {
+      payload->type = PAYLOAD_TYPE_BYTE_ARRAY;
+      payload->x.byte_array.segment = capture.segment;
+      payload->x.byte_array.bytes = capture.segment->bytes;
+      payload->x.byte_array.size = (uint32_t)capture.size;
+      payload->x.byte_array.capacity = (uint32_t)capture.size;
+      payload->x.byte_array.borrowed = false;
+
+      // the segment holds its own reference on the pool, the part no longer needs one
+      capture_pool_release(pool);
+      success = true;
+   }
+
+   return success;
+}
+
 static size_t get_size_of_part(const PAYLOAD *payload)
 {
    size_t size = 0;
@@ -50,6 +259,24 @@ static size_t get_size_of_part(const PAYLOAD *payload)
          {
             size = payload->x.callback.calculated_size;
          }
+         else if (payload->x.callback.materialize)
+         {
+            // the one run of the producer captures its output, the size comes with it
+            if (materialize_callback((PAYLOAD *)payload) == true)
+            {
+               size = payload->x.byte_array.size;
+            }
+            else
+            {
+               DPRINTF_AMQP("[ERROR] Failed to capture the output of writer_callback");
+               size = 0;
+            }
+         }
+         else if (payload->x.callback.size_callback != NULL)
+         {
+            size = payload->x.callback.size_callback(payload->x.callback.user_context);
+            ((PAYLOAD *)payload)->x.callback.calculated_size = size;
+         }
          else if (payload->x.callback.writer_callback(payload->x.callback.user_context,
                                                       count_bytes,
                                                       &size) == true)
@@ -82,24 +309,99 @@ static PAYLOAD* get_last_part(PAYLOAD *payload)
    return last;
 }
 
-static void payload_copy_bytes(PAYLOAD *payload, const unsigned char *buffer, size_t length)
+static bool payload_owns_bytes(const PAYLOAD *payload)
+{
+   return payload->type == PAYLOAD_TYPE_BYTE_ARRAY && payload->x.byte_array.segment != NULL;
+}
+
+static void payload_release_bytes(PAYLOAD *payload)
+{
+   if (payload->type == PAYLOAD_TYPE_BYTE_ARRAY)
+   {
+      segment_release(payload->x.byte_array.segment);
+      payload->x.byte_array.segment = NULL;
+      payload->x.byte_array.bytes = NULL;
+   }
+   else if (payload->type == PAYLOAD_TYPE_CALLBACK)
+   {
+      // an unmaterialized part keeps the pool it will capture into
+      capture_pool_release(payload->x.callback.capture_pool);
+      payload->x.callback.capture_pool = NULL;
+   }
+}
+
+static void payload_allocate_bytes(PAYLOAD *payload, size_t capacity)
 {
+   payload_release_bytes(payload);
+
    payload->type = PAYLOAD_TYPE_BYTE_ARRAY;
-   payload->x.byte_array.bytes = (unsigned char *)calloc(length, 1);
+   payload->x.byte_array.segment = segment_create(capacity);
+   payload->x.byte_array.bytes = payload->x.byte_array.segment != NULL ? payload->x.byte_array.segment->bytes : NULL;
+   payload->x.byte_array.capacity = payload->x.byte_array.segment != NULL ? (uint32_t)capacity : 0;
+   payload->x.byte_array.size = 0;
+   payload->x.byte_array.borrowed = false;
+}
+
+static bool payload_copy_bytes(PAYLOAD *payload, const unsigned char *buffer, size_t length)
+{
+   payload_allocate_bytes(payload, length);
    if (payload->x.byte_array.bytes != 0)
    {
       memcpy((void*)payload->x.byte_array.bytes, (void*)buffer, (uint32_t)length);
-      payload->x.byte_array.capacity = (uint32_t)length;
       payload->x.byte_array.size = (uint32_t)length;
    }
+   return payload->x.byte_array.bytes != NULL;
+}
+
+static void payload_share_bytes(PAYLOAD *payload, const PAYLOAD *source)
+{
+   PAYLOAD_SEGMENT *segment = source->x.byte_array.segment;
+
+   if (segment->pool != NULL)
+   {
+      // only the source holds the segment until now, so nobody else can be reading its pool; once shared it may be
+      // released on another thread, where it must not touch the pool's free list
+      PAYLOAD_CAPTURE_POOL *pool = segment->pool;
+      segment->pool = NULL;
+      capture_pool_release(pool);
+   }
+
+   payload->type = PAYLOAD_TYPE_BYTE_ARRAY;
+   payload->x.byte_array = source->x.byte_array;
+   // the sharer gets no spare capacity so it can never write into the segment
+   payload->x.byte_array.capacity = source->x.byte_array.size;
+   (void)INC_REF_VAR(segment->ref_count);
 }
 
-static void payload_set_callback(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context, size_t size)
+static void payload_set_borrowed_bytes(PAYLOAD *payload, const unsigned char *buffer, size_t length)
 {
+   payload->type = PAYLOAD_TYPE_BYTE_ARRAY;
+   payload->x.byte_array.bytes = (unsigned char *)buffer;
+   payload->x.byte_array.capacity = (uint32_t)length;
+   payload->x.byte_array.size = (uint32_t)length;
+   payload->x.byte_array.borrowed = true;
+   payload->x.byte_array.segment = NULL;
+}
+
+static void payload_set_callback(PAYLOAD *payload, const PAYLOAD_CALLBACK *callback)
+{
+   // an empty tail may still hold a reservation
+   payload_release_bytes(payload);
+
    payload->type = PAYLOAD_TYPE_CALLBACK;
-   payload->x.callback.writer_callback = callback;
-   payload->x.callback.user_context = context;
-   payload->x.callback.calculated_size = size;
+   payload->x.callback = *callback;
+   if (payload->x.callback.capture_pool != NULL)
+   {
+      (void)INC_REF_VAR(payload->x.callback.capture_pool->ref_count);
+   }
+}
+
+static void payload_set_copied_callback(PAYLOAD *payload, const PAYLOAD_CALLBACK *callback)
+{
+   // a copy may be used on another thread than the pool's, so it captures into the heap
+   PAYLOAD_CALLBACK copy = *callback;
+   copy.capture_pool = NULL;
+   payload_set_callback(payload, &copy);
 }
 
 size_t payload_get_spare_capacity(const PAYLOAD *payload)
@@ -141,6 +443,8 @@ PAYLOAD *payload_create()
       new_payload->x.byte_array.bytes = NULL;
       new_payload->x.byte_array.capacity = 0;
       new_payload->x.byte_array.size = 0;
+      new_payload->x.byte_array.borrowed = false;
+      new_payload->x.byte_array.segment = NULL;
       new_payload->next = NULL;
    }
    return new_payload;
@@ -176,15 +480,12 @@ void payload_clear(PAYLOAD *payload)
    payload_destroy(&payload->next);
 
    // clear this payload
-   if (payload->type == PAYLOAD_TYPE_BYTE_ARRAY && payload->x.byte_array.bytes != NULL)
-   {
-      free((void *)payload->x.byte_array.bytes);
-   }
+   payload_release_bytes(payload);
 
    payload->type = PAYLOAD_TYPE_BYTE_ARRAY;
-   payload->x.byte_array.bytes = NULL;
    payload->x.byte_array.size = 0;
    payload->x.byte_array.capacity = 0;
+   payload->x.byte_array.borrowed = false;
 }
 
 void payload_destroy(PAYLOAD **payload_to_destroy)
@@ -196,11 +497,7 @@ void payload_destroy(PAYLOAD **payload_to_destroy)
       while (payload)
       {
          PAYLOAD *next = payload->next;
-         if (payload->type == PAYLOAD_TYPE_BYTE_ARRAY && payload->x.byte_array.bytes != NULL)
-         {
-            free((void *)payload->x.byte_array.bytes);
-            payload->x.byte_array.bytes = NULL;
-         }
+         payload_release_bytes(payload);
          free(payload);
          
          --payloadCount;
@@ -267,6 +564,37 @@ bool payload_has_callback_data(const PAYLOAD *payload)
    return false;
 }
 
+bool payload_has_unsized_callback_data(const PAYLOAD *payload)
+{
+   while (payload)
+   {
+      if (payload->type == PAYLOAD_TYPE_CALLBACK
+         && !payload->x.callback.size_hinted
+         && payload->x.callback.size_callback == NULL
+         && !payload->x.callback.materialize)
+      {
+         return true;
+      }
+      payload = payload->next;
+   }
+
+   return false;
+}
+
+bool payload_has_borrowed_data(const PAYLOAD *payload)
+{
+   while (payload)
+   {
+      if (payload->type == PAYLOAD_TYPE_BYTE_ARRAY && payload->x.byte_array.borrowed)
+      {
+         return true;
+      }
+      payload = payload->next;
+   }
+
+   return false;
+}
+
 size_t payload_get_length(const PAYLOAD *payload)
 {
    size_t length = 0;
@@ -334,7 +662,16 @@ bool payload_stream_output(const PAYLOAD *payload, PAYLOAD_WRITE_FUNCTION *strea
       {
          payload_debug(payload, payloadCounter++);
 
-         if (payload->type == PAYLOAD_TYPE_BYTE_ARRAY)
+         if (payload_is_unmaterialized(payload))
+         {
+            success = materialize_callback((PAYLOAD *)payload);
+         }
+
+         if (!success)
+         {
+            // the producer failed, nothing left to stream
+         }
+         else if (payload->type == PAYLOAD_TYPE_BYTE_ARRAY)
          {
             success = stream_array_output(payload, stream_writer, stream_context);
          }
@@ -350,6 +687,40 @@ bool payload_stream_output(const PAYLOAD *payload, PAYLOAD_WRITE_FUNCTION *strea
    return success;
 }
 
+bool payload_stream_output_parts(const PAYLOAD *payload, PAYLOAD_WRITE_FUNCTION *byte_array_writer, PAYLOAD_WRITE_FUNCTION *callback_writer, void *stream_context)
+{
+   bool success = false;
+   if (payload && byte_array_writer && callback_writer)
+   {
+      success = true;
+
+      while (payload && success)
+      {
+         if (payload_is_unmaterialized(payload))
+         {
+            success = materialize_callback((PAYLOAD *)payload);
+         }
+
+         if (!success)
+         {
+            // the producer failed, nothing left to stream
+         }
+         else if (payload->type == PAYLOAD_TYPE_BYTE_ARRAY)
+         {
+            success = stream_array_output(payload, byte_array_writer, stream_context);
+         }
+         else if (payload->type == PAYLOAD_TYPE_CALLBACK)
+         {
+            success = payload->x.callback.writer_callback(payload->x.callback.user_context, callback_writer, stream_context);
+         }
+
+         payload = payload->next;
+      }
+   }
+
+   return success;
+}
+
 typedef struct
 {
    unsigned char* buffer;
@@ -391,12 +762,18 @@ void payload_move_to_payload_end(PAYLOAD *destination, PAYLOAD **source)
 
    if (!payload_is_empty(tail))
    {
-      tail->next = payload_create();
-      tail = tail->next;
+      // chain the source parts as they are
+      tail->next = *source;
    }
+   else
+   {
+      // move the first source part into the empty tail, dropping whatever the tail had reserved
+      payload_release_bytes(tail);
+      *tail = **source;
 
-   // move source to tail
-   *tail = **source;
+      free(*source);
+      --payloadCount;
+   }
 
    // clear old source as it has been moved
    *source = NULL;
@@ -410,9 +787,29 @@ void payload_append_payload_as_copy(PAYLOAD *payload, const PAYLOAD *payload_to_
 
    while (payload_to_append != NULL)
    {
+      if (payload_is_unmaterialized(payload_to_append))
+      {
+         // capture the output now so that the copy shares it instead of running the producer again
+         (void)materialize_callback((PAYLOAD *)payload_to_append);
+      }
+
       if (payload_to_append->type == PAYLOAD_TYPE_BYTE_ARRAY)
       {
-         payload_append_data(tail, payload_to_append->x.byte_array.bytes, payload_to_append->x.byte_array.size);
+         if (!payload_owns_bytes(payload_to_append) || payload_to_append->x.byte_array.size < SHARE_THRESHOLD)
+         {
+            // borrowed bytes may go away with their owner, and small parts are cheaper to copy than to share
+            payload_append_data(tail, payload_to_append->x.byte_array.bytes, payload_to_append->x.byte_array.size);
+         }
+         else
+         {
+            if (!payload_is_empty(tail) || payload_owns_bytes(tail))
+            {
+               tail->next = payload_create();
+               tail = tail->next;
+            }
+
+            payload_share_bytes(tail, payload_to_append);
+         }
       }
       else if (payload_to_append->type == PAYLOAD_TYPE_CALLBACK)
       {
@@ -422,11 +819,43 @@ void payload_append_payload_as_copy(PAYLOAD *payload, const PAYLOAD *payload_to_
             tail = tail->next;
          }
          
-         payload_set_callback(
-            tail, 
-            payload_to_append->x.callback.writer_callback,
-            payload_to_append->x.callback.user_context,
-            payload_to_append->x.callback.calculated_size);
+         payload_set_copied_callback(tail, &payload_to_append->x.callback);
+      }
+
+      if (tail->next != NULL)
+      {
+         tail = tail->next;
+      }
+      payload_to_append = payload_to_append->next;
+   }
+}
+
+void payload_append_payload_as_borrowed(PAYLOAD *payload, const PAYLOAD *payload_to_append)
+{
+   if (!payload) FATAL("Payload is null");
+
+   PAYLOAD *tail = get_last_part(payload);
+
+   while (payload_to_append != NULL)
+   {
+      if (payload_is_unmaterialized(payload_to_append))
+      {
+         (void)materialize_callback((PAYLOAD *)payload_to_append);
+      }
+
+      if (payload_to_append->type == PAYLOAD_TYPE_BYTE_ARRAY)
+      {
+         payload_append_borrowed_data(tail, payload_to_append->x.byte_array.bytes, payload_to_append->x.byte_array.size);
+      }
+      else if (payload_to_append->type == PAYLOAD_TYPE_CALLBACK)
+      {
+         if (!payload_is_empty(tail))
+         {
+            tail->next = payload_create();
+            tail = tail->next;
+         }
+
+         payload_set_copied_callback(tail, &payload_to_append->x.callback);
       }
 
       if (tail->next != NULL)
@@ -437,10 +866,86 @@ void payload_append_payload_as_copy(PAYLOAD *payload, const PAYLOAD *payload_to_
    }
 }
 
-void payload_append_data(PAYLOAD *payload, const unsigned char *buffer, size_t length)
+// Checks that the window lies within source and only covers byte arrays, materializing the parts it covers on the way.
+static bool slice_is_borrowable(const PAYLOAD *source, size_t offset, size_t length)
+{
+   bool result = (length <= SIZE_MAX - offset);
+   size_t position = 0;
+
+   while (result && source != NULL && position < offset + length)
+   {
+      size_t part_size = get_size_of_part(source);
+
+      if (position + part_size > offset && source->type != PAYLOAD_TYPE_BYTE_ARRAY)
+      {
+         // callback output cannot be referenced, only regenerated
+         result = false;
+      }
+
+      position += part_size;
+      source = source->next;
+   }
+
+   return result && (position >= offset + length);
+}
+
+bool payload_append_slice_as_borrowed(PAYLOAD *payload, const PAYLOAD *source, size_t offset, size_t length)
+{
+   bool success;
+
+   if (!payload) FATAL("Payload is null");
+
+   // the window is checked before anything is appended, so a failed call leaves the destination as it was
+   success = slice_is_borrowable(source, offset, length);
+
+   while (success && source != NULL && length > 0)
+   {
+      size_t part_size = get_size_of_part(source);
+
+      if (offset >= part_size)
+      {
+         // window starts beyond this part
+         offset -= part_size;
+      }
+      else
+      {
+         size_t slice_size = min(part_size - offset, length);
+         payload_append_borrowed_data(payload, source->x.byte_array.bytes + offset, slice_size);
+         length -= slice_size;
+         offset = 0;
+      }
+
+      source = source->next;
+   }
+
+   return success;
+}
+
+void payload_append_borrowed_data(PAYLOAD *payload, const unsigned char *buffer, size_t length)
 {
    if (!payload) FATAL("Payload is null");
 
+   if ((buffer != NULL) && (length > 0))
+   {
+      PAYLOAD *tail = get_last_part(payload);
+
+      // only an empty tail that holds no allocation can be pointed at the borrowed bytes
+      if (!payload_is_empty(tail) || payload_owns_bytes(tail))
+      {
+         tail->next = payload_create();
+         tail = tail->next;
+      }
+
+      payload_set_borrowed_bytes(tail, buffer, length);
+   }
+}
+
+bool payload_append_data(PAYLOAD *payload, const unsigned char *buffer, size_t length)
+{
+   bool success = true;
+
+   if (!payload) FATAL("Payload is null");
+
    if ((buffer != NULL) && (length > 0))
    {
       PAYLOAD *tail = get_last_part(payload);
@@ -448,7 +953,7 @@ void payload_append_data(PAYLOAD *payload, const unsigned char *buffer, size_t l
       if (payload_is_empty(tail) && payload_get_spare_capacity(tail) == 0)
       {
          // Empty tail part - just copy on top of it...
-         payload_copy_bytes(tail, buffer, length);
+         success = payload_copy_bytes(tail, buffer, length);
       }
       else if (payload_get_spare_capacity(tail) >= length)
       {
@@ -459,9 +964,11 @@ void payload_append_data(PAYLOAD *payload, const unsigned char *buffer, size_t l
       else
       {
          tail->next = payload_create();
-         payload_copy_bytes(tail->next, buffer, length);
+         success = (tail->next != NULL) && payload_copy_bytes(tail->next, buffer, length);
       }
    }
+
+   return success;
 }
 
 void payload_append_string(PAYLOAD *payload, const char *buffer)
@@ -481,18 +988,16 @@ bool payload_reserve_data(PAYLOAD *payload, size_t length)
       tail = tail->next;
    }
 
-   tail->type = PAYLOAD_TYPE_BYTE_ARRAY;
-   tail->x.byte_array.bytes = malloc(length);
-   tail->x.byte_array.capacity = (uint32_t)length;
-   tail->x.byte_array.size = 0;
+   // an empty tail may still hold a smaller earlier reservation, which is released here
+   payload_allocate_bytes(tail, length);
 
    return tail->x.byte_array.bytes != NULL;
 }
 
-void payload_append_callback(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context)
+static void append_callback_part(PAYLOAD *payload, const PAYLOAD_CALLBACK *callback)
 {
    if (!payload) FATAL("Payload is NULL");
-   if (!callback) FATAL("Callback is NULL");
+   if (!callback->writer_callback) FATAL("Callback is NULL");
 
    PAYLOAD *tail = get_last_part(payload);
 
@@ -502,7 +1007,33 @@ void payload_append_callback(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callba
       tail = tail->next;
    }
 
-   payload_set_callback(tail, callback, context, UNCALCULATED_SIZE);
+   payload_set_callback(tail, callback);
+}
+
+void payload_append_callback(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context)
+{
+   PAYLOAD_CALLBACK part = { context, callback, UNCALCULATED_SIZE, false, NULL, false, NULL };
+   append_callback_part(payload, &part);
+}
+
+void payload_append_callback_with_size(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context, size_t size)
+{
+   PAYLOAD_CALLBACK part = { context, callback, size, true, NULL, false, NULL };
+   append_callback_part(payload, &part);
+}
+
+void payload_append_callback_with_size_query(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, PAYLOAD_SIZE_FUNCTION *size_callback, void *context)
+{
+   if (!size_callback) FATAL("Size callback is NULL");
+
+   PAYLOAD_CALLBACK part = { context, callback, UNCALCULATED_SIZE, false, size_callback, false, NULL };
+   append_callback_part(payload, &part);
+}
+
+void payload_append_callback_materialized(PAYLOAD *payload, PAYLOAD_CALLBACK_FUNCTION *callback, void *context, PAYLOAD_CAPTURE_POOL *pool)
+{
+   PAYLOAD_CALLBACK part = { context, callback, UNCALCULATED_SIZE, false, NULL, true, pool };
+   append_callback_part(payload, &part);
 }
 
 bool payload_is_empty(const PAYLOAD *payload)
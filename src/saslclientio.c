@@ -16,6 +16,7 @@
 #include "azure_uamqp_c/sasl_frame_codec.h"
 #include "azure_uamqp_c/amqp_definitions.h"
 #include "azure_uamqp_c/amqpvalue_to_string.h"
+#include "azure_uamqp_c/xio_sendv.h"
 
 typedef enum IO_STATE_TAG
 {
@@ -70,6 +71,8 @@ typedef struct SASL_CLIENT_IO_INSTANCE_TAG
     FRAME_CODEC_HANDLE frame_codec;
     IO_STATE io_state;
     SASL_MECHANISM_HANDLE sasl_mechanism;
+    XIO_SENDV underlying_sendv;
+    void* underlying_sendv_context;
     unsigned int is_trace_on : 1;
     unsigned int is_trace_on_set : 1;
 } SASL_CLIENT_IO_INSTANCE;
@@ -1190,6 +1193,31 @@ int saslclientio_send_async(CONCRETE_IO_HANDLE sasl_client_io, const void* buffe
     return result;
 }
 
+static int saslclientio_sendv(void* sendv_context, const XIO_SEND_BUFFER* buffers, size_t buffer_count)
+{
+    int result;
+    SASL_CLIENT_IO_INSTANCE* sasl_client_io_instance = (SASL_CLIENT_IO_INSTANCE*)sendv_context;
+
+    /* Codes_SRS_SASLCLIENTIO_01_147: [ The sendv function shall fail and return a non-zero value if the SASL client IO state is not `IO_STATE_OPEN`. ]*/
+    if (sasl_client_io_instance->io_state != IO_STATE_OPEN)
+    {
+        LogError("sendv called while not open");
+        result = MU_FAILURE;
+    }
+    /* Codes_SRS_SASLCLIENTIO_01_146: [ The sendv function shall pass the buffers to the sendv function of the underlying IO. ]*/
+    else if (sasl_client_io_instance->underlying_sendv(sasl_client_io_instance->underlying_sendv_context, buffers, buffer_count) != 0)
+    {
+        LogError("Underlying sendv failed");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
 void saslclientio_dowork(CONCRETE_IO_HANDLE sasl_client_io)
 {
     /* Codes_SRS_SASLCLIENTIO_01_026: [If the `sasl_client_io` argument is NULL, `saslclientio_dowork` shall do nothing.]*/
@@ -1241,6 +1269,30 @@ int saslclientio_setoption(CONCRETE_IO_HANDLE sasl_client_io, const char* option
             /* Codes_SRS_SASLCLIENTIO_01_128: [ On success, `saslclientio_setoption` shall return 0. ]*/
             result = 0;
         }
+        /* Codes_SRS_SASLCLIENTIO_01_145: [ - xio_sendv - XIO_SENDV_QUERY*. ]*/
+        else if (strcmp(OPTION_XIO_SENDV, option_name) == 0)
+        {
+            XIO_SENDV_QUERY underlying_sendv_query = { NULL, NULL };
+
+            /* Codes_SRS_SASLCLIENTIO_01_148: [ If the underlying IO does not provide a sendv function, `saslclientio_setoption` shall fail and return a non-zero value without logging an error, as this only tells the caller to keep sending with `xio_send`. ]*/
+            if ((value == NULL) ||
+                (xio_setoption(sasl_client_io_instance->underlying_io, OPTION_XIO_SENDV, &underlying_sendv_query) != 0) ||
+                (underlying_sendv_query.sendv == NULL))
+            {
+                result = MU_FAILURE;
+            }
+            else
+            {
+                /* Codes_SRS_SASLCLIENTIO_01_149: [ Otherwise `saslclientio_setoption` shall fill in the query with a sendv function that forwards to the underlying one while the SASL client IO is open. ]*/
+                XIO_SENDV_QUERY* sendv_query = (XIO_SENDV_QUERY*)value;
+                sasl_client_io_instance->underlying_sendv = underlying_sendv_query.sendv;
+                sasl_client_io_instance->underlying_sendv_context = underlying_sendv_query.sendv_context;
+                sendv_query->sendv = saslclientio_sendv;
+                sendv_query->sendv_context = sasl_client_io_instance;
+
+                result = 0;
+            }
+        }
         else
         {
             /* Codes_SRS_SASLCLIENTIO_03_001: [`saslclientio_setoption` shall forward all unhandled options to underlying io by calling `xio_setoption`.]*/
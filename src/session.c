@@ -16,6 +16,47 @@ typedef enum LINK_ENDPOINT_STATE_TAG
     LINK_ENDPOINT_STATE_DETACHING
 } LINK_ENDPOINT_STATE;
 
+/* Transfer, flow and disposition performatives are sent over and over on a link with only a few fields changing.
+Each link endpoint keeps them encoded with every field in a fixed width constructor, so that a send only patches the
+changing fields at known offsets and hands the bytes to connection_encode_frame_bytes. */
+#define PERFORMATIVE_HEADER_SIZE            6
+#define FIXED_UINT_SIZE                     5
+#define FIXED_BOOL_SIZE                     2
+#define MAX_TEMPLATE_DELIVERY_TAG_SIZE      32
+#define MAX_TEMPLATE_DELIVERY_STATE_SIZE    44
+
+#define TRANSFER_HANDLE_OFFSET                  PERFORMATIVE_HEADER_SIZE
+#define TRANSFER_DELIVERY_ID_OFFSET             (TRANSFER_HANDLE_OFFSET + FIXED_UINT_SIZE)
+#define TRANSFER_DELIVERY_TAG_OFFSET            (TRANSFER_DELIVERY_ID_OFFSET + FIXED_UINT_SIZE)
+#define TRANSFER_MESSAGE_FORMAT_OFFSET(tag_size) (TRANSFER_DELIVERY_TAG_OFFSET + 2 + (tag_size))
+#define TRANSFER_SETTLED_OFFSET(tag_size)       (TRANSFER_MESSAGE_FORMAT_OFFSET(tag_size) + FIXED_UINT_SIZE)
+#define TRANSFER_MORE_OFFSET(tag_size)          (TRANSFER_SETTLED_OFFSET(tag_size) + FIXED_BOOL_SIZE)
+#define TRANSFER_TEMPLATE_SIZE(tag_size)        (TRANSFER_MORE_OFFSET(tag_size) + FIXED_BOOL_SIZE)
+
+#define FLOW_FIELD_OFFSET(index)                (PERFORMATIVE_HEADER_SIZE + ((index) * FIXED_UINT_SIZE))
+#define SESSION_FLOW_FIELD_COUNT                4
+#define LINK_FLOW_FIELD_COUNT                   7
+
+#define DISPOSITION_ROLE_OFFSET                 PERFORMATIVE_HEADER_SIZE
+#define DISPOSITION_FIRST_OFFSET                (DISPOSITION_ROLE_OFFSET + FIXED_BOOL_SIZE)
+#define DISPOSITION_LAST_OFFSET                 (DISPOSITION_FIRST_OFFSET + FIXED_UINT_SIZE)
+#define DISPOSITION_SETTLED_OFFSET              (DISPOSITION_LAST_OFFSET + FIXED_UINT_SIZE)
+#define DISPOSITION_STATE_OFFSET                (DISPOSITION_SETTLED_OFFSET + FIXED_BOOL_SIZE)
+
+typedef struct TRANSFER_TEMPLATE_TAG
+{
+    unsigned char bytes[TRANSFER_TEMPLATE_SIZE(MAX_TEMPLATE_DELIVERY_TAG_SIZE)];
+    size_t size;
+    size_t delivery_tag_size;
+} TRANSFER_TEMPLATE;
+
+typedef struct DISPOSITION_TEMPLATE_TAG
+{
+    unsigned char bytes[DISPOSITION_STATE_OFFSET + MAX_TEMPLATE_DELIVERY_STATE_SIZE];
+    size_t size;
+    AMQP_VALUE delivery_state;
+} DISPOSITION_TEMPLATE;
+
 typedef struct LINK_ENDPOINT_INSTANCE_TAG
 {
     char* name;
@@ -29,6 +70,9 @@ typedef struct LINK_ENDPOINT_INSTANCE_TAG
     LINK_ENDPOINT_STATE link_endpoint_state;
     ON_LINK_ENDPOINT_DESTROYED_CALLBACK on_link_endpoint_destroyed_callback;
     void* on_link_endpoint_destroyed_context;
+    TRANSFER_TEMPLATE transfer_template;
+    unsigned char flow_template[FLOW_FIELD_OFFSET(LINK_FLOW_FIELD_COUNT)];
+    DISPOSITION_TEMPLATE disposition_template;
 } LINK_ENDPOINT_INSTANCE;
 
 typedef struct SESSION_INSTANCE_TAG
@@ -54,12 +98,166 @@ typedef struct SESSION_INSTANCE_TAG
     handle handle_max;
     uint32_t remote_incoming_window;
     uint32_t remote_outgoing_window;
+    uint32_t max_transfer_frame_size;
     unsigned int is_underlying_connection_open : 1;
 } SESSION_INSTANCE;
 
 #define UNDERLYING_CONNECTION_NOT_OPEN 0
 #define UNDERLYING_CONNECTION_OPEN 1
 
+static void put_performative_header(unsigned char* bytes, uint64_t descriptor, size_t performative_size, unsigned char field_count)
+{
+    /* descriptor: small ulong, followed by a list8 whose size byte counts the field count byte and the fields */
+    bytes[0] = 0x00;
+    bytes[1] = 0x53;
+    bytes[2] = (unsigned char)descriptor;
+    bytes[3] = 0xC0;
+    bytes[4] = (unsigned char)(performative_size - 5);
+    bytes[5] = field_count;
+}
+
+static void put_fixed_uint(unsigned char* bytes, uint32_t value)
+{
+    bytes[0] = 0x70;
+    bytes[1] = (unsigned char)(value >> 24);
+    bytes[2] = (unsigned char)(value >> 16);
+    bytes[3] = (unsigned char)(value >> 8);
+    bytes[4] = (unsigned char)value;
+}
+
+static void put_fixed_bool(unsigned char* bytes, bool value)
+{
+    bytes[0] = 0x56;
+    bytes[1] = value ? 0x01 : 0x00;
+}
+
+static void build_transfer_template(LINK_ENDPOINT_INSTANCE* link_endpoint_instance, size_t delivery_tag_size)
+{
+    TRANSFER_TEMPLATE* transfer_template = &link_endpoint_instance->transfer_template;
+
+    transfer_template->size = TRANSFER_TEMPLATE_SIZE(delivery_tag_size);
+    transfer_template->delivery_tag_size = delivery_tag_size;
+
+    put_performative_header(transfer_template->bytes, AMQP_TRANSFER, transfer_template->size, 6);
+    put_fixed_uint(transfer_template->bytes + TRANSFER_HANDLE_OFFSET, link_endpoint_instance->output_handle);
+    put_fixed_uint(transfer_template->bytes + TRANSFER_DELIVERY_ID_OFFSET, 0);
+    transfer_template->bytes[TRANSFER_DELIVERY_TAG_OFFSET] = 0xA0;
+    transfer_template->bytes[TRANSFER_DELIVERY_TAG_OFFSET + 1] = (unsigned char)delivery_tag_size;
+    (void)memset(transfer_template->bytes + TRANSFER_DELIVERY_TAG_OFFSET + 2, 0, delivery_tag_size);
+    put_fixed_uint(transfer_template->bytes + TRANSFER_MESSAGE_FORMAT_OFFSET(delivery_tag_size), 0);
+    put_fixed_bool(transfer_template->bytes + TRANSFER_SETTLED_OFFSET(delivery_tag_size), false);
+    put_fixed_bool(transfer_template->bytes + TRANSFER_MORE_OFFSET(delivery_tag_size), false);
+}
+
+static void build_flow_template(unsigned char* bytes, unsigned char field_count)
+{
+    unsigned char i;
+
+    put_performative_header(bytes, AMQP_FLOW, FLOW_FIELD_OFFSET(field_count), field_count);
+    for (i = 0; i < field_count; i++)
+    {
+        put_fixed_uint(bytes + FLOW_FIELD_OFFSET(i), 0);
+    }
+}
+
+/* amqpvalue_are_equal does not look into described values, which every delivery state is */
+static bool delivery_states_are_equal(AMQP_VALUE delivery_state1, AMQP_VALUE delivery_state2)
+{
+    bool result;
+
+    if (delivery_state1 == delivery_state2)
+    {
+        result = true;
+    }
+    else if ((delivery_state1 == NULL) || (delivery_state2 == NULL))
+    {
+        result = false;
+    }
+    else
+    {
+        AMQP_TYPE type1 = amqpvalue_get_type(delivery_state1);
+        AMQP_TYPE type2 = amqpvalue_get_type(delivery_state2);
+
+        if (((type1 != AMQP_TYPE_DESCRIBED) && (type1 != AMQP_TYPE_COMPOSITE)) ||
+            ((type2 != AMQP_TYPE_DESCRIBED) && (type2 != AMQP_TYPE_COMPOSITE)))
+        {
+            result = amqpvalue_are_equal(delivery_state1, delivery_state2);
+        }
+        else
+        {
+            result = amqpvalue_are_equal(amqpvalue_get_inplace_descriptor(delivery_state1), amqpvalue_get_inplace_descriptor(delivery_state2)) &&
+                amqpvalue_are_equal(amqpvalue_get_inplace_described_value(delivery_state1), amqpvalue_get_inplace_described_value(delivery_state2));
+        }
+    }
+
+    return result;
+}
+
+/* encodes the delivery state into the disposition template; fails when the state does not fit so the caller can fall back to a DISPOSITION_HANDLE */
+static int build_disposition_template(DISPOSITION_TEMPLATE* disposition_template, AMQP_VALUE delivery_state)
+{
+    int result;
+    size_t delivery_state_size = 0;
+
+    if (disposition_template->delivery_state != NULL)
+    {
+        amqpvalue_destroy(disposition_template->delivery_state);
+        disposition_template->delivery_state = NULL;
+    }
+
+    disposition_template->size = 0;
+
+    if ((delivery_state != NULL) &&
+        ((amqpvalue_get_encoded_size(delivery_state, &delivery_state_size) != 0) ||
+        (delivery_state_size > MAX_TEMPLATE_DELIVERY_STATE_SIZE)))
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        if (delivery_state == NULL)
+        {
+            result = 0;
+        }
+        else
+        {
+            PAYLOAD* encoded_delivery_state = payload_create_and_reserve(delivery_state_size);
+            if (encoded_delivery_state == NULL)
+            {
+                result = MU_FAILURE;
+            }
+            else
+            {
+                const unsigned char* delivery_state_bytes;
+
+                if ((amqpvalue_encode_to_payload(delivery_state, encoded_delivery_state) != 0) ||
+                    (payload_get_length(encoded_delivery_state) != delivery_state_size) ||
+                    (payload_get_parts(encoded_delivery_state) != 1) ||
+                    ((delivery_state_bytes = payload_peek_bytes(encoded_delivery_state)) == NULL) ||
+                    ((disposition_template->delivery_state = amqpvalue_clone(delivery_state)) == NULL))
+                {
+                    result = MU_FAILURE;
+                }
+                else
+                {
+                    (void)memcpy(disposition_template->bytes + DISPOSITION_STATE_OFFSET, delivery_state_bytes, delivery_state_size);
+                    result = 0;
+                }
+
+                payload_destroy(&encoded_delivery_state);
+            }
+        }
+
+        if (result == 0)
+        {
+            disposition_template->size = DISPOSITION_STATE_OFFSET + delivery_state_size;
+            put_performative_header(disposition_template->bytes, AMQP_DISPOSITION, disposition_template->size, (delivery_state == NULL) ? 4 : 5);
+        }
+    }
+
+    return result;
+}
+
 static void remove_link_endpoint(LINK_ENDPOINT_HANDLE link_endpoint)
 {
     if (link_endpoint != NULL)
@@ -121,6 +319,11 @@ static void free_link_endpoint(LINK_ENDPOINT_HANDLE link_endpoint)
         free(link_endpoint->name);
     }
 
+    if (link_endpoint->disposition_template.delivery_state != NULL)
+    {
+        amqpvalue_destroy(link_endpoint->disposition_template.delivery_state);
+    }
+
     free(link_endpoint);
 }
 
@@ -274,41 +477,21 @@ static int send_flow(SESSION_INSTANCE* session)
     }
     else
     {
-        FLOW_HANDLE flow = flow_create(session->incoming_window, session->next_outgoing_id, session->outgoing_window);
+        unsigned char flow_bytes[FLOW_FIELD_OFFSET(SESSION_FLOW_FIELD_COUNT)];
 
-        if (flow == NULL)
+        build_flow_template(flow_bytes, SESSION_FLOW_FIELD_COUNT);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(0), session->next_incoming_id);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(1), session->incoming_window);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(2), session->next_outgoing_id);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(3), session->outgoing_window);
+
+        if (connection_encode_frame_bytes(session->endpoint, flow_bytes, sizeof(flow_bytes), NULL, NULL, NULL) != 0)
         {
             result = MU_FAILURE;
         }
         else
         {
-            if (flow_set_next_incoming_id(flow, session->next_incoming_id) != 0)
-            {
-                result = MU_FAILURE;
-            }
-            else
-            {
-                AMQP_VALUE flow_performative_value = amqpvalue_create_flow(flow);
-                if (flow_performative_value == NULL)
-                {
-                    result = MU_FAILURE;
-                }
-                else
-                {
-                    if (connection_encode_frame(session->endpoint, flow_performative_value, NULL, NULL, NULL) != 0)
-                    {
-                        result = MU_FAILURE;
-                    }
-                    else
-                    {
-                        result = 0;
-                    }
-
-                    amqpvalue_destroy(flow_performative_value);
-                }
-            }
-
-            flow_destroy(flow);
+            result = 0;
         }
     }
 
@@ -1049,6 +1232,50 @@ int session_get_outgoing_window(SESSION_HANDLE session, uint32_t* outgoing_windo
     return result;
 }
 
+int session_set_max_transfer_frame_size(SESSION_HANDLE session, uint32_t max_transfer_frame_size)
+{
+    int result;
+
+    /* Codes_S_R_S_SESSION_01_080: [If session is NULL or max_transfer_frame_size is neither 0 nor at least 512, session_set_max_transfer_frame_size shall fail and return a non-zero value.] */
+    if ((session == NULL) ||
+        ((max_transfer_frame_size != 0) && (max_transfer_frame_size < 512)))
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)session;
+
+        /* Codes_S_R_S_SESSION_01_081: [session_set_max_transfer_frame_size shall set the size up to which transfer frames are filled, 0 meaning the remote max frame size.] */
+        session_instance->max_transfer_frame_size = max_transfer_frame_size;
+
+        result = 0;
+    }
+
+    return result;
+}
+
+int session_get_max_transfer_frame_size(SESSION_HANDLE session, uint32_t* max_transfer_frame_size)
+{
+    int result;
+
+    if ((session == NULL) ||
+        (max_transfer_frame_size == NULL))
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)session;
+
+        *max_transfer_frame_size = session_instance->max_transfer_frame_size;
+
+        result = 0;
+    }
+
+    return result;
+}
+
 int session_set_handle_max(SESSION_HANDLE session, handle handle_max)
 {
     int result;
@@ -1090,6 +1317,51 @@ int session_get_handle_max(SESSION_HANDLE session, handle* handle_max)
     return result;
 }
 
+TIMER_QUEUE_HANDLE session_get_timer_queue(SESSION_HANDLE session)
+{
+    TIMER_QUEUE_HANDLE result;
+
+    if (session == NULL)
+    {
+        /* Codes_S_R_S_SESSION_01_084: [If session is NULL, session_get_timer_queue shall return NULL.] */
+        result = NULL;
+    }
+    else
+    {
+        SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)session;
+
+        /* Codes_S_R_S_SESSION_01_083: [session_get_timer_queue shall return the timer queue of the connection the session was created on, obtained by calling connection_get_timer_queue.] */
+        result = connection_get_timer_queue(session_instance->connection);
+    }
+
+    return result;
+}
+
+int session_get_next_delivery_id(SESSION_HANDLE session, delivery_number* next_delivery_id)
+{
+    int result;
+
+    if ((session == NULL) ||
+        (next_delivery_id == NULL))
+    {
+        /* Codes_S_R_S_SESSION_01_086: [If session or next_delivery_id is NULL, session_get_next_delivery_id shall fail and return a non-zero value.] */
+        LogError("Bad arguments: session = %p, next_delivery_id = %p",
+            session, next_delivery_id);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)session;
+
+        /* Codes_S_R_S_SESSION_01_085: [session_get_next_delivery_id shall return in next_delivery_id the delivery id that the next transfer sent on the session will take, and return 0.] */
+        /* a transfer takes the next outgoing transfer id as its delivery id */
+        *next_delivery_id = session_instance->next_outgoing_id;
+        result = 0;
+    }
+
+    return result;
+}
+
 LINK_ENDPOINT_HANDLE session_create_link_endpoint(SESSION_HANDLE session, const char* name)
 {
     LINK_ENDPOINT_INSTANCE* result;
@@ -1135,6 +1407,8 @@ LINK_ENDPOINT_HANDLE session_create_link_endpoint(SESSION_HANDLE session, const
             result->name = (char*)malloc(name_length + 1);
             result->on_link_endpoint_destroyed_callback = NULL;
             result->on_link_endpoint_destroyed_context = NULL;
+            build_flow_template(result->flow_template, LINK_FLOW_FIELD_COUNT);
+            put_fixed_uint(result->flow_template + FLOW_FIELD_OFFSET(4), selected_handle);
             if (result->name == NULL)
             {
                 /* Codes_S_R_S_SESSION_01_045: [If allocating memory for the link endpoint fails, session_create_link_endpoint shall fail and return NULL.] */
@@ -1317,6 +1591,44 @@ int session_send_flow(LINK_ENDPOINT_HANDLE link_endpoint, FLOW_HANDLE flow)
     return result;
 }
 
+int session_send_link_flow(LINK_ENDPOINT_HANDLE link_endpoint, sequence_no delivery_count, uint32_t link_credit)
+{
+    int result;
+
+    /* Codes_S_R_S_SESSION_01_064: [If link_endpoint is NULL, session_send_link_flow shall fail and return a non-zero value.] */
+    if (link_endpoint == NULL)
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        LINK_ENDPOINT_INSTANCE* link_endpoint_instance = (LINK_ENDPOINT_INSTANCE*)link_endpoint;
+        SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)link_endpoint_instance->session;
+        unsigned char* flow_bytes = link_endpoint_instance->flow_template;
+
+        /* Codes_S_R_S_SESSION_01_065: [session_send_link_flow shall send a flow frame carrying the session's next-incoming-id, incoming-window, next-outgoing-id and outgoing-window, the link endpoint handle, delivery_count and link_credit, by patching those fields into the flow performative bytes kept by the link endpoint.] */
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(0), session_instance->next_incoming_id);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(1), session_instance->incoming_window);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(2), session_instance->next_outgoing_id);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(3), session_instance->outgoing_window);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(5), delivery_count);
+        put_fixed_uint(flow_bytes + FLOW_FIELD_OFFSET(6), link_credit);
+
+        /* Codes_S_R_S_SESSION_01_066: [The frame shall be encoded by calling connection_encode_frame_bytes.] */
+        if (connection_encode_frame_bytes(session_instance->endpoint, flow_bytes, sizeof(link_endpoint_instance->flow_template), NULL, NULL, NULL) != 0)
+        {
+            /* Codes_S_R_S_SESSION_01_067: [If connection_encode_frame_bytes fails, session_send_link_flow shall fail and return a non-zero value.] */
+            result = MU_FAILURE;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
 int session_send_attach(LINK_ENDPOINT_HANDLE link_endpoint, ATTACH_HANDLE attach)
 {
     int result;
@@ -1394,6 +1706,80 @@ int session_send_disposition(LINK_ENDPOINT_HANDLE link_endpoint, DISPOSITION_HAN
     return result;
 }
 
+static int send_disposition_from_handle(LINK_ENDPOINT_HANDLE link_endpoint, role role, delivery_number first, delivery_number last, bool settled, AMQP_VALUE delivery_state)
+{
+    int result;
+    DISPOSITION_HANDLE disposition = disposition_create(role, first);
+
+    if (disposition == NULL)
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        if ((disposition_set_last(disposition, last) != 0) ||
+            (disposition_set_settled(disposition, settled) != 0) ||
+            ((delivery_state != NULL) && (disposition_set_state(disposition, delivery_state) != 0)))
+        {
+            result = MU_FAILURE;
+        }
+        else
+        {
+            result = session_send_disposition(link_endpoint, disposition);
+        }
+
+        disposition_destroy(disposition);
+    }
+
+    return result;
+}
+
+int session_send_link_disposition(LINK_ENDPOINT_HANDLE link_endpoint, role role, delivery_number first, delivery_number last, bool settled, AMQP_VALUE delivery_state)
+{
+    int result;
+
+    /* Codes_S_R_S_SESSION_01_068: [If link_endpoint is NULL, session_send_link_disposition shall fail and return a non-zero value.] */
+    if (link_endpoint == NULL)
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        LINK_ENDPOINT_INSTANCE* link_endpoint_instance = (LINK_ENDPOINT_INSTANCE*)link_endpoint;
+        DISPOSITION_TEMPLATE* disposition_template = &link_endpoint_instance->disposition_template;
+
+        /* Codes_S_R_S_SESSION_01_070: [The encoded delivery_state shall be kept by the link endpoint and shall only be encoded again when delivery_state differs from the previous one.] */
+        if (((disposition_template->size == 0) || !delivery_states_are_equal(disposition_template->delivery_state, delivery_state)) &&
+            (build_disposition_template(disposition_template, delivery_state) != 0))
+        {
+            /* Codes_S_R_S_SESSION_01_071: [If the delivery_state cannot be kept encoded, session_send_link_disposition shall send the disposition by creating a disposition performative and calling session_send_disposition.] */
+            result = send_disposition_from_handle(link_endpoint, role, first, last, settled, delivery_state);
+        }
+        else
+        {
+            SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)link_endpoint_instance->session;
+
+            /* Codes_S_R_S_SESSION_01_069: [session_send_link_disposition shall send a disposition frame carrying role, first, last, settled and delivery_state, encoded with connection_encode_frame_bytes.] */
+            put_fixed_bool(disposition_template->bytes + DISPOSITION_ROLE_OFFSET, role);
+            put_fixed_uint(disposition_template->bytes + DISPOSITION_FIRST_OFFSET, first);
+            put_fixed_uint(disposition_template->bytes + DISPOSITION_LAST_OFFSET, last);
+            put_fixed_bool(disposition_template->bytes + DISPOSITION_SETTLED_OFFSET, settled);
+
+            if (connection_encode_frame_bytes(session_instance->endpoint, disposition_template->bytes, disposition_template->size, NULL, NULL, NULL) != 0)
+            {
+                /* Codes_S_R_S_SESSION_01_072: [If connection_encode_frame_bytes fails, session_send_link_disposition shall fail and return a non-zero value.] */
+                result = MU_FAILURE;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
 int session_send_detach(LINK_ENDPOINT_HANDLE link_endpoint, DETACH_HANDLE detach)
 {
     int result;
@@ -1440,7 +1826,12 @@ int session_send_detach(LINK_ENDPOINT_HANDLE link_endpoint, DETACH_HANDLE detach
 typedef struct 
 {
    SESSION_INSTANCE* session_instance;
-   TRANSFER_HANDLE transfer;
+   TRANSFER_TEMPLATE* transfer_template;
+   // without a template, the transfer performative encoded once with more set and once without
+   const unsigned char* more_header;
+   const unsigned char* last_header;
+   size_t more_header_size;
+   size_t last_header_size;
    ON_SEND_COMPLETE on_send_complete;
    void* callback_context;
    
@@ -1455,45 +1846,81 @@ typedef struct
    SESSION_SEND_TRANSFER_RESULT result;
 } SessionStreamingContext;
 
-static const uint32_t MAX_FRAME_SIZE = 1024;
+static void session_send_transfer_frame(SessionStreamingContext *context, PAYLOAD* transfer_frame_payloads)
+{
+   const unsigned char* header_bytes;
+   size_t header_size;
+
+   /* Codes_S_R_S_SESSION_01_078: [All frames of a multi-frame transfer shall reuse the same encoded transfer performative, only the more field shall differ between them.] */
+   if (context->transfer_template != NULL)
+   {
+      put_fixed_bool(context->transfer_template->bytes + TRANSFER_MORE_OFFSET(context->transfer_template->delivery_tag_size), context->moreToCome);
+      header_bytes = context->transfer_template->bytes;
+      header_size = context->transfer_template->size;
+   }
+   else if (context->moreToCome)
+   {
+      header_bytes = context->more_header;
+      header_size = context->more_header_size;
+   }
+   else
+   {
+      header_bytes = context->last_header;
+      header_size = context->last_header_size;
+   }
+
+   /* Codes_S_R_S_SESSION_01_087: [Only the last frame of a multi-frame transfer shall carry on_send_complete, so that it is called once per transfer.] */
+   if (connection_encode_frame_bytes(context->session_instance->endpoint,
+      header_bytes,
+      header_size,
+      transfer_frame_payloads,
+      context->moreToCome ? NULL : context->on_send_complete,
+      context->moreToCome ? NULL : context->callback_context) != 0)
+   {
+      context->result = SESSION_SEND_TRANSFER_ERROR;
+   }
+}
 
 static void session_stream_flush_buffer(SessionStreamingContext *context)
 {
-   AMQP_VALUE multi_transfer_amqp_value;
+   PAYLOAD* transfer_frame_payloads = payload_create();
+   payload_append_borrowed_data(transfer_frame_payloads, context->buffer.data, context->buffer.size);
+
+   session_send_transfer_frame(context, transfer_frame_payloads);
+
+   payload_destroy(&transfer_frame_payloads);
+}
+
+/* Codes_S_R_S_SESSION_01_082: [If the payload has no callback parts, each transfer frame shall carry a borrowed slice of the payload instead of a copy.] */
+static void session_send_payload_slices(SessionStreamingContext *context, const PAYLOAD* payloads, size_t payload_size, size_t max_slice_size)
+{
+   size_t offset = 0;
 
    do
    {
-      if (transfer_set_more(context->transfer, context->moreToCome) != 0)
+      size_t slice_size = payload_size - offset;
+      PAYLOAD* transfer_frame_payloads = payload_create();
+
+      if (slice_size > max_slice_size)
       {
-         context->result = SESSION_SEND_TRANSFER_ERROR;
-         break;
+         slice_size = max_slice_size;
       }
 
-      multi_transfer_amqp_value = amqpvalue_create_transfer(context->transfer);
-      if (multi_transfer_amqp_value == NULL)
+      if (!payload_append_slice_as_borrowed(transfer_frame_payloads, payloads, offset, slice_size))
       {
          context->result = SESSION_SEND_TRANSFER_ERROR;
-         break;
       }
-
-      PAYLOAD* transfer_frame_payloads = payload_create();
-      payload_append_data(transfer_frame_payloads, context->buffer.data, context->buffer.size);
-
-      if (connection_encode_frame(context->session_instance->endpoint,
-         multi_transfer_amqp_value,
-         transfer_frame_payloads,
-         context->on_send_complete,
-         context->callback_context) != 0)
+      else
       {
-         context->result = SESSION_SEND_TRANSFER_ERROR;
-         payload_destroy(&transfer_frame_payloads);
-         amqpvalue_destroy(multi_transfer_amqp_value);
-         break;
+         offset += slice_size;
+         context->moreToCome = (offset < payload_size);
+         session_send_transfer_frame(context, transfer_frame_payloads);
       }
 
       payload_destroy(&transfer_frame_payloads);
-      amqpvalue_destroy(multi_transfer_amqp_value);
-   } while (0);
+   } while ((context->result == SESSION_SEND_TRANSFER_OK) && (offset < payload_size));
+
+   context->moreToCome = false;
 }
 
 static bool session_stream_payload(void *generic_context, const unsigned char *buffer, size_t length)
@@ -1532,141 +1959,226 @@ static bool session_stream_payload(void *generic_context, const unsigned char *b
    return false;
 }
 
-/* Codes_S_R_S_SESSION_01_051: [session_send_transfer shall send a transfer frame with the performative indicated in the transfer argument.] */
-SESSION_SEND_TRANSFER_RESULT session_send_transfer(LINK_ENDPOINT_HANDLE link_endpoint, TRANSFER_HANDLE transfer, PAYLOAD* payloads, delivery_number* delivery_id, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+static int get_transfer_frame_size(SESSION_INSTANCE* session_instance, uint32_t* frame_size)
+{
+    int result;
+
+    if (connection_get_remote_max_frame_size(session_instance->connection, frame_size) != 0)
+    {
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_S_R_S_SESSION_01_079: [If a max transfer frame size was set with session_set_max_transfer_frame_size and it is smaller than the remote max frame size, transfer frames shall not exceed it.] */
+        if ((session_instance->max_transfer_frame_size != 0) &&
+            (session_instance->max_transfer_frame_size < *frame_size))
+        {
+            *frame_size = session_instance->max_transfer_frame_size;
+        }
+
+        result = 0;
+    }
+
+    return result;
+}
+
+/* encodes the transfer performative into one contiguous byte array, with the more field set as requested */
+static PAYLOAD* encode_transfer_header(TRANSFER_HANDLE transfer, AMQP_VALUE transfer_value, size_t encoded_size, bool more)
+{
+    PAYLOAD* result;
+
+    // transfer_value shares its fields with transfer, so setting more on transfer changes what gets encoded
+    if (transfer_set_more(transfer, more) != 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = payload_create_and_reserve(encoded_size);
+        if ((result != NULL) &&
+            ((amqpvalue_encode_to_payload(transfer_value, result) != 0) ||
+            (payload_get_parts(result) != 1) ||
+            (payload_get_length(result) != encoded_size)))
+        {
+            payload_destroy(&result);
+        }
+    }
+
+    return result;
+}
+
+/* sends a transfer either from the transfer performative or, when transfer is NULL, from the link endpoint transfer template */
+static SESSION_SEND_TRANSFER_RESULT send_transfer(LINK_ENDPOINT_INSTANCE* link_endpoint_instance, TRANSFER_HANDLE transfer, PAYLOAD* payloads, delivery_number* delivery_id, ON_SEND_COMPLETE on_send_complete, void* callback_context)
 {
     SESSION_SEND_TRANSFER_RESULT result;
+    SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)link_endpoint_instance->session;
+    TRANSFER_TEMPLATE* transfer_template = (transfer == NULL) ? &link_endpoint_instance->transfer_template : NULL;
 
-    /* Codes_S_R_S_SESSION_01_054: [If link_endpoint or transfer is NULL, session_send_transfer shall fail and return a non-zero value.] */
-    if ((link_endpoint == NULL) ||
-        (transfer == NULL))
+    /* Codes_S_R_S_SESSION_01_059: [When session_send_transfer is called while the session is not in the MAPPED state, session_send_transfer shall fail and return a non-zero value.] */
+    if (session_instance->session_state != SESSION_STATE_MAPPED)
     {
         result = SESSION_SEND_TRANSFER_ERROR;
     }
     else
     {
-        LINK_ENDPOINT_INSTANCE* link_endpoint_instance = (LINK_ENDPOINT_INSTANCE*)link_endpoint;
-        SESSION_INSTANCE* session_instance = (SESSION_INSTANCE*)link_endpoint_instance->session;
-
-        /* Codes_S_R_S_SESSION_01_059: [When session_send_transfer is called while the session is not in the MAPPED state, session_send_transfer shall fail and return a non-zero value.] */
-        if (session_instance->session_state != SESSION_STATE_MAPPED)
+        size_t payload_size = payload_get_length(payloads);
+        //DPRINTF_AMQP("Payload size = %d\n", (uint32_t)payload_size);
+        if (payload_size > UINT32_MAX)
         {
             result = SESSION_SEND_TRANSFER_ERROR;
         }
         else
         {
-         size_t payload_size = payload_get_length(payloads);
-         //DPRINTF_AMQP("Payload size = %d\n", (uint32_t)payload_size);
-         if(payload_size > UINT32_MAX)
+            if (session_instance->remote_incoming_window == 0)
             {
-                result = SESSION_SEND_TRANSFER_ERROR;
+                result = SESSION_SEND_TRANSFER_BUSY;
             }
             else
             {
-                if (session_instance->remote_incoming_window == 0)
+                /* Codes_S_R_S_SESSION_01_012: [The session endpoint assigns each outgoing transfer frame an implicit transfer-id from a session scoped sequence.] */
+                /* Codes_S_R_S_SESSION_01_027: [sending a transfer Upon sending a transfer, the sending endpoint will increment its next-outgoing-id] */
+                *delivery_id = session_instance->next_outgoing_id;
+                if (transfer_template != NULL)
+                {
+                    put_fixed_uint(transfer_template->bytes + TRANSFER_DELIVERY_ID_OFFSET, *delivery_id);
+                    put_fixed_bool(transfer_template->bytes + TRANSFER_MORE_OFFSET(transfer_template->delivery_tag_size), false);
+                }
+
+                if ((transfer != NULL) &&
+                    ((transfer_set_handle(transfer, link_endpoint_instance->output_handle) != 0) ||
+                    (transfer_set_delivery_id(transfer, *delivery_id) != 0) ||
+                    (transfer_set_more(transfer, false) != 0)))
                 {
-                    result = SESSION_SEND_TRANSFER_BUSY;
+                    /* Codes_S_R_S_SESSION_01_058: [When any other error occurs, session_send_transfer shall fail and return a non-zero value.] */
+                    result = SESSION_SEND_TRANSFER_ERROR;
                 }
                 else
                 {
-                    /* Codes_S_R_S_SESSION_01_012: [The session endpoint assigns each outgoing transfer frame an implicit transfer-id from a session scoped sequence.] */
-                    /* Codes_S_R_S_SESSION_01_027: [sending a transfer Upon sending a transfer, the sending endpoint will increment its next-outgoing-id] */
-                    *delivery_id = session_instance->next_outgoing_id;
-                    if ((transfer_set_handle(transfer, link_endpoint_instance->output_handle) != 0) ||
-                        (transfer_set_delivery_id(transfer, *delivery_id) != 0) ||
-                        (transfer_set_more(transfer, false) != 0))
+                    AMQP_VALUE transfer_value = NULL;
+
+                    if ((transfer != NULL) &&
+                        ((transfer_value = amqpvalue_create_transfer(transfer)) == NULL))
                     {
                         /* Codes_S_R_S_SESSION_01_058: [When any other error occurs, session_send_transfer shall fail and return a non-zero value.] */
                         result = SESSION_SEND_TRANSFER_ERROR;
                     }
                     else
                     {
-                        AMQP_VALUE transfer_value;
+                        uint32_t available_frame_size;
+                        size_t encoded_size = 0;
+
+                        if (transfer_template != NULL)
+                        {
+                            encoded_size = transfer_template->size;
+                        }
 
-                        transfer_value = amqpvalue_create_transfer(transfer);
-                        if (transfer_value == NULL)
+                        if ((get_transfer_frame_size(session_instance, &available_frame_size) != 0) ||
+                            ((transfer_value != NULL) && (amqpvalue_get_encoded_size(transfer_value, &encoded_size) != 0)) ||
+                            (encoded_size + 8 >= available_frame_size))
                         {
                             /* Codes_S_R_S_SESSION_01_058: [When any other error occurs, session_send_transfer shall fail and return a non-zero value.] */
                             result = SESSION_SEND_TRANSFER_ERROR;
                         }
                         else
                         {
-                            uint32_t available_frame_size;
-                            size_t encoded_size;
+                            available_frame_size -= (uint32_t)encoded_size;
+                            available_frame_size -= 8;
 
-                            if ((connection_get_remote_max_frame_size(session_instance->connection, &available_frame_size) != 0) ||
-                                (amqpvalue_get_encoded_size(transfer_value, &encoded_size) != 0))
+                            // [JEP] if the frame size is not determinate we force a streamed approach
+                            if (available_frame_size >= payload_size)
                             {
-                                result = SESSION_SEND_TRANSFER_ERROR;
+                                /* Codes_S_R_S_SESSION_01_055: [The encoding of the frame shall be done by calling connection_encode_frame and passing as arguments: the connection handle associated with the session, the transfer performative and the payload chunks passed to session_send_transfer.] */
+                                if (((transfer_value != NULL) && (connection_encode_frame(session_instance->endpoint, transfer_value, payloads, on_send_complete, callback_context) != 0)) ||
+                                    ((transfer_value == NULL) && (connection_encode_frame_bytes(session_instance->endpoint, transfer_template->bytes, transfer_template->size, payloads, on_send_complete, callback_context) != 0)))
+                                {
+                                    /* Codes_S_R_S_SESSION_01_056: [If connection_encode_frame fails then session_send_transfer shall fail and return a non-zero value.] */
+                                    result = SESSION_SEND_TRANSFER_ERROR;
+                                }
+                                else
+                                {
+                                    /* Codes_S_R_S_SESSION_01_018: [is incremented after each successive transfer according to RFC-1982 [RFC1982] serial number arithmetic.] */
+                                    session_instance->next_outgoing_id++;
+                                    session_instance->remote_incoming_window--;
+                                    session_instance->outgoing_window--;
+
+                                    /* Codes_S_R_S_SESSION_01_053: [On success, session_send_transfer shall return 0.] */
+                                    result = SESSION_SEND_TRANSFER_OK;
+                                }
                             }
                             else
                             {
-                                available_frame_size -= (uint32_t)encoded_size;
-                                available_frame_size -= 8;
-
-                                // [JEP] if the frame size is not determinate we force a streamed approach
-                                if (available_frame_size >= payload_size)
+                                /* Codes_S_R_S_SESSION_01_077: [When the payload does not fit in one frame, it shall be sent as several transfer frames, each filled up to the transfer frame size.] */
+                                // byte arrays are sent as slices of the payload, only callback output is copied through a buffer
+                                bool is_sliced = !payload_has_callback_data(payloads);
+                                unsigned char *buffer = is_sliced ? NULL : (unsigned char *)malloc(available_frame_size);
+                                PAYLOAD* more_header = NULL;
+                                PAYLOAD* last_header = NULL;
+
+                                if ((!is_sliced && (buffer == NULL)) ||
+                                    ((transfer != NULL) &&
+                                    (((last_header = encode_transfer_header(transfer, transfer_value, encoded_size, false)) == NULL) ||
+                                    ((more_header = encode_transfer_header(transfer, transfer_value, encoded_size, true)) == NULL))))
                                 {
-                                    /* Codes_S_R_S_SESSION_01_055: [The encoding of the frame shall be done by calling connection_encode_frame and passing as arguments: the connection handle associated with the session, the transfer performative and the payload chunks passed to session_send_transfer.] */
-                                    if (connection_encode_frame(session_instance->endpoint, transfer_value, payloads, on_send_complete, callback_context) != 0)
-                                    {
-                                        /* Codes_S_R_S_SESSION_01_056: [If connection_encode_frame fails then session_send_transfer shall fail and return a non-zero value.] */
-                                        result = SESSION_SEND_TRANSFER_ERROR;
-                                    }
-                                    else
-                                    {
-                                        /* Codes_S_R_S_SESSION_01_018: [is incremented after each successive transfer according to RFC-1982 [RFC1982] serial number arithmetic.] */
-                                        session_instance->next_outgoing_id++;
-                                        session_instance->remote_incoming_window--;
-                                        session_instance->outgoing_window--;
-
-                                        /* Codes_S_R_S_SESSION_01_053: [On success, session_send_transfer shall return 0.] */
-                                        result = SESSION_SEND_TRANSFER_OK;
-                                    }
+                                   /* Codes_S_R_S_SESSION_01_058: [When any other error occurs, session_send_transfer shall fail and return a non-zero value.] */
+                                   result = SESSION_SEND_TRANSFER_ERROR;
                                 }
                                 else
                                 {
-                                    if (available_frame_size > MAX_FRAME_SIZE)
-                                    {
-                                       available_frame_size = MAX_FRAME_SIZE;
-                                    }
-
-                                    unsigned char *buffer = (unsigned char *)malloc(available_frame_size);
-                                    SessionStreamingContext streaming_context =
-                                    {
-                                       .session_instance = session_instance,
-                                       .transfer = transfer,
-                                       .on_send_complete = on_send_complete,
-                                       .callback_context = callback_context,
-                                       .buffer = {
-                                          .data = buffer,
-                                          .size = 0,
-                                          .capacity = available_frame_size
-                                       },
-                                       .moreToCome = false,
-                                       .result = SESSION_SEND_TRANSFER_OK
-                                    };
-
-                                    if (!payload_stream_output(payloads, session_stream_payload, &streaming_context))
-                                    {
-                                       result = SESSION_SEND_TRANSFER_ERROR;
-                                    }
-                                    else
-                                    {
-                                       session_stream_flush_buffer(&streaming_context);
-                                       result = streaming_context.result;
-                                       if (result == SESSION_SEND_TRANSFER_OK)
-                                       {
-                                          /* Codes_SRS_SESSION_01_018: [is incremented after each successive transfer according to RFC-1982 [RFC1982] serial number arithmetic.] */
-                                          session_instance->next_outgoing_id++;
-                                          session_instance->remote_incoming_window--;
-                                          session_instance->outgoing_window--;
-                                       }
-                                    }
-                                    free(buffer);
+                                   SessionStreamingContext streaming_context =
+                                   {
+                                      .session_instance = session_instance,
+                                      .transfer_template = transfer_template,
+                                      .more_header = payload_peek_bytes(more_header),
+                                      .last_header = payload_peek_bytes(last_header),
+                                      .more_header_size = encoded_size,
+                                      .last_header_size = encoded_size,
+                                      .on_send_complete = on_send_complete,
+                                      .callback_context = callback_context,
+                                      .buffer = {
+                                         .data = buffer,
+                                         .size = 0,
+                                         .capacity = available_frame_size
+                                      },
+                                      .moreToCome = false,
+                                      .result = SESSION_SEND_TRANSFER_OK
+                                   };
+
+                                   if (is_sliced)
+                                   {
+                                      session_send_payload_slices(&streaming_context, payloads, payload_size, available_frame_size);
+                                   }
+                                   else if (!payload_stream_output(payloads, session_stream_payload, &streaming_context))
+                                   {
+                                      streaming_context.result = SESSION_SEND_TRANSFER_ERROR;
+                                   }
+                                   else
+                                   {
+                                      session_stream_flush_buffer(&streaming_context);
+                                   }
+
+                                   result = streaming_context.result;
+                                   if (result == SESSION_SEND_TRANSFER_OK)
+                                   {
+                                      /* Codes_SRS_SESSION_01_018: [is incremented after each successive transfer according to RFC-1982 [RFC1982] serial number arithmetic.] */
+                                      session_instance->next_outgoing_id++;
+                                      session_instance->remote_incoming_window--;
+                                      session_instance->outgoing_window--;
+                                   }
                                 }
+
+                                if (transfer != NULL)
+                                {
+                                   (void)transfer_set_more(transfer, false);
+                                }
+
+                                payload_destroy(&more_header);
+                                payload_destroy(&last_header);
+                                free(buffer);
                             }
+                        }
 
+                        if (transfer_value != NULL)
+                        {
                             amqpvalue_destroy(transfer_value);
                         }
                     }
@@ -1677,3 +2189,62 @@ SESSION_SEND_TRANSFER_RESULT session_send_transfer(LINK_ENDPOINT_HANDLE link_end
 
     return result;
 }
+
+/* Codes_S_R_S_SESSION_01_051: [session_send_transfer shall send a transfer frame with the performative indicated in the transfer argument.] */
+SESSION_SEND_TRANSFER_RESULT session_send_transfer(LINK_ENDPOINT_HANDLE link_endpoint, TRANSFER_HANDLE transfer, PAYLOAD* payloads, delivery_number* delivery_id, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    SESSION_SEND_TRANSFER_RESULT result;
+
+    /* Codes_S_R_S_SESSION_01_054: [If link_endpoint or transfer is NULL, session_send_transfer shall fail and return a non-zero value.] */
+    if ((link_endpoint == NULL) ||
+        (transfer == NULL))
+    {
+        result = SESSION_SEND_TRANSFER_ERROR;
+    }
+    else
+    {
+        result = send_transfer((LINK_ENDPOINT_INSTANCE*)link_endpoint, transfer, payloads, delivery_id, on_send_complete, callback_context);
+    }
+
+    return result;
+}
+
+SESSION_SEND_TRANSFER_RESULT session_send_link_transfer(LINK_ENDPOINT_HANDLE link_endpoint, const unsigned char* delivery_tag, size_t delivery_tag_size, message_format message_format, bool settled, PAYLOAD* payloads, delivery_number* delivery_id, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    SESSION_SEND_TRANSFER_RESULT result;
+
+    /* Codes_S_R_S_SESSION_01_073: [If link_endpoint or delivery_id is NULL, or delivery_tag is NULL while delivery_tag_size is not 0, session_send_link_transfer shall fail and return SESSION_SEND_TRANSFER_ERROR.] */
+    /* Codes_S_R_S_SESSION_01_074: [If delivery_tag_size is greater than 32, session_send_link_transfer shall fail and return SESSION_SEND_TRANSFER_ERROR.] */
+    if ((link_endpoint == NULL) ||
+        (delivery_id == NULL) ||
+        ((delivery_tag == NULL) && (delivery_tag_size > 0)) ||
+        (delivery_tag_size > MAX_TEMPLATE_DELIVERY_TAG_SIZE))
+    {
+        result = SESSION_SEND_TRANSFER_ERROR;
+    }
+    else
+    {
+        LINK_ENDPOINT_INSTANCE* link_endpoint_instance = (LINK_ENDPOINT_INSTANCE*)link_endpoint;
+        TRANSFER_TEMPLATE* transfer_template = &link_endpoint_instance->transfer_template;
+
+        /* Codes_S_R_S_SESSION_01_076: [The transfer performative bytes shall be kept by the link endpoint and only be rebuilt when the delivery tag size changes.] */
+        if ((transfer_template->size == 0) ||
+            (transfer_template->delivery_tag_size != delivery_tag_size))
+        {
+            build_transfer_template(link_endpoint_instance, delivery_tag_size);
+        }
+
+        if (delivery_tag_size > 0)
+        {
+            (void)memcpy(transfer_template->bytes + TRANSFER_DELIVERY_TAG_OFFSET + 2, delivery_tag, delivery_tag_size);
+        }
+
+        put_fixed_uint(transfer_template->bytes + TRANSFER_MESSAGE_FORMAT_OFFSET(delivery_tag_size), message_format);
+        put_fixed_bool(transfer_template->bytes + TRANSFER_SETTLED_OFFSET(delivery_tag_size), settled);
+
+        /* Codes_S_R_S_SESSION_01_075: [session_send_link_transfer shall send the same frames as session_send_transfer would for a transfer performative with the link endpoint handle, delivery_tag, message_format and settled set, encoding them with connection_encode_frame_bytes.] */
+        result = send_transfer(link_endpoint_instance, NULL, payloads, delivery_id, on_send_complete, callback_context);
+    }
+
+    return result;
+}
@@ -0,0 +1,347 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "azure_macro_utils/macro_utils.h"
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_uamqp_c/timer_queue.h"
+
+#define INITIAL_TIMER_QUEUE_CAPACITY 16
+#define TIMER_NOT_QUEUED SIZE_MAX
+
+/* running timers as a binary min-heap ordered by deadline, then by the order in which they were started */
+typedef struct TIMER_QUEUE_INSTANCE_TAG
+{
+    TICK_COUNTER_HANDLE tick_counter;
+    TIMER** timers;
+    size_t capacity;
+    size_t count;
+    uint64_t next_sequence;
+} TIMER_QUEUE_INSTANCE;
+
+static bool expires_before(const TIMER* timer, const TIMER* other_timer)
+{
+    return (timer->deadline < other_timer->deadline) ||
+        ((timer->deadline == other_timer->deadline) && (timer->sequence < other_timer->sequence));
+}
+
+static void place_timer(TIMER_QUEUE_INSTANCE* timer_queue, size_t index, TIMER* timer)
+{
+    timer_queue->timers[index] = timer;
+    timer->index = index;
+}
+
+/* moves the timer at index up or down until the heap is ordered again */
+static void sift_timer(TIMER_QUEUE_INSTANCE* timer_queue, size_t index)
+{
+    TIMER* timer = timer_queue->timers[index];
+
+    while ((index > 0) &&
+        expires_before(timer, timer_queue->timers[(index - 1) / 2]))
+    {
+        place_timer(timer_queue, index, timer_queue->timers[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+
+    while (1)
+    {
+        size_t child = (2 * index) + 1;
+        TIMER* earliest = timer;
+
+        if ((child < timer_queue->count) &&
+            expires_before(timer_queue->timers[child], earliest))
+        {
+            earliest = timer_queue->timers[child];
+        }
+
+        if ((child + 1 < timer_queue->count) &&
+            expires_before(timer_queue->timers[child + 1], earliest))
+        {
+            earliest = timer_queue->timers[++child];
+        }
+
+        if (earliest == timer)
+        {
+            break;
+        }
+
+        place_timer(timer_queue, index, earliest);
+        index = child;
+    }
+
+    place_timer(timer_queue, index, timer);
+}
+
+static void remove_timer(TIMER_QUEUE_INSTANCE* timer_queue, TIMER* timer)
+{
+    size_t index = timer->index;
+
+    timer_queue->count--;
+    if (index < timer_queue->count)
+    {
+        timer_queue->timers[index] = timer_queue->timers[timer_queue->count];
+        sift_timer(timer_queue, index);
+    }
+
+    timer->timer_queue = NULL;
+    timer->index = TIMER_NOT_QUEUED;
+}
+
+TIMER_QUEUE_HANDLE timer_queue_create(TICK_COUNTER_HANDLE tick_counter)
+{
+    TIMER_QUEUE_INSTANCE* timer_queue;
+
+    if (tick_counter == NULL)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_002: [ If `tick_counter` is NULL, `timer_queue_create` shall fail and return NULL.]*/
+        LogError("NULL tick_counter");
+        timer_queue = NULL;
+    }
+    else
+    {
+        timer_queue = (TIMER_QUEUE_INSTANCE*)malloc(sizeof(TIMER_QUEUE_INSTANCE));
+        if (timer_queue == NULL)
+        {
+            /* Codes_SRS_TIMER_QUEUE_01_003: [ If allocating memory for the timer queue fails, `timer_queue_create` shall fail and return NULL.]*/
+            LogError("Cannot allocate memory for timer queue");
+        }
+        else
+        {
+            /* Codes_SRS_TIMER_QUEUE_01_001: [ `timer_queue_create` shall create a new timer queue that reads the current time from `tick_counter` and return a non-NULL handle to it.]*/
+            timer_queue->tick_counter = tick_counter;
+            timer_queue->timers = NULL;
+            timer_queue->capacity = 0;
+            timer_queue->count = 0;
+            timer_queue->next_sequence = 0;
+        }
+    }
+
+    return timer_queue;
+}
+
+void timer_queue_destroy(TIMER_QUEUE_HANDLE timer_queue)
+{
+    if (timer_queue == NULL)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_006: [ If `timer_queue` is NULL, `timer_queue_destroy` shall do nothing.]*/
+        LogError("NULL timer_queue");
+    }
+    else
+    {
+        size_t i;
+
+        /* Codes_SRS_TIMER_QUEUE_01_005: [ Timers still running on the queue shall be stopped without calling their `on_timer_expired`.]*/
+        for (i = 0; i < timer_queue->count; i++)
+        {
+            timer_queue->timers[i]->timer_queue = NULL;
+            timer_queue->timers[i]->index = TIMER_NOT_QUEUED;
+        }
+
+        /* Codes_SRS_TIMER_QUEUE_01_004: [ `timer_queue_destroy` shall free all resources associated with the timer queue.]*/
+        free(timer_queue->timers);
+        free(timer_queue);
+    }
+}
+
+void timer_init(TIMER* timer, ON_TIMER_EXPIRED on_timer_expired, void* context)
+{
+    if (timer == NULL)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_008: [ If `timer` is NULL, `timer_init` shall do nothing.]*/
+        LogError("NULL timer");
+    }
+    else
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_007: [ `timer_init` shall initialize `timer` as not running, to call `on_timer_expired` with `context` when it expires.]*/
+        timer->on_timer_expired = on_timer_expired;
+        timer->context = context;
+        timer->timer_queue = NULL;
+        timer->deadline = 0;
+        timer->sequence = 0;
+        timer->index = TIMER_NOT_QUEUED;
+    }
+}
+
+int timer_start(TIMER_QUEUE_HANDLE timer_queue, TIMER* timer, tickcounter_ms_t timeout)
+{
+    int result;
+    tickcounter_ms_t current_ms;
+
+    if ((timer_queue == NULL) ||
+        (timer == NULL) ||
+        (timer->on_timer_expired == NULL))
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_011: [ If `timer_queue` or `timer` is NULL, or `timer` was initialized with a NULL `on_timer_expired`, `timer_start` shall fail and return a non-zero value.]*/
+        LogError("Bad arguments: timer_queue = %p, timer = %p",
+            timer_queue, timer);
+        result = MU_FAILURE;
+    }
+    else if (tickcounter_get_current_ms(timer_queue->tick_counter, &current_ms) != 0)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_012: [ If getting the current time fails, `timer_start` shall fail and return a non-zero value.]*/
+        LogError("Cannot get current tick count");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        if (timer->timer_queue != timer_queue)
+        {
+            if (timer_queue->count == timer_queue->capacity)
+            {
+                size_t new_capacity = (timer_queue->capacity == 0) ? INITIAL_TIMER_QUEUE_CAPACITY : timer_queue->capacity * 2;
+                TIMER** new_timers = (TIMER**)realloc(timer_queue->timers, new_capacity * sizeof(TIMER*));
+                if (new_timers == NULL)
+                {
+                    /* Codes_SRS_TIMER_QUEUE_01_013: [ If making room for the timer in the queue fails, `timer_start` shall fail and return a non-zero value.]*/
+                    LogError("Cannot grow timer queue to %u timers", (unsigned int)new_capacity);
+                    result = MU_FAILURE;
+                }
+                else
+                {
+                    timer_queue->timers = new_timers;
+                    timer_queue->capacity = new_capacity;
+                    result = 0;
+                }
+            }
+            else
+            {
+                result = 0;
+            }
+
+            if ((result == 0) &&
+                (timer->timer_queue != NULL))
+            {
+                /* running on another queue */
+                remove_timer(timer->timer_queue, timer);
+            }
+        }
+        else
+        {
+            result = 0;
+        }
+
+        if (result == 0)
+        {
+            /* Codes_SRS_TIMER_QUEUE_01_009: [ `timer_start` shall start `timer` on `timer_queue` so that it expires `timeout` milliseconds after the current time read from the tick counter of the queue.]*/
+            /* Codes_SRS_TIMER_QUEUE_01_010: [ If `timer` is already running, `timer_start` shall restart it with the new timeout.]*/
+            timer->deadline = current_ms + timeout;
+            timer->sequence = timer_queue->next_sequence++;
+
+            if (timer->timer_queue == NULL)
+            {
+                timer->timer_queue = timer_queue;
+                timer_queue->timers[timer_queue->count] = timer;
+                timer->index = timer_queue->count;
+                timer_queue->count++;
+            }
+
+            sift_timer(timer_queue, timer->index);
+
+            /* Codes_SRS_TIMER_QUEUE_01_014: [ On success `timer_start` shall return 0.]*/
+        }
+    }
+
+    return result;
+}
+
+void timer_stop(TIMER* timer)
+{
+    /* Codes_SRS_TIMER_QUEUE_01_016: [ If `timer` is NULL or not running, `timer_stop` shall do nothing.]*/
+    if ((timer != NULL) &&
+        (timer->timer_queue != NULL))
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_015: [ `timer_stop` shall remove `timer` from its queue so that it does not expire.]*/
+        remove_timer(timer->timer_queue, timer);
+    }
+}
+
+bool timer_is_running(const TIMER* timer)
+{
+    /* Codes_SRS_TIMER_QUEUE_01_017: [ `timer_is_running` shall return true if `timer` has been started and has neither expired nor been stopped since.]*/
+    /* Codes_SRS_TIMER_QUEUE_01_018: [ If `timer` is NULL, `timer_is_running` shall return false.]*/
+    return (timer != NULL) && (timer->timer_queue != NULL);
+}
+
+int timer_queue_dowork(TIMER_QUEUE_HANDLE timer_queue)
+{
+    int result;
+    tickcounter_ms_t current_ms;
+
+    if (timer_queue == NULL)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_022: [ If `timer_queue` is NULL, `timer_queue_dowork` shall fail and return a non-zero value.]*/
+        LogError("NULL timer_queue");
+        result = MU_FAILURE;
+    }
+    else if (tickcounter_get_current_ms(timer_queue->tick_counter, &current_ms) != 0)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_023: [ If getting the current time fails, `timer_queue_dowork` shall fail and return a non-zero value.]*/
+        LogError("Cannot get current tick count");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_021: [ Timers started while `timer_queue_dowork` is running shall not expire before the next call to `timer_queue_dowork`.]*/
+        uint64_t first_sequence_started_now = timer_queue->next_sequence;
+
+        /* Codes_SRS_TIMER_QUEUE_01_019: [ `timer_queue_dowork` shall call `on_timer_expired` for each timer whose deadline is not after the current time, in order of deadline and, for equal deadlines, in the order the timers were started.]*/
+        while ((timer_queue->count > 0) &&
+            (timer_queue->timers[0]->deadline <= current_ms) &&
+            (timer_queue->timers[0]->sequence < first_sequence_started_now))
+        {
+            TIMER* timer = timer_queue->timers[0];
+
+            /* Codes_SRS_TIMER_QUEUE_01_020: [ A timer shall no longer be running when its `on_timer_expired` is called, so that the callback can start it again.]*/
+            remove_timer(timer_queue, timer);
+            timer->on_timer_expired(timer->context);
+        }
+
+        /* Codes_SRS_TIMER_QUEUE_01_024: [ On success `timer_queue_dowork` shall return 0.]*/
+        result = 0;
+    }
+
+    return result;
+}
+
+int timer_queue_get_time_to_next_deadline(TIMER_QUEUE_HANDLE timer_queue, tickcounter_ms_t* time_to_next_deadline)
+{
+    int result;
+    tickcounter_ms_t current_ms;
+
+    if ((timer_queue == NULL) ||
+        (time_to_next_deadline == NULL))
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_027: [ If `timer_queue` or `time_to_next_deadline` is NULL, `timer_queue_get_time_to_next_deadline` shall fail and return a non-zero value.]*/
+        LogError("Bad arguments: timer_queue = %p, time_to_next_deadline = %p",
+            timer_queue, time_to_next_deadline);
+        result = MU_FAILURE;
+    }
+    else if (timer_queue->count == 0)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_026: [ If no timer is running, `timer_queue_get_time_to_next_deadline` shall set `time_to_next_deadline` to the largest `tickcounter_ms_t` value.]*/
+        *time_to_next_deadline = (tickcounter_ms_t)-1;
+        result = 0;
+    }
+    else if (tickcounter_get_current_ms(timer_queue->tick_counter, &current_ms) != 0)
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_028: [ If getting the current time fails, `timer_queue_get_time_to_next_deadline` shall fail and return a non-zero value.]*/
+        LogError("Cannot get current tick count");
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_SRS_TIMER_QUEUE_01_025: [ `timer_queue_get_time_to_next_deadline` shall set `time_to_next_deadline` to the number of milliseconds until the earliest running timer expires, or 0 if it is already due.]*/
+        tickcounter_ms_t deadline = timer_queue->timers[0]->deadline;
+        *time_to_next_deadline = (deadline > current_ms) ? (deadline - current_ms) : 0;
+
+        /* Codes_SRS_TIMER_QUEUE_01_029: [ On success `timer_queue_get_time_to_next_deadline` shall return 0.]*/
+        result = 0;
+    }
+
+    return result;
+}
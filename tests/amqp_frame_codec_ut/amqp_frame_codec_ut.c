@@ -18,6 +18,7 @@
 #include "testrunnerswitcher.h"
 #include "umock_c/umock_c.h"
 #include "umock_c/umocktypes_stdint.h"
+#include "umock_c/umocktypes_bool.h"
 
 static void* my_gballoc_malloc(size_t size)
 {
@@ -51,19 +52,16 @@ static void my_gballoc_free(void* ptr)
 
 #define TEST_FRAME_CODEC_HANDLE            (FRAME_CODEC_HANDLE)0x4242
 #define TEST_DESCRIPTOR_AMQP_VALUE        (AMQP_VALUE)0x4243
-#define TEST_DECODER_HANDLE                (AMQPVALUE_DECODER_HANDLE)0x4244
 #define TEST_ENCODER_HANDLE                (ENCODER_HANDLE)0x4245
 #define TEST_AMQP_VALUE                    (AMQP_VALUE)0x4246
 #define TEST_CONTEXT                    (void*)0x4247
+#define TEST_ARENA_HANDLE               (AMQPVALUE_ARENA_HANDLE)0x4248
 
 static const unsigned char test_encoded_bytes[2] = { 0x42, 0x43 };
 
 static ON_FRAME_RECEIVED saved_on_frame_received;
 static void* saved_callback_context;
 
-static ON_VALUE_DECODED saved_value_decoded_callback;
-static void* saved_value_decoded_callback_context;
-static size_t total_bytes;
 static PAYLOAD* actual_payloads;
 static size_t actual_payload_count;
 
@@ -282,38 +280,39 @@ static int my_frame_codec_encode_frame(FRAME_CODEC_HANDLE frame_codec, uint8_t t
     return 0;
 }
 
-static AMQPVALUE_DECODER_HANDLE my_amqpvalue_decoder_create(ON_VALUE_DECODED value_decoded_callback, void* value_decoded_callback_context)
+static int my_amqpvalue_decode_buffer_in_arena(AMQPVALUE_ARENA_HANDLE arena, const unsigned char* buffer, size_t size, bool borrow_binaries, AMQP_VALUE* value, size_t* used_bytes)
 {
-    saved_value_decoded_callback = value_decoded_callback;
-    saved_value_decoded_callback_context = value_decoded_callback_context;
-    total_bytes = 0;
-    return TEST_DECODER_HANDLE;
-}
+    int result;
 
-static int my_amqpvalue_decode_bytes(AMQPVALUE_DECODER_HANDLE handle, const unsigned char* buffer, size_t size)
-{
-    unsigned char* new_bytes = (unsigned char*)my_gballoc_realloc(performative_decoded_bytes, performative_decoded_byte_count + size);
-    (void)handle;
-    if (new_bytes != NULL)
+    (void)arena;
+    (void)borrow_binaries;
+
+    if (size < sizeof(test_performative))
     {
-        performative_decoded_bytes = new_bytes;
-        (void)memcpy(performative_decoded_bytes + performative_decoded_byte_count, buffer, size);
-        performative_decoded_byte_count += size;
+        result = 1;
     }
-    total_bytes += size;
-    if (total_bytes == sizeof(test_performative))
+    else
     {
-        saved_value_decoded_callback(saved_value_decoded_callback_context, TEST_AMQP_VALUE);
-        total_bytes = 0;
+        unsigned char* new_bytes = (unsigned char*)my_gballoc_realloc(performative_decoded_bytes, performative_decoded_byte_count + sizeof(test_performative));
+        if (new_bytes != NULL)
+        {
+            performative_decoded_bytes = new_bytes;
+            (void)memcpy(performative_decoded_bytes + performative_decoded_byte_count, buffer, sizeof(test_performative));
+            performative_decoded_byte_count += sizeof(test_performative);
+        }
+
+        *value = TEST_AMQP_VALUE;
+        *used_bytes = sizeof(test_performative);
+        result = 0;
     }
 
-    return 0;
+    return result;
 }
 
-static int my_amqpvalue_encode(AMQP_VALUE value, AMQPVALUE_ENCODER_OUTPUT encoder_output, void* context)
+static int my_amqpvalue_encode_to_payload(AMQP_VALUE value, PAYLOAD* payload)
 {
     (void)value;
-    encoder_output(context, test_encoded_bytes, sizeof(test_encoded_bytes));
+    payload_append_data(payload, test_encoded_bytes, sizeof(test_encoded_bytes));
     return 0;
 }
 
@@ -354,6 +353,8 @@ TEST_SUITE_INITIALIZE(suite_init)
 
     result = umocktypes_stdint_register_types();
     ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_bool_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, my_gballoc_calloc);
@@ -361,15 +362,14 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_ulong, my_amqpvalue_get_ulong);
     REGISTER_GLOBAL_MOCK_HOOK(frame_codec_subscribe, my_frame_codec_subscribe);
     REGISTER_GLOBAL_MOCK_HOOK(frame_codec_encode_frame, my_frame_codec_encode_frame);
-    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_decoder_create, my_amqpvalue_decoder_create);
-    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_decode_bytes, my_amqpvalue_decode_bytes);
-    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_encode, my_amqpvalue_encode);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_decode_buffer_in_arena, my_amqpvalue_decode_buffer_in_arena);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_encode_to_payload, my_amqpvalue_encode_to_payload);
 
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_ulong, TEST_AMQP_VALUE);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_inplace_descriptor, TEST_DESCRIPTOR_AMQP_VALUE);
     REGISTER_GLOBAL_MOCK_RETURN(frame_codec_create, TEST_FRAME_CODEC_HANDLE);
+    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_arena_create, TEST_ARENA_HANDLE);
     REGISTER_GLOBAL_MOCK_RETURN(frame_codec_unsubscribe, 0);
-    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_encoded_size, 0);
 
     REGISTER_TYPE(PAYLOAD*, PAYLOAD_ptr);
 
@@ -377,6 +377,7 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(FRAME_CODEC_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(ON_FRAME_RECEIVED, void*);
     REGISTER_UMOCK_ALIAS_TYPE(AMQPVALUE_DECODER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(AMQPVALUE_ARENA_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(ON_BYTES_ENCODED, void*);
     REGISTER_UMOCK_ALIAS_TYPE(AMQPVALUE_ENCODER_OUTPUT, void*);
@@ -421,14 +422,14 @@ TEST_FUNCTION_CLEANUP(method_cleanup)
 
 /* Tests_SRS_AMQP_FRAME_CODEC_01_011: [amqp_frame_codec_create shall create an instance of an amqp_frame_codec and return a non-NULL handle to it.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_013: [amqp_frame_codec_create shall subscribe for AMQP frames with the given frame_codec.] */
-/* Tests_SRS_AMQP_FRAME_CODEC_01_018: [amqp_frame_codec_create shall create a decoder to be used for decoding AMQP values.] */
+/* Tests_SRS_AMQP_FRAME_CODEC_01_072: [amqp_frame_codec_create shall create an arena for decoded performatives by calling amqpvalue_arena_create.] */
 TEST_FUNCTION(amqp_frame_codec_create_with_valid_args_succeeds)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec;
 
     STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_decoder_create(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_arena_create(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(frame_codec_subscribe(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     // act
@@ -444,14 +445,13 @@ TEST_FUNCTION(amqp_frame_codec_create_with_valid_args_succeeds)
 
 /* Tests_SRS_AMQP_FRAME_CODEC_01_011: [amqp_frame_codec_create shall create an instance of an amqp_frame_codec and return a non-NULL handle to it.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_013: [amqp_frame_codec_create shall subscribe for AMQP frames with the given frame_codec.] */
-/* Tests_SRS_AMQP_FRAME_CODEC_01_018: [amqp_frame_codec_create shall create a decoder to be used for decoding AMQP values.] */
 TEST_FUNCTION(amqp_frame_codec_create_with_valid_args_and_NULL_context_succeeds)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec;
     STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_arena_create(IGNORED_NUM_ARG));
 
-    STRICT_EXPECTED_CALL(amqpvalue_decoder_create(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(frame_codec_subscribe(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     // act
@@ -523,12 +523,12 @@ TEST_FUNCTION(when_frame_codec_subscribe_fails_then_amqp_frame_codec_create_fail
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec;
     STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_arena_create(IGNORED_NUM_ARG));
 
-    STRICT_EXPECTED_CALL(amqpvalue_decoder_create(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(frame_codec_subscribe(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .SetReturn(1);
 
-    STRICT_EXPECTED_CALL(amqpvalue_decoder_destroy(TEST_DECODER_HANDLE));
+    STRICT_EXPECTED_CALL(amqpvalue_arena_destroy(TEST_ARENA_HANDLE));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
@@ -539,17 +539,14 @@ TEST_FUNCTION(when_frame_codec_subscribe_fails_then_amqp_frame_codec_create_fail
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
-/* Tests_SRS_AMQP_FRAME_CODEC_01_019: [If creating the decoder fails, amqp_frame_codec_create shall fail and return NULL.] */
-TEST_FUNCTION(when_creating_the_decoder_fails_then_amqp_frame_codec_create_fails)
+/* Tests_SRS_AMQP_FRAME_CODEC_01_020: [If allocating memory for the new amqp_frame_codec fails, then amqp_frame_codec_create shall fail and return NULL.] */
+TEST_FUNCTION(when_allocating_memory_for_amqp_frame_codec_fails_then_amqp_frame_codec_create_fails)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec;
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
 
-    STRICT_EXPECTED_CALL(amqpvalue_decoder_create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .SetReturn((AMQPVALUE_DECODER_HANDLE)NULL);
-
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
 
     // act
     amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
@@ -559,36 +556,38 @@ TEST_FUNCTION(when_creating_the_decoder_fails_then_amqp_frame_codec_create_fails
     ASSERT_IS_NULL(amqp_frame_codec);
 }
 
-/* Tests_SRS_AMQP_FRAME_CODEC_01_020: [If allocating memory for the new amqp_frame_codec fails, then amqp_frame_codec_create shall fail and return NULL.] */
-TEST_FUNCTION(when_allocating_memory_for_amqp_frame_codec_fails_then_amqp_frame_codec_create_fails)
+/* Tests_SRS_AMQP_FRAME_CODEC_01_073: [If creating the arena fails, amqp_frame_codec_create shall fail and return NULL.] */
+TEST_FUNCTION(when_creating_the_arena_fails_then_amqp_frame_codec_create_fails)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec;
 
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_arena_create(IGNORED_NUM_ARG))
         .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
 
     // assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
     ASSERT_IS_NULL(amqp_frame_codec);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
 /* amqp_frame_codec_destroy */
 
 /* Tests_SRS_AMQP_FRAME_CODEC_01_015: [amqp_frame_codec_destroy shall free all resources associated with the amqp_frame_codec instance.] */
-/* Tests_SRS_AMQP_FRAME_CODEC_01_021: [The decoder created in amqp_frame_codec_create shall be destroyed by amqp_frame_codec_destroy.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_017: [amqp_frame_codec_destroy shall unsubscribe from receiving AMQP frames from the frame_codec that was passed to amqp_frame_codec_create.] */
-TEST_FUNCTION(amqp_frame_codec_destroy_frees_the_decoder_and_unsubscribes_from_AMQP_frames)
+/* Tests_SRS_AMQP_FRAME_CODEC_01_074: [amqp_frame_codec_destroy shall destroy the performative arena by calling amqpvalue_arena_destroy.] */
+TEST_FUNCTION(amqp_frame_codec_destroy_frees_memory_and_unsubscribes_from_AMQP_frames)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
     umock_c_reset_all_calls();
 
     STRICT_EXPECTED_CALL(frame_codec_unsubscribe(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP));
-    STRICT_EXPECTED_CALL(amqpvalue_decoder_destroy(TEST_DECODER_HANDLE));
+    STRICT_EXPECTED_CALL(amqpvalue_arena_destroy(TEST_ARENA_HANDLE));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
@@ -599,7 +598,6 @@ TEST_FUNCTION(amqp_frame_codec_destroy_frees_the_decoder_and_unsubscribes_from_A
 }
 
 /* Tests_SRS_AMQP_FRAME_CODEC_01_015: [amqp_frame_codec_destroy shall free all resources associated with the amqp_frame_codec instance.] */
-/* Tests_SRS_AMQP_FRAME_CODEC_01_021: [The decoder created in amqp_frame_codec_create shall be destroyed by amqp_frame_codec_destroy.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_017: [amqp_frame_codec_destroy shall unsubscribe from receiving AMQP frames from the frame_codec that was passed to amqp_frame_codec_create.] */
 TEST_FUNCTION(when_unsubscribe_fails_amqp_frame_codec_destroy_still_frees_everything)
 {
@@ -609,7 +607,7 @@ TEST_FUNCTION(when_unsubscribe_fails_amqp_frame_codec_destroy_still_frees_everyt
 
     STRICT_EXPECTED_CALL(frame_codec_unsubscribe(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP))
         .SetReturn(1);
-    STRICT_EXPECTED_CALL(amqpvalue_decoder_destroy(TEST_DECODER_HANDLE));
+    STRICT_EXPECTED_CALL(amqpvalue_arena_destroy(TEST_ARENA_HANDLE));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
@@ -636,8 +634,7 @@ TEST_FUNCTION(amqp_frame_codec_destroy_with_NULL_handle_does_nothing)
 /* Tests_SRS_AMQP_FRAME_CODEC_01_022: [amqp_frame_codec_encode_frame shall encode the frame header and AMQP performative in an AMQP frame and on success it shall return 0.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_025: [amqp_frame_codec_encode_frame shall encode the frame header by using frame_codec_encode_frame.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_026: [The payload frame size shall be computed based on the encoded size of the performative and its fields plus the sum of the payload sizes passed via the payloads argument.] */
-/* Tests_SRS_AMQP_FRAME_CODEC_01_027: [The encoded size of the performative and its fields shall be obtained by calling amqpvalue_get_encoded_size.] */
-/* Tests_SRS_AMQP_FRAME_CODEC_01_030: [Encoding of the AMQP performative and its fields shall be done by calling amqpvalue_encode.] */
+/* Tests_SRS_AMQP_FRAME_CODEC_01_027: [The performative and its fields shall be encoded into that PAYLOAD by calling amqpvalue_encode_to_payload, which reserves the encoded size of the performative before writing it.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_028: [The encode result for the performative shall be placed in a PAYLOAD structure.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_070: [The payloads argument for frame_codec_encode_frame shall be made of the payload for the encoded performative and the payloads passed to amqp_frame_codec_encode_frame.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_005: [Bytes 6 and 7 of an AMQP frame contain the channel number ] */
@@ -647,7 +644,6 @@ TEST_FUNCTION(encoding_a_frame_succeeds)
     // arrange
     int result;
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
     uint16_t channel = 0;
     unsigned char channel_bytes[] = { 0, 0 };
     PAYLOAD expected_payloads[] = { { test_encoded_bytes, sizeof(test_encoded_bytes) } };
@@ -655,11 +651,7 @@ TEST_FUNCTION(encoding_a_frame_succeeds)
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(frame_codec_encode_frame(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, 2, channel_bytes, sizeof(channel_bytes), test_on_bytes_encoded, (void*)0x4242))
         .ValidateArgumentBuffer(5, &channel_bytes, sizeof(channel_bytes));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -686,18 +678,13 @@ TEST_FUNCTION(using_channel_no_0x4243_passes_the_channel_number_as_type_specific
     // arrange
     int result;
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
     uint16_t channel = 0x4243;
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     umock_c_reset_all_calls();
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(frame_codec_encode_frame(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, 2, channel_bytes, sizeof(channel_bytes), test_on_bytes_encoded, (void*)0x4242))
         .ValidateArgumentBuffer(5, &channel_bytes, sizeof(channel_bytes));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -720,7 +707,6 @@ TEST_FUNCTION(encoding_a_frame_with_no_payloads_send_down_to_frame_codec_just_th
     // arrange
     int result;
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
     uint16_t channel = 0x4243;
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     PAYLOAD expected_payloads[] = { { test_encoded_bytes, sizeof(test_encoded_bytes) } };
@@ -728,11 +714,7 @@ TEST_FUNCTION(encoding_a_frame_with_no_payloads_send_down_to_frame_codec_just_th
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(frame_codec_encode_frame(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, 1, channel_bytes, sizeof(channel_bytes), test_on_bytes_encoded, (void*)0x4242))
         .ValidateArgumentBuffer(5, &channel_bytes, sizeof(channel_bytes));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -807,52 +789,55 @@ TEST_FUNCTION(amqp_frame_codec_encode_frame_with_NULL_on_bytes_received_fails)
     amqp_frame_codec_destroy(amqp_frame_codec);
 }
 
-/* Tests_SRS_AMQP_FRAME_CODEC_01_029: [If any error occurs during encoding, amqp_frame_codec_encode_frame shall fail and return a non-zero value.] */
-TEST_FUNCTION(when_amqpvalue_get_encoded_size_fails_then_amqp_frame_codec_encode_frame_fails)
+/* Tests_SRS_AMQP_FRAME_CODEC_01_077: [amqp_frame_codec_encode_frame_bytes shall encode a frame whose body is performative_bytes followed by payloads, without decoding or copying performative_bytes before frame_codec_encode_frame copies the frame.] */
+/* Tests_SRS_AMQP_FRAME_CODEC_01_005: [Bytes 6 and 7 of an AMQP frame contain the channel number ] */
+TEST_FUNCTION(amqp_frame_codec_encode_frame_bytes_encodes_the_performative_bytes_without_decoding_them)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
-    uint16_t channel = 0;
+    unsigned char performative_bytes[] = { 0x00, 0x53, 0x13, 0x45 };
+    unsigned char channel_bytes[] = { 0x42, 0x43 };
     int result;
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
-    STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size))
-        .SetReturn(1);
+    STRICT_EXPECTED_CALL(frame_codec_encode_frame(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, channel_bytes, sizeof(channel_bytes), test_on_bytes_encoded, (void*)0x4242))
+        .ValidateArgumentBuffer(4, &channel_bytes, sizeof(channel_bytes));
 
     // act
-    result = amqp_frame_codec_encode_frame(amqp_frame_codec, channel, TEST_AMQP_VALUE, &test_user_payload, 1, test_on_bytes_encoded, (void*)0x4242);
+    result = amqp_frame_codec_encode_frame_bytes(amqp_frame_codec, 0x4243, performative_bytes, sizeof(performative_bytes), NULL, test_on_bytes_encoded, (void*)0x4242);
 
     // assert
-    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     // cleanup
     amqp_frame_codec_destroy(amqp_frame_codec);
 }
 
-/* Tests_SRS_AMQP_FRAME_CODEC_01_029: [If any error occurs during encoding, amqp_frame_codec_encode_frame shall fail and return a non-zero value.] */
-TEST_FUNCTION(when_allocating_memory_for_the_new_payloads_array_fails_then_amqp_frame_codec_encode_frame_fails)
+/* Tests_SRS_AMQP_FRAME_CODEC_01_075: [If amqp_frame_codec, performative_bytes or on_bytes_encoded is NULL, amqp_frame_codec_encode_frame_bytes shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqp_frame_codec_encode_frame_bytes_with_NULL_amqp_frame_codec_fails)
+{
+    // arrange
+    unsigned char performative_bytes[] = { 0x00, 0x53, 0x13, 0x45 };
+
+    // act
+    int result = amqp_frame_codec_encode_frame_bytes(NULL, 0, performative_bytes, sizeof(performative_bytes), NULL, test_on_bytes_encoded, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_AMQP_FRAME_CODEC_01_075: [If amqp_frame_codec, performative_bytes or on_bytes_encoded is NULL, amqp_frame_codec_encode_frame_bytes shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqp_frame_codec_encode_frame_bytes_with_NULL_performative_bytes_fails)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
-    uint16_t channel = 0;
     int result;
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
-    STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .SetReturn(NULL);
-
     // act
-    result = amqp_frame_codec_encode_frame(amqp_frame_codec, channel, TEST_AMQP_VALUE, &test_user_payload, 1, test_on_bytes_encoded, (void*)0x4242);
+    result = amqp_frame_codec_encode_frame_bytes(amqp_frame_codec, 0, NULL, 4, NULL, test_on_bytes_encoded, (void*)0x4242);
 
     // assert
     ASSERT_ARE_NOT_EQUAL(int, 0, result);
@@ -862,27 +847,17 @@ TEST_FUNCTION(when_allocating_memory_for_the_new_payloads_array_fails_then_amqp_
     amqp_frame_codec_destroy(amqp_frame_codec);
 }
 
-/* Tests_SRS_AMQP_FRAME_CODEC_01_029: [If any error occurs during encoding, amqp_frame_codec_encode_frame shall fail and return a non-zero value.] */
-TEST_FUNCTION(when_allocating_memory_for_the_encoded_performative_fails_then_amqp_frame_codec_encode_frame_fails)
+/* Tests_SRS_AMQP_FRAME_CODEC_01_076: [If performative_bytes does not start with the small ulong descriptor of one of the performatives defined in section 2.7, amqp_frame_codec_encode_frame_bytes shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqp_frame_codec_encode_frame_bytes_with_a_descriptor_that_is_not_a_performative_fails)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
-    uint16_t channel = 0;
+    unsigned char performative_bytes[] = { 0x00, 0x53, 0x24, 0x45 };
     int result;
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
-    STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
-        .SetReturn(NULL);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
-
     // act
-    result = amqp_frame_codec_encode_frame(amqp_frame_codec, channel, TEST_AMQP_VALUE, &test_user_payload, 1, test_on_bytes_encoded, (void*)0x4242);
+    result = amqp_frame_codec_encode_frame_bytes(amqp_frame_codec, 0, performative_bytes, sizeof(performative_bytes), NULL, test_on_bytes_encoded, (void*)0x4242);
 
     // assert
     ASSERT_ARE_NOT_EQUAL(int, 0, result);
@@ -893,22 +868,17 @@ TEST_FUNCTION(when_allocating_memory_for_the_encoded_performative_fails_then_amq
 }
 
 /* Tests_SRS_AMQP_FRAME_CODEC_01_029: [If any error occurs during encoding, amqp_frame_codec_encode_frame shall fail and return a non-zero value.] */
-TEST_FUNCTION(when_amqpvalue_encode_fails_then_amqp_frame_codec_encode_frame_fails)
+TEST_FUNCTION(when_amqpvalue_encode_to_payload_fails_then_amqp_frame_codec_encode_frame_fails)
 {
     // arrange
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
     uint16_t channel = 0;
     int result;
     umock_c_reset_all_calls();
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
         .SetReturn(1);
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -928,7 +898,6 @@ TEST_FUNCTION(when_amqpvalue_encode_fails_then_amqp_frame_codec_encode_frame_fai
 TEST_FUNCTION(when_frame_codec_encode_frame_fails_then_amqp_frame_codec_encode_frame_fails)
 {
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t performative_size = 2;
     uint16_t channel = 0;
     unsigned char channel_bytes[] = { 0, 0 };
     int result;
@@ -936,11 +905,7 @@ TEST_FUNCTION(when_frame_codec_encode_frame_fails_then_amqp_frame_codec_encode_f
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-        .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(frame_codec_encode_frame(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, 2, channel_bytes, sizeof(channel_bytes), test_on_bytes_encoded, (void*)0x4242))
         .ValidateArgumentBuffer(5, &channel_bytes, sizeof(channel_bytes))
         .SetReturn(1);
@@ -969,7 +934,6 @@ TEST_FUNCTION(amqp_performatives_are_encoded_successfully)
 
     for (i = 0; i < sizeof(valid_performatives) / sizeof(valid_performatives[0]); i++)
     {
-        size_t performative_size = 2;
         uint16_t channel = 0;
         unsigned char channel_bytes[] = { 0, 0 };
         int result;
@@ -981,11 +945,7 @@ TEST_FUNCTION(amqp_performatives_are_encoded_successfully)
 
         STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
         STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG));
-        STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_AMQP_VALUE, IGNORED_PTR_ARG))
-            .CopyOutArgumentBuffer(2, &performative_size, sizeof(performative_size));
-        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
-        STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
-        STRICT_EXPECTED_CALL(amqpvalue_encode(TEST_AMQP_VALUE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+        STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload(TEST_AMQP_VALUE, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(frame_codec_encode_frame(TEST_FRAME_CODEC_HANDLE, FRAME_TYPE_AMQP, IGNORED_PTR_ARG, 1, channel_bytes, sizeof(channel_bytes), test_on_bytes_encoded, (void*)0x4242))
             .ValidateArgumentBuffer(5, &channel_bytes, sizeof(channel_bytes));
         STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
@@ -1256,7 +1216,8 @@ TEST_FUNCTION(when_an_empty_frame_with_only_1_byte_of_type_specific_data_is_rece
     amqp_frame_codec_destroy(amqp_frame_codec);
 }
 
-/* Tests_SRS_AMQP_FRAME_CODEC_01_052: [Decoding the performative shall be done by feeding the bytes to the decoder create in amqp_frame_codec_create.] */
+/* Tests_SRS_AMQP_FRAME_CODEC_01_052: [Decoding the performative shall be done by calling amqpvalue_decode_buffer_in_arena with the performative arena and the frame body bytes.] */
+/* Tests_SRS_AMQP_FRAME_CODEC_01_071: [The decoded performative shall be destroyed once frame_received_callback returns.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_054: [Once the performative is decoded, the callback frame_received_callback shall be called.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_055: [The decoded channel and performative shall be passed to frame_received_callback.]  */
 TEST_FUNCTION(when_all_performative_bytes_are_received_and_AMQP_frame_payload_is_0_callback_is_triggered)
@@ -1265,17 +1226,14 @@ TEST_FUNCTION(when_all_performative_bytes_are_received_and_AMQP_frame_payload_is
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
     uint64_t descriptor_ulong = AMQP_OPEN;
-    size_t i;
     umock_c_reset_all_calls();
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
         .CopyOutArgumentBuffer(2, &descriptor_ulong, sizeof(descriptor_ulong));
     STRICT_EXPECTED_CALL(amqp_frame_received_callback_1(TEST_CONTEXT, 0x4243, TEST_AMQP_VALUE, IGNORED_PTR_ARG, 0));
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_performative, sizeof(test_performative));
@@ -1300,19 +1258,16 @@ TEST_FUNCTION(amqp_frame_with_1_payload_bytes_are_reported_via_the_amqp_frame_pa
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
     uint64_t descriptor_ulong = AMQP_OPEN;
-    size_t i;
     umock_c_reset_all_calls();
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
         .CopyOutArgumentBuffer(2, &descriptor_ulong, sizeof(descriptor_ulong));
 
     STRICT_EXPECTED_CALL(amqp_frame_received_callback_1(TEST_CONTEXT, 0x4243, TEST_AMQP_VALUE, test_frame_payload_bytes, 1))
         .ValidateArgumentBuffer(4, test_frame_payload_bytes, 1);
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 1);
@@ -1334,19 +1289,16 @@ TEST_FUNCTION(amqp_frame_with_2_payload_bytes_are_reported_via_the_amqp_frame_pa
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
     uint64_t descriptor_ulong = AMQP_OPEN;
-    size_t i;
     umock_c_reset_all_calls();
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
         .CopyOutArgumentBuffer(2, &descriptor_ulong, sizeof(descriptor_ulong));
 
     STRICT_EXPECTED_CALL(amqp_frame_received_callback_1(TEST_CONTEXT, 0x4243, TEST_AMQP_VALUE, test_frame_payload_bytes, 2))
         .ValidateArgumentBuffer(4, test_frame_payload_bytes, 2);
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
@@ -1365,32 +1317,27 @@ TEST_FUNCTION(after_decoding_succesfully_a_second_frame_can_be_decoded)
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
     uint64_t descriptor_ulong = AMQP_OPEN;
-    size_t i;
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
         .CopyOutArgumentBuffer(2, &descriptor_ulong, sizeof(descriptor_ulong));
 
     STRICT_EXPECTED_CALL(amqp_frame_received_callback_1(TEST_CONTEXT, 0x4243, TEST_AMQP_VALUE, test_frame_payload_bytes, 2))
         .ValidateArgumentBuffer(4, test_frame_payload_bytes, 2);
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     (void)saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
     umock_c_reset_all_calls();
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
         .CopyOutArgumentBuffer(2, &descriptor_ulong, sizeof(descriptor_ulong));
 
     STRICT_EXPECTED_CALL(amqp_frame_received_callback_1(TEST_CONTEXT, 0x4243, TEST_AMQP_VALUE, test_frame_payload_bytes, 2))
         .ValidateArgumentBuffer(4, test_frame_payload_bytes, 2);
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
@@ -1413,21 +1360,18 @@ TEST_FUNCTION(valid_performative_codes_trigger_callbacks)
 
     for (i = 0; i < 2; i++)
     {
-        size_t j;
         umock_c_reset_all_calls();
 
         performative_ulong = valid_performatives[i];
 
-        for (j = 0; j < sizeof(test_performative); j++)
-        {
-            STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-        }
+        STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
         STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
         STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
             .CopyOutArgumentBuffer(2, &performative_ulong, sizeof(performative_ulong));
 
         STRICT_EXPECTED_CALL(amqp_frame_received_callback_1(TEST_CONTEXT, 0x4243, TEST_AMQP_VALUE, test_frame_payload_bytes, 2))
             .ValidateArgumentBuffer(4, test_frame_payload_bytes, 2);
+        STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
         // act
         saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
@@ -1447,19 +1391,16 @@ TEST_FUNCTION(performative_0x09_can_not_be_decoded)
     // arrange
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t i;
     umock_c_reset_all_calls();
     performative_ulong = 0x09;
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
         .CopyOutArgumentBuffer(2, &performative_ulong, sizeof(performative_ulong));
 
     STRICT_EXPECTED_CALL(test_amqp_frame_codec_error(TEST_CONTEXT));
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
@@ -1478,20 +1419,17 @@ TEST_FUNCTION(performative_0x19_can_not_be_decoded)
     // arrange
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t i;
     umock_c_reset_all_calls();
     performative_ulong = 0x19;
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
         .CopyOutArgumentBuffer(2, &performative_ulong, sizeof(performative_ulong));
 
     STRICT_EXPECTED_CALL(test_amqp_frame_codec_error(TEST_CONTEXT));
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
@@ -1513,7 +1451,7 @@ TEST_FUNCTION(when_amqp_value_decoding_for_the_performative_fails_decoder_fails)
     umock_c_reset_all_calls();
 
     performative_ulong = AMQP_OPEN;
-    STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .SetReturn(1);
 
     STRICT_EXPECTED_CALL(test_amqp_frame_codec_error(TEST_CONTEXT));
@@ -1530,7 +1468,7 @@ TEST_FUNCTION(when_amqp_value_decoding_for_the_performative_fails_decoder_fails)
 
 /* Tests_SRS_AMQP_FRAME_CODEC_01_060: [If any error occurs while decoding a frame, the decoder shall switch to an error state where decoding shall not be possible anymore.] */
 /* Tests_SRS_AMQP_FRAME_CODEC_01_069: [If any error occurs while decoding a frame, the decoder shall indicate the error by calling the amqp_frame_codec_error_callback  and passing to it the callback context argument that was given in amqp_frame_codec_create.] */
-TEST_FUNCTION(when_second_amqp_value_decoding_for_the_performative_fails_decoder_fails)
+TEST_FUNCTION(when_the_frame_body_ends_before_the_performative_is_decoded_decoder_fails)
 {
     // arrange
     unsigned char channel_bytes[] = { 0x42, 0x43 };
@@ -1538,14 +1476,12 @@ TEST_FUNCTION(when_second_amqp_value_decoding_for_the_performative_fails_decoder
     umock_c_reset_all_calls();
 
     performative_ulong = AMQP_OPEN;
-    STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-        .SetReturn(1);
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, sizeof(test_performative) - 1, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     STRICT_EXPECTED_CALL(test_amqp_frame_codec_error(TEST_CONTEXT));
 
     // act
-    saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
+    saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) - 1);
 
     // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
@@ -1561,19 +1497,16 @@ TEST_FUNCTION(when_getting_the_descriptor_fails_decoder_fails)
     // arrange
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t i;
     umock_c_reset_all_calls();
     performative_ulong = AMQP_OPEN;
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE))
         .SetReturn(NULL);
 
     STRICT_EXPECTED_CALL(test_amqp_frame_codec_error(TEST_CONTEXT));
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
@@ -1592,14 +1525,10 @@ TEST_FUNCTION(when_getting_the_ulong_value_of_the_descriptor_fails_decoder_fails
     // arrange
     unsigned char channel_bytes[] = { 0x42, 0x43 };
     AMQP_FRAME_CODEC_HANDLE amqp_frame_codec = amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, amqp_frame_received_callback_1, amqp_empty_frame_received_callback_1, test_amqp_frame_codec_error, TEST_CONTEXT);
-    size_t i;
     umock_c_reset_all_calls();
     performative_ulong = AMQP_OPEN;
 
-    for (i = 0; i < sizeof(test_performative); i++)
-    {
-        STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    }
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
     STRICT_EXPECTED_CALL(amqpvalue_get_inplace_descriptor(TEST_AMQP_VALUE));
     STRICT_EXPECTED_CALL(amqpvalue_get_ulong(TEST_DESCRIPTOR_AMQP_VALUE, IGNORED_PTR_ARG))
@@ -1607,6 +1536,7 @@ TEST_FUNCTION(when_getting_the_ulong_value_of_the_descriptor_fails_decoder_fails
         .SetReturn(1);
 
     STRICT_EXPECTED_CALL(test_amqp_frame_codec_error(TEST_CONTEXT));
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(TEST_AMQP_VALUE));
 
     // act
     saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
@@ -1627,7 +1557,7 @@ TEST_FUNCTION(when_amqp_value_decoding_fails_subsequent_decoding_fails_even_if_t
     umock_c_reset_all_calls();
 
     performative_ulong = AMQP_OPEN;
-    STRICT_EXPECTED_CALL(amqpvalue_decode_bytes(TEST_DECODER_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+    STRICT_EXPECTED_CALL(amqpvalue_decode_buffer_in_arena(TEST_ARENA_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, false, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .SetReturn(1);
 
     (void)saved_on_frame_received(saved_callback_context, channel_bytes, sizeof(channel_bytes), test_frame, sizeof(test_performative) + 2);
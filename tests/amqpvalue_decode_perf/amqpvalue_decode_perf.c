@@ -0,0 +1,434 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_uamqp_c/amqpvalue.h"
+#include "azure_uamqp_c/amqp_definitions.h"
+
+#define DECODE_COUNT 200000
+
+static size_t total_values_decoded;
+
+static int encode_bytes(void* context, PAYLOAD* to_append)
+{
+    PAYLOAD* payload = (PAYLOAD*)context;
+    payload_append_payload_as_copy(payload, to_append);
+    return 0;
+}
+
+static void on_value_decoded(void* context, AMQP_VALUE decoded_value)
+{
+    (void)context;
+    (void)decoded_value;
+
+    total_values_decoded++;
+}
+
+static unsigned char* encode_performative(AMQP_VALUE performative, size_t* encoded_size)
+{
+    unsigned char* result;
+
+    if (performative == NULL)
+    {
+        LogError("Cannot create performative");
+        result = NULL;
+    }
+    else
+    {
+        PAYLOAD* payload = payload_create();
+        if (payload == NULL)
+        {
+            LogError("Cannot create payload");
+            result = NULL;
+        }
+        else
+        {
+            if (amqpvalue_encode(performative, encode_bytes, payload) != 0)
+            {
+                LogError("Cannot encode performative");
+                result = NULL;
+            }
+            else
+            {
+                *encoded_size = payload_stream_to_heap(payload, &result);
+            }
+
+            payload_destroy(&payload);
+        }
+
+        amqpvalue_destroy(performative);
+    }
+
+    return result;
+}
+
+static unsigned char* create_transfer(size_t* encoded_size)
+{
+    unsigned char* result;
+    TRANSFER_HANDLE transfer = transfer_create(1);
+    if (transfer == NULL)
+    {
+        LogError("Cannot create transfer");
+        result = NULL;
+    }
+    else
+    {
+        unsigned char tag_bytes[] = { 0x00, 0x00, 0x00, 0x2A };
+        delivery_tag tag = payload_create();
+
+        payload_append_data(tag, tag_bytes, sizeof(tag_bytes));
+
+        if ((transfer_set_delivery_id(transfer, 42) != 0) ||
+            (transfer_set_delivery_tag(transfer, tag) != 0) ||
+            (transfer_set_message_format(transfer, 0) != 0) ||
+            (transfer_set_settled(transfer, false) != 0))
+        {
+            LogError("Cannot set transfer fields");
+            result = NULL;
+        }
+        else
+        {
+            result = encode_performative(amqpvalue_create_transfer(transfer), encoded_size);
+        }
+
+        payload_destroy(&tag);
+        transfer_destroy(transfer);
+    }
+
+    return result;
+}
+
+static unsigned char* create_attach(size_t* encoded_size)
+{
+    unsigned char* result;
+    ATTACH_HANDLE attach = attach_create("sender-link-8f4b1e2c", 0, role_sender);
+    if (attach == NULL)
+    {
+        LogError("Cannot create attach");
+        result = NULL;
+    }
+    else
+    {
+        SOURCE_HANDLE source = source_create();
+        TARGET_HANDLE target = target_create();
+        AMQP_VALUE source_address = amqpvalue_create_string("ingress");
+        AMQP_VALUE target_address = amqpvalue_create_string("amqps://localhost/queue/perf");
+        AMQP_VALUE source_value = NULL;
+        AMQP_VALUE target_value = NULL;
+        AMQP_VALUE properties = amqpvalue_create_map();
+        AMQP_VALUE property_key = amqpvalue_create_symbol("com.microsoft:client-version");
+        AMQP_VALUE property_value = amqpvalue_create_string("uamqp-perf");
+
+        if ((source == NULL) || (target == NULL) ||
+            (source_set_address(source, source_address) != 0) ||
+            (target_set_address(target, target_address) != 0) ||
+            ((source_value = amqpvalue_create_source(source)) == NULL) ||
+            ((target_value = amqpvalue_create_target(target)) == NULL) ||
+            (amqpvalue_set_map_value(properties, property_key, property_value) != 0) ||
+            (attach_set_snd_settle_mode(attach, sender_settle_mode_unsettled) != 0) ||
+            (attach_set_rcv_settle_mode(attach, receiver_settle_mode_first) != 0) ||
+            (attach_set_source(attach, source_value) != 0) ||
+            (attach_set_target(attach, target_value) != 0) ||
+            (attach_set_initial_delivery_count(attach, 0) != 0) ||
+            (attach_set_max_message_size(attach, 256 * 1024) != 0) ||
+            (attach_set_properties(attach, properties) != 0))
+        {
+            LogError("Cannot set attach fields");
+            result = NULL;
+        }
+        else
+        {
+            result = encode_performative(amqpvalue_create_attach(attach), encoded_size);
+        }
+
+        amqpvalue_destroy(property_value);
+        amqpvalue_destroy(property_key);
+        amqpvalue_destroy(properties);
+        amqpvalue_destroy(target_value);
+        amqpvalue_destroy(source_value);
+        amqpvalue_destroy(target_address);
+        amqpvalue_destroy(source_address);
+        if (target != NULL)
+        {
+            target_destroy(target);
+        }
+        if (source != NULL)
+        {
+            source_destroy(source);
+        }
+        attach_destroy(attach);
+    }
+
+    return result;
+}
+
+static unsigned char* create_flow(size_t* encoded_size)
+{
+    unsigned char* result;
+    FLOW_HANDLE flow = flow_create(5000, 1, 5000);
+    if (flow == NULL)
+    {
+        LogError("Cannot create flow");
+        result = NULL;
+    }
+    else
+    {
+        if ((flow_set_next_incoming_id(flow, 100) != 0) ||
+            (flow_set_handle(flow, 0) != 0) ||
+            (flow_set_delivery_count(flow, 100) != 0) ||
+            (flow_set_link_credit(flow, 1000) != 0))
+        {
+            LogError("Cannot set flow fields");
+            result = NULL;
+        }
+        else
+        {
+            result = encode_performative(amqpvalue_create_flow(flow), encoded_size);
+        }
+
+        flow_destroy(flow);
+    }
+
+    return result;
+}
+
+static void log_rate(const char* name, const char* decoder_name, tickcounter_ms_t start_ms, tickcounter_ms_t end_ms, size_t encoded_size)
+{
+    double seconds = (double)(end_ms - start_ms) / 1000;
+
+    LogInfo("%s (%lu bytes), %s: %lu values in %.03f seconds, %.0f values/s",
+        name,
+        (unsigned long)encoded_size,
+        decoder_name,
+        (unsigned long)DECODE_COUNT,
+        seconds,
+        (seconds > 0) ? ((double)DECODE_COUNT / seconds) : 0.0);
+}
+
+static int run_streaming_decode(TICK_COUNTER_HANDLE tick_counter, const unsigned char* encoded, size_t encoded_size, const char* name)
+{
+    int result;
+    AMQPVALUE_DECODER_HANDLE decoder = amqpvalue_decoder_create(on_value_decoded, NULL);
+    if (decoder == NULL)
+    {
+        LogError("Cannot create decoder");
+        result = __LINE__;
+    }
+    else
+    {
+        tickcounter_ms_t start_ms;
+        tickcounter_ms_t end_ms;
+
+        if (tickcounter_get_current_ms(tick_counter, &start_ms) != 0)
+        {
+            LogError("Cannot get tick counter value");
+            result = __LINE__;
+        }
+        else
+        {
+            size_t i;
+
+            result = 0;
+            total_values_decoded = 0;
+
+            for (i = 0; i < DECODE_COUNT; i++)
+            {
+                if (amqpvalue_decode_bytes(decoder, encoded, encoded_size) != 0)
+                {
+                    LogError("amqpvalue_decode_bytes failed");
+                    result = __LINE__;
+                    break;
+                }
+            }
+
+            if (tickcounter_get_current_ms(tick_counter, &end_ms) != 0)
+            {
+                LogError("Cannot get tick counter value");
+                result = __LINE__;
+            }
+            else if (total_values_decoded != DECODE_COUNT)
+            {
+                LogError("Decoded %lu values instead of %lu", (unsigned long)total_values_decoded, (unsigned long)DECODE_COUNT);
+                result = __LINE__;
+            }
+            else if (result == 0)
+            {
+                log_rate(name, "streaming decoder", start_ms, end_ms, encoded_size);
+            }
+        }
+
+        amqpvalue_decoder_destroy(decoder);
+    }
+
+    return result;
+}
+
+static int run_buffer_decode(TICK_COUNTER_HANDLE tick_counter, const unsigned char* encoded, size_t encoded_size, const char* name)
+{
+    int result;
+    tickcounter_ms_t start_ms;
+    tickcounter_ms_t end_ms;
+
+    if (tickcounter_get_current_ms(tick_counter, &start_ms) != 0)
+    {
+        LogError("Cannot get tick counter value");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t i;
+
+        result = 0;
+
+        for (i = 0; i < DECODE_COUNT; i++)
+        {
+            AMQP_VALUE value;
+            size_t used_bytes;
+
+            if ((amqpvalue_decode_buffer(encoded, encoded_size, &value, &used_bytes) != 0) ||
+                (used_bytes != encoded_size))
+            {
+                LogError("amqpvalue_decode_buffer failed");
+                result = __LINE__;
+                break;
+            }
+
+            amqpvalue_destroy(value);
+        }
+
+        if (tickcounter_get_current_ms(tick_counter, &end_ms) != 0)
+        {
+            LogError("Cannot get tick counter value");
+            result = __LINE__;
+        }
+        else if (result == 0)
+        {
+            log_rate(name, "buffer decoder", start_ms, end_ms, encoded_size);
+        }
+    }
+
+    return result;
+}
+
+static int run_arena_decode(TICK_COUNTER_HANDLE tick_counter, const unsigned char* encoded, size_t encoded_size, const char* name)
+{
+    int result;
+    AMQPVALUE_ARENA_HANDLE arena = amqpvalue_arena_create(1024);
+    if (arena == NULL)
+    {
+        LogError("Cannot create arena");
+        result = __LINE__;
+    }
+    else
+    {
+        tickcounter_ms_t start_ms;
+        tickcounter_ms_t end_ms;
+
+        if (tickcounter_get_current_ms(tick_counter, &start_ms) != 0)
+        {
+            LogError("Cannot get tick counter value");
+            result = __LINE__;
+        }
+        else
+        {
+            size_t i;
+
+            result = 0;
+
+            for (i = 0; i < DECODE_COUNT; i++)
+            {
+                AMQP_VALUE value;
+                size_t used_bytes;
+
+                if ((amqpvalue_decode_buffer_in_arena(arena, encoded, encoded_size, false, &value, &used_bytes) != 0) ||
+                    (used_bytes != encoded_size))
+                {
+                    LogError("amqpvalue_decode_buffer_in_arena failed");
+                    result = __LINE__;
+                    break;
+                }
+
+                amqpvalue_destroy(value);
+            }
+
+            if (tickcounter_get_current_ms(tick_counter, &end_ms) != 0)
+            {
+                LogError("Cannot get tick counter value");
+                result = __LINE__;
+            }
+            else if (result == 0)
+            {
+                log_rate(name, "arena decoder", start_ms, end_ms, encoded_size);
+            }
+        }
+
+        amqpvalue_arena_destroy(arena);
+    }
+
+    return result;
+}
+
+static int run_performative(TICK_COUNTER_HANDLE tick_counter, unsigned char* encoded, size_t encoded_size, const char* name)
+{
+    int result;
+
+    if (encoded == NULL)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        if ((run_streaming_decode(tick_counter, encoded, encoded_size, name) != 0) ||
+            (run_buffer_decode(tick_counter, encoded, encoded_size, name) != 0) ||
+            (run_arena_decode(tick_counter, encoded, encoded_size, name) != 0))
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+
+        free(encoded);
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result;
+    TICK_COUNTER_HANDLE tick_counter;
+
+    (void)argc;
+    (void)argv;
+
+    tick_counter = tickcounter_create();
+    if (tick_counter == NULL)
+    {
+        LogError("Cannot create tick counter");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t transfer_size = 0;
+        size_t attach_size = 0;
+        size_t flow_size = 0;
+        unsigned char* transfer = create_transfer(&transfer_size);
+        unsigned char* attach = create_attach(&attach_size);
+        unsigned char* flow = create_flow(&flow_size);
+
+        /* run_performative frees the encoded bytes, so all three are always run */
+        result = run_performative(tick_counter, transfer, transfer_size, "Transfer");
+        result = (run_performative(tick_counter, attach, attach_size, "Attach") != 0) ? __LINE__ : result;
+        result = (run_performative(tick_counter, flow, flow_size, "Flow") != 0) ? __LINE__ : result;
+
+        tickcounter_destroy(tick_counter);
+    }
+
+    return result;
+}
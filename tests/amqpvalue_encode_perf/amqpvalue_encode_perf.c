@@ -0,0 +1,258 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_uamqp_c/amqpvalue.h"
+#include "azure_uamqp_c/amqp_definitions.h"
+
+#define ENCODE_COUNT 200000
+
+static int encode_bytes(void* context, PAYLOAD* to_append)
+{
+    PAYLOAD* payload = (PAYLOAD*)context;
+    payload_append_payload_as_copy(payload, to_append);
+    return 0;
+}
+
+/* the way frames were encoded before amqpvalue_encode_to_payload: size, reserve, then one payload per encoded field */
+static int encode_with_encoder_output(AMQP_VALUE value, PAYLOAD* payload)
+{
+    int result;
+    size_t encoded_size;
+
+    if ((amqpvalue_get_encoded_size(value, &encoded_size) != 0) ||
+        (!payload_reserve_data(payload, encoded_size)) ||
+        (amqpvalue_encode(value, encode_bytes, payload) != 0))
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+
+    return result;
+}
+
+static AMQP_VALUE create_transfer(void)
+{
+    AMQP_VALUE result;
+    TRANSFER_HANDLE transfer = transfer_create(1);
+    if (transfer == NULL)
+    {
+        LogError("Cannot create transfer");
+        result = NULL;
+    }
+    else
+    {
+        unsigned char tag_bytes[] = { 0x00, 0x00, 0x00, 0x2A };
+        delivery_tag tag = payload_create();
+
+        payload_append_data(tag, tag_bytes, sizeof(tag_bytes));
+
+        if ((transfer_set_delivery_id(transfer, 42) != 0) ||
+            (transfer_set_delivery_tag(transfer, tag) != 0) ||
+            (transfer_set_message_format(transfer, 0) != 0) ||
+            (transfer_set_settled(transfer, false) != 0))
+        {
+            LogError("Cannot set transfer fields");
+            result = NULL;
+        }
+        else
+        {
+            result = amqpvalue_create_transfer(transfer);
+        }
+
+        payload_destroy(&tag);
+        transfer_destroy(transfer);
+    }
+
+    return result;
+}
+
+static AMQP_VALUE create_flow(void)
+{
+    AMQP_VALUE result;
+    FLOW_HANDLE flow = flow_create(5000, 1, 5000);
+    if (flow == NULL)
+    {
+        LogError("Cannot create flow");
+        result = NULL;
+    }
+    else
+    {
+        if ((flow_set_next_incoming_id(flow, 100) != 0) ||
+            (flow_set_handle(flow, 0) != 0) ||
+            (flow_set_delivery_count(flow, 100) != 0) ||
+            (flow_set_link_credit(flow, 1000) != 0))
+        {
+            LogError("Cannot set flow fields");
+            result = NULL;
+        }
+        else
+        {
+            result = amqpvalue_create_flow(flow);
+        }
+
+        flow_destroy(flow);
+    }
+
+    return result;
+}
+
+static AMQP_VALUE create_disposition(void)
+{
+    AMQP_VALUE result;
+    DISPOSITION_HANDLE disposition = disposition_create(role_receiver, 42);
+    if (disposition == NULL)
+    {
+        LogError("Cannot create disposition");
+        result = NULL;
+    }
+    else
+    {
+        ACCEPTED_HANDLE accepted = accepted_create();
+        AMQP_VALUE accepted_value = NULL;
+
+        if ((accepted == NULL) ||
+            ((accepted_value = amqpvalue_create_accepted(accepted)) == NULL) ||
+            (disposition_set_last(disposition, 42) != 0) ||
+            (disposition_set_settled(disposition, true) != 0) ||
+            (disposition_set_state(disposition, accepted_value) != 0))
+        {
+            LogError("Cannot set disposition fields");
+            result = NULL;
+        }
+        else
+        {
+            result = amqpvalue_create_disposition(disposition);
+        }
+
+        amqpvalue_destroy(accepted_value);
+        if (accepted != NULL)
+        {
+            accepted_destroy(accepted);
+        }
+        disposition_destroy(disposition);
+    }
+
+    return result;
+}
+
+static int run_encode(TICK_COUNTER_HANDLE tick_counter, AMQP_VALUE value, const char* name, const char* encoder_name, int (*encode)(AMQP_VALUE value, PAYLOAD* payload))
+{
+    int result;
+    tickcounter_ms_t start_ms;
+    tickcounter_ms_t end_ms;
+
+    if (tickcounter_get_current_ms(tick_counter, &start_ms) != 0)
+    {
+        LogError("Cannot get tick counter value");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t encoded_size = 0;
+        size_t i;
+
+        result = 0;
+
+        for (i = 0; i < ENCODE_COUNT; i++)
+        {
+            PAYLOAD* payload = payload_create();
+            if (encode(value, payload) != 0)
+            {
+                LogError("Encoding with %s failed", encoder_name);
+                result = __LINE__;
+            }
+            else
+            {
+                encoded_size = payload_get_length(payload);
+            }
+
+            payload_destroy(&payload);
+
+            if (result != 0)
+            {
+                break;
+            }
+        }
+
+        if (tickcounter_get_current_ms(tick_counter, &end_ms) != 0)
+        {
+            LogError("Cannot get tick counter value");
+            result = __LINE__;
+        }
+        else if (result == 0)
+        {
+            double seconds = (double)(end_ms - start_ms) / 1000;
+
+            LogInfo("%s (%lu bytes), %s: %lu values in %.03f seconds, %.0f values/s",
+                name,
+                (unsigned long)encoded_size,
+                encoder_name,
+                (unsigned long)ENCODE_COUNT,
+                seconds,
+                (seconds > 0) ? ((double)ENCODE_COUNT / seconds) : 0.0);
+        }
+    }
+
+    return result;
+}
+
+static int run_performative(TICK_COUNTER_HANDLE tick_counter, AMQP_VALUE value, const char* name)
+{
+    int result;
+
+    if (value == NULL)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        if ((run_encode(tick_counter, value, name, "amqpvalue_encode", encode_with_encoder_output) != 0) ||
+            (run_encode(tick_counter, value, name, "amqpvalue_encode_to_payload", amqpvalue_encode_to_payload) != 0))
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+
+        amqpvalue_destroy(value);
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result;
+    TICK_COUNTER_HANDLE tick_counter;
+
+    (void)argc;
+    (void)argv;
+
+    tick_counter = tickcounter_create();
+    if (tick_counter == NULL)
+    {
+        LogError("Cannot create tick counter");
+        result = __LINE__;
+    }
+    else
+    {
+        /* run_performative destroys the value, so all three are always run */
+        result = run_performative(tick_counter, create_transfer(), "Transfer");
+        result = (run_performative(tick_counter, create_flow(), "Flow") != 0) ? __LINE__ : result;
+        result = (run_performative(tick_counter, create_disposition(), "Disposition") != 0) ? __LINE__ : result;
+
+        tickcounter_destroy(tick_counter);
+    }
+
+    return result;
+}
@@ -3177,6 +3177,121 @@ TEST_FUNCTION(when_allocating_memory_fails_then_amqpvalue_create_list_fails)
     ASSERT_IS_NULL(result);
 }
 
+/* amqpvalue_reserve_list */
+
+/* Tests_SRS_AMQPVALUE_01_463: [amqpvalue_reserve_list shall allocate storage for at least capacity items, without changing the items already in the list.] */
+/* Tests_SRS_AMQPVALUE_01_466: [On success amqpvalue_reserve_list shall return 0.] */
+TEST_FUNCTION(amqpvalue_reserve_list_allocates_the_items_once)
+{
+    // arrange
+    int result;
+    uint32_t i;
+    uint32_t item_count;
+    AMQP_VALUE list = amqpvalue_create_list();
+    AMQP_VALUE item = amqpvalue_create_uint(42);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, 10 * sizeof(AMQP_VALUE)));
+
+    // act
+    result = amqpvalue_reserve_list(list, 10);
+    for (i = 0; i < 10; i++)
+    {
+        (void)amqpvalue_set_list_item(list, i, item);
+    }
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    (void)amqpvalue_get_list_item_count(list, &item_count);
+    ASSERT_ARE_EQUAL(uint32_t, 10, item_count);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(list);
+    amqpvalue_destroy(item);
+}
+
+/* Tests_SRS_AMQPVALUE_01_464: [If value is NULL or is not a list, amqpvalue_reserve_list shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_reserve_list_with_NULL_value_fails)
+{
+    // arrange
+    int result;
+
+    // act
+    result = amqpvalue_reserve_list(NULL, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_464: [If value is NULL or is not a list, amqpvalue_reserve_list shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_reserve_list_on_a_map_fails)
+{
+    // arrange
+    int result;
+    AMQP_VALUE map = amqpvalue_create_map();
+    umock_c_reset_all_calls();
+
+    // act
+    result = amqpvalue_reserve_list(map, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(map);
+}
+
+/* Tests_SRS_AMQPVALUE_01_465: [If allocating memory fails, amqpvalue_reserve_list shall fail and return a non-zero value, leaving the list unaltered.] */
+TEST_FUNCTION(when_reallocating_fails_amqpvalue_reserve_list_fails)
+{
+    // arrange
+    int result;
+    uint32_t item_count;
+    AMQP_VALUE list = amqpvalue_create_list();
+    AMQP_VALUE item = amqpvalue_create_uint(42);
+    (void)amqpvalue_set_list_item(list, 0, item);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = amqpvalue_reserve_list(list, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    (void)amqpvalue_get_list_item_count(list, &item_count);
+    ASSERT_ARE_EQUAL(uint32_t, 1, item_count);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(list);
+    amqpvalue_destroy(item);
+}
+
+/* Tests_SRS_AMQPVALUE_01_466: [On success amqpvalue_reserve_list shall return 0.] */
+TEST_FUNCTION(amqpvalue_reserve_list_with_less_than_the_item_count_does_not_allocate)
+{
+    // arrange
+    int result;
+    AMQP_VALUE list = amqpvalue_create_list();
+    (void)amqpvalue_set_list_item_count(list, 2);
+    umock_c_reset_all_calls();
+
+    // act
+    result = amqpvalue_reserve_list(list, 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(list);
+}
+
 /* amqpvalue_set_list_item_count */
 
 /* Tests_SRS_AMQPVALUE_01_152: [amqpvalue_set_list_item_count shall resize an AMQP list.] */
@@ -3962,6 +4077,80 @@ TEST_FUNCTION(amqpvalue_create_map_creates_a_map_with_no_pairs)
     amqpvalue_destroy(map);
 }
 
+/* amqpvalue_reserve_map */
+
+/* Tests_SRS_AMQPVALUE_01_467: [amqpvalue_reserve_map shall allocate storage for at least capacity key/value pairs, without changing the key/value pairs already in the map.] */
+/* Tests_SRS_AMQPVALUE_01_470: [On success amqpvalue_reserve_map shall return 0.] */
+TEST_FUNCTION(amqpvalue_reserve_map_allocates_the_pairs_once)
+{
+    // arrange
+    int result;
+    uint32_t i;
+    AMQP_VALUE map = amqpvalue_create_map();
+    AMQP_VALUE keys[4];
+    for (i = 0; i < 4; i++)
+    {
+        keys[i] = amqpvalue_create_uint(i);
+    }
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+    // act
+    result = amqpvalue_reserve_map(map, 4);
+    for (i = 0; i < 4; i++)
+    {
+        (void)amqpvalue_set_map_value(map, keys[i], keys[i]);
+    }
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(map);
+    for (i = 0; i < 4; i++)
+    {
+        amqpvalue_destroy(keys[i]);
+    }
+}
+
+/* Tests_SRS_AMQPVALUE_01_468: [If value is NULL or is not a map, amqpvalue_reserve_map shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_reserve_map_with_NULL_value_fails)
+{
+    // arrange
+    int result;
+
+    // act
+    result = amqpvalue_reserve_map(NULL, 4);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_469: [If allocating memory fails, amqpvalue_reserve_map shall fail and return a non-zero value, leaving the map unaltered.] */
+TEST_FUNCTION(when_reallocating_fails_amqpvalue_reserve_map_fails)
+{
+    // arrange
+    int result;
+    AMQP_VALUE map = amqpvalue_create_map();
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = amqpvalue_reserve_map(map, 4);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(map);
+}
+
 /* amqpvalue_set_map_value */
 
 /* Tests_SRS_AMQPVALUE_01_181: [amqpvalue_set_map_value shall set the value in the map identified by the map argument for a key/value pair identified by the key argument.] */
@@ -4302,6 +4491,133 @@ TEST_FUNCTION(amqpvalue_get_map_value_for_a_non_map_value_fails)
     amqpvalue_destroy(key);
 }
 
+/* Tests_SRS_AMQPVALUE_01_460: [Once a map holds more than 8 pairs, amqpvalue_set_map_value and amqpvalue_get_map_value shall look up keys through a hash index, built the first time it is needed.] */
+TEST_FUNCTION(amqpvalue_get_map_value_finds_every_key_of_a_large_map)
+{
+    // arrange
+    AMQP_VALUE map = amqpvalue_create_map();
+    uint32_t i;
+    for (i = 0; i < 40; i++)
+    {
+        AMQP_VALUE key = amqpvalue_create_uint(i);
+        AMQP_VALUE value = amqpvalue_create_uint(i + 100);
+        (void)amqpvalue_set_map_value(map, key, value);
+        amqpvalue_destroy(key);
+        amqpvalue_destroy(value);
+    }
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    for (i = 0; i < 40; i++)
+    {
+        uint32_t uint_value;
+        AMQP_VALUE key = amqpvalue_create_uint(i);
+        AMQP_VALUE result = amqpvalue_get_map_value(map, key);
+
+        // assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_uint(result, &uint_value));
+        ASSERT_ARE_EQUAL(uint32_t, i + 100, uint_value);
+
+        amqpvalue_destroy(key);
+        amqpvalue_destroy(result);
+    }
+
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(map);
+}
+
+/* Tests_SRS_AMQPVALUE_01_461: [If allocating the hash index fails, the map shall be searched linearly.] */
+TEST_FUNCTION(when_allocating_the_map_index_fails_amqpvalue_get_map_value_still_finds_the_key)
+{
+    // arrange
+    AMQP_VALUE result;
+    AMQP_VALUE map = amqpvalue_create_map();
+    AMQP_VALUE key = amqpvalue_create_uint(8);
+    uint32_t i;
+    for (i = 0; i < 9; i++)
+    {
+        AMQP_VALUE item = amqpvalue_create_uint(i);
+        (void)amqpvalue_set_map_value(map, item, item);
+        amqpvalue_destroy(item);
+    }
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = amqpvalue_get_map_value(map, key);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_IS_TRUE(amqpvalue_are_equal(key, result));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(map);
+    amqpvalue_destroy(key);
+    amqpvalue_destroy(result);
+}
+
+/* Tests_SRS_AMQPVALUE_01_184: [If the key already exists in the map, its value shall be replaced with the value provided by the value argument.] */
+/* Tests_SRS_AMQPVALUE_01_462: [The hash index shall not change the order of the key/value pairs.] */
+TEST_FUNCTION(amqpvalue_set_map_value_replacing_a_value_in_a_large_map_keeps_the_pair_order)
+{
+    // arrange
+    int result;
+    uint32_t pair_count;
+    uint32_t uint_value;
+    AMQP_VALUE pair_key;
+    AMQP_VALUE pair_value;
+    AMQP_VALUE map = amqpvalue_create_map();
+    AMQP_VALUE key = amqpvalue_create_symbol("key5");
+    AMQP_VALUE value = amqpvalue_create_uint(42);
+    uint32_t i;
+    for (i = 0; i < 20; i++)
+    {
+        char key_chars[8];
+        AMQP_VALUE item_key;
+        AMQP_VALUE item_value = amqpvalue_create_uint(i);
+        (void)sprintf(key_chars, "key%u", (unsigned int)i);
+        item_key = amqpvalue_create_symbol(key_chars);
+        (void)amqpvalue_set_map_value(map, item_key, item_value);
+        amqpvalue_destroy(item_key);
+        amqpvalue_destroy(item_value);
+    }
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_set_map_value(map, key, value);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_map_pair_count(map, &pair_count));
+    ASSERT_ARE_EQUAL(uint32_t, 20, pair_count);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_map_key_value_pair(map, 5, &pair_key, &pair_value));
+    ASSERT_IS_TRUE(amqpvalue_are_equal(key, pair_key));
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_uint(pair_value, &uint_value));
+    ASSERT_ARE_EQUAL(uint32_t, 42, uint_value);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(pair_key);
+    amqpvalue_destroy(pair_value);
+    amqpvalue_destroy(map);
+    amqpvalue_destroy(key);
+    amqpvalue_destroy(value);
+}
+
 /* amqpvalue_get_map_pair_count */
 
 /* Tests_SRS_AMQPVALUE_01_193: [amqpvalue_get_map_pair_count shall fill in the number of key/value pairs in the map in the pair_count argument.] */
@@ -4774,45 +5090,120 @@ TEST_FUNCTION(amqpvalue_get_array_item_count_on_a_non_array_type_fails)
     amqpvalue_destroy(null_value);
 }
 
-/* amqpvalue_add_array_item */
+/* amqpvalue_reserve_array */
 
-/* Tests_SRS_AMQPVALUE_01_407: [ `amqpvalue_add_array_item` shall add the AMQP_VALUE specified by `array_item_value` at the 0 based n-th position in the array. ]*/
-/* Tests_SRS_AMQPVALUE_01_408: [ On success `amqpvalue_add_array_item` shall return 0. ]*/
-/* Tests_SRS_AMQPVALUE_01_410: [ The item stored at the n-th position in the array shall be a clone of `array_item_value`. ] */
-TEST_FUNCTION(amqpvalue_add_array_item_on_an_empty_array_succeeds)
+/* Tests_SRS_AMQPVALUE_01_471: [amqpvalue_reserve_array shall allocate storage for at least capacity items, without changing the items already in the array.] */
+/* Tests_SRS_AMQPVALUE_01_474: [On success amqpvalue_reserve_array shall return 0.] */
+TEST_FUNCTION(amqpvalue_reserve_array_allocates_the_items_once)
 {
     // arrange
     int result;
+    uint32_t i;
+    uint32_t item_count;
     AMQP_VALUE array = amqpvalue_create_array();
-    AMQP_VALUE null_value = amqpvalue_create_null();
+    AMQP_VALUE item = amqpvalue_create_uint(42);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, 100 * sizeof(AMQP_VALUE)));
 
     // act
-    result = amqpvalue_add_array_item(array, null_value);
+    result = amqpvalue_reserve_array(array, 100);
+    for (i = 0; i < 100; i++)
+    {
+        (void)amqpvalue_add_array_item(array, item);
+    }
 
     // assert
     ASSERT_ARE_EQUAL(int, 0, result);
+    (void)amqpvalue_get_array_item_count(array, &item_count);
+    ASSERT_ARE_EQUAL(uint32_t, 100, item_count);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     // cleanup
     amqpvalue_destroy(array);
-    amqpvalue_destroy(null_value);
+    amqpvalue_destroy(item);
 }
 
-/* Codes_SRS_AMQPVALUE_01_172: [If growing the array fails, then amqpvalue_add_array_item shall fail and return a non-zero value.] */
-TEST_FUNCTION(when_reallocating_the_array_fails_amqpvalue_add_array_item_fails_too)
+/* Tests_SRS_AMQPVALUE_01_472: [If value is NULL or is not an array, amqpvalue_reserve_array shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_reserve_array_on_a_list_fails)
 {
     // arrange
     int result;
-    AMQP_VALUE array = amqpvalue_create_array();
-    AMQP_VALUE null_value = amqpvalue_create_null();
+    AMQP_VALUE list = amqpvalue_create_list();
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-        .SetReturn(NULL);
-
+    // act
+    result = amqpvalue_reserve_array(list, 100);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(list);
+}
+
+/* Tests_SRS_AMQPVALUE_01_473: [If allocating memory fails, amqpvalue_reserve_array shall fail and return a non-zero value, leaving the array unaltered.] */
+TEST_FUNCTION(when_reallocating_fails_amqpvalue_reserve_array_fails)
+{
+    // arrange
+    int result;
+    AMQP_VALUE array = amqpvalue_create_array();
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = amqpvalue_reserve_array(array, 100);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(array);
+}
+
+/* amqpvalue_add_array_item */
+
+/* Tests_SRS_AMQPVALUE_01_407: [ `amqpvalue_add_array_item` shall add the AMQP_VALUE specified by `array_item_value` at the 0 based n-th position in the array. ]*/
+/* Tests_SRS_AMQPVALUE_01_408: [ On success `amqpvalue_add_array_item` shall return 0. ]*/
+/* Tests_SRS_AMQPVALUE_01_410: [ The item stored at the n-th position in the array shall be a clone of `array_item_value`. ] */
+TEST_FUNCTION(amqpvalue_add_array_item_on_an_empty_array_succeeds)
+{
+    // arrange
+    int result;
+    AMQP_VALUE array = amqpvalue_create_array();
+    AMQP_VALUE null_value = amqpvalue_create_null();
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+    // act
+    result = amqpvalue_add_array_item(array, null_value);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(array);
+    amqpvalue_destroy(null_value);
+}
+
+/* Codes_SRS_AMQPVALUE_01_172: [If growing the array fails, then amqpvalue_add_array_item shall fail and return a non-zero value.] */
+TEST_FUNCTION(when_reallocating_the_array_fails_amqpvalue_add_array_item_fails_too)
+{
+    // arrange
+    int result;
+    AMQP_VALUE array = amqpvalue_create_array();
+    AMQP_VALUE null_value = amqpvalue_create_null();
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
     // act
     result = amqpvalue_add_array_item(array, null_value);
 
@@ -4936,6 +5327,38 @@ TEST_FUNCTION(amqpvalue_add_array_item_on_a_non_array_item_fails)
     amqpvalue_destroy(value_1);
 }
 
+/* Tests_SRS_AMQPVALUE_01_407: [ `amqpvalue_add_array_item` shall add the AMQP_VALUE specified by `array_item_value` at the 0 based n-th position in the array. ]*/
+TEST_FUNCTION(adding_items_one_by_one_grows_the_array_geometrically)
+{
+    // arrange
+    uint32_t i;
+    uint32_t item_count;
+    AMQP_VALUE array = amqpvalue_create_array();
+    AMQP_VALUE item = amqpvalue_create_uint(42);
+    umock_c_reset_all_calls();
+
+    /* 1, 2, 4, 8, 16, 32, 64 and 128 items */
+    for (i = 0; i < 8; i++)
+    {
+        STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    }
+
+    // act
+    for (i = 0; i < 100; i++)
+    {
+        (void)amqpvalue_add_array_item(array, item);
+    }
+
+    // assert
+    (void)amqpvalue_get_array_item_count(array, &item_count);
+    ASSERT_ARE_EQUAL(uint32_t, 100, item_count);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(array);
+    amqpvalue_destroy(item);
+}
+
 /* amqpvalue_get_array_item */
 
 /* Tests_SRS_AMQPVALUE_01_414: [ `amqpvalue_get_array_item` shall return a copy of the AMQP_VALUE stored at the 0 based position `index` in the array identified by `value`. ] */
@@ -9506,6 +9929,198 @@ TEST_FUNCTION(amqpvalue_encode_array_with_2_different_items_fails)
     test_amqpvalue_encode_failure(source);
 }
 
+/* Tests_SRS_AMQPVALUE_01_475: [amqpvalue_encode shall compute the sizes of all lists, maps and arrays contained in value in a single pass before producing any output.] */
+/* Tests_SRS_AMQPVALUE_01_477: [amqpvalue_encode shall then write the encoded bytes in a second pass that uses the computed sizes and does not size any value again.] */
+TEST_FUNCTION(amqpvalue_encode_array_with_an_array_of_one_ubyte_succeeds)
+{
+    AMQP_VALUE source = amqpvalue_create_array();
+    AMQP_VALUE inner_array = amqpvalue_create_array();
+    AMQP_VALUE item = amqpvalue_create_ubyte(0x1B);
+    amqpvalue_add_array_item(inner_array, item);
+    amqpvalue_destroy(item);
+    amqpvalue_add_array_item(source, inner_array);
+    amqpvalue_destroy(inner_array);
+    test_amqpvalue_encode(source, "[0xE0,0x0C,0x01,0xF0,0x00,0x00,0x00,0x05,0x00,0x00,0x00,0x01,0x50,0x1B]");
+}
+
+static AMQP_VALUE create_nested_lists(size_t depth)
+{
+    AMQP_VALUE result = amqpvalue_create_list();
+    size_t i;
+
+    for (i = 0; i < depth; i++)
+    {
+        AMQP_VALUE outer_list = amqpvalue_create_list();
+        (void)amqpvalue_set_list_item_count(outer_list, 1);
+        (void)amqpvalue_set_list_item(outer_list, 0, result);
+        amqpvalue_destroy(result);
+        result = outer_list;
+    }
+
+    return result;
+}
+
+/* Tests_SRS_AMQPVALUE_01_475: [amqpvalue_encode shall compute the sizes of all lists, maps and arrays contained in value in a single pass before producing any output.] */
+/* Tests_SRS_AMQPVALUE_01_477: [amqpvalue_encode shall then write the encoded bytes in a second pass that uses the computed sizes and does not size any value again.] */
+TEST_FUNCTION(amqpvalue_encode_20_nested_lists_succeeds)
+{
+    // arrange
+    int result;
+    size_t i;
+    AMQP_VALUE source = create_nested_lists(20);
+    unsigned char expected_bytes[61];
+    for (i = 0; i < 20; i++)
+    {
+        expected_bytes[i * 3] = 0xC0;
+        expected_bytes[(i * 3) + 1] = (unsigned char)(59 - (i * 3));
+        expected_bytes[(i * 3) + 2] = 0x01;
+    }
+    expected_bytes[60] = 0x45;
+    stringify_bytes(expected_bytes, sizeof(expected_bytes), expected_stringified);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(test_encoder_output(NULL, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(test_encoder_output(NULL, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    result = amqpvalue_encode(source, test_encoder_output, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    stringify_bytes(encoded_bytes, encoded_byte_count, actual_stringified);
+    ASSERT_ARE_EQUAL(char_ptr, expected_stringified, actual_stringified);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(source);
+}
+
+/* Tests_SRS_AMQPVALUE_01_476: [If computing the sizes fails, amqpvalue_encode shall fail and return a non-zero value without calling encoder_output.] */
+TEST_FUNCTION(when_growing_the_size_cache_fails_amqpvalue_encode_fails)
+{
+    // arrange
+    int result;
+    AMQP_VALUE source = create_nested_lists(20);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = amqpvalue_encode(source, test_encoder_output, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(source);
+}
+
+/* amqpvalue_encode_to_payload */
+
+/* Tests_SRS_AMQPVALUE_01_479: [If value or payload is NULL, amqpvalue_encode_to_payload shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_encode_to_payload_with_NULL_value_fails)
+{
+    // arrange
+    int result;
+    PAYLOAD* payload = payload_create();
+
+    // act
+    result = amqpvalue_encode_to_payload(NULL, payload);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(payload_is_empty(payload));
+
+    // cleanup
+    payload_destroy(&payload);
+}
+
+/* Tests_SRS_AMQPVALUE_01_479: [If value or payload is NULL, amqpvalue_encode_to_payload shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_encode_to_payload_with_NULL_payload_fails)
+{
+    // arrange
+    int result;
+    AMQP_VALUE source = amqpvalue_create_null();
+    umock_c_reset_all_calls();
+
+    // act
+    result = amqpvalue_encode_to_payload(source, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(source);
+}
+
+/* Tests_SRS_AMQPVALUE_01_478: [amqpvalue_encode_to_payload shall encode value per the ISO and append the encoded bytes to payload.] */
+/* Tests_SRS_AMQPVALUE_01_480: [If the spare capacity at the end of payload is smaller than the encoded size of value, amqpvalue_encode_to_payload shall reserve the encoded size of value in payload before writing to it.] */
+/* Tests_SRS_AMQPVALUE_01_481: [amqpvalue_encode_to_payload shall append the encoded bytes to payload without creating a payload for each encoded field.] */
+/* Tests_SRS_AMQPVALUE_01_483: [On success amqpvalue_encode_to_payload shall return 0.] */
+TEST_FUNCTION(amqpvalue_encode_to_payload_appends_the_encoded_list_as_one_part)
+{
+    // arrange
+    int result;
+    unsigned char* actual_bytes;
+    size_t actual_length;
+    AMQP_VALUE source = amqpvalue_create_list();
+    AMQP_VALUE item = amqpvalue_create_uint(0x42);
+    PAYLOAD* payload = payload_create();
+    (void)amqpvalue_set_list_item_count(source, 2);
+    (void)amqpvalue_set_list_item(source, 0, item);
+    (void)amqpvalue_set_list_item(source, 1, item);
+    amqpvalue_destroy(item);
+    umock_c_reset_all_calls();
+
+    // act
+    result = amqpvalue_encode_to_payload(source, payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, payload_get_parts(payload));
+    actual_length = payload_stream_to_heap(payload, &actual_bytes);
+    stringify_bytes(actual_bytes, actual_length, actual_stringified);
+    ASSERT_ARE_EQUAL(char_ptr, "[0xC0,0x05,0x02,0x52,0x42,0x52,0x42]", actual_stringified);
+
+    // cleanup
+    free(actual_bytes);
+    payload_destroy(&payload);
+    amqpvalue_destroy(source);
+}
+
+/* Tests_SRS_AMQPVALUE_01_482: [If any error occurs, amqpvalue_encode_to_payload shall fail and return a non-zero value.] */
+TEST_FUNCTION(when_growing_the_size_cache_fails_amqpvalue_encode_to_payload_fails)
+{
+    // arrange
+    int result;
+    AMQP_VALUE source = create_nested_lists(20);
+    PAYLOAD* payload = payload_create();
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = amqpvalue_encode_to_payload(source, payload);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(payload_is_empty(payload));
+
+    // cleanup
+    payload_destroy(&payload);
+    amqpvalue_destroy(source);
+}
+
 /* amqpvalue_get_encoded_size */
 
 /* Tests_SRS_AMQPVALUE_01_309: [If any argument is NULL, amqpvalue_get_encoded_size shall return a non-zero value.] */
@@ -10136,6 +10751,15 @@ TEST_FUNCTION(amqpvalue_get_encoded_size_with_array_value_with_255_null_items_su
     test_amqpvalue_get_encoded_size(source, 4);
 }
 
+/* Tests_SRS_AMQPVALUE_01_308: [amqpvalue_get_encoded_size shall fill in the encoded_size argument the number of bytes required to encode the given AMQP value.] */
+/* Tests_SRS_AMQPVALUE_01_485: [amqpvalue_get_encoded_size shall compute the encoded size from the types and lengths of value and its items, without encoding value and without allocating memory.] */
+TEST_FUNCTION(amqpvalue_get_encoded_size_with_20_nested_lists_does_not_allocate)
+{
+    // arrange
+    AMQP_VALUE source = create_nested_lists(20);
+    test_amqpvalue_get_encoded_size(source, 61);
+}
+
 /* amqpvalue_destroy */
 
 /* Tests_SRS_AMQPVALUE_01_315: [If the value argument is NULL, amqpvalue_destroy shall do nothing.] */
@@ -16528,4 +17152,662 @@ TEST_FUNCTION(amqpvalue_decode_array_0xF0_256_null_items_succeeds)
     amqpvalue_decoder_destroy(amqpvalue_decoder);
 }
 
+
+/* amqpvalue_decode_buffer */
+
+/* Tests_SRS_AMQPVALUE_01_434: [If buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_with_NULL_buffer_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+
+    // act
+    result = amqpvalue_decode_buffer(NULL, 1, &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_434: [If buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_with_0_size_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0x40 };
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, 0, &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_434: [If buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_with_NULL_value_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    unsigned char bytes[] = { 0x40 };
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), NULL, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_434: [If buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_with_NULL_used_bytes_fails)
+{
+    // arrange
+    int result;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0x40 };
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), &value, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_435: [amqpvalue_decode_buffer shall decode the first AMQP value encoded in buffer and return it in value.] */
+/* Tests_SRS_AMQPVALUE_01_436: [The number of bytes taken by the value shall be returned in used_bytes.] */
+/* Tests_SRS_AMQPVALUE_01_438: [On success, amqpvalue_decode_buffer shall return 0.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_decodes_a_null_value)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0x40, 0x40 };
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, used_bytes);
+    ASSERT_ARE_EQUAL(int, (int)AMQP_TYPE_NULL, (int)amqpvalue_get_type(value));
+
+    // cleanup
+    amqpvalue_destroy(value);
+}
+
+/* Tests_SRS_AMQPVALUE_01_435: [amqpvalue_decode_buffer shall decode the first AMQP value encoded in buffer and return it in value.] */
+/* Tests_SRS_AMQPVALUE_01_436: [The number of bytes taken by the value shall be returned in used_bytes.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_decodes_a_str8_value)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    const char* string_value;
+    unsigned char bytes[] = { 0xA1, 0x02, 'a', 'b', 0x40 };
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 4, used_bytes);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_string(value, &string_value));
+    ASSERT_ARE_EQUAL(char_ptr, "ab", string_value);
+
+    // cleanup
+    amqpvalue_destroy(value);
+}
+
+/* Tests_SRS_AMQPVALUE_01_435: [amqpvalue_decode_buffer shall decode the first AMQP value encoded in buffer and return it in value.] */
+/* Tests_SRS_AMQPVALUE_01_436: [The number of bytes taken by the value shall be returned in used_bytes.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_decodes_a_described_list)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    uint32_t item_count;
+    uint64_t descriptor_value;
+    uint32_t uint_value;
+    unsigned char bytes[] = { 0x00, 0x53, 0x10, 0xC0, 0x04, 0x02, 0x52, 0x2A, 0x40 };
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, sizeof(bytes), used_bytes);
+    ASSERT_ARE_EQUAL(int, (int)AMQP_TYPE_DESCRIBED, (int)amqpvalue_get_type(value));
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_ulong(amqpvalue_get_inplace_descriptor(value), &descriptor_value));
+    ASSERT_ARE_EQUAL(uint64_t, 0x10, descriptor_value);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_list_item_count(amqpvalue_get_inplace_described_value(value), &item_count));
+    ASSERT_ARE_EQUAL(uint32_t, 2, item_count);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_uint(amqpvalue_get_list_item_in_place(amqpvalue_get_inplace_described_value(value), 0), &uint_value));
+    ASSERT_ARE_EQUAL(uint32_t, 42, uint_value);
+    ASSERT_ARE_EQUAL(int, (int)AMQP_TYPE_NULL, (int)amqpvalue_get_type(amqpvalue_get_list_item_in_place(amqpvalue_get_inplace_described_value(value), 1)));
+
+    // cleanup
+    amqpvalue_destroy(value);
+}
+
+/* Tests_SRS_AMQPVALUE_01_437: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_with_a_truncated_list_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0xC0, 0x04, 0x02, 0x52, 0x2A };
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_437: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_with_a_list_count_larger_than_its_size_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0xC0, 0x02, 0x05, 0x40 };
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_437: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer shall fail and return a non-zero value.] */
+TEST_FUNCTION(when_allocating_the_value_fails_amqpvalue_decode_buffer_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0x40 };
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = amqpvalue_decode_buffer(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* amqpvalue_decode_buffer_borrowed */
+
+/* Tests_SRS_AMQPVALUE_01_439: [If buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer_borrowed shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_borrowed_with_NULL_buffer_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+
+    // act
+    result = amqpvalue_decode_buffer_borrowed(NULL, 1, &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_440: [amqpvalue_decode_buffer_borrowed shall decode the first AMQP value encoded in buffer, return it in value and return the number of bytes taken by the value in used_bytes.] */
+/* Tests_SRS_AMQPVALUE_01_441: [Binary values with a non-zero length shall reference their bytes in buffer instead of copying them.] */
+/* Tests_SRS_AMQPVALUE_01_443: [On success, amqpvalue_decode_buffer_borrowed shall return 0.] */
+/* Tests_SRS_AMQPVALUE_01_448: [amqpvalue_get_binary_borrowed shall append to binary_value a reference to the bytes held by the AMQP value, without copying them.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_borrowed_references_binary_bytes_in_the_buffer)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0xA0, 0x03, 0x01, 0x02, 0x03, 0x40 };
+    PAYLOAD* binary_value = payload_create();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_decode_buffer_borrowed(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 5, used_bytes);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_binary_borrowed(value, binary_value));
+    ASSERT_IS_TRUE(payload_has_borrowed_data(binary_value));
+    ASSERT_ARE_EQUAL(size_t, 3, payload_get_length(binary_value));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    payload_destroy(&binary_value);
+    amqpvalue_destroy(value);
+}
+
+/* Tests_SRS_AMQPVALUE_01_442: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer_borrowed shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_borrowed_with_a_truncated_binary_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0xA0, 0x03, 0x01, 0x02 };
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_decode_buffer_borrowed(bytes, sizeof(bytes), &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_444: [If value references bytes it does not own, amqpvalue_clone shall return a new value that holds its own copy of those bytes.] */
+TEST_FUNCTION(amqpvalue_clone_of_a_borrowed_list_copies_the_binary_bytes)
+{
+    // arrange
+    size_t used_bytes;
+    AMQP_VALUE value;
+    AMQP_VALUE cloned_value;
+    unsigned char bytes[] = { 0xC0, 0x06, 0x02, 0xA0, 0x02, 0x01, 0x02, 0x40 };
+    unsigned char expected_bytes[] = { 0x01, 0x02 };
+    PAYLOAD* binary_value = payload_create();
+    PAYLOAD* expected_value = payload_create();
+
+    payload_append_data(expected_value, expected_bytes, sizeof(expected_bytes));
+    (void)amqpvalue_decode_buffer_borrowed(bytes, sizeof(bytes), &value, &used_bytes);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    cloned_value = amqpvalue_clone(value);
+    amqpvalue_destroy(value);
+    (void)memset(bytes, 0, sizeof(bytes));
+
+    // assert
+    ASSERT_IS_NOT_NULL(cloned_value);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_binary_borrowed(amqpvalue_get_list_item_in_place(cloned_value, 0), binary_value));
+    ASSERT_IS_FALSE(payload_has_borrowed_data(binary_value));
+    ASSERT_IS_TRUE(payload_are_equal(expected_value, binary_value));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    payload_destroy(&expected_value);
+    payload_destroy(&binary_value);
+    amqpvalue_destroy(cloned_value);
+}
+
+/* Tests_SRS_AMQPVALUE_01_445: [If copying the borrowed bytes fails, amqpvalue_clone shall fail and return NULL.] */
+TEST_FUNCTION(when_allocating_the_copy_fails_amqpvalue_clone_of_a_borrowed_value_fails)
+{
+    // arrange
+    size_t used_bytes;
+    AMQP_VALUE value;
+    AMQP_VALUE cloned_value;
+    unsigned char bytes[] = { 0xA0, 0x01, 0x42 };
+
+    (void)amqpvalue_decode_buffer_borrowed(bytes, sizeof(bytes), &value, &used_bytes);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    cloned_value = amqpvalue_clone(value);
+
+    // assert
+    ASSERT_IS_NULL(cloned_value);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(value);
+}
+
+/* amqpvalue_get_binary_borrowed */
+
+/* Tests_SRS_AMQPVALUE_01_446: [If any of the arguments is NULL then amqpvalue_get_binary_borrowed shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_get_binary_borrowed_with_NULL_value_fails)
+{
+    // arrange
+    int result;
+    PAYLOAD* binary_value = payload_create();
+
+    // act
+    result = amqpvalue_get_binary_borrowed(NULL, binary_value);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    payload_destroy(&binary_value);
+}
+
+/* Tests_SRS_AMQPVALUE_01_447: [If the type of the value is not binary, then amqpvalue_get_binary_borrowed shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_get_binary_borrowed_on_a_null_value_fails)
+{
+    // arrange
+    int result;
+    PAYLOAD* binary_value = payload_create();
+    AMQP_VALUE value = amqpvalue_create_null();
+    umock_c_reset_all_calls();
+
+    // act
+    result = amqpvalue_get_binary_borrowed(value, binary_value);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    payload_destroy(&binary_value);
+    amqpvalue_destroy(value);
+}
+
+/* amqpvalue_arena_create */
+
+/* Tests_SRS_AMQPVALUE_01_449: [If chunk_size is 0, amqpvalue_arena_create shall fail and return NULL.] */
+TEST_FUNCTION(amqpvalue_arena_create_with_0_chunk_size_fails)
+{
+    // arrange
+    AMQPVALUE_ARENA_HANDLE arena;
+
+    // act
+    arena = amqpvalue_arena_create(0);
+
+    // assert
+    ASSERT_IS_NULL(arena);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_450: [amqpvalue_arena_create shall create an arena that allocates decoded values from chunks of chunk_size bytes and return a non-NULL handle to it.] */
+/* Tests_SRS_AMQPVALUE_01_452: [amqpvalue_arena_create shall not allocate the first chunk, it shall be allocated by the first decode.] */
+TEST_FUNCTION(amqpvalue_arena_create_succeeds)
+{
+    // arrange
+    AMQPVALUE_ARENA_HANDLE arena;
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    arena = amqpvalue_arena_create(1024);
+
+    // assert
+    ASSERT_IS_NOT_NULL(arena);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_arena_destroy(arena);
+}
+
+/* Tests_SRS_AMQPVALUE_01_451: [If allocating memory for the arena fails, amqpvalue_arena_create shall fail and return NULL.] */
+TEST_FUNCTION(when_allocating_memory_fails_amqpvalue_arena_create_fails)
+{
+    // arrange
+    AMQPVALUE_ARENA_HANDLE arena;
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    arena = amqpvalue_arena_create(1024);
+
+    // assert
+    ASSERT_IS_NULL(arena);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* amqpvalue_arena_destroy */
+
+/* Tests_SRS_AMQPVALUE_01_453: [If arena is NULL, amqpvalue_arena_destroy shall do nothing.] */
+TEST_FUNCTION(amqpvalue_arena_destroy_with_NULL_arena_does_nothing)
+{
+    // arrange
+
+    // act
+    amqpvalue_arena_destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_454: [amqpvalue_arena_destroy shall free the arena; chunks that still hold live values shall be freed when the last of those values is destroyed.] */
+TEST_FUNCTION(a_value_decoded_in_an_arena_outlives_the_arena)
+{
+    // arrange
+    size_t used_bytes;
+    uint32_t item_count;
+    uint64_t ulong_value;
+    AMQP_VALUE value;
+    AMQP_VALUE cloned_value;
+    unsigned char bytes[] = { 0xC0, 0x05, 0x02, 0x53, 0x01, 0x53, 0x02 };
+    AMQPVALUE_ARENA_HANDLE arena = amqpvalue_arena_create(1024);
+
+    (void)amqpvalue_decode_buffer_in_arena(arena, bytes, sizeof(bytes), false, &value, &used_bytes);
+    cloned_value = amqpvalue_clone(value);
+    amqpvalue_destroy(value);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    amqpvalue_arena_destroy(arena);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_list_item_count(cloned_value, &item_count));
+    ASSERT_ARE_EQUAL(uint32_t, 2, item_count);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_ulong(amqpvalue_get_list_item_in_place(cloned_value, 1), &ulong_value));
+    ASSERT_ARE_EQUAL(uint64_t, 2, ulong_value);
+
+    // cleanup
+    amqpvalue_destroy(cloned_value);
+}
+
+/* amqpvalue_decode_buffer_in_arena */
+
+/* Tests_SRS_AMQPVALUE_01_455: [If arena, buffer, value or used_bytes is NULL or size is 0, amqpvalue_decode_buffer_in_arena shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_in_arena_with_NULL_arena_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0x40 };
+
+    // act
+    result = amqpvalue_decode_buffer_in_arena(NULL, bytes, sizeof(bytes), false, &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_AMQPVALUE_01_456: [amqpvalue_decode_buffer_in_arena shall decode the first AMQP value encoded in buffer like amqpvalue_decode_buffer, or like amqpvalue_decode_buffer_borrowed when borrow_binaries is true.] */
+/* Tests_SRS_AMQPVALUE_01_457: [The decoded values and the items of decoded lists, maps and arrays shall be allocated from arena.] */
+/* Tests_SRS_AMQPVALUE_01_459: [On success, amqpvalue_decode_buffer_in_arena shall return 0.] */
+TEST_FUNCTION(decoding_again_in_an_arena_reuses_the_chunk_without_allocating)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    uint32_t item_count;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0xC0, 0x05, 0x02, 0x53, 0x01, 0x53, 0x02 };
+    AMQPVALUE_ARENA_HANDLE arena = amqpvalue_arena_create(1024);
+
+    (void)amqpvalue_decode_buffer_in_arena(arena, bytes, sizeof(bytes), false, &value, &used_bytes);
+    amqpvalue_destroy(value);
+    umock_c_reset_all_calls();
+
+    // act
+    result = amqpvalue_decode_buffer_in_arena(arena, bytes, sizeof(bytes), false, &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(bytes), used_bytes);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_list_item_count(value, &item_count));
+    ASSERT_ARE_EQUAL(uint32_t, 2, item_count);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(value);
+    amqpvalue_arena_destroy(arena);
+}
+
+/* Tests_SRS_AMQPVALUE_01_457: [The decoded values and the items of decoded lists, maps and arrays shall be allocated from arena.] */
+TEST_FUNCTION(decoding_again_in_an_arena_does_not_reuse_a_chunk_that_a_kept_value_lives_in)
+{
+    // arrange
+    size_t used_bytes;
+    uint64_t ulong_value;
+    AMQP_VALUE value;
+    AMQP_VALUE kept_value;
+    AMQP_VALUE other_value;
+    unsigned char bytes[] = { 0xC0, 0x05, 0x02, 0x53, 0x01, 0x53, 0x02 };
+    unsigned char other_bytes[] = { 0xC0, 0x05, 0x02, 0x53, 0x03, 0x53, 0x04 };
+    AMQPVALUE_ARENA_HANDLE arena = amqpvalue_arena_create(1024);
+
+    (void)amqpvalue_decode_buffer_in_arena(arena, bytes, sizeof(bytes), false, &value, &used_bytes);
+    kept_value = amqpvalue_clone(value);
+    amqpvalue_destroy(value);
+    umock_c_reset_all_calls();
+
+    // act
+    (void)amqpvalue_decode_buffer_in_arena(arena, other_bytes, sizeof(other_bytes), false, &other_value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_ulong(amqpvalue_get_list_item_in_place(kept_value, 0), &ulong_value));
+    ASSERT_ARE_EQUAL(uint64_t, 1, ulong_value);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_ulong(amqpvalue_get_list_item_in_place(kept_value, 1), &ulong_value));
+    ASSERT_ARE_EQUAL(uint64_t, 2, ulong_value);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_ulong(amqpvalue_get_list_item_in_place(other_value, 1), &ulong_value));
+    ASSERT_ARE_EQUAL(uint64_t, 4, ulong_value);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(kept_value);
+    amqpvalue_destroy(other_value);
+    amqpvalue_arena_destroy(arena);
+}
+
+/* Tests_SRS_AMQPVALUE_01_457: [The decoded values and the items of decoded lists, maps and arrays shall be allocated from arena.] */
+TEST_FUNCTION(a_list_decoded_in_an_arena_can_grow)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    uint32_t item_count;
+    uint64_t ulong_value;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0xC0, 0x05, 0x02, 0x53, 0x01, 0x53, 0x02 };
+    AMQPVALUE_ARENA_HANDLE arena = amqpvalue_arena_create(1024);
+
+    (void)amqpvalue_decode_buffer_in_arena(arena, bytes, sizeof(bytes), false, &value, &used_bytes);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_set_list_item_count(value, 4);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_list_item_count(value, &item_count));
+    ASSERT_ARE_EQUAL(uint32_t, 4, item_count);
+    ASSERT_ARE_EQUAL(int, 0, amqpvalue_get_ulong(amqpvalue_get_list_item_in_place(value, 1), &ulong_value));
+    ASSERT_ARE_EQUAL(uint64_t, 2, ulong_value);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_destroy(value);
+    amqpvalue_arena_destroy(arena);
+}
+
+/* Tests_SRS_AMQPVALUE_01_458: [If the bytes in buffer do not hold a complete and valid AMQP value, or if any allocation fails, amqpvalue_decode_buffer_in_arena shall fail and return a non-zero value.] */
+TEST_FUNCTION(amqpvalue_decode_buffer_in_arena_with_a_truncated_list_fails)
+{
+    // arrange
+    int result;
+    size_t used_bytes;
+    AMQP_VALUE value;
+    unsigned char bytes[] = { 0xC0, 0x05, 0x02, 0x53, 0x01 };
+    AMQPVALUE_ARENA_HANDLE arena = amqpvalue_arena_create(1024);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    result = amqpvalue_decode_buffer_in_arena(arena, bytes, sizeof(bytes), false, &value, &used_bytes);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    amqpvalue_arena_destroy(arena);
+}
+
 END_TEST_SUITE(amqpvalue_ut)
@@ -14,6 +14,8 @@
 #include "testrunnerswitcher.h"
 #include "umock_c/umock_c.h"
 #include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_bool.h"
+#include "umock_c/umocktypes_stdint.h"
 
 static void* my_gballoc_malloc(size_t size)
 {
@@ -45,10 +47,13 @@ static void my_gballoc_free(void* ptr)
 #include "azure_uamqp_c/amqp_frame_codec.h"
 #include "azure_uamqp_c/amqpvalue_to_string.h"
 #include "azure_uamqp_c/amqp_definitions.h"
+#include "azure_uamqp_c/timer_queue.h"
 
 #undef ENABLE_MOCKS
 
 #include "azure_uamqp_c/connection.h"
+#include "azure_uamqp_c/payload.h"
+#include "azure_uamqp_c/xio_sendv.h"
 
 /* Requirements implicitly tested */
 /* Tests_S_R_S_CONNECTION_01_088: [Any data appearing beyond the protocol header MUST match the version indicated by the protocol header.] */
@@ -77,6 +82,10 @@ static void my_gballoc_free(void* ptr)
 #define TEST_TRANSFER_PERFORMATIVE          (AMQP_VALUE)0x4304
 #define TEST_PROPERTIES                     (fields)0x4255
 #define TEST_CLONED_PROPERTIES              (fields)0x4256
+#define TEST_TIMER_QUEUE_HANDLE             (TIMER_QUEUE_HANDLE)0x4257
+#define TEST_OPEN_HANDLE                    (OPEN_HANDLE)0x4306
+#define TEST_OPEN_AMQP_VALUE                (AMQP_VALUE)0x4307
+#define TEST_SENDV_CONTEXT                  (void*)0x4308
 
 #define TEST_CONTEXT                        (void*)(0x4242)
 
@@ -103,6 +112,13 @@ static void* saved_amqp_frame_codec_callback_context;
 static void* saved_on_connection_state_changed_context;
 static CONNECTION_STATE saved_new_connection_state;
 CONNECTION_STATE saved_previous_connection_state;
+static unsigned char sent_bytes[1024];
+static size_t sent_byte_count;
+static tickcounter_ms_t test_current_ms;
+static uint32_t test_remote_max_frame_size;
+static bool test_io_has_sendv;
+static PAYLOAD* test_frame_bytes;
+static bool test_frame_codec_receives_close;
 
 static void stringify_bytes(const unsigned char* bytes, size_t byte_count, char* output_string)
 {
@@ -157,6 +173,12 @@ static int my_frame_codec_receive_bytes(FRAME_CODEC_HANDLE frame_codec, const un
         (void)memcpy(frame_codec_bytes + frame_codec_byte_count, buffer, size);
         frame_codec_byte_count += size;
     }
+    if (test_frame_codec_receives_close)
+    {
+        /* the bytes handed over decode to a CLOSE frame */
+        test_frame_codec_receives_close = false;
+        saved_frame_received_callback(saved_amqp_frame_codec_callback_context, 0, TEST_CLOSE_PERFORMATIVE, NULL, 0);
+    }
     return 0;
 }
 
@@ -211,15 +233,118 @@ const void* my_singlylinkedlist_item_get_value(LIST_ITEM_HANDLE item_handle)
     return (const void*)item_handle;
 }
 
-static void test_on_send_complete(void* context, IO_SEND_RESULT io_send_result)
+static void record_sent_bytes(const void* buffer, size_t size)
+{
+    if (sent_byte_count + size <= sizeof(sent_bytes))
+    {
+        (void)memcpy(sent_bytes + sent_byte_count, buffer, size);
+        sent_byte_count += size;
+    }
+}
+
+static int my_xio_send(XIO_HANDLE xio, const void* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    (void)xio;
+    (void)on_send_complete;
+    (void)callback_context;
+    record_sent_bytes(buffer, size);
+    return 0;
+}
+
+MOCK_FUNCTION_WITH_CODE(, int, test_sendv, void*, sendv_context, const XIO_SEND_BUFFER*, buffers, size_t, buffer_count)
+    size_t i;
+    for (i = 0; i < buffer_count; i++)
+    {
+        record_sent_bytes(buffers[i].buffer, buffers[i].size);
+    }
+MOCK_FUNCTION_END(0)
+
+static int my_xio_setoption(XIO_HANDLE xio, const char* optionName, const void* value)
+{
+    int result;
+    (void)xio;
+
+    if (test_io_has_sendv &&
+        (strcmp(optionName, OPTION_XIO_SENDV) == 0))
+    {
+        XIO_SENDV_QUERY* sendv_query = (XIO_SENDV_QUERY*)value;
+        sendv_query->sendv = test_sendv;
+        sendv_query->sendv_context = TEST_SENDV_CONTEXT;
+        result = 0;
+    }
+    else
+    {
+        result = MU_FAILURE;
+    }
+
+    return result;
+}
+
+static int my_tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, tickcounter_ms_t* current_ms)
+{
+    (void)tick_counter;
+    *current_ms = test_current_ms;
+    return 0;
+}
+
+static int my_timer_queue_get_time_to_next_deadline(TIMER_QUEUE_HANDLE timer_queue, tickcounter_ms_t* time_to_next_deadline)
+{
+    (void)timer_queue;
+    *time_to_next_deadline = 1000;
+    return 0;
+}
+
+/* the frame codec hands test_frame_bytes back as the encoded frame */
+static int my_amqp_frame_codec_encode_frame(AMQP_FRAME_CODEC_HANDLE amqp_frame_codec, uint16_t channel, AMQP_VALUE performative, PAYLOAD* payloads, ON_BYTES_ENCODED on_bytes_encoded, void* callback_context)
+{
+    (void)amqp_frame_codec;
+    (void)channel;
+    (void)performative;
+    (void)payloads;
+    if (test_frame_bytes != NULL)
+    {
+        on_bytes_encoded(callback_context, test_frame_bytes, true);
+    }
+    return 0;
+}
+
+static AMQP_VALUE my_amqpvalue_get_inplace_descriptor(AMQP_VALUE value)
+{
+    return value;
+}
+
+static bool my_is_open_type_by_descriptor(AMQP_VALUE descriptor)
+{
+    return (descriptor == TEST_OPEN_PERFORMATIVE);
+}
+
+static bool my_is_close_type_by_descriptor(AMQP_VALUE descriptor)
+{
+    return (descriptor == TEST_CLOSE_PERFORMATIVE);
+}
+
+static int my_amqpvalue_get_open(AMQP_VALUE value, OPEN_HANDLE* open_handle)
 {
-    (void)context;
-    (void)io_send_result;
+    (void)value;
+    *open_handle = TEST_OPEN_HANDLE;
+    return 0;
+}
+
+static int my_open_get_max_frame_size(OPEN_HANDLE open, uint32_t* max_frame_size)
+{
+    (void)open;
+    *max_frame_size = test_remote_max_frame_size;
+    return 0;
 }
 
+MOCK_FUNCTION_WITH_CODE(, void, test_on_send_complete, void*, context, IO_SEND_RESULT, send_result)
+MOCK_FUNCTION_END()
+
 static TEST_MUTEX_HANDLE g_testByTest;
 
 MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+TEST_DEFINE_ENUM_TYPE(IO_SEND_RESULT, IO_SEND_RESULT_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(IO_SEND_RESULT, IO_SEND_RESULT_VALUES);
 
 static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
 {
@@ -239,6 +364,10 @@ TEST_SUITE_INITIALIZE(suite_init)
 
     result = umocktypes_charptr_register_types();
     ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_bool_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, my_gballoc_calloc);
@@ -247,15 +376,16 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_RETURN(xio_create, TEST_IO_HANDLE);
     REGISTER_GLOBAL_MOCK_HOOK(xio_open, my_xio_open);
     REGISTER_GLOBAL_MOCK_RETURN(xio_close, 0);
-    REGISTER_GLOBAL_MOCK_RETURN(xio_send, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(xio_send, my_xio_send);
+    REGISTER_GLOBAL_MOCK_HOOK(xio_setoption, my_xio_setoption);
     REGISTER_GLOBAL_MOCK_HOOK(frame_codec_receive_bytes, my_frame_codec_receive_bytes);
     REGISTER_GLOBAL_MOCK_RETURN(frame_codec_create, TEST_FRAME_CODEC_HANDLE);
     REGISTER_GLOBAL_MOCK_RETURN(frame_codec_set_max_frame_size, 0);
     REGISTER_GLOBAL_MOCK_HOOK(amqp_frame_codec_create, my_amqp_frame_codec_create);
-    REGISTER_GLOBAL_MOCK_RETURN(amqp_frame_codec_encode_frame, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(amqp_frame_codec_encode_frame, my_amqp_frame_codec_encode_frame);
     REGISTER_GLOBAL_MOCK_RETURN(amqp_frame_codec_encode_empty_frame, 0);
     REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_ulong, my_amqpvalue_get_ulong);
-    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_inplace_descriptor, TEST_DESCRIPTOR_AMQP_VALUE);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_inplace_descriptor, my_amqpvalue_get_inplace_descriptor);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_string, 0);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_list_item, TEST_LIST_ITEM_AMQP_VALUE);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_inplace_described_value, TEST_DESCRIBED_AMQP_VALUE);
@@ -265,7 +395,15 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_HOOK(singlylinkedlist_find, my_singlylinkedlist_find);
     REGISTER_GLOBAL_MOCK_HOOK(singlylinkedlist_item_get_value, my_singlylinkedlist_item_get_value);
     REGISTER_GLOBAL_MOCK_RETURN(tickcounter_create, test_tick_counter);
-    REGISTER_GLOBAL_MOCK_RETURN(tickcounter_get_current_ms, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_get_current_ms, my_tickcounter_get_current_ms);
+    REGISTER_GLOBAL_MOCK_RETURN(timer_queue_create, TEST_TIMER_QUEUE_HANDLE);
+    REGISTER_GLOBAL_MOCK_HOOK(timer_queue_get_time_to_next_deadline, my_timer_queue_get_time_to_next_deadline);
+    REGISTER_GLOBAL_MOCK_RETURN(open_create, TEST_OPEN_HANDLE);
+    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_open, TEST_OPEN_AMQP_VALUE);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_open, my_amqpvalue_get_open);
+    REGISTER_GLOBAL_MOCK_HOOK(open_get_max_frame_size, my_open_get_max_frame_size);
+    REGISTER_GLOBAL_MOCK_HOOK(is_open_type_by_descriptor, my_is_open_type_by_descriptor);
+    REGISTER_GLOBAL_MOCK_HOOK(is_close_type_by_descriptor, my_is_close_type_by_descriptor);
     REGISTER_GLOBAL_MOCK_RETURN(fields_clone, TEST_CLONED_PROPERTIES);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_clone, TEST_CLONED_PROPERTIES);
 
@@ -279,6 +417,22 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(AMQP_FRAME_CODEC_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(XIO_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TIMER_QUEUE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_TIMER_EXPIRED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_IO_OPEN_COMPLETE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_BYTES_RECEIVED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_IO_ERROR, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_IO_CLOSE_COMPLETE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_SEND_COMPLETE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_BYTES_ENCODED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PAYLOAD*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(OPEN_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(CLOSE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ERROR_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(CONNECTION_STATE, int);
+    REGISTER_UMOCK_ALIAS_TYPE(const XIO_SEND_BUFFER*, void*);
+
+    REGISTER_TYPE(IO_SEND_RESULT, IO_SEND_RESULT);
 }
 
 TEST_SUITE_CLEANUP(suite_cleanup)
@@ -300,6 +454,12 @@ TEST_FUNCTION_INITIALIZE(method_init)
     frame_codec_bytes = NULL;
     frame_codec_byte_count = 0;
     performative_ulong = 0x10;
+    sent_byte_count = 0;
+    test_current_ms = 0;
+    test_remote_max_frame_size = 512;
+    test_io_has_sendv = false;
+    test_frame_bytes = NULL;
+    test_frame_codec_receives_close = false;
 }
 
 TEST_FUNCTION_CLEANUP(method_cleanup)
@@ -1608,9 +1768,7 @@ TEST_FUNCTION(when_2_bytes_are_received_from_the_io_it_is_passed_to_the_frame_co
     saved_on_bytes_received(saved_on_bytes_received_context, amqp_header, sizeof(amqp_header));
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(frame_codec_receive_bytes(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG));
-    STRICT_EXPECTED_CALL(frame_codec_receive_bytes(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-        .IgnoreAllCalls();
+    STRICT_EXPECTED_CALL(frame_codec_receive_bytes(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, 2));
 
     // act
     unsigned char bytes[] = { 42, 43 };
@@ -1882,6 +2040,27 @@ TEST_FUNCTION(when_one_extra_byte_is_received_with_the_header_the_extra_byte_is_
     connection_destroy(connection);
 }
 
+/* Tests_S_R_S_CONNECTION_01_212: [After the initial handshake has been done all bytes received from the io instance shall be passed to the frame_codec for decoding by calling frame_codec_receive_bytes.] */
+TEST_FUNCTION(when_frame_bytes_are_received_with_the_header_they_are_passed_to_the_frame_codec_in_one_call)
+{
+    // arrange
+    CONNECTION_HANDLE connection = connection_create(TEST_IO_HANDLE, NULL, "1234");
+    connection_dowork(connection);
+    saved_io_state_changed(saved_on_io_open_complete_context, IO_STATE_OPEN, IO_STATE_NOT_OPEN);
+    const unsigned char in_bytes[] = { 'A', 'M', 'Q', 'P', 0, 1, 0, 0, 42, 43, 44, 45 };
+
+    // act
+    saved_on_bytes_received(saved_on_bytes_received_context, in_bytes, sizeof(in_bytes));
+
+    // assert
+    stringify_bytes(&in_bytes[8], 4, expected_stringified_io);
+    stringify_bytes(frame_codec_bytes, frame_codec_byte_count, actual_stringified_io);
+    ASSERT_ARE_EQUAL(char_ptr, expected_stringified_io, actual_stringified_io);
+
+    // cleanup
+    connection_destroy(connection);
+}
+
 /* Tests_S_R_S_CONNECTION_01_143: [If any of the values in the received open frame are invalid then the connection shall be closed.] */
 /* Tests_S_R_S_CONNECTION_01_220: [The error amqp:invalid-field shall be set in the error.condition field of the CLOSE frame.] */
 TEST_FUNCTION(when_an_open_frame_that_cannot_be_parsed_properly_is_received_the_connection_is_closed)
@@ -3494,6 +3673,9 @@ TEST_FUNCTION(connection_create2_with_valid_args_succeeds)
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(tickcounter_create());
+    STRICT_EXPECTED_CALL(timer_queue_create(test_tick_counter));
+    STRICT_EXPECTED_CALL(timer_init(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(timer_init(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
 
     // act
@@ -3507,6 +3689,34 @@ TEST_FUNCTION(connection_create2_with_valid_args_succeeds)
     connection_destroy(connection);
 }
 
+/* Tests_S_R_S_CONNECTION_01_310: [If timer_queue_create fails, connection_create shall return NULL.] */
+TEST_FUNCTION(when_timer_queue_create_fails_connection_create2_fails)
+{
+    // arrange
+    CONNECTION_HANDLE connection;
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(frame_codec_create(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqp_frame_codec_create(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_create());
+    STRICT_EXPECTED_CALL(timer_queue_create(test_tick_counter))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(tickcounter_destroy(test_tick_counter));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqp_frame_codec_destroy(TEST_AMQP_FRAME_CODEC_HANDLE));
+    STRICT_EXPECTED_CALL(frame_codec_destroy(TEST_FRAME_CODEC_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    connection = connection_create2(TEST_IO_HANDLE, "testhost", test_container_id, NULL, NULL, NULL, TEST_IO_HANDLE, TEST_on_io_error, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NULL(connection);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
 /* Tests_S_R_S_CONNECTION_07_002: [If connection is NULL then connection_set_trace shall do nothing.] */
 TEST_FUNCTION(connection_set_trace_connection_NULL_fail)
 {
@@ -3685,4 +3895,959 @@ TEST_FUNCTION(connection_unsubscribe_on_connection_close_received_with_NULL_even
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
+/* connection_get_timer_queue */
+
+/* Tests_S_R_S_CONNECTION_01_317: [If connection is NULL, connection_get_timer_queue shall return NULL.] */
+TEST_FUNCTION(connection_get_timer_queue_with_NULL_connection_returns_NULL)
+{
+    // arrange
+
+    // act
+    TIMER_QUEUE_HANDLE result = connection_get_timer_queue(NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_CONNECTION_01_309: [connection_create shall create a timer queue that reads the time from the connection tick counter by calling timer_queue_create.] */
+/* Tests_S_R_S_CONNECTION_01_316: [connection_get_timer_queue shall return the timer queue of the connection, on which timers are expired by connection_dowork.] */
+TEST_FUNCTION(connection_get_timer_queue_returns_the_timer_queue_created_with_the_connection)
+{
+    // arrange
+    CONNECTION_HANDLE connection = connection_create(TEST_IO_HANDLE, "testhost", test_container_id, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    TIMER_QUEUE_HANDLE result = connection_get_timer_queue(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, TEST_TIMER_QUEUE_HANDLE, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy(connection);
+}
+
+/* output buffer and write coalescing */
+
+static CONNECTION_HANDLE create_opened_connection(ENDPOINT_HANDLE* endpoint)
+{
+    const unsigned char amqp_header_bytes[] = { 'A', 'M', 'Q', 'P', 0, 1, 0, 0 };
+    CONNECTION_HANDLE connection = connection_create(TEST_IO_HANDLE, "testhost", test_container_id, NULL, NULL);
+    *endpoint = connection_create_endpoint(connection);
+    (void)connection_start_endpoint(*endpoint, test_on_frame_received, test_on_connection_state_changed, TEST_CONTEXT);
+    (void)connection_open(connection);
+    saved_on_io_open_complete(saved_on_io_open_complete_context, IO_OPEN_OK);
+    saved_on_bytes_received(saved_on_bytes_received_context, amqp_header_bytes, sizeof(amqp_header_bytes));
+    saved_frame_received_callback(saved_amqp_frame_codec_callback_context, 0, TEST_OPEN_PERFORMATIVE, NULL, 0);
+    sent_byte_count = 0;
+    return connection;
+}
+
+static PAYLOAD* create_frame_bytes(unsigned char first_byte, size_t size)
+{
+    unsigned char bytes[64];
+    PAYLOAD* payload = payload_create();
+    size_t i;
+    for (i = 0; i < size; i++)
+    {
+        bytes[i] = (unsigned char)(first_byte + i);
+    }
+    payload_append_data(payload, bytes, size);
+    return payload;
+}
+
+static void send_frame(ENDPOINT_HANDLE endpoint, unsigned char first_byte, size_t size, ON_SEND_COMPLETE on_send_complete)
+{
+    test_frame_bytes = create_frame_bytes(first_byte, size);
+    (void)connection_encode_frame(endpoint, TEST_TRANSFER_PERFORMATIVE, NULL, on_send_complete, TEST_CONTEXT);
+    payload_destroy(&test_frame_bytes);
+}
+
+static void assert_sent_bytes_run_from(unsigned char first_byte, size_t size)
+{
+    size_t i;
+    ASSERT_ARE_EQUAL(size_t, size, sent_byte_count);
+    for (i = 0; i < size; i++)
+    {
+        ASSERT_ARE_EQUAL(int, (int)(unsigned char)(first_byte + i), (int)sent_bytes[i]);
+    }
+}
+
+static bool test_write_callback_output(void* user_context, PAYLOAD_WRITE_FUNCTION* stream_writer, void* stream_context)
+{
+    unsigned char bytes[20];
+    size_t i;
+    (void)user_context;
+    for (i = 0; i < sizeof(bytes); i++)
+    {
+        bytes[i] = (unsigned char)(5 + i);
+    }
+    return stream_writer(stream_context, bytes, sizeof(bytes));
+}
+
+/* connection_set_output_buffer_size */
+
+/* Tests_S_R_S_CONNECTION_01_293: [If connection is NULL or output_buffer_size is 0, connection_set_output_buffer_size shall fail and return a non-zero value.] */
+TEST_FUNCTION(connection_set_output_buffer_size_with_NULL_connection_fails)
+{
+    // arrange
+
+    // act
+    int result = connection_set_output_buffer_size(NULL, 1024);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_CONNECTION_01_293: [If connection is NULL or output_buffer_size is 0, connection_set_output_buffer_size shall fail and return a non-zero value.] */
+TEST_FUNCTION(connection_set_output_buffer_size_with_0_size_fails)
+{
+    // arrange
+    CONNECTION_HANDLE connection = connection_create(TEST_IO_HANDLE, "testhost", test_container_id, NULL, NULL);
+    int result;
+    umock_c_reset_all_calls();
+
+    // act
+    result = connection_set_output_buffer_size(connection, 0);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_292: [connection_set_output_buffer_size shall set the size of the buffer in which encoded frames are coalesced before being handed to the io. The new size shall take effect once the buffer holds no pending bytes.] */
+/* Tests_S_R_S_CONNECTION_01_294: [On success connection_set_output_buffer_size shall return 0.] */
+/* Tests_S_R_S_CONNECTION_01_320: [connection_set_gathered_send shall turn on or off asking the underlying io for a scatter/gather send. It shall be off by default.] */
+TEST_FUNCTION(connection_set_output_buffer_size_sets_the_size_of_the_output_buffer)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    int result;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, 32));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    result = connection_set_output_buffer_size(connection, 32);
+    send_frame(endpoint, 1, 8, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, sent_byte_count);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_295: [If connection_set_output_buffer_size has not been called, the output buffer size shall be the remote max frame size, capped at 64 KB.] */
+TEST_FUNCTION(the_default_output_buffer_size_is_the_remote_max_frame_size)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection;
+    test_remote_max_frame_size = 4096;
+    connection = create_opened_connection(&endpoint);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, 4096));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 1, 8, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_295: [If connection_set_output_buffer_size has not been called, the output buffer size shall be the remote max frame size, capped at 64 KB.] */
+TEST_FUNCTION(the_default_output_buffer_size_is_capped_at_64_KB)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection;
+    test_remote_max_frame_size = 1024 * 1024;
+    connection = create_opened_connection(&endpoint);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, 64 * 1024));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 1, 8, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_296: [Encoded frames shall be copied into the output buffer and its contents shall be sent with xio_send when it is full or flushed.] */
+TEST_FUNCTION(frames_are_coalesced_in_the_output_buffer_and_sent_in_one_xio_send_on_flush)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    int result;
+    (void)connection_set_output_buffer_size(connection, 16);
+    send_frame(endpoint, 1, 6, NULL);
+    send_frame(endpoint, 7, 6, NULL);
+    ASSERT_ARE_EQUAL(size_t, 0, sent_byte_count);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 12, NULL, NULL));
+
+    // act
+    result = connection_flush(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 12);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_296: [Encoded frames shall be copied into the output buffer and its contents shall be sent with xio_send when it is full or flushed.] */
+/* Tests_S_R_S_CONNECTION_01_291: [If xio_setoption fails or does not fill in a sendv function, encoded frames shall be sent with xio_send.] */
+TEST_FUNCTION(when_the_output_buffer_is_full_it_is_sent_and_the_rest_of_the_frame_stays_buffered)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_output_buffer_size(connection, 16);
+    /* the io does not have a gathered send */
+    (void)connection_set_gathered_send(connection, true);
+    send_frame(endpoint, 1, 10, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 16, NULL, NULL));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 11, 10, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 16);
+    (void)connection_flush(connection);
+    assert_sent_bytes_run_from(1, 20);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_318: [A frame sent with an on_send_complete callback shall be sent with the output buffer before the callback is called, so that the send result reported is the result of handing its bytes to the io.] */
+TEST_FUNCTION(a_frame_with_an_on_send_complete_is_sent_with_the_coalesced_frames_before_its_result_is_reported)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_output_buffer_size(connection, 64);
+    (void)connection_set_write_coalescing(connection, 1024, 1000000);
+    send_frame(endpoint, 1, 6, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 12, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_send_complete(TEST_CONTEXT, IO_SEND_OK));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 7, 6, test_on_send_complete);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 12);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_296: [Encoded frames shall be copied into the output buffer and its contents shall be sent with xio_send when it is full or flushed.] */
+TEST_FUNCTION(frames_sent_back_to_back_without_on_send_complete_go_to_the_io_in_one_xio_send)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_output_buffer_size(connection, 64);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, 64));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 24, NULL, NULL));
+
+    // act
+    send_frame(endpoint, 1, 8, NULL);
+    send_frame(endpoint, 9, 8, NULL);
+    send_frame(endpoint, 17, 8, NULL);
+    (void)connection_flush(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 24);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_318: [A frame sent with an on_send_complete callback shall be sent with the output buffer before the callback is called, so that the send result reported is the result of handing its bytes to the io.] */
+TEST_FUNCTION(frames_sent_back_to_back_with_on_send_complete_go_to_the_io_in_one_xio_send_each)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_output_buffer_size(connection, 64);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, 64));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 8, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_send_complete(TEST_CONTEXT, IO_SEND_OK));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 8, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_send_complete(TEST_CONTEXT, IO_SEND_OK));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 8, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_send_complete(TEST_CONTEXT, IO_SEND_OK));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 1, 8, test_on_send_complete);
+    send_frame(endpoint, 9, 8, test_on_send_complete);
+    send_frame(endpoint, 17, 8, test_on_send_complete);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 24);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_318: [A frame sent with an on_send_complete callback shall be sent with the output buffer before the callback is called, so that the send result reported is the result of handing its bytes to the io.] */
+TEST_FUNCTION(when_sending_a_frame_with_an_on_send_complete_fails_the_error_is_reported_and_the_connection_is_closed)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_output_buffer_size(connection, 64);
+    (void)connection_set_write_coalescing(connection, 1024, 1000000);
+    send_frame(endpoint, 1, 6, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 12, NULL, NULL))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(test_on_send_complete(TEST_CONTEXT, IO_SEND_ERROR));
+    STRICT_EXPECTED_CALL(xio_close(TEST_IO_HANDLE, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_connection_state_changed(TEST_CONTEXT, CONNECTION_STATE_END, CONNECTION_STATE_OPENED));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 7, 6, test_on_send_complete);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_297: [Frames that do not fit in the space left in the output buffer shall be sent with the gathered send, together with the pending output buffer contents, if the underlying io provided one.] */
+/* Tests_S_R_S_CONNECTION_01_289: [If the underlying io provided a sendv function, the encoded frame bytes shall be sent by calling it with the byte array parts of the frame payload as XIO_SEND_BUFFER entries, without copying them.] */
+TEST_FUNCTION(a_frame_that_does_not_fit_in_the_output_buffer_is_sent_gathered_with_the_pending_bytes)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection;
+    test_io_has_sendv = true;
+    connection = create_opened_connection(&endpoint);
+    (void)connection_set_gathered_send(connection, true);
+    (void)connection_set_output_buffer_size(connection, 16);
+    send_frame(endpoint, 1, 4, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_sendv(TEST_SENDV_CONTEXT, IGNORED_PTR_ARG, 2));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 5, 32, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 36);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_290: [Output of callback parts of the frame payload shall be copied into the output buffer and sent from there.] */
+TEST_FUNCTION(callback_output_of_a_gathered_frame_is_sent_from_the_output_buffer)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection;
+    test_io_has_sendv = true;
+    connection = create_opened_connection(&endpoint);
+    (void)connection_set_gathered_send(connection, true);
+    (void)connection_set_output_buffer_size(connection, 16);
+    send_frame(endpoint, 1, 1, NULL);
+    (void)connection_flush(connection);
+    sent_byte_count = 0;
+    test_frame_bytes = create_frame_bytes(1, 4);
+    payload_append_callback_with_size(test_frame_bytes, test_write_callback_output, NULL, 20);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_sendv(TEST_SENDV_CONTEXT, IGNORED_PTR_ARG, 2));
+    STRICT_EXPECTED_CALL(test_sendv(TEST_SENDV_CONTEXT, IGNORED_PTR_ARG, 1));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    (void)connection_encode_frame(endpoint, TEST_TRANSFER_PERFORMATIVE, NULL, NULL, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 24);
+
+    // cleanup
+    payload_destroy(&test_frame_bytes);
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+TEST_FUNCTION(when_a_callback_part_writes_fewer_bytes_than_its_size_hint_the_frame_is_padded_with_spaces)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    size_t i;
+    (void)connection_set_output_buffer_size(connection, 64);
+    send_frame(endpoint, 1, 1, NULL);
+    (void)connection_flush(connection);
+    sent_byte_count = 0;
+    test_frame_bytes = create_frame_bytes(1, 4);
+    payload_append_callback_with_size(test_frame_bytes, test_write_callback_output, NULL, 24);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 28, NULL, NULL));
+
+    // act
+    (void)connection_encode_frame(endpoint, TEST_TRANSFER_PERFORMATIVE, NULL, NULL, NULL);
+    (void)connection_flush(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 28, sent_byte_count);
+    for (i = 0; i < 24; i++)
+    {
+        ASSERT_ARE_EQUAL(int, (int)(i + 1), (int)sent_bytes[i]);
+    }
+    ASSERT_ARE_EQUAL(int, 0, memcmp(sent_bytes + 24, "    ", 4));
+
+    // cleanup
+    payload_destroy(&test_frame_bytes);
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+TEST_FUNCTION(when_a_callback_part_writes_more_bytes_than_its_size_hint_the_frame_fails_and_the_connection_is_closed)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_output_buffer_size(connection, 64);
+    send_frame(endpoint, 1, 1, NULL);
+    (void)connection_flush(connection);
+    test_frame_bytes = create_frame_bytes(1, 4);
+    payload_append_callback_with_size(test_frame_bytes, test_write_callback_output, NULL, 16);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_on_send_complete(TEST_CONTEXT, IO_SEND_ERROR));
+    STRICT_EXPECTED_CALL(xio_close(TEST_IO_HANDLE, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_connection_state_changed(TEST_CONTEXT, CONNECTION_STATE_END, CONNECTION_STATE_OPENED));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    (void)connection_encode_frame(endpoint, TEST_TRANSFER_PERFORMATIVE, NULL, test_on_send_complete, TEST_CONTEXT);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    payload_destroy(&test_frame_bytes);
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_297: [Frames that do not fit in the space left in the output buffer shall be sent with the gathered send, together with the pending output buffer contents, if the underlying io provided one.] */
+TEST_FUNCTION(when_the_gathered_send_fails_the_error_is_reported_and_the_connection_is_closed)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection;
+    test_io_has_sendv = true;
+    connection = create_opened_connection(&endpoint);
+    (void)connection_set_gathered_send(connection, true);
+    (void)connection_set_output_buffer_size(connection, 16);
+    send_frame(endpoint, 1, 4, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_sendv(TEST_SENDV_CONTEXT, IGNORED_PTR_ARG, 2))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(test_on_send_complete(TEST_CONTEXT, IO_SEND_ERROR));
+    STRICT_EXPECTED_CALL(xio_close(TEST_IO_HANDLE, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_connection_state_changed(TEST_CONTEXT, CONNECTION_STATE_END, CONNECTION_STATE_OPENED));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 5, 32, test_on_send_complete);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* connection_flush */
+
+/* Tests_S_R_S_CONNECTION_01_300: [If connection is NULL, connection_flush shall fail and return a non-zero value.] */
+TEST_FUNCTION(connection_flush_with_NULL_connection_fails)
+{
+    // arrange
+
+    // act
+    int result = connection_flush(NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_CONNECTION_01_303: [On success connection_flush shall return 0.] */
+TEST_FUNCTION(connection_flush_with_no_pending_bytes_sends_nothing)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    int result;
+    umock_c_reset_all_calls();
+
+    // act
+    result = connection_flush(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_301: [connection_flush shall send the contents of the output buffer by calling xio_send.] */
+/* Tests_S_R_S_CONNECTION_01_303: [On success connection_flush shall return 0.] */
+TEST_FUNCTION(connection_flush_sends_the_pending_bytes_once)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    int result;
+    send_frame(endpoint, 1, 8, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 8, NULL, NULL));
+
+    // act
+    result = connection_flush(connection);
+    (void)connection_flush(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 8);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_302: [If xio_send fails, connection_flush shall close the io, set the connection state to END and return a non-zero value.] */
+TEST_FUNCTION(when_xio_send_fails_connection_flush_closes_the_connection_and_fails)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    int result;
+    send_frame(endpoint, 1, 8, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 8, NULL, NULL))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(xio_close(TEST_IO_HANDLE, NULL, NULL));
+    STRICT_EXPECTED_CALL(test_on_connection_state_changed(TEST_CONTEXT, CONNECTION_STATE_END, CONNECTION_STATE_OPENED));
+
+    // act
+    result = connection_flush(connection);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_298: [After xio_dowork, connection_dowork shall send the frames coalesced in the output buffer as if connection_flush was called.] */
+TEST_FUNCTION(connection_dowork_sends_the_coalesced_frames_after_xio_dowork)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    send_frame(endpoint, 1, 6, NULL);
+    send_frame(endpoint, 7, 6, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(timer_queue_dowork(TEST_TIMER_QUEUE_HANDLE));
+    STRICT_EXPECTED_CALL(timer_queue_get_time_to_next_deadline(TEST_TIMER_QUEUE_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_dowork(TEST_IO_HANDLE));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 12, NULL, NULL));
+
+    // act
+    connection_dowork(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 12);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* connection_set_gathered_send */
+
+/* Tests_S_R_S_CONNECTION_01_321: [If connection is NULL, connection_set_gathered_send shall fail and return a non-zero value.] */
+TEST_FUNCTION(connection_set_gathered_send_with_NULL_connection_fails)
+{
+    // arrange
+
+    // act
+    int result = connection_set_gathered_send(NULL, true);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_CONNECTION_01_320: [connection_set_gathered_send shall turn on or off asking the underlying io for a scatter/gather send. It shall be off by default.] */
+/* Tests_S_R_S_CONNECTION_01_322: [On success connection_set_gathered_send shall return 0.] */
+/* Tests_S_R_S_CONNECTION_01_288: [If gathered sends were turned on with connection_set_gathered_send, before sending the first encoded frame the connection shall ask the underlying io for a scatter/gather send by calling xio_setoption with OPTION_XIO_SENDV and an XIO_SENDV_QUERY.] */
+TEST_FUNCTION(with_gathered_send_on_the_io_is_asked_for_a_gathered_send_before_the_first_frame)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    int result;
+    (void)connection_set_output_buffer_size(connection, 32);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_setoption(TEST_IO_HANDLE, OPTION_XIO_SENDV, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, 32));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    result = connection_set_gathered_send(connection, true);
+    send_frame(endpoint, 1, 8, NULL);
+    send_frame(endpoint, 9, 8, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* connection_set_write_coalescing */
+
+/* Tests_S_R_S_CONNECTION_01_305: [If connection is NULL, connection_set_write_coalescing shall fail and return a non-zero value.] */
+TEST_FUNCTION(connection_set_write_coalescing_with_NULL_connection_fails)
+{
+    // arrange
+
+    // act
+    int result = connection_set_write_coalescing(NULL, 1024, 1000);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_CONNECTION_01_304: [connection_set_write_coalescing shall hold encoded frames in the output buffer across connection_dowork calls until flush_threshold bytes are pending or the oldest pending frame has waited max_delay_us. A flush_threshold of 0 shall turn write coalescing off.] */
+/* Tests_S_R_S_CONNECTION_01_306: [On success connection_set_write_coalescing shall return 0.] */
+/* Tests_S_R_S_CONNECTION_01_307: [When write coalescing is on, connection_dowork shall only send the output buffer once its oldest frame has been waiting for at least max_delay_us.] */
+TEST_FUNCTION(with_write_coalescing_connection_dowork_holds_the_frames_until_max_delay)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    int result;
+    result = connection_set_write_coalescing(connection, 1024, 5000);
+    test_current_ms = 100;
+    send_frame(endpoint, 1, 6, NULL);
+    test_current_ms = 104;
+    send_frame(endpoint, 7, 6, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(timer_queue_dowork(TEST_TIMER_QUEUE_HANDLE));
+    STRICT_EXPECTED_CALL(timer_queue_get_time_to_next_deadline(TEST_TIMER_QUEUE_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_dowork(TEST_IO_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    connection_dowork(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, sent_byte_count);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_307: [When write coalescing is on, connection_dowork shall only send the output buffer once its oldest frame has been waiting for at least max_delay_us.] */
+TEST_FUNCTION(with_write_coalescing_connection_dowork_sends_the_frames_once_max_delay_has_passed)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_write_coalescing(connection, 1024, 5000);
+    test_current_ms = 100;
+    send_frame(endpoint, 1, 6, NULL);
+    test_current_ms = 104;
+    send_frame(endpoint, 7, 6, NULL);
+    test_current_ms = 105;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(timer_queue_dowork(TEST_TIMER_QUEUE_HANDLE));
+    STRICT_EXPECTED_CALL(timer_queue_get_time_to_next_deadline(TEST_TIMER_QUEUE_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_dowork(TEST_IO_HANDLE));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 12, NULL, NULL));
+
+    // act
+    connection_dowork(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 12);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_308: [When write coalescing is on, the output buffer shall be sent as soon as it holds flush_threshold bytes or more.] */
+TEST_FUNCTION(with_write_coalescing_the_output_buffer_is_sent_once_it_reaches_the_flush_threshold)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_write_coalescing(connection, 8, 1000000);
+    send_frame(endpoint, 1, 6, NULL);
+    ASSERT_ARE_EQUAL(size_t, 0, sent_byte_count);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqp_frame_codec_encode_frame(TEST_AMQP_FRAME_CODEC_HANDLE, 0, TEST_TRANSFER_PERFORMATIVE, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 12, NULL, NULL));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    send_frame(endpoint, 7, 6, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 12);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_304: [connection_set_write_coalescing shall hold encoded frames in the output buffer across connection_dowork calls until flush_threshold bytes are pending or the oldest pending frame has waited max_delay_us. A flush_threshold of 0 shall turn write coalescing off.] */
+TEST_FUNCTION(a_flush_threshold_of_0_turns_write_coalescing_off)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    (void)connection_set_write_coalescing(connection, 8, 1000000);
+    (void)connection_set_write_coalescing(connection, 0, 1000000);
+    test_current_ms = 100;
+    send_frame(endpoint, 1, 6, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(timer_queue_dowork(TEST_TIMER_QUEUE_HANDLE));
+    STRICT_EXPECTED_CALL(timer_queue_get_time_to_next_deadline(TEST_TIMER_QUEUE_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(xio_dowork(TEST_IO_HANDLE));
+    STRICT_EXPECTED_CALL(xio_send(TEST_IO_HANDLE, IGNORED_PTR_ARG, 6, NULL, NULL));
+
+    // act
+    connection_dowork(connection);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_sent_bytes_run_from(1, 6);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* frame reception */
+
+/* Tests_S_R_S_CONNECTION_01_319: [Received bytes shall be passed to the frame_codec at most one frame at a time, so that once a frame (such as CLOSE) moves the connection out of the states in which frames are received, the bytes that follow it are not decoded.] */
+TEST_FUNCTION(frames_received_in_one_buffer_are_passed_to_the_frame_codec_one_at_a_time)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    const unsigned char frame_bytes[] =
+    {
+        0x00, 0x00, 0x00, 0x08, 0x02, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x0A, 0x02, 0x00, 0x00, 0x00, 0x42, 0x43
+    };
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(frame_codec_receive_bytes(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, 8));
+    STRICT_EXPECTED_CALL(frame_codec_receive_bytes(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, 10));
+
+    // act
+    saved_on_bytes_received(saved_on_bytes_received_context, frame_bytes, sizeof(frame_bytes));
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    stringify_bytes(frame_bytes, sizeof(frame_bytes), expected_stringified_io);
+    stringify_bytes(frame_codec_bytes, frame_codec_byte_count, actual_stringified_io);
+    ASSERT_ARE_EQUAL(char_ptr, expected_stringified_io, actual_stringified_io);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_319: [Received bytes shall be passed to the frame_codec at most one frame at a time, so that once a frame (such as CLOSE) moves the connection out of the states in which frames are received, the bytes that follow it are not decoded.] */
+TEST_FUNCTION(a_frame_split_across_receives_is_passed_to_the_frame_codec_up_to_its_end)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    const unsigned char first_bytes[] = { 0x00, 0x00 };
+    const unsigned char second_bytes[] = { 0x00, 0x0A, 0x02, 0x00, 0x00 };
+    const unsigned char third_bytes[] = { 0x00, 0x42, 0x43, 0x00, 0x00, 0x00, 0x08 };
+    saved_on_bytes_received(saved_on_bytes_received_context, first_bytes, sizeof(first_bytes));
+    saved_on_bytes_received(saved_on_bytes_received_context, second_bytes, sizeof(second_bytes));
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(frame_codec_receive_bytes(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, 3));
+    STRICT_EXPECTED_CALL(frame_codec_receive_bytes(TEST_FRAME_CODEC_HANDLE, IGNORED_PTR_ARG, 4));
+
+    // act
+    saved_on_bytes_received(saved_on_bytes_received_context, third_bytes, sizeof(third_bytes));
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, sizeof(first_bytes) + sizeof(second_bytes) + sizeof(third_bytes), frame_codec_byte_count);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
+/* Tests_S_R_S_CONNECTION_01_319: [Received bytes shall be passed to the frame_codec at most one frame at a time, so that once a frame (such as CLOSE) moves the connection out of the states in which frames are received, the bytes that follow it are not decoded.] */
+TEST_FUNCTION(frames_received_after_a_close_frame_in_the_same_buffer_are_not_passed_to_the_frame_codec)
+{
+    // arrange
+    ENDPOINT_HANDLE endpoint;
+    CONNECTION_HANDLE connection = create_opened_connection(&endpoint);
+    CLOSE_HANDLE received_test_close_handle = (CLOSE_HANDLE)0x4000;
+    const unsigned char frame_bytes[] =
+    {
+        0x00, 0x00, 0x00, 0x08, 0x02, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x08, 0x02, 0x00, 0x00, 0x00
+    };
+    test_frame_codec_receives_close = true;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(amqpvalue_get_close(TEST_CLOSE_PERFORMATIVE, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &received_test_close_handle, sizeof(received_test_close_handle));
+    STRICT_EXPECTED_CALL(close_get_error(received_test_close_handle, IGNORED_PTR_ARG))
+        .SetReturn(1);
+
+    // act
+    saved_on_bytes_received(saved_on_bytes_received_context, frame_bytes, sizeof(frame_bytes));
+
+    // assert
+    stringify_bytes(frame_bytes, 8, expected_stringified_io);
+    stringify_bytes(frame_codec_bytes, frame_codec_byte_count, actual_stringified_io);
+    ASSERT_ARE_EQUAL(char_ptr, expected_stringified_io, actual_stringified_io);
+
+    // cleanup
+    connection_destroy_endpoint(endpoint);
+    connection_destroy(connection);
+}
+
 END_TEST_SUITE(connection_ut)
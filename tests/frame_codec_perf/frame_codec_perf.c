@@ -0,0 +1,409 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/xio.h"
+#include "azure_uamqp_c/frame_codec.h"
+#include "azure_uamqp_c/connection.h"
+
+#define FRAME_COUNT 4096
+#define FRAME_BODY_SIZE 1024
+#define ITERATION_COUNT 20
+#define MAX_FRAME_SIZE (64 * 1024)
+/* the largest data offset, so that frames without a body still carry 1020 bytes */
+#define EMPTY_FRAME_DOFF 255
+
+static size_t total_frames_received;
+static CONNECTION_STATE connection_state;
+
+static const unsigned char amqp_header[] = { 'A', 'M', 'Q', 'P', 0, 1, 0, 0 };
+
+/* an io that opens on the first dowork, accepts everything sent and lets the test feed the received bytes */
+typedef struct TEST_IO_INSTANCE_TAG
+{
+    ON_IO_OPEN_COMPLETE on_io_open_complete;
+    void* on_io_open_complete_context;
+    ON_BYTES_RECEIVED on_bytes_received;
+    void* on_bytes_received_context;
+} TEST_IO_INSTANCE;
+
+/* the io the connection under test uses */
+static TEST_IO_INSTANCE* created_test_io;
+
+static CONCRETE_IO_HANDLE test_io_create(void* io_create_parameters)
+{
+    (void)io_create_parameters;
+    created_test_io = (TEST_IO_INSTANCE*)calloc(1, sizeof(TEST_IO_INSTANCE));
+    return created_test_io;
+}
+
+static void test_io_destroy(CONCRETE_IO_HANDLE test_io)
+{
+    free(test_io);
+}
+
+static int test_io_open_async(CONCRETE_IO_HANDLE test_io, ON_IO_OPEN_COMPLETE on_io_open_complete, void* on_io_open_complete_context, ON_BYTES_RECEIVED on_bytes_received, void* on_bytes_received_context, ON_IO_ERROR on_io_error, void* on_io_error_context)
+{
+    TEST_IO_INSTANCE* test_io_instance = (TEST_IO_INSTANCE*)test_io;
+    (void)on_io_error;
+    (void)on_io_error_context;
+
+    test_io_instance->on_io_open_complete = on_io_open_complete;
+    test_io_instance->on_io_open_complete_context = on_io_open_complete_context;
+    test_io_instance->on_bytes_received = on_bytes_received;
+    test_io_instance->on_bytes_received_context = on_bytes_received_context;
+
+    return 0;
+}
+
+static int test_io_close_async(CONCRETE_IO_HANDLE test_io, ON_IO_CLOSE_COMPLETE on_io_close_complete, void* callback_context)
+{
+    (void)test_io;
+
+    if (on_io_close_complete != NULL)
+    {
+        on_io_close_complete(callback_context);
+    }
+
+    return 0;
+}
+
+static int test_io_send_async(CONCRETE_IO_HANDLE test_io, const void* buffer, size_t size, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    (void)test_io;
+    (void)buffer;
+    (void)size;
+
+    if (on_send_complete != NULL)
+    {
+        on_send_complete(callback_context, IO_SEND_OK);
+    }
+
+    return 0;
+}
+
+static void test_io_dowork(CONCRETE_IO_HANDLE test_io)
+{
+    TEST_IO_INSTANCE* test_io_instance = (TEST_IO_INSTANCE*)test_io;
+
+    if (test_io_instance->on_io_open_complete != NULL)
+    {
+        ON_IO_OPEN_COMPLETE on_io_open_complete = test_io_instance->on_io_open_complete;
+        test_io_instance->on_io_open_complete = NULL;
+        on_io_open_complete(test_io_instance->on_io_open_complete_context, IO_OPEN_OK);
+    }
+}
+
+static int test_io_set_option(CONCRETE_IO_HANDLE test_io, const char* option_name, const void* value)
+{
+    (void)test_io;
+    (void)option_name;
+    (void)value;
+
+    /* no options, so the connection sends with xio_send */
+    return __LINE__;
+}
+
+static OPTIONHANDLER_HANDLE test_io_retrieve_options(CONCRETE_IO_HANDLE test_io)
+{
+    (void)test_io;
+    return NULL;
+}
+
+static const IO_INTERFACE_DESCRIPTION test_io_interface_description =
+{
+    test_io_retrieve_options,
+    test_io_create,
+    test_io_destroy,
+    test_io_open_async,
+    test_io_close_async,
+    test_io_send_async,
+    test_io_dowork,
+    test_io_set_option
+};
+
+static void on_frame_codec_error(void* context)
+{
+    (void)context;
+    LogError("Frame codec error");
+}
+
+static void on_frame_received(void* context, const unsigned char* type_specific, uint32_t type_specific_size, const unsigned char* frame_body, uint32_t frame_body_size)
+{
+    (void)context;
+    (void)type_specific;
+    (void)type_specific_size;
+    (void)frame_body;
+    (void)frame_body_size;
+
+    total_frames_received++;
+}
+
+static void on_connection_state_changed(void* context, CONNECTION_STATE new_connection_state, CONNECTION_STATE previous_connection_state)
+{
+    (void)context;
+    (void)previous_connection_state;
+
+    connection_state = new_connection_state;
+}
+
+static unsigned char* create_frames(uint8_t doff, size_t body_size, size_t* buffer_size)
+{
+    size_t frame_size = ((size_t)doff * 4) + body_size;
+    unsigned char* result = (unsigned char*)malloc(frame_size * FRAME_COUNT);
+    if (result == NULL)
+    {
+        LogError("Cannot allocate frame buffer");
+    }
+    else
+    {
+        size_t i;
+
+        for (i = 0; i < FRAME_COUNT; i++)
+        {
+            unsigned char* frame = result + (i * frame_size);
+            frame[0] = (unsigned char)((frame_size >> 24) & 0xFF);
+            frame[1] = (unsigned char)((frame_size >> 16) & 0xFF);
+            frame[2] = (unsigned char)((frame_size >> 8) & 0xFF);
+            frame[3] = (unsigned char)(frame_size & 0xFF);
+            frame[4] = doff;
+            frame[5] = FRAME_TYPE_AMQP;
+            frame[6] = 0;
+            frame[7] = 0;
+            (void)memset(frame + 8, (int)(i & 0xFF), frame_size - 8);
+        }
+
+        *buffer_size = frame_size * FRAME_COUNT;
+    }
+
+    return result;
+}
+
+static void log_throughput(const char* name, size_t frame_count, size_t byte_count, tickcounter_ms_t start_ms, tickcounter_ms_t end_ms)
+{
+    double seconds = (double)(end_ms - start_ms) / 1000;
+    double megabytes = (double)byte_count / (1024 * 1024);
+
+    LogInfo("%s: %lu frames, %.02f MB in %.03f seconds, %.02f MB/s",
+        name,
+        (unsigned long)frame_count,
+        megabytes,
+        seconds,
+        (seconds > 0) ? (megabytes / seconds) : 0.0);
+}
+
+static int run_receive(TICK_COUNTER_HANDLE tick_counter, const unsigned char* buffer, size_t buffer_size, size_t chunk_size, const char* name)
+{
+    int result;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(on_frame_codec_error, NULL);
+    if (frame_codec == NULL)
+    {
+        LogError("Cannot create frame codec");
+        result = __LINE__;
+    }
+    else
+    {
+        tickcounter_ms_t start_ms;
+        tickcounter_ms_t end_ms;
+
+        if ((frame_codec_set_max_frame_size(frame_codec, MAX_FRAME_SIZE) != 0) ||
+            (frame_codec_subscribe(frame_codec, FRAME_TYPE_AMQP, on_frame_received, NULL) != 0) ||
+            (tickcounter_get_current_ms(tick_counter, &start_ms) != 0))
+        {
+            LogError("Cannot set up frame codec");
+            result = __LINE__;
+        }
+        else
+        {
+            size_t iteration;
+
+            result = 0;
+            total_frames_received = 0;
+
+            for (iteration = 0; (result == 0) && (iteration < ITERATION_COUNT); iteration++)
+            {
+                size_t pos;
+
+                for (pos = 0; pos < buffer_size; pos += chunk_size)
+                {
+                    size_t to_send = buffer_size - pos;
+                    if (to_send > chunk_size)
+                    {
+                        to_send = chunk_size;
+                    }
+
+                    if (frame_codec_receive_bytes(frame_codec, buffer + pos, to_send) != 0)
+                    {
+                        LogError("frame_codec_receive_bytes failed");
+                        result = __LINE__;
+                        break;
+                    }
+                }
+            }
+
+            if (tickcounter_get_current_ms(tick_counter, &end_ms) != 0)
+            {
+                LogError("Cannot get tick counter value");
+                result = __LINE__;
+            }
+            else if (result == 0)
+            {
+                log_throughput(name, total_frames_received, buffer_size * ITERATION_COUNT, start_ms, end_ms);
+            }
+        }
+
+        frame_codec_destroy(frame_codec);
+    }
+
+    return result;
+}
+
+/* feeds the same frames through the connection, as the underlying io would hand them over */
+static int run_connection_receive(TICK_COUNTER_HANDLE tick_counter, const unsigned char* buffer, size_t buffer_size, size_t chunk_size, const char* name)
+{
+    int result;
+    XIO_HANDLE io = xio_create(&test_io_interface_description, NULL);
+    if (io == NULL)
+    {
+        LogError("Cannot create test io");
+        result = __LINE__;
+    }
+    else
+    {
+        CONNECTION_HANDLE connection = connection_create2(io, NULL, "perf", NULL, NULL, on_connection_state_changed, NULL, NULL, NULL);
+        if (connection == NULL)
+        {
+            LogError("Cannot create connection");
+            result = __LINE__;
+        }
+        else
+        {
+            tickcounter_ms_t start_ms;
+            tickcounter_ms_t end_ms;
+
+            connection_state = CONNECTION_STATE_START;
+
+            if (connection_open(connection) != 0)
+            {
+                LogError("Cannot open connection");
+                result = __LINE__;
+            }
+            else
+            {
+                /* the open completes and the header goes out, the peer header then moves the connection to OPEN_SENT */
+                connection_dowork(connection);
+                created_test_io->on_bytes_received(created_test_io->on_bytes_received_context, amqp_header, sizeof(amqp_header));
+
+                if ((connection_state != CONNECTION_STATE_OPEN_SENT) ||
+                    (tickcounter_get_current_ms(tick_counter, &start_ms) != 0))
+                {
+                    LogError("Cannot set up connection");
+                    result = __LINE__;
+                }
+                else
+                {
+                    size_t iteration;
+
+                    for (iteration = 0; iteration < ITERATION_COUNT; iteration++)
+                    {
+                        size_t pos;
+
+                        for (pos = 0; pos < buffer_size; pos += chunk_size)
+                        {
+                            size_t to_send = buffer_size - pos;
+                            if (to_send > chunk_size)
+                            {
+                                to_send = chunk_size;
+                            }
+
+                            created_test_io->on_bytes_received(created_test_io->on_bytes_received_context, buffer + pos, to_send);
+                        }
+                    }
+
+                    if (tickcounter_get_current_ms(tick_counter, &end_ms) != 0)
+                    {
+                        LogError("Cannot get tick counter value");
+                        result = __LINE__;
+                    }
+                    /* a frame the connection could not decode would have closed it */
+                    else if (connection_state != CONNECTION_STATE_OPEN_SENT)
+                    {
+                        LogError("Connection failed while receiving frames");
+                        result = __LINE__;
+                    }
+                    else
+                    {
+                        log_throughput(name, FRAME_COUNT * ITERATION_COUNT, buffer_size * ITERATION_COUNT, start_ms, end_ms);
+                        result = 0;
+                    }
+                }
+            }
+
+            connection_destroy(connection);
+        }
+
+        xio_destroy(io);
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result;
+    size_t buffer_size;
+    size_t empty_frames_buffer_size;
+    unsigned char* buffer;
+    unsigned char* empty_frames_buffer;
+
+    (void)argc;
+    (void)argv;
+
+    buffer = create_frames(2, FRAME_BODY_SIZE, &buffer_size);
+    /* the connection is not open yet, so it is fed frames without a performative */
+    empty_frames_buffer = create_frames(EMPTY_FRAME_DOFF, 0, &empty_frames_buffer_size);
+    if ((buffer == NULL) ||
+        (empty_frames_buffer == NULL))
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        TICK_COUNTER_HANDLE tick_counter = tickcounter_create();
+        if (tick_counter == NULL)
+        {
+            LogError("Cannot create tick counter");
+            result = __LINE__;
+        }
+        else
+        {
+            /* per byte is what the connection used to do for every received byte */
+            if ((run_receive(tick_counter, buffer, buffer_size, 1, "Per byte") != 0) ||
+                /* typical socket read size */
+                (run_receive(tick_counter, buffer, buffer_size, 16 * 1024, "16 KB chunks") != 0) ||
+                (run_receive(tick_counter, buffer, buffer_size, buffer_size, "Whole buffer") != 0) ||
+                /* the same comparison one layer up, through the connection receive path */
+                (run_connection_receive(tick_counter, empty_frames_buffer, empty_frames_buffer_size, 1, "Connection per byte") != 0) ||
+                (run_connection_receive(tick_counter, empty_frames_buffer, empty_frames_buffer_size, 16 * 1024, "Connection 16 KB chunks") != 0) ||
+                (run_connection_receive(tick_counter, empty_frames_buffer, empty_frames_buffer_size, empty_frames_buffer_size, "Connection whole buffer") != 0))
+            {
+                result = __LINE__;
+            }
+            else
+            {
+                result = 0;
+            }
+
+            tickcounter_destroy(tick_counter);
+        }
+    }
+
+    free(buffer);
+    free(empty_frames_buffer);
+
+    return result;
+}
@@ -414,11 +414,9 @@ TEST_FUNCTION(receiving_a_frame_with_exactly_512_bytes_of_total_frame_size_immed
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 504))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[8], 504);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -598,11 +596,9 @@ TEST_FUNCTION(receiving_a_frame_with_exactly_max_frame_size_bytes_of_total_frame
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 1016))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[8], 1016);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -751,6 +747,179 @@ TEST_FUNCTION(setting_a_new_max_frame_while_the_frame_size_is_being_received_mak
     frame_codec_destroy(frame_codec);
 }
 
+/* frame_codec_set_option */
+
+/* Tests_SRS_FRAME_CODEC_01_112: [If any of the arguments frame_codec, option_name or value is NULL, frame_codec_set_option shall return a non-zero value.] */
+TEST_FUNCTION(frame_codec_set_option_with_NULL_frame_codec_fails)
+{
+    // arrange
+    uint32_t retain_limit = 0;
+
+    // act
+    int result = frame_codec_set_option(NULL, FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT, &retain_limit);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_FRAME_CODEC_01_112: [If any of the arguments frame_codec, option_name or value is NULL, frame_codec_set_option shall return a non-zero value.] */
+TEST_FUNCTION(frame_codec_set_option_with_NULL_option_name_fails)
+{
+    // arrange
+    int result;
+    uint32_t retain_limit = 0;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(test_frame_codec_decode_error, TEST_ERROR_CONTEXT);
+    umock_c_reset_all_calls();
+
+    // act
+    result = frame_codec_set_option(frame_codec, NULL, &retain_limit);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    frame_codec_destroy(frame_codec);
+}
+
+/* Tests_SRS_FRAME_CODEC_01_112: [If any of the arguments frame_codec, option_name or value is NULL, frame_codec_set_option shall return a non-zero value.] */
+TEST_FUNCTION(frame_codec_set_option_with_NULL_value_fails)
+{
+    // arrange
+    int result;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(test_frame_codec_decode_error, TEST_ERROR_CONTEXT);
+    umock_c_reset_all_calls();
+
+    // act
+    result = frame_codec_set_option(frame_codec, FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    frame_codec_destroy(frame_codec);
+}
+
+/* Tests_SRS_FRAME_CODEC_01_114: [If option_name is not known, frame_codec_set_option shall return a non-zero value.] */
+TEST_FUNCTION(frame_codec_set_option_with_an_unknown_option_fails)
+{
+    // arrange
+    int result;
+    uint32_t retain_limit = 0;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(test_frame_codec_decode_error, TEST_ERROR_CONTEXT);
+    umock_c_reset_all_calls();
+
+    // act
+    result = frame_codec_set_option(frame_codec, "unknown_option", &retain_limit);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    frame_codec_destroy(frame_codec);
+}
+
+/* Tests_SRS_FRAME_CODEC_01_029: [The sequence of bytes does not have to be a complete frame, frame_codec shall be responsible for maintaining decoding state between frame_codec_receive_bytes calls.] */
+TEST_FUNCTION(the_receive_buffer_is_reused_for_a_subsequent_frame_split_across_calls)
+{
+    // arrange
+    int result;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(test_frame_codec_decode_error, TEST_ERROR_CONTEXT);
+    unsigned char frame[] = { 0x00, 0x00, 0x00, 0x09, 0x02, 0x00, 0x01, 0x02, 0x42 };
+    (void)frame_codec_subscribe(frame_codec, 0, on_frame_received_1, frame_codec);
+    (void)frame_codec_receive_bytes(frame_codec, frame, 1);
+    (void)frame_codec_receive_bytes(frame_codec, frame + 1, sizeof(frame) - 1);
+    (void)frame_codec_receive_bytes(frame_codec, frame, 1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .ValidateArgumentBuffer(3, &frame[5], 1);
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 1))
+        .ValidateArgumentBuffer(2, &frame[6], 2)
+        .ValidateArgumentBuffer(4, &frame[8], 1);
+
+    // act
+    result = frame_codec_receive_bytes(frame_codec, frame + 1, sizeof(frame) - 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    (void)frame_codec_unsubscribe(frame_codec, 0);
+    frame_codec_destroy(frame_codec);
+}
+
+/* Tests_SRS_FRAME_CODEC_01_113: [If option_name is `receive_buffer_retain_limit` (FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT), value shall be a pointer to a uint32_t holding the largest receive buffer size that is kept between frames.] */
+/* Tests_SRS_FRAME_CODEC_01_115: [On success, frame_codec_set_option shall return 0.] */
+TEST_FUNCTION(a_receive_buffer_bigger_than_the_retain_limit_is_freed_after_the_frame_is_dispatched)
+{
+    // arrange
+    int result;
+    uint32_t retain_limit = 2;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(test_frame_codec_decode_error, TEST_ERROR_CONTEXT);
+    unsigned char frame[] = { 0x00, 0x00, 0x00, 0x09, 0x02, 0x00, 0x01, 0x02, 0x42 };
+    (void)frame_codec_subscribe(frame_codec, 0, on_frame_received_1, frame_codec);
+    (void)frame_codec_set_option(frame_codec, FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT, &retain_limit);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .ValidateArgumentBuffer(3, &frame[5], 1);
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 1))
+        .ValidateArgumentBuffer(2, &frame[6], 2)
+        .ValidateArgumentBuffer(4, &frame[8], 1);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    (void)frame_codec_receive_bytes(frame_codec, frame, 1);
+
+    // act
+    result = frame_codec_receive_bytes(frame_codec, frame + 1, sizeof(frame) - 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    (void)frame_codec_unsubscribe(frame_codec, 0);
+    frame_codec_destroy(frame_codec);
+}
+
+/* Tests_SRS_FRAME_CODEC_01_113: [If option_name is `receive_buffer_retain_limit` (FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT), value shall be a pointer to a uint32_t holding the largest receive buffer size that is kept between frames.] */
+/* Tests_SRS_FRAME_CODEC_01_115: [On success, frame_codec_set_option shall return 0.] */
+TEST_FUNCTION(lowering_the_retain_limit_frees_a_retained_receive_buffer)
+{
+    // arrange
+    int result;
+    uint32_t retain_limit = 0;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(test_frame_codec_decode_error, TEST_ERROR_CONTEXT);
+    unsigned char frame[] = { 0x00, 0x00, 0x00, 0x09, 0x02, 0x00, 0x01, 0x02, 0x42 };
+    (void)frame_codec_subscribe(frame_codec, 0, on_frame_received_1, frame_codec);
+    (void)frame_codec_receive_bytes(frame_codec, frame, 1);
+    (void)frame_codec_receive_bytes(frame_codec, frame + 1, sizeof(frame) - 1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    result = frame_codec_set_option(frame_codec, FRAME_CODEC_OPTION_RECEIVE_BUFFER_RETAIN_LIMIT, &retain_limit);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    (void)frame_codec_unsubscribe(frame_codec, 0);
+    frame_codec_destroy(frame_codec);
+}
+
 /* frame_codec_receive_bytes */
 
 /* Tests_SRS_FRAME_CODEC_01_025: [frame_codec_receive_bytes decodes a sequence of bytes into frames and on success it shall return zero.] */
@@ -783,10 +952,8 @@ TEST_FUNCTION(frame_codec_receive_bytes_decodes_one_empty_frame)
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -905,7 +1072,6 @@ TEST_FUNCTION(when_frame_codec_receive_1_byte_in_one_call_and_the_rest_of_the_fr
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     (void)frame_codec_receive_bytes(frame_codec, frame, 1);
 
@@ -939,7 +1105,6 @@ TEST_FUNCTION(when_frame_codec_receive_the_frame_bytes_in_1_byte_per_call_a_succ
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     for (i = 0; i < sizeof(frame) - 1; i++)
     {
@@ -972,10 +1137,8 @@ TEST_FUNCTION(a_frame_codec_receive_bytes_call_with_bad_args_before_any_real_fra
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     (void)frame_codec_receive_bytes(frame_codec, NULL, 1);
 
@@ -1008,7 +1171,6 @@ TEST_FUNCTION(a_frame_codec_receive_bytes_call_with_bad_args_in_the_middle_of_th
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     (void)frame_codec_receive_bytes(frame_codec, frame, 1);
     (void)frame_codec_receive_bytes(frame_codec, NULL, 1);
@@ -1040,18 +1202,14 @@ TEST_FUNCTION(frame_codec_receive_bytes_decodes_2_empty_frames)
         .ValidateArgumentBuffer(3, &frame1[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame1[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .ValidateArgumentBuffer(3, &frame2[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame2[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     (void)frame_codec_receive_bytes(frame_codec, frame1, sizeof(frame1));
 
@@ -1082,18 +1240,14 @@ TEST_FUNCTION(a_call_to_frame_codec_receive_bytes_with_bad_args_between_2_frames
         .ValidateArgumentBuffer(3, &frame1[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame1[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .ValidateArgumentBuffer(3, &frame2[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame2[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     (void)frame_codec_receive_bytes(frame_codec, frame1, sizeof(frame1));
     (void)frame_codec_receive_bytes(frame_codec, NULL, 1);
@@ -1254,11 +1408,9 @@ TEST_FUNCTION(receiving_a_frame_with_1_byte_frame_body_succeeds)
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 1))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[8], 1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -1293,7 +1445,7 @@ TEST_FUNCTION(when_allocating_type_specific_data_fails_frame_codec_receive_bytes
     STRICT_EXPECTED_CALL(test_frame_codec_decode_error(TEST_ERROR_CONTEXT));
 
     // act
-    result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
+    result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame) - 1);
 
     // assert
     ASSERT_ARE_NOT_EQUAL(int, 0, result);
@@ -1318,7 +1470,7 @@ TEST_FUNCTION(when_allocating_type_specific_data_fails_a_subsequent_decode_Call_
     STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
         .SetReturn(NULL);
 
-    (void)frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
+    (void)frame_codec_receive_bytes(frame_codec, frame, sizeof(frame) - 1);
     umock_c_reset_all_calls();
 
     // act
@@ -1347,11 +1499,9 @@ TEST_FUNCTION(a_frame_with_2_bytes_received_together_with_the_header_passes_the_
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 2))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[sizeof(frame) - 2], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -1380,18 +1530,14 @@ TEST_FUNCTION(two_empty_frames_received_in_the_same_call_yields_2_callbacks)
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame[6], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 0))
         .ValidateArgumentBuffer(2, &frame[14], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -1420,20 +1566,16 @@ TEST_FUNCTION(two_frames_with_1_byte_each_received_in_the_same_call_yields_2_cal
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 1))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[8], 1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 1))
         .ValidateArgumentBuffer(2, &frame[15], 2)
         .ValidateArgumentBuffer(4, &frame[17], 1);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -1447,6 +1589,45 @@ TEST_FUNCTION(two_frames_with_1_byte_each_received_in_the_same_call_yields_2_cal
     frame_codec_destroy(frame_codec);
 }
 
+/* Tests_SRS_FRAME_CODEC_01_029: [The sequence of bytes does not have to be a complete frame, frame_codec shall be responsible for maintaining decoding state between frame_codec_receive_bytes calls.] */
+TEST_FUNCTION(a_complete_frame_followed_by_a_partial_frame_dispatches_the_first_frame_from_the_buffer_and_keeps_the_rest)
+{
+    // arrange
+    int result;
+    FRAME_CODEC_HANDLE frame_codec = frame_codec_create(test_frame_codec_decode_error, TEST_ERROR_CONTEXT);
+    unsigned char frame[] = { 0x00, 0x00, 0x00, 0x09, 0x02, 0x00, 0x01, 0x02, 0x42,
+        0x00, 0x00, 0x00, 0x09, 0x02, 0x00, 0x03, 0x04, 0x43 };
+    (void)frame_codec_subscribe(frame_codec, 0, on_frame_received_1, frame_codec);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .ValidateArgumentBuffer(3, &frame[5], 1);
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, &frame[6], 2, &frame[8], 1));
+    STRICT_EXPECTED_CALL(singlylinkedlist_find(TEST_LIST_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .ValidateArgumentBuffer(3, &frame[14], 1);
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 1))
+        .ValidateArgumentBuffer(2, &frame[15], 2)
+        .ValidateArgumentBuffer(4, &frame[17], 1);
+
+    (void)frame_codec_receive_bytes(frame_codec, frame, sizeof(frame) - 4);
+
+    // act
+    result = frame_codec_receive_bytes(frame_codec, &frame[sizeof(frame) - 4], 4);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    (void)frame_codec_unsubscribe(frame_codec, 0);
+    frame_codec_destroy(frame_codec);
+}
+
 /* frame_codec_subscribe */
 
 /* Tests_SRS_FRAME_CODEC_01_033: [frame_codec_subscribe subscribes for a certain type of frame received by the frame_codec instance identified by frame_codec.] */
@@ -1627,11 +1808,9 @@ TEST_FUNCTION(when_2_subscriptions_exist_and_first_one_matches_the_callback_is_i
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_1(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 2))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[sizeof(frame) - 2], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -1662,11 +1841,9 @@ TEST_FUNCTION(when_2_subscriptions_exist_and_second_one_matches_the_callback_is_
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_2(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 2))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[sizeof(frame) - 2], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -1723,11 +1900,9 @@ TEST_FUNCTION(the_callbacks_for_the_2nd_frame_codec_subscribe_for_the_same_frame
         .ValidateArgumentBuffer(3, &frame[5], 1);
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(singlylinkedlist_item_get_value(IGNORED_PTR_ARG));
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
     STRICT_EXPECTED_CALL(on_frame_received_2(frame_codec, IGNORED_PTR_ARG, 2, IGNORED_PTR_ARG, 2))
         .ValidateArgumentBuffer(2, &frame[6], 2)
         .ValidateArgumentBuffer(4, &frame[sizeof(frame) - 2], 2);
-    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
     // act
     result = frame_codec_receive_bytes(frame_codec, frame, sizeof(frame));
@@ -0,0 +1,669 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#endif
+
+#include "azure_macro_utils/macro_utils.h"
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_bool.h"
+#include "umock_c/umocktypes_stdint.h"
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* my_gballoc_calloc(size_t nmemb, size_t size)
+{
+    return calloc(nmemb, size);
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#define ENABLE_MOCKS
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_uamqp_c/session.h"
+#include "azure_uamqp_c/amqpvalue.h"
+#include "azure_uamqp_c/amqp_definitions.h"
+#include "azure_uamqp_c/async_operation.h"
+#include "azure_uamqp_c/timer_queue.h"
+
+#undef ENABLE_MOCKS
+
+#include "azure_uamqp_c/link.h"
+
+#define TEST_SESSION_HANDLE             (SESSION_HANDLE)0x4240
+#define TEST_LINK_ENDPOINT              (LINK_ENDPOINT_HANDLE)0x4241
+#define TEST_SOURCE                     (AMQP_VALUE)0x4242
+#define TEST_TARGET                     (AMQP_VALUE)0x4243
+#define TEST_ATTACH_HANDLE              (ATTACH_HANDLE)0x4244
+#define TEST_FLOW_HANDLE                (FLOW_HANDLE)0x4245
+#define TEST_DISPOSITION_HANDLE         (DISPOSITION_HANDLE)0x4246
+#define TEST_ATTACH_PERFORMATIVE        (AMQP_VALUE)0x5000
+#define TEST_FLOW_PERFORMATIVE          (AMQP_VALUE)0x5001
+#define TEST_DISPOSITION_PERFORMATIVE   (AMQP_VALUE)0x5002
+#define TEST_DELIVERY_STATE             (AMQP_VALUE)0x5003
+#define TEST_MAX_SETTLED                64
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+static ON_ENDPOINT_FRAME_RECEIVED saved_frame_received;
+static ON_SESSION_STATE_CHANGED saved_on_session_state_changed;
+static void* saved_link_endpoint_context;
+
+/* delivery id that the fake session hands out to the next transfer */
+static delivery_number test_next_delivery_id;
+static uint32_t test_link_credit;
+static delivery_number test_disposition_first;
+static delivery_number test_disposition_last;
+
+static delivery_number test_settled_ids[TEST_MAX_SETTLED];
+static LINK_DELIVERY_SETTLE_REASON test_settled_reasons[TEST_MAX_SETTLED];
+static size_t test_settled_count;
+/* the fake session completes the send of the transfer before it returns, as the connection does when it flushes right away */
+static bool test_complete_send_before_returning;
+
+typedef struct TEST_ASYNC_OPERATION_TAG
+{
+    ASYNC_OPERATION_CANCEL_HANDLER_FUNC async_operation_cancel_handler;
+} TEST_ASYNC_OPERATION;
+
+static ASYNC_OPERATION_HANDLE my_async_operation_create(ASYNC_OPERATION_CANCEL_HANDLER_FUNC async_operation_cancel_handler, size_t context_size)
+{
+    TEST_ASYNC_OPERATION* result = (TEST_ASYNC_OPERATION*)my_gballoc_malloc(context_size);
+    if (result != NULL)
+    {
+        result->async_operation_cancel_handler = async_operation_cancel_handler;
+    }
+
+    return (ASYNC_OPERATION_HANDLE)result;
+}
+
+static void my_async_operation_destroy(ASYNC_OPERATION_HANDLE async_operation)
+{
+    my_gballoc_free(async_operation);
+}
+
+static AMQP_VALUE my_amqpvalue_clone(AMQP_VALUE value)
+{
+    return value;
+}
+
+/* the performatives stand for their own descriptors */
+static AMQP_VALUE my_amqpvalue_get_inplace_descriptor(AMQP_VALUE value)
+{
+    return value;
+}
+
+static bool my_is_attach_type_by_descriptor(AMQP_VALUE descriptor)
+{
+    return descriptor == TEST_ATTACH_PERFORMATIVE;
+}
+
+static bool my_is_flow_type_by_descriptor(AMQP_VALUE descriptor)
+{
+    return descriptor == TEST_FLOW_PERFORMATIVE;
+}
+
+static bool my_is_disposition_type_by_descriptor(AMQP_VALUE descriptor)
+{
+    return descriptor == TEST_DISPOSITION_PERFORMATIVE;
+}
+
+static int my_session_start_link_endpoint(LINK_ENDPOINT_HANDLE link_endpoint, ON_ENDPOINT_FRAME_RECEIVED frame_received_callback, ON_SESSION_STATE_CHANGED on_session_state_changed, ON_SESSION_FLOW_ON on_session_flow_on, void* context)
+{
+    (void)link_endpoint;
+    (void)on_session_flow_on;
+    saved_frame_received = frame_received_callback;
+    saved_on_session_state_changed = on_session_state_changed;
+    saved_link_endpoint_context = context;
+    return 0;
+}
+
+static int my_session_get_next_delivery_id(SESSION_HANDLE session, delivery_number* next_delivery_id)
+{
+    (void)session;
+    *next_delivery_id = test_next_delivery_id;
+    return 0;
+}
+
+static SESSION_SEND_TRANSFER_RESULT my_session_send_link_transfer(LINK_ENDPOINT_HANDLE link_endpoint, const unsigned char* delivery_tag, size_t delivery_tag_size, message_format message_format, bool settled, PAYLOAD* payloads, delivery_number* delivery_id, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    (void)link_endpoint;
+    (void)delivery_tag;
+    (void)delivery_tag_size;
+    (void)message_format;
+    (void)settled;
+    (void)payloads;
+    *delivery_id = test_next_delivery_id++;
+
+    if (test_complete_send_before_returning &&
+        (on_send_complete != NULL))
+    {
+        on_send_complete(callback_context, IO_SEND_OK);
+    }
+
+    return SESSION_SEND_TRANSFER_OK;
+}
+
+static int my_amqpvalue_get_attach(AMQP_VALUE value, ATTACH_HANDLE* attach_handle)
+{
+    (void)value;
+    *attach_handle = TEST_ATTACH_HANDLE;
+    return 0;
+}
+
+static int my_amqpvalue_get_flow(AMQP_VALUE value, FLOW_HANDLE* flow_handle)
+{
+    (void)value;
+    *flow_handle = TEST_FLOW_HANDLE;
+    return 0;
+}
+
+static int my_flow_get_link_credit(FLOW_HANDLE flow, uint32_t* link_credit_value)
+{
+    (void)flow;
+    *link_credit_value = test_link_credit;
+    return 0;
+}
+
+static int my_flow_get_delivery_count(FLOW_HANDLE flow, sequence_no* delivery_count_value)
+{
+    (void)flow;
+    *delivery_count_value = 0;
+    return 0;
+}
+
+static int my_amqpvalue_get_disposition(AMQP_VALUE value, DISPOSITION_HANDLE* disposition_handle)
+{
+    (void)value;
+    *disposition_handle = TEST_DISPOSITION_HANDLE;
+    return 0;
+}
+
+static int my_disposition_get_first(DISPOSITION_HANDLE disposition, delivery_number* first_value)
+{
+    (void)disposition;
+    *first_value = test_disposition_first;
+    return 0;
+}
+
+static int my_disposition_get_last(DISPOSITION_HANDLE disposition, delivery_number* last_value)
+{
+    (void)disposition;
+    *last_value = test_disposition_last;
+    return 0;
+}
+
+static int my_disposition_get_settled(DISPOSITION_HANDLE disposition, bool* settled_value)
+{
+    (void)disposition;
+    *settled_value = true;
+    return 0;
+}
+
+static int my_disposition_get_state(DISPOSITION_HANDLE disposition, AMQP_VALUE* state_value)
+{
+    (void)disposition;
+    *state_value = TEST_DELIVERY_STATE;
+    return 0;
+}
+
+static void test_on_link_state_changed(void* context, LINK_STATE new_link_state, LINK_STATE previous_link_state)
+{
+    (void)context;
+    (void)new_link_state;
+    (void)previous_link_state;
+}
+
+static void test_on_link_flow_on(void* context)
+{
+    (void)context;
+}
+
+static void test_on_delivery_settled(void* context, delivery_number delivery_no, LINK_DELIVERY_SETTLE_REASON reason, AMQP_VALUE delivery_state)
+{
+    (void)context;
+    (void)delivery_state;
+
+    ASSERT_IS_TRUE(test_settled_count < TEST_MAX_SETTLED);
+    test_settled_ids[test_settled_count] = delivery_no;
+    test_settled_reasons[test_settled_count] = reason;
+    test_settled_count++;
+}
+
+TEST_DEFINE_ENUM_TYPE(LINK_TRANSFER_RESULT, LINK_TRANSFER_RESULT_VALUES);
+TEST_DEFINE_ENUM_TYPE(LINK_DELIVERY_SETTLE_REASON, LINK_DELIVERY_SETTLE_REASON_VALUES);
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%" PRI_MU_ENUM "", MU_ENUM_VALUE(UMOCK_C_ERROR_CODE, error_code));
+}
+
+/* a sender link that the peer attached and gave plenty of credit */
+static LINK_HANDLE create_attached_sender_link(void)
+{
+    LINK_HANDLE link = link_create(TEST_SESSION_HANDLE, "test_link", role_sender, TEST_SOURCE, TEST_TARGET);
+    ASSERT_IS_NOT_NULL(link);
+    ASSERT_ARE_EQUAL(int, 0, link_attach(link, NULL, test_on_link_state_changed, test_on_link_flow_on, NULL));
+    saved_on_session_state_changed(saved_link_endpoint_context, SESSION_STATE_MAPPED, SESSION_STATE_BEGIN_SENT);
+    saved_frame_received(saved_link_endpoint_context, TEST_ATTACH_PERFORMATIVE, 0, NULL);
+    saved_frame_received(saved_link_endpoint_context, TEST_FLOW_PERFORMATIVE, 0, NULL);
+    umock_c_reset_all_calls();
+
+    return link;
+}
+
+static void send_transfers(LINK_HANDLE link, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        LINK_TRANSFER_RESULT link_transfer_result;
+        ASSERT_IS_NOT_NULL(link_transfer_async(link, 0, NULL, test_on_delivery_settled, NULL, &link_transfer_result, 0));
+    }
+}
+
+/* the peer settles the deliveries from first to last */
+static void receive_disposition(delivery_number first, delivery_number last)
+{
+    test_disposition_first = first;
+    test_disposition_last = last;
+    saved_frame_received(saved_link_endpoint_context, TEST_DISPOSITION_PERFORMATIVE, 0, NULL);
+}
+
+BEGIN_TEST_SUITE(link_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_bool_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, my_gballoc_calloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    REGISTER_GLOBAL_MOCK_HOOK(async_operation_create, my_async_operation_create);
+    REGISTER_GLOBAL_MOCK_HOOK(async_operation_destroy, my_async_operation_destroy);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_clone, my_amqpvalue_clone);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_inplace_descriptor, my_amqpvalue_get_inplace_descriptor);
+    REGISTER_GLOBAL_MOCK_HOOK(is_attach_type_by_descriptor, my_is_attach_type_by_descriptor);
+    REGISTER_GLOBAL_MOCK_HOOK(is_flow_type_by_descriptor, my_is_flow_type_by_descriptor);
+    REGISTER_GLOBAL_MOCK_HOOK(is_disposition_type_by_descriptor, my_is_disposition_type_by_descriptor);
+    REGISTER_GLOBAL_MOCK_RETURN(is_transfer_type_by_descriptor, false);
+    REGISTER_GLOBAL_MOCK_RETURN(is_detach_type_by_descriptor, false);
+    REGISTER_GLOBAL_MOCK_RETURN(session_create_link_endpoint, TEST_LINK_ENDPOINT);
+    REGISTER_GLOBAL_MOCK_RETURN(session_begin, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(session_start_link_endpoint, my_session_start_link_endpoint);
+    REGISTER_GLOBAL_MOCK_RETURN(session_send_attach, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(session_get_next_delivery_id, my_session_get_next_delivery_id);
+    REGISTER_GLOBAL_MOCK_HOOK(session_send_link_transfer, my_session_send_link_transfer);
+    REGISTER_GLOBAL_MOCK_RETURN(attach_create, TEST_ATTACH_HANDLE);
+    REGISTER_GLOBAL_MOCK_RETURN(attach_set_initial_delivery_count, 0);
+    REGISTER_GLOBAL_MOCK_RETURN(attach_set_max_message_size, 0);
+    REGISTER_GLOBAL_MOCK_RETURN(attach_get_max_message_size, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_attach, my_amqpvalue_get_attach);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_flow, my_amqpvalue_get_flow);
+    REGISTER_GLOBAL_MOCK_HOOK(flow_get_link_credit, my_flow_get_link_credit);
+    REGISTER_GLOBAL_MOCK_HOOK(flow_get_delivery_count, my_flow_get_delivery_count);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_disposition, my_amqpvalue_get_disposition);
+    REGISTER_GLOBAL_MOCK_HOOK(disposition_get_first, my_disposition_get_first);
+    REGISTER_GLOBAL_MOCK_HOOK(disposition_get_last, my_disposition_get_last);
+    REGISTER_GLOBAL_MOCK_HOOK(disposition_get_settled, my_disposition_get_settled);
+    REGISTER_GLOBAL_MOCK_HOOK(disposition_get_state, my_disposition_get_state);
+
+    REGISTER_UMOCK_ALIAS_TYPE(SESSION_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(LINK_ENDPOINT_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ATTACH_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ATTACH_HANDLE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(FLOW_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(FLOW_HANDLE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(DISPOSITION_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(DISPOSITION_HANDLE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(DETACH_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TRANSFER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ERROR_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ASYNC_OPERATION_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ASYNC_OPERATION_CANCEL_HANDLER_FUNC, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_LINK_ENDPOINT_DESTROYED_CALLBACK, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_ENDPOINT_FRAME_RECEIVED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_SESSION_STATE_CHANGED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_SESSION_FLOW_ON, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_SEND_COMPLETE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_TIMER_EXPIRED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TIMER*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(const TIMER*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TIMER_QUEUE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PAYLOAD*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(const unsigned char*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(SESSION_SEND_TRANSFER_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(role, bool);
+    REGISTER_UMOCK_ALIAS_TYPE(handle, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(sender_settle_mode, uint8_t);
+    REGISTER_UMOCK_ALIAS_TYPE(receiver_settle_mode, uint8_t);
+    REGISTER_UMOCK_ALIAS_TYPE(sequence_no, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(sequence_no*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(delivery_number, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(delivery_number*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(message_format, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(uint32_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(uint64_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(bool*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(tickcounter_ms_t, unsigned long long);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+
+    umock_c_reset_all_calls();
+
+    test_next_delivery_id = 0;
+    test_link_credit = 1000;
+    test_disposition_first = 0;
+    test_disposition_last = 0;
+    (void)memset(test_settled_ids, 0, sizeof(test_settled_ids));
+    (void)memset(test_settled_reasons, 0, sizeof(test_settled_reasons));
+    test_settled_count = 0;
+    test_complete_send_before_returning = false;
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* link_transfer_async */
+
+TEST_FUNCTION(link_transfer_async_reserves_room_for_the_next_delivery_id_before_sending)
+{
+    // arrange
+    LINK_TRANSFER_RESULT link_transfer_result;
+    ASYNC_OPERATION_HANDLE result;
+    LINK_HANDLE link = create_attached_sender_link();
+    test_next_delivery_id = 5;
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(timer_init(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(session_get_next_delivery_id(TEST_SESSION_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(session_send_link_transfer(TEST_LINK_ENDPOINT, IGNORED_PTR_ARG, IGNORED_NUM_ARG, 0, false, NULL, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG));
+
+    // act
+    result = link_transfer_async(link, 0, NULL, test_on_delivery_settled, NULL, &link_transfer_result, 0);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    link_destroy(link);
+}
+
+TEST_FUNCTION(when_a_settled_transfer_is_settled_while_it_is_sent_link_transfer_async_returns_NULL_and_OK)
+{
+    // arrange
+    LINK_TRANSFER_RESULT link_transfer_result = LINK_TRANSFER_ERROR;
+    ASYNC_OPERATION_HANDLE result;
+    LINK_HANDLE link = create_attached_sender_link();
+    ASSERT_ARE_EQUAL(int, 0, link_set_snd_settle_mode(link, sender_settle_mode_settled));
+    test_complete_send_before_returning = true;
+
+    // act
+    result = link_transfer_async(link, 0, NULL, test_on_delivery_settled, NULL, &link_transfer_result, 0);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(LINK_TRANSFER_RESULT, LINK_TRANSFER_OK, link_transfer_result);
+    ASSERT_ARE_EQUAL(size_t, 1, test_settled_count);
+    ASSERT_ARE_EQUAL(uint32_t, 0, test_settled_ids[0]);
+    ASSERT_ARE_EQUAL(LINK_DELIVERY_SETTLE_REASON, LINK_DELIVERY_SETTLE_REASON_SETTLED, test_settled_reasons[0]);
+
+    // cleanup
+    link_destroy(link);
+}
+
+TEST_FUNCTION(when_making_room_for_the_delivery_fails_link_transfer_async_does_not_send_it)
+{
+    // arrange
+    LINK_TRANSFER_RESULT link_transfer_result;
+    ASYNC_OPERATION_HANDLE result;
+    LINK_HANDLE link = create_attached_sender_link();
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(timer_init(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(session_get_next_delivery_id(TEST_SESSION_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(async_operation_destroy(IGNORED_PTR_ARG));
+
+    // act
+    result = link_transfer_async(link, 0, NULL, test_on_delivery_settled, NULL, &link_transfer_result, 0);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(LINK_TRANSFER_RESULT, LINK_TRANSFER_ERROR, link_transfer_result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    link_destroy(link);
+}
+
+TEST_FUNCTION(when_other_links_took_delivery_ids_the_room_for_them_is_made_before_sending)
+{
+    // arrange
+    LINK_TRANSFER_RESULT link_transfer_result;
+    ASYNC_OPERATION_HANDLE result;
+    LINK_HANDLE link = create_attached_sender_link();
+    send_transfers(link, 1);
+    /* other links of the session sent deliveries 1 to 99 */
+    test_next_delivery_id = 100;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(timer_init(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(session_get_next_delivery_id(TEST_SESSION_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_calloc(IGNORED_NUM_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(session_send_link_transfer(TEST_LINK_ENDPOINT, IGNORED_PTR_ARG, IGNORED_NUM_ARG, 0, false, NULL, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG));
+
+    // act
+    result = link_transfer_async(link, 0, NULL, test_on_delivery_settled, NULL, &link_transfer_result, 0);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    receive_disposition(0, 100);
+    ASSERT_ARE_EQUAL(size_t, 2, test_settled_count);
+    ASSERT_ARE_EQUAL(uint32_t, 0, test_settled_ids[0]);
+    ASSERT_ARE_EQUAL(uint32_t, 100, test_settled_ids[1]);
+
+    // cleanup
+    link_destroy(link);
+}
+
+/* disposition received */
+
+TEST_FUNCTION(a_disposition_settles_the_pending_deliveries_in_its_range)
+{
+    // arrange
+    LINK_HANDLE link = create_attached_sender_link();
+    test_next_delivery_id = 10;
+    send_transfers(link, 5);
+    umock_c_reset_all_calls();
+
+    // act
+    receive_disposition(11, 13);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 3, test_settled_count);
+    ASSERT_ARE_EQUAL(uint32_t, 11, test_settled_ids[0]);
+    ASSERT_ARE_EQUAL(uint32_t, 12, test_settled_ids[1]);
+    ASSERT_ARE_EQUAL(uint32_t, 13, test_settled_ids[2]);
+    ASSERT_ARE_EQUAL(LINK_DELIVERY_SETTLE_REASON, LINK_DELIVERY_SETTLE_REASON_DISPOSITION_RECEIVED, test_settled_reasons[0]);
+    ASSERT_ARE_EQUAL(LINK_DELIVERY_SETTLE_REASON, LINK_DELIVERY_SETTLE_REASON_DISPOSITION_RECEIVED, test_settled_reasons[2]);
+
+    // cleanup
+    link_destroy(link);
+}
+
+TEST_FUNCTION(a_disposition_over_a_settled_gap_settles_the_deliveries_left_on_both_sides)
+{
+    // arrange
+    LINK_HANDLE link = create_attached_sender_link();
+    test_next_delivery_id = 10;
+    send_transfers(link, 5);
+    receive_disposition(11, 13);
+    test_settled_count = 0;
+    umock_c_reset_all_calls();
+
+    // act
+    receive_disposition(0, 20);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, test_settled_count);
+    ASSERT_ARE_EQUAL(uint32_t, 10, test_settled_ids[0]);
+    ASSERT_ARE_EQUAL(uint32_t, 14, test_settled_ids[1]);
+
+    // cleanup
+    link_destroy(link);
+}
+
+TEST_FUNCTION(a_disposition_outside_the_pending_deliveries_settles_nothing)
+{
+    // arrange
+    LINK_HANDLE link = create_attached_sender_link();
+    test_next_delivery_id = 10;
+    send_transfers(link, 2);
+    umock_c_reset_all_calls();
+
+    // act
+    receive_disposition(0, 9);
+    receive_disposition(12, 100);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, test_settled_count);
+    receive_disposition(10, 11);
+    ASSERT_ARE_EQUAL(size_t, 2, test_settled_count);
+
+    // cleanup
+    link_destroy(link);
+}
+
+TEST_FUNCTION(a_disposition_settles_pending_deliveries_whose_ids_wrap_around)
+{
+    // arrange
+    LINK_HANDLE link = create_attached_sender_link();
+    test_next_delivery_id = 0xFFFFFFFE;
+    send_transfers(link, 4);
+    umock_c_reset_all_calls();
+
+    // act
+    receive_disposition(0xFFFFFFFF, 0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, test_settled_count);
+    ASSERT_ARE_EQUAL(uint32_t, 0xFFFFFFFF, test_settled_ids[0]);
+    ASSERT_ARE_EQUAL(uint32_t, 0, test_settled_ids[1]);
+    receive_disposition(0xFFFFFFF0, 5);
+    ASSERT_ARE_EQUAL(size_t, 4, test_settled_count);
+    ASSERT_ARE_EQUAL(uint32_t, 0xFFFFFFFE, test_settled_ids[2]);
+    ASSERT_ARE_EQUAL(uint32_t, 1, test_settled_ids[3]);
+
+    // cleanup
+    link_destroy(link);
+}
+
+TEST_FUNCTION(pending_deliveries_keep_their_order_when_the_ring_grows_after_wrapping)
+{
+    // arrange
+    size_t i;
+    LINK_HANDLE link = create_attached_sender_link();
+    test_next_delivery_id = 100;
+    /* settling the front as new deliveries are added makes the 16 slots ring wrap before it grows */
+    send_transfers(link, 12);
+    receive_disposition(100, 109);
+    send_transfers(link, 20);
+    umock_c_reset_all_calls();
+
+    // act
+    receive_disposition(0, 0xFFFF);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 32, test_settled_count);
+    for (i = 0; i < 32; i++)
+    {
+        ASSERT_ARE_EQUAL(uint32_t, 100 + (uint32_t)i, test_settled_ids[i]);
+    }
+
+    // cleanup
+    link_destroy(link);
+}
+
+/* link_dowork */
+
+TEST_FUNCTION(link_dowork_does_not_run_the_connection_timer_queue)
+{
+    // arrange
+    LINK_HANDLE link = create_attached_sender_link();
+    send_transfers(link, 1);
+    umock_c_reset_all_calls();
+
+    // act
+    link_dowork(link);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    link_destroy(link);
+}
+
+END_TEST_SUITE(link_ut)
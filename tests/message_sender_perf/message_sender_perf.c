@@ -0,0 +1,403 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "azure_c_shared_utility/platform.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/socketio.h"
+#include "azure_uamqp_c/uamqp.h"
+
+/* all messages are queued before the link attaches, so the sender starts with a deep backlog
+that is drained as credit arrives and settled as dispositions come back */
+#define QUEUED_MESSAGE_COUNT 100000
+#define TEST_TIMEOUT 60000 // ms
+#define PERF_PORT 5672
+
+typedef struct SERVER_TAG
+{
+    CONNECTION_HANDLE connection;
+    SESSION_HANDLE session;
+    LINK_HANDLE link;
+    MESSAGE_RECEIVER_HANDLE message_receiver;
+    XIO_HANDLE io;
+    size_t messages_received;
+} SERVER;
+
+static SERVER server;
+static size_t messages_settled;
+static size_t messages_failed;
+
+static AMQP_VALUE on_message_received(const void* context, MESSAGE_HANDLE message)
+{
+    (void)context;
+    (void)message;
+
+    server.messages_received++;
+
+    return messaging_delivery_accepted();
+}
+
+static bool on_new_link_attached(void* context, LINK_ENDPOINT_HANDLE new_link_endpoint, const char* name, role role, AMQP_VALUE source, AMQP_VALUE target, fields properties)
+{
+    bool result;
+    (void)context;
+    (void)properties;
+
+    server.link = link_create_from_endpoint(server.session, new_link_endpoint, name, role, source, target);
+    if (server.link == NULL)
+    {
+        LogError("Cannot create link");
+        result = false;
+    }
+    else if (link_set_rcv_settle_mode(server.link, receiver_settle_mode_first) != 0)
+    {
+        LogError("Cannot set receiver settle mode");
+        result = false;
+    }
+    else
+    {
+        server.message_receiver = messagereceiver_create(server.link, NULL, NULL);
+        if (server.message_receiver == NULL)
+        {
+            LogError("Cannot create message receiver");
+            result = false;
+        }
+        else if (messagereceiver_open(server.message_receiver, on_message_received, NULL) != 0)
+        {
+            LogError("Cannot open message receiver");
+            result = false;
+        }
+        else
+        {
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+static bool on_new_session_endpoint(void* context, ENDPOINT_HANDLE new_endpoint)
+{
+    bool result;
+    (void)context;
+
+    server.session = session_create_from_endpoint(server.connection, new_endpoint, on_new_link_attached, NULL);
+    if (server.session == NULL)
+    {
+        LogError("Cannot create session");
+        result = false;
+    }
+    else if ((session_set_incoming_window(server.session, QUEUED_MESSAGE_COUNT) != 0) ||
+        (session_begin(server.session) != 0))
+    {
+        LogError("Cannot begin session");
+        result = false;
+    }
+    else
+    {
+        result = true;
+    }
+
+    return result;
+}
+
+static void on_socket_accepted(void* context, const IO_INTERFACE_DESCRIPTION* interface_description, void* io_parameters)
+{
+    XIO_HANDLE underlying_io;
+    (void)context;
+
+    underlying_io = xio_create(interface_description, io_parameters);
+    if (underlying_io == NULL)
+    {
+        LogError("Cannot create accepted socket IO");
+    }
+    else
+    {
+        HEADER_DETECT_IO_CONFIG header_detect_io_config;
+        HEADER_DETECT_ENTRY header_detect_entries[1];
+
+        header_detect_entries[0].header = header_detect_io_get_amqp_header();
+        header_detect_entries[0].io_interface_description = NULL;
+
+        header_detect_io_config.underlying_io = underlying_io;
+        header_detect_io_config.header_detect_entry_count = 1;
+        header_detect_io_config.header_detect_entries = header_detect_entries;
+        server.io = xio_create(header_detect_io_get_interface_description(), &header_detect_io_config);
+        if (server.io == NULL)
+        {
+            xio_destroy(underlying_io);
+            LogError("Cannot create header detect IO");
+        }
+        else
+        {
+            server.connection = connection_create(server.io, NULL, "1", on_new_session_endpoint, NULL);
+            if (server.connection == NULL)
+            {
+                LogError("Cannot create server connection");
+            }
+            else if (connection_listen(server.connection) != 0)
+            {
+                LogError("Cannot listen on server connection");
+            }
+        }
+    }
+}
+
+static void on_message_send_complete(void* context, MESSAGE_SEND_RESULT send_result, AMQP_VALUE delivery_state)
+{
+    (void)context;
+    (void)delivery_state;
+
+    if (send_result == MESSAGE_SEND_OK)
+    {
+        messages_settled++;
+    }
+    else
+    {
+        messages_failed++;
+    }
+}
+
+static int queue_messages(MESSAGE_SENDER_HANDLE message_sender)
+{
+    int result;
+    MESSAGE_HANDLE message = message_create();
+    BINARY_DATA binary_data = payload_create();
+
+    if ((message == NULL) ||
+        (binary_data == NULL))
+    {
+        LogError("Error creating message");
+        result = __LINE__;
+    }
+    else
+    {
+        unsigned char hello[] = { 'H', 'e', 'l', 'l', 'o' };
+
+        payload_append_data(binary_data, hello, sizeof(hello));
+        if (message_add_body_amqp_data(message, binary_data) != 0)
+        {
+            LogError("Error setting message body");
+            result = __LINE__;
+        }
+        else
+        {
+            size_t i;
+
+            result = 0;
+
+            for (i = 0; i < QUEUED_MESSAGE_COUNT; i++)
+            {
+                if (messagesender_send_async(message_sender, message, on_message_send_complete, NULL, 0) == NULL)
+                {
+                    LogError("Error queueing message %lu", (unsigned long)i);
+                    result = __LINE__;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (binary_data != NULL)
+    {
+        payload_destroy(&binary_data);
+    }
+
+    if (message != NULL)
+    {
+        message_destroy(message);
+    }
+
+    return result;
+}
+
+static int run_client(SOCKET_LISTENER_HANDLE socket_listener, TICK_COUNTER_HANDLE tick_counter)
+{
+    int result;
+    SOCKETIO_CONFIG socketio_config = { "localhost", PERF_PORT, NULL };
+    XIO_HANDLE io = xio_create(socketio_get_interface_description(), &socketio_config);
+    if (io == NULL)
+    {
+        LogError("Cannot create client IO");
+        result = __LINE__;
+    }
+    else
+    {
+        CONNECTION_HANDLE connection = connection_create(io, "localhost", "some", NULL, NULL);
+        SESSION_HANDLE session = (connection == NULL) ? NULL : session_create(connection, NULL, NULL);
+        if (session == NULL)
+        {
+            LogError("Cannot create client connection and session");
+            result = __LINE__;
+        }
+        else
+        {
+            AMQP_VALUE source = messaging_create_source("ingress");
+            AMQP_VALUE target = messaging_create_target("localhost/ingress");
+            LINK_HANDLE link = link_create(session, "sender-link", role_sender, source, target);
+            MESSAGE_SENDER_HANDLE message_sender = (link == NULL) ? NULL : messagesender_create(link, NULL, NULL);
+
+            amqpvalue_destroy(source);
+            amqpvalue_destroy(target);
+
+            if (message_sender == NULL)
+            {
+                LogError("Cannot create client link and message sender");
+                result = __LINE__;
+            }
+            else
+            {
+                tickcounter_ms_t start_ms;
+                tickcounter_ms_t queued_ms;
+                tickcounter_ms_t current_ms;
+
+                if ((session_set_outgoing_window(session, QUEUED_MESSAGE_COUNT) != 0) ||
+                    (link_set_snd_settle_mode(link, sender_settle_mode_unsettled) != 0) ||
+                    (tickcounter_get_current_ms(tick_counter, &start_ms) != 0) ||
+                    (queue_messages(message_sender) != 0) ||
+                    (tickcounter_get_current_ms(tick_counter, &queued_ms) != 0) ||
+                    (messagesender_open(message_sender) != 0))
+                {
+                    LogError("Cannot queue messages");
+                    result = __LINE__;
+                }
+                else
+                {
+                    result = 0;
+                    current_ms = queued_ms;
+
+                    while (messages_settled + messages_failed < QUEUED_MESSAGE_COUNT)
+                    {
+                        socketlistener_dowork(socket_listener);
+                        connection_dowork(connection);
+                        if (server.connection != NULL)
+                        {
+                            connection_dowork(server.connection);
+                        }
+
+                        if (tickcounter_get_current_ms(tick_counter, &current_ms) != 0)
+                        {
+                            LogError("Cannot get tick counter value");
+                            result = __LINE__;
+                            break;
+                        }
+
+                        if (current_ms - start_ms > TEST_TIMEOUT)
+                        {
+                            LogError("Timed out with %lu messages settled", (unsigned long)messages_settled);
+                            result = __LINE__;
+                            break;
+                        }
+                    }
+
+                    if (result == 0)
+                    {
+                        double seconds = ((double)current_ms - queued_ms) / 1000;
+
+                        LogInfo("Queued %lu messages in %.03f seconds, sent and settled them in %.03f seconds, %.02f messages/s, %lu failed",
+                            (unsigned long)QUEUED_MESSAGE_COUNT,
+                            ((double)queued_ms - start_ms) / 1000,
+                            seconds,
+                            (seconds > 0) ? (messages_settled / seconds) : 0.0,
+                            (unsigned long)messages_failed);
+                    }
+                }
+
+                messagesender_destroy(message_sender);
+            }
+
+            if (link != NULL)
+            {
+                link_destroy(link);
+            }
+
+            session_destroy(session);
+        }
+
+        if (connection != NULL)
+        {
+            connection_destroy(connection);
+        }
+
+        xio_destroy(io);
+    }
+
+    return result;
+}
+
+int main(void)
+{
+    int result;
+
+    if (platform_init() != 0)
+    {
+        LogError("platform_init failed");
+        result = __LINE__;
+    }
+    else
+    {
+        SOCKET_LISTENER_HANDLE socket_listener = socketlistener_create(PERF_PORT);
+        if (socket_listener == NULL)
+        {
+            LogError("Cannot create socket listener");
+            result = __LINE__;
+        }
+        else
+        {
+            if (socketlistener_start(socket_listener, on_socket_accepted, NULL) != 0)
+            {
+                LogError("socketlistener_start failed");
+                result = __LINE__;
+            }
+            else
+            {
+                TICK_COUNTER_HANDLE tick_counter = tickcounter_create();
+                if (tick_counter == NULL)
+                {
+                    LogError("Cannot create tick counter");
+                    result = __LINE__;
+                }
+                else
+                {
+                    result = run_client(socket_listener, tick_counter);
+                    tickcounter_destroy(tick_counter);
+                }
+
+                (void)socketlistener_stop(socket_listener);
+            }
+
+            socketlistener_destroy(socket_listener);
+        }
+
+        if (server.message_receiver != NULL)
+        {
+            messagereceiver_destroy(server.message_receiver);
+        }
+
+        if (server.link != NULL)
+        {
+            link_destroy(server.link);
+        }
+
+        if (server.session != NULL)
+        {
+            session_destroy(server.session);
+        }
+
+        if (server.connection != NULL)
+        {
+            connection_destroy(server.connection);
+        }
+
+        if (server.io != NULL)
+        {
+            xio_destroy(server.io);
+        }
+
+        platform_deinit();
+    }
+
+    return result;
+}
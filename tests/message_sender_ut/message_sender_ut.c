@@ -0,0 +1,1170 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#endif
+
+#include "azure_macro_utils/macro_utils.h"
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_bool.h"
+#include "umock_c/umocktypes_stdint.h"
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* my_gballoc_calloc(size_t nmemb, size_t size)
+{
+    return calloc(nmemb, size);
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#define ENABLE_MOCKS
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_uamqp_c/link.h"
+#include "azure_uamqp_c/message.h"
+#include "azure_uamqp_c/amqpvalue_to_string.h"
+#include "azure_uamqp_c/async_operation.h"
+#include "azure_uamqp_c/amqp_definitions.h"
+
+#undef ENABLE_MOCKS
+
+#include "azure_uamqp_c/message_sender.h"
+#include "azure_uamqp_c/payload.h"
+
+#define TEST_LINK_HANDLE            (LINK_HANDLE)0x4242
+#define TEST_MESSAGE_1              (MESSAGE_HANDLE)0x4301
+#define TEST_MESSAGE_2              (MESSAGE_HANDLE)0x4302
+#define TEST_MESSAGE_3              (MESSAGE_HANDLE)0x4303
+/* a message with a single data section, its body is test_data_body */
+#define TEST_DATA_MESSAGE           (MESSAGE_HANDLE)0x4304
+/* a message whose body encodes to TEST_LARGE_ENCODED_BODY_SIZE bytes */
+#define TEST_LARGE_MESSAGE          (MESSAGE_HANDLE)0x4305
+#define TEST_TIMEOUT                10000
+#define TEST_MAX_TRANSFERS          8
+#define TEST_ENCODED_BODY_SIZE      4
+#define TEST_LARGE_ENCODED_BODY_SIZE 64
+/* a message in a batched message is a data section: descriptor, vbin8 constructor and length, then the encoded message */
+#define TEST_DATA_SECTION_SIZE      (5 + TEST_ENCODED_BODY_SIZE)
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+/* the encoded body of a message is made of the low byte of its handle, so that a transfer tells which message it carries */
+static unsigned char test_message_id(MESSAGE_HANDLE message)
+{
+    return (unsigned char)((uintptr_t)message & 0xFF);
+}
+
+typedef struct TEST_ASYNC_OPERATION_TAG
+{
+    ASYNC_OPERATION_CANCEL_HANDLER_FUNC async_operation_cancel_handler;
+} TEST_ASYNC_OPERATION;
+
+static ASYNC_OPERATION_HANDLE my_async_operation_create(ASYNC_OPERATION_CANCEL_HANDLER_FUNC async_operation_cancel_handler, size_t context_size)
+{
+    TEST_ASYNC_OPERATION* result = (TEST_ASYNC_OPERATION*)my_gballoc_malloc(context_size);
+    if (result != NULL)
+    {
+        result->async_operation_cancel_handler = async_operation_cancel_handler;
+    }
+
+    return (ASYNC_OPERATION_HANDLE)result;
+}
+
+static void my_async_operation_destroy(ASYNC_OPERATION_HANDLE async_operation)
+{
+    my_gballoc_free(async_operation);
+}
+
+static int my_async_operation_cancel(ASYNC_OPERATION_HANDLE async_operation)
+{
+    ((TEST_ASYNC_OPERATION*)async_operation)->async_operation_cancel_handler(async_operation);
+    return 0;
+}
+
+/* what the fake link does with each transfer, in call order */
+typedef enum TEST_TRANSFER_ACTION_TAG
+{
+    TEST_TRANSFER_PENDING,
+    TEST_TRANSFER_SETTLE,
+    TEST_TRANSFER_BUSY,
+    TEST_TRANSFER_ERROR
+} TEST_TRANSFER_ACTION;
+
+typedef struct TEST_TRANSFER_TAG
+{
+    ASYNC_OPERATION_HANDLE operation;
+    ON_DELIVERY_SETTLED on_delivery_settled;
+    void* callback_context;
+} TEST_TRANSFER;
+
+static TEST_TRANSFER_ACTION test_transfer_actions[TEST_MAX_TRANSFERS];
+static TEST_TRANSFER test_transfers[TEST_MAX_TRANSFERS];
+static unsigned char test_transferred_message_ids[TEST_MAX_TRANSFERS];
+static size_t test_transferred_sizes[TEST_MAX_TRANSFERS];
+static size_t test_transfer_count;
+
+static uint64_t test_peer_max_message_size;
+
+static ON_LINK_STATE_CHANGED saved_on_link_state_changed;
+static ON_LINK_FLOW_ON saved_on_link_flow_on;
+static void* saved_link_callback_context;
+
+static size_t test_batch_complete_call_count;
+static MESSAGE_SEND_RESULT test_batch_send_results[TEST_MAX_TRANSFERS];
+static size_t test_batch_message_count;
+
+static void test_on_message_batch_send_complete(void* context, const MESSAGE_SEND_RESULT* send_results, size_t message_count)
+{
+    (void)context;
+    test_batch_complete_call_count++;
+    test_batch_message_count = message_count;
+    (void)memcpy(test_batch_send_results, send_results, message_count * sizeof(MESSAGE_SEND_RESULT));
+}
+
+static size_t test_send_complete_call_count;
+static MESSAGE_SEND_RESULT test_send_complete_result;
+
+static void test_on_message_send_complete(void* context, MESSAGE_SEND_RESULT send_result, AMQP_VALUE delivery_state)
+{
+    (void)context;
+    (void)delivery_state;
+    test_send_complete_call_count++;
+    test_send_complete_result = send_result;
+}
+
+static void test_transfer_cancel_handler(ASYNC_OPERATION_HANDLE async_operation)
+{
+    size_t i;
+
+    for (i = 0; i < test_transfer_count; i++)
+    {
+        if (test_transfers[i].operation == async_operation)
+        {
+            test_transfers[i].operation = NULL;
+            test_transfers[i].on_delivery_settled(test_transfers[i].callback_context, (delivery_number)i, LINK_DELIVERY_SETTLE_REASON_CANCELLED, NULL);
+            break;
+        }
+    }
+
+    my_async_operation_destroy(async_operation);
+}
+
+/* settles a pending transfer the way the link does when the peer settles it */
+static void settle_transfer(size_t index, LINK_DELIVERY_SETTLE_REASON reason)
+{
+    ASYNC_OPERATION_HANDLE operation = test_transfers[index].operation;
+
+    ASSERT_IS_NOT_NULL(operation);
+    test_transfers[index].operation = NULL;
+    test_transfers[index].on_delivery_settled(test_transfers[index].callback_context, (delivery_number)index, reason, NULL);
+    my_async_operation_destroy(operation);
+}
+
+static int my_link_attach(LINK_HANDLE link, ON_TRANSFER_RECEIVED on_transfer_received, ON_LINK_STATE_CHANGED on_link_state_changed, ON_LINK_FLOW_ON on_link_flow_on, void* callback_context)
+{
+    (void)link;
+    (void)on_transfer_received;
+    saved_on_link_state_changed = on_link_state_changed;
+    saved_on_link_flow_on = on_link_flow_on;
+    saved_link_callback_context = callback_context;
+    return 0;
+}
+
+static ASYNC_OPERATION_HANDLE my_link_transfer_async(LINK_HANDLE handle, message_format message_format, PAYLOAD* payloads, ON_DELIVERY_SETTLED on_delivery_settled, void* callback_context, LINK_TRANSFER_RESULT* link_transfer_result, tickcounter_ms_t timeout)
+{
+    ASYNC_OPERATION_HANDLE result;
+    size_t index = test_transfer_count++;
+    unsigned char* bytes;
+    (void)handle;
+    (void)message_format;
+    (void)timeout;
+
+    ASSERT_IS_TRUE(index < TEST_MAX_TRANSFERS);
+
+    /* the payload only lives for the call */
+    test_transferred_sizes[index] = payload_stream_to_heap(payloads, &bytes);
+    if (test_transferred_sizes[index] > 0)
+    {
+        test_transferred_message_ids[index] = bytes[test_transferred_sizes[index] - 1];
+        free(bytes);
+    }
+
+    test_transfers[index].operation = NULL;
+    test_transfers[index].on_delivery_settled = on_delivery_settled;
+    test_transfers[index].callback_context = callback_context;
+
+    switch (test_transfer_actions[index])
+    {
+    default:
+    case TEST_TRANSFER_ERROR:
+        *link_transfer_result = LINK_TRANSFER_ERROR;
+        result = NULL;
+        break;
+
+    case TEST_TRANSFER_BUSY:
+        *link_transfer_result = LINK_TRANSFER_BUSY;
+        result = NULL;
+        break;
+
+    case TEST_TRANSFER_SETTLE:
+        /* sent settled, so the link settles the delivery before returning */
+        on_delivery_settled(callback_context, (delivery_number)index, LINK_DELIVERY_SETTLE_REASON_SETTLED, NULL);
+        *link_transfer_result = LINK_TRANSFER_OK;
+        result = NULL;
+        break;
+
+    case TEST_TRANSFER_PENDING:
+        *link_transfer_result = LINK_TRANSFER_OK;
+        result = my_async_operation_create(test_transfer_cancel_handler, sizeof(TEST_ASYNC_OPERATION));
+        test_transfers[index].operation = result;
+        break;
+    }
+
+    return result;
+}
+
+static int my_link_get_peer_max_message_size(LINK_HANDLE link, uint64_t* peer_max_message_size)
+{
+    (void)link;
+    *peer_max_message_size = test_peer_max_message_size;
+    return 0;
+}
+
+static PAYLOAD* test_data_body;
+
+static int my_message_get_body_type(MESSAGE_HANDLE message, MESSAGE_BODY_TYPE* body_type)
+{
+    *body_type = (message == TEST_DATA_MESSAGE) ? MESSAGE_BODY_TYPE_DATA : MESSAGE_BODY_TYPE_VALUE;
+    return 0;
+}
+
+static int my_message_get_body_amqp_data_count(MESSAGE_HANDLE message, size_t* count)
+{
+    (void)message;
+    *count = 1;
+    return 0;
+}
+
+static BINARY_DATA my_message_get_body_amqp_data_in_place(MESSAGE_HANDLE message, size_t index)
+{
+    (void)message;
+    (void)index;
+    return test_data_body;
+}
+
+/* the data section value stands for the message, so that it is encoded like a message body */
+static AMQP_VALUE my_amqpvalue_create_data(data value)
+{
+    (void)value;
+    return (AMQP_VALUE)TEST_DATA_MESSAGE;
+}
+
+static bool test_body_producer(void* user_context, PAYLOAD_WRITE_FUNCTION* stream_writer, void* stream_context)
+{
+    (void)user_context;
+    return stream_writer(stream_context, (const unsigned char*)"body", 4);
+}
+
+static int my_message_get_message_format(MESSAGE_HANDLE message, uint32_t* message_format)
+{
+    (void)message;
+    *message_format = 0;
+    return 0;
+}
+
+static int my_message_get_body_amqp_value_in_place(MESSAGE_HANDLE message, AMQP_VALUE* body_amqp_value)
+{
+    *body_amqp_value = (AMQP_VALUE)message;
+    return 0;
+}
+
+static MESSAGE_HANDLE my_message_clone(MESSAGE_HANDLE source_message)
+{
+    return source_message;
+}
+
+static AMQP_VALUE my_amqpvalue_create_amqp_value(AMQP_VALUE value)
+{
+    return value;
+}
+
+static int my_amqpvalue_get_encoded_size(AMQP_VALUE value, size_t* encoded_size)
+{
+    *encoded_size = (value == (AMQP_VALUE)TEST_LARGE_MESSAGE) ? TEST_LARGE_ENCODED_BODY_SIZE : TEST_ENCODED_BODY_SIZE;
+    return 0;
+}
+
+static int my_amqpvalue_encode_to_payload(AMQP_VALUE value, PAYLOAD* payload)
+{
+    unsigned char bytes[TEST_ENCODED_BODY_SIZE];
+
+    (void)memset(bytes, test_message_id((MESSAGE_HANDLE)value), sizeof(bytes));
+    payload_append_data(payload, bytes, sizeof(bytes));
+    return 0;
+}
+
+TEST_DEFINE_ENUM_TYPE(MESSAGE_SEND_RESULT, MESSAGE_SEND_RESULT_VALUES);
+TEST_DEFINE_ENUM_TYPE(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_RESULT_VALUES);
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%" PRI_MU_ENUM "", MU_ENUM_VALUE(UMOCK_C_ERROR_CODE, error_code));
+}
+
+static MESSAGE_SENDER_HANDLE create_open_message_sender(void)
+{
+    MESSAGE_SENDER_HANDLE message_sender = messagesender_create(TEST_LINK_HANDLE, NULL, NULL);
+    ASSERT_IS_NOT_NULL(message_sender);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_open(message_sender));
+    saved_on_link_state_changed(saved_link_callback_context, LINK_STATE_ATTACHED, LINK_STATE_DETACHED);
+    umock_c_reset_all_calls();
+
+    return message_sender;
+}
+
+/* the calls made to encode and transfer one message that has no header, annotations or properties */
+static void setup_send_message_expectations(MESSAGE_HANDLE message)
+{
+    STRICT_EXPECTED_CALL(message_get_message_format(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_type(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_header(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_message_annotations(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_properties(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_application_properties(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_amqp_value_in_place(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_create_amqp_value((AMQP_VALUE)message));
+    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size((AMQP_VALUE)message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload((AMQP_VALUE)message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_destroy((AMQP_VALUE)message));
+    STRICT_EXPECTED_CALL(link_transfer_async(TEST_LINK_HANDLE, 0, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, TEST_TIMEOUT));
+}
+
+/* the calls made to size a message for a batched message, and to encode it when it fits */
+static void setup_batched_message_add_expectations(MESSAGE_HANDLE message, bool fits)
+{
+    STRICT_EXPECTED_CALL(link_get_peer_max_message_size(TEST_LINK_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_type(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_header(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_message_annotations(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_properties(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_application_properties(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_amqp_value_in_place(message, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_create_amqp_value((AMQP_VALUE)message));
+    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size((AMQP_VALUE)message, IGNORED_PTR_ARG));
+    if (fits)
+    {
+        STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload((AMQP_VALUE)message, IGNORED_PTR_ARG));
+    }
+    STRICT_EXPECTED_CALL(amqpvalue_destroy((AMQP_VALUE)message));
+}
+
+static BATCHED_MESSAGE_HANDLE create_batched_message(MESSAGE_SENDER_HANDLE message_sender, size_t message_count)
+{
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2, TEST_MESSAGE_3 };
+    BATCHED_MESSAGE_HANDLE batched_message = messagesender_batched_message_create(message_sender);
+    size_t i;
+
+    ASSERT_IS_NOT_NULL(batched_message);
+    for (i = 0; i < message_count; i++)
+    {
+        ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_OK, messagesender_batched_message_add(batched_message, messages[i]));
+    }
+
+    umock_c_reset_all_calls();
+
+    return batched_message;
+}
+
+BEGIN_TEST_SUITE(message_sender_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_bool_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, my_gballoc_calloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    REGISTER_GLOBAL_MOCK_HOOK(async_operation_create, my_async_operation_create);
+    REGISTER_GLOBAL_MOCK_HOOK(async_operation_destroy, my_async_operation_destroy);
+    REGISTER_GLOBAL_MOCK_HOOK(async_operation_cancel, my_async_operation_cancel);
+    REGISTER_GLOBAL_MOCK_HOOK(link_attach, my_link_attach);
+    REGISTER_GLOBAL_MOCK_HOOK(link_transfer_async, my_link_transfer_async);
+    REGISTER_GLOBAL_MOCK_RETURN(link_detach, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(link_get_peer_max_message_size, my_link_get_peer_max_message_size);
+    REGISTER_GLOBAL_MOCK_HOOK(message_get_body_type, my_message_get_body_type);
+    REGISTER_GLOBAL_MOCK_HOOK(message_get_message_format, my_message_get_message_format);
+    REGISTER_GLOBAL_MOCK_HOOK(message_get_body_amqp_value_in_place, my_message_get_body_amqp_value_in_place);
+    REGISTER_GLOBAL_MOCK_HOOK(message_get_body_amqp_data_count, my_message_get_body_amqp_data_count);
+    REGISTER_GLOBAL_MOCK_HOOK(message_get_body_amqp_data_in_place, my_message_get_body_amqp_data_in_place);
+    REGISTER_GLOBAL_MOCK_HOOK(message_clone, my_message_clone);
+    REGISTER_GLOBAL_MOCK_RETURN(message_get_header, 0);
+    REGISTER_GLOBAL_MOCK_RETURN(message_get_message_annotations, 0);
+    REGISTER_GLOBAL_MOCK_RETURN(message_get_properties, 0);
+    REGISTER_GLOBAL_MOCK_RETURN(message_get_application_properties, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_create_amqp_value, my_amqpvalue_create_amqp_value);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_encoded_size, my_amqpvalue_get_encoded_size);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_encode_to_payload, my_amqpvalue_encode_to_payload);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_create_data, my_amqpvalue_create_data);
+
+    REGISTER_UMOCK_ALIAS_TYPE(LINK_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(MESSAGE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ASYNC_OPERATION_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ASYNC_OPERATION_CANCEL_HANDLER_FUNC, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_TRANSFER_RECEIVED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_LINK_STATE_CHANGED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_LINK_FLOW_ON, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_DELIVERY_SETTLED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PAYLOAD*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(BINARY_DATA, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(data, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(size_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(LINK_TRANSFER_RESULT*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(HEADER_HANDLE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PROPERTIES_HANDLE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(message_annotations*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(MESSAGE_BODY_TYPE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(uint32_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(uint64_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(message_format, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(tickcounter_ms_t, unsigned long long);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+}
+
+TEST_FUNCTION_INITIALIZE(method_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+
+    umock_c_reset_all_calls();
+
+    (void)memset(test_transfer_actions, 0, sizeof(test_transfer_actions));
+    (void)memset(test_transfers, 0, sizeof(test_transfers));
+    (void)memset(test_transferred_message_ids, 0, sizeof(test_transferred_message_ids));
+    (void)memset(test_transferred_sizes, 0, sizeof(test_transferred_sizes));
+    test_transfer_count = 0;
+    test_peer_max_message_size = 0;
+    test_data_body = NULL;
+    test_batch_complete_call_count = 0;
+    test_batch_message_count = 0;
+    test_send_complete_call_count = 0;
+    test_send_complete_result = MESSAGE_SEND_ERROR;
+    (void)memset(test_batch_send_results, 0, sizeof(test_batch_send_results));
+}
+
+TEST_FUNCTION_CLEANUP(method_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* messagesender_send_async */
+
+TEST_FUNCTION(messagesender_send_async_returns_the_operation_while_the_message_is_in_flight)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    setup_send_message_expectations(TEST_MESSAGE_1);
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_async(message_sender, TEST_MESSAGE_1, test_on_message_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, test_send_complete_call_count);
+
+    // cleanup
+    settle_transfer(0, LINK_DELIVERY_SETTLE_REASON_SETTLED);
+    ASSERT_ARE_EQUAL(size_t, 1, test_send_complete_call_count);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_async_when_the_message_is_settled_during_the_call_returns_NULL)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    test_transfer_actions[0] = TEST_TRANSFER_SETTLE;
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    setup_send_message_expectations(TEST_MESSAGE_1);
+    STRICT_EXPECTED_CALL(async_operation_destroy(IGNORED_PTR_ARG));
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_async(message_sender, TEST_MESSAGE_1, test_on_message_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, test_send_complete_call_count);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_send_complete_result);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+/* messagesender_send_batch_async */
+
+TEST_FUNCTION(messagesender_send_batch_async_with_NULL_message_sender_fails)
+{
+    // arrange
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1 };
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batch_async(NULL, messages, 1, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+TEST_FUNCTION(messagesender_send_batch_async_with_no_messages_fails)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1 };
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batch_async(message_sender, messages, 0, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batch_async_with_a_NULL_message_fails)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, NULL };
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batch_async(message_sender, messages, 2, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batch_async_transfers_all_messages_in_order)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2, TEST_MESSAGE_3 };
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    setup_send_message_expectations(TEST_MESSAGE_1);
+    setup_send_message_expectations(TEST_MESSAGE_2);
+    setup_send_message_expectations(TEST_MESSAGE_3);
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batch_async(message_sender, messages, 3, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 3, test_transfer_count);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_1), test_transferred_message_ids[0]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_2), test_transferred_message_ids[1]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_3), test_transferred_message_ids[2]);
+    ASSERT_ARE_EQUAL(size_t, 0, test_batch_complete_call_count);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batch_async_reports_the_batch_once_all_messages_are_settled)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2 };
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batch_async(message_sender, messages, 2, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+    ASSERT_IS_NOT_NULL(result);
+    settle_transfer(0, LINK_DELIVERY_SETTLE_REASON_SETTLED);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(async_operation_destroy(result));
+
+    // act
+    settle_transfer(1, LINK_DELIVERY_SETTLE_REASON_SETTLED);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, test_batch_complete_call_count);
+    ASSERT_ARE_EQUAL(size_t, 2, test_batch_message_count);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_batch_send_results[0]);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_batch_send_results[1]);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batch_async_when_all_messages_are_settled_during_the_call_returns_NULL)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2 };
+    test_transfer_actions[0] = TEST_TRANSFER_SETTLE;
+    test_transfer_actions[1] = TEST_TRANSFER_SETTLE;
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    setup_send_message_expectations(TEST_MESSAGE_1);
+    setup_send_message_expectations(TEST_MESSAGE_2);
+    STRICT_EXPECTED_CALL(async_operation_destroy(IGNORED_PTR_ARG));
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batch_async(message_sender, messages, 2, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, test_batch_complete_call_count);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_batch_send_results[0]);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_batch_send_results[1]);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batch_async_when_all_messages_fail_during_the_call_returns_NULL)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2 };
+    test_transfer_actions[0] = TEST_TRANSFER_ERROR;
+    test_transfer_actions[1] = TEST_TRANSFER_ERROR;
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    setup_send_message_expectations(TEST_MESSAGE_1);
+    setup_send_message_expectations(TEST_MESSAGE_2);
+    STRICT_EXPECTED_CALL(async_operation_destroy(IGNORED_PTR_ARG));
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batch_async(message_sender, messages, 2, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, test_batch_complete_call_count);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_ERROR, test_batch_send_results[0]);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_ERROR, test_batch_send_results[1]);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batch_async_reports_a_result_per_message_when_some_fail)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2, TEST_MESSAGE_3 };
+    ASYNC_OPERATION_HANDLE result;
+    test_transfer_actions[0] = TEST_TRANSFER_PENDING;
+    test_transfer_actions[1] = TEST_TRANSFER_ERROR;
+    test_transfer_actions[2] = TEST_TRANSFER_PENDING;
+
+    // act
+    result = messagesender_send_batch_async(message_sender, messages, 3, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(size_t, 0, test_batch_complete_call_count);
+    settle_transfer(2, LINK_DELIVERY_SETTLE_REASON_TIMEOUT);
+    ASSERT_ARE_EQUAL(size_t, 0, test_batch_complete_call_count);
+    settle_transfer(0, LINK_DELIVERY_SETTLE_REASON_SETTLED);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 3, test_transfer_count);
+    ASSERT_ARE_EQUAL(size_t, 1, test_batch_complete_call_count);
+    ASSERT_ARE_EQUAL(size_t, 3, test_batch_message_count);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_batch_send_results[0]);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_ERROR, test_batch_send_results[1]);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_TIMEOUT, test_batch_send_results[2]);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(cancelling_a_batch_cancels_only_the_messages_not_completed_yet)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2, TEST_MESSAGE_3 };
+    ASYNC_OPERATION_HANDLE result;
+    test_transfer_actions[0] = TEST_TRANSFER_PENDING;
+    test_transfer_actions[1] = TEST_TRANSFER_PENDING;
+    test_transfer_actions[2] = TEST_TRANSFER_BUSY;
+    result = messagesender_send_batch_async(message_sender, messages, 3, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+    ASSERT_IS_NOT_NULL(result);
+    settle_transfer(0, LINK_DELIVERY_SETTLE_REASON_SETTLED);
+    umock_c_reset_all_calls();
+
+    // the in flight message is taken back from the link, the queued one is dropped
+    STRICT_EXPECTED_CALL(async_operation_cancel(result));
+    STRICT_EXPECTED_CALL(async_operation_cancel(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_destroy(TEST_MESSAGE_3));
+    STRICT_EXPECTED_CALL(async_operation_destroy(result));
+
+    // act
+    (void)async_operation_cancel(result);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_NULL(test_transfers[1].operation);
+    ASSERT_ARE_EQUAL(size_t, 1, test_batch_complete_call_count);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_batch_send_results[0]);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_CANCELLED, test_batch_send_results[1]);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_CANCELLED, test_batch_send_results[2]);
+
+    // the cancelled message is not sent when credit comes back
+    saved_on_link_flow_on(saved_link_callback_context);
+    ASSERT_ARE_EQUAL(size_t, 3, test_transfer_count);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(a_batch_message_refused_for_lack_of_credit_is_sent_first_when_credit_comes_back)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    MESSAGE_HANDLE messages[] = { TEST_MESSAGE_1, TEST_MESSAGE_2, TEST_MESSAGE_3 };
+    ASYNC_OPERATION_HANDLE result;
+    test_transfer_actions[0] = TEST_TRANSFER_PENDING;
+    test_transfer_actions[1] = TEST_TRANSFER_BUSY;
+    test_transfer_actions[2] = TEST_TRANSFER_PENDING;
+    test_transfer_actions[3] = TEST_TRANSFER_PENDING;
+    result = messagesender_send_batch_async(message_sender, messages, 3, test_on_message_batch_send_complete, NULL, TEST_TIMEOUT);
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(size_t, 2, test_transfer_count);
+    umock_c_reset_all_calls();
+
+    setup_send_message_expectations(TEST_MESSAGE_2);
+    setup_send_message_expectations(TEST_MESSAGE_3);
+
+    // act
+    saved_on_link_flow_on(saved_link_callback_context);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 4, test_transfer_count);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_1), test_transferred_message_ids[0]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_2), test_transferred_message_ids[1]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_2), test_transferred_message_ids[2]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_3), test_transferred_message_ids[3]);
+
+    // cleanup
+    messagesender_destroy(message_sender);
+}
+
+/* messagesender_batched_message_add */
+
+TEST_FUNCTION(messagesender_batched_message_add_returns_FULL_when_the_message_does_not_fit_in_what_is_left)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    size_t message_count;
+    uint64_t encoded_size;
+    test_peer_max_message_size = (3 * TEST_DATA_SECTION_SIZE) - 1;
+    batched_message = create_batched_message(message_sender, 2);
+
+    setup_batched_message_add_expectations(TEST_MESSAGE_3, false);
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_MESSAGE_3);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_FULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 2, message_count);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, 2 * TEST_DATA_SECTION_SIZE, encoded_size);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_batched_message_add_succeeds_when_the_message_fills_the_peer_max_message_size_exactly)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    uint64_t encoded_size;
+    test_peer_max_message_size = 3 * TEST_DATA_SECTION_SIZE;
+    batched_message = create_batched_message(message_sender, 2);
+
+    setup_batched_message_add_expectations(TEST_MESSAGE_3, true);
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_MESSAGE_3);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, test_peer_max_message_size, encoded_size);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_batched_message_add_returns_TOO_LARGE_when_the_message_alone_does_not_fit)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    size_t message_count;
+    test_peer_max_message_size = TEST_DATA_SECTION_SIZE - 1;
+    batched_message = create_batched_message(message_sender, 0);
+
+    setup_batched_message_add_expectations(TEST_MESSAGE_1, false);
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_MESSAGE_1);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_TOO_LARGE, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 0, message_count);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_batched_message_add_returns_TOO_LARGE_when_the_message_alone_does_not_fit_in_a_batch_that_is_not_empty)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    size_t message_count;
+    uint64_t encoded_size;
+    test_peer_max_message_size = 2 * TEST_DATA_SECTION_SIZE;
+    batched_message = create_batched_message(message_sender, 1);
+
+    setup_batched_message_add_expectations(TEST_LARGE_MESSAGE, false);
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_LARGE_MESSAGE);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_TOO_LARGE, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 1, message_count);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, TEST_DATA_SECTION_SIZE, encoded_size);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_batched_message_add_with_a_peer_max_message_size_of_0_does_not_limit_the_batch)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    uint64_t encoded_size;
+    test_peer_max_message_size = 0;
+    batched_message = create_batched_message(message_sender, 2);
+
+    setup_batched_message_add_expectations(TEST_MESSAGE_3, true);
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_MESSAGE_3);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, 3 * TEST_DATA_SECTION_SIZE, encoded_size);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(when_encoding_the_message_fails_messagesender_batched_message_add_fails_and_leaves_the_batched_message_as_it_was)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    size_t message_count;
+    uint64_t encoded_size;
+    batched_message = create_batched_message(message_sender, 2);
+
+    STRICT_EXPECTED_CALL(link_get_peer_max_message_size(TEST_LINK_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_type(TEST_MESSAGE_3, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_header(TEST_MESSAGE_3, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_message_annotations(TEST_MESSAGE_3, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_properties(TEST_MESSAGE_3, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_application_properties(TEST_MESSAGE_3, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_amqp_value_in_place(TEST_MESSAGE_3, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_create_amqp_value((AMQP_VALUE)TEST_MESSAGE_3));
+    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size((AMQP_VALUE)TEST_MESSAGE_3, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(amqpvalue_encode_to_payload((AMQP_VALUE)TEST_MESSAGE_3, IGNORED_PTR_ARG))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(amqpvalue_destroy((AMQP_VALUE)TEST_MESSAGE_3));
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_MESSAGE_3);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 2, message_count);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, 2 * TEST_DATA_SECTION_SIZE, encoded_size);
+    ASSERT_IS_NOT_NULL(messagesender_send_batched_message_async(batched_message, NULL, NULL, TEST_TIMEOUT));
+    ASSERT_ARE_EQUAL(size_t, 2 * TEST_DATA_SECTION_SIZE, test_transferred_sizes[0]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_2), test_transferred_message_ids[0]);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_batched_message_add_of_a_data_body_with_a_callback_part_of_unknown_size_fails)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    size_t message_count;
+    uint64_t encoded_size;
+    test_data_body = payload_create();
+    payload_append_callback(test_data_body, test_body_producer, NULL);
+    batched_message = create_batched_message(message_sender, 1);
+
+    STRICT_EXPECTED_CALL(link_get_peer_max_message_size(TEST_LINK_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_type(TEST_DATA_MESSAGE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_header(TEST_DATA_MESSAGE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_message_annotations(TEST_DATA_MESSAGE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_properties(TEST_DATA_MESSAGE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_application_properties(TEST_DATA_MESSAGE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_amqp_data_count(TEST_DATA_MESSAGE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(message_get_body_amqp_data_in_place(TEST_DATA_MESSAGE, 0));
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_DATA_MESSAGE);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 1, message_count);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, TEST_DATA_SECTION_SIZE, encoded_size);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+    payload_destroy(&test_data_body);
+}
+
+TEST_FUNCTION(messagesender_batched_message_add_of_a_data_body_with_a_callback_part_of_hinted_size_succeeds)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    size_t message_count;
+    test_data_body = payload_create();
+    payload_append_callback_with_size(test_data_body, test_body_producer, NULL, 4);
+    batched_message = create_batched_message(message_sender, 1);
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_DATA_MESSAGE);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_OK, result);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 2, message_count);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+    payload_destroy(&test_data_body);
+}
+
+/* messagesender_send_batched_message_async */
+
+TEST_FUNCTION(messagesender_send_batched_message_async_transfers_the_data_sections_as_one_batched_message)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message = create_batched_message(message_sender, 2);
+    size_t message_count;
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(link_transfer_async(TEST_LINK_HANDLE, MESSAGE_FORMAT_BATCHED, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, TEST_TIMEOUT));
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batched_message_async(batched_message, NULL, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 2 * TEST_DATA_SECTION_SIZE, test_transferred_sizes[0]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_2), test_transferred_message_ids[0]);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 0, message_count);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batched_message_async_hands_the_encoded_messages_back_when_the_send_fails)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message = create_batched_message(message_sender, 2);
+    size_t message_count;
+    uint64_t encoded_size;
+    test_transfer_actions[0] = TEST_TRANSFER_ERROR;
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(link_transfer_async(TEST_LINK_HANDLE, MESSAGE_FORMAT_BATCHED, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, TEST_TIMEOUT));
+    STRICT_EXPECTED_CALL(async_operation_destroy(IGNORED_PTR_ARG));
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batched_message_async(batched_message, NULL, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 2, message_count);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, 2 * TEST_DATA_SECTION_SIZE, encoded_size);
+
+    // the retry sends the same bytes
+    result = messagesender_send_batched_message_async(batched_message, NULL, NULL, TEST_TIMEOUT);
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(size_t, 2, test_transfer_count);
+    ASSERT_ARE_EQUAL(size_t, 2 * TEST_DATA_SECTION_SIZE, test_transferred_sizes[1]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_2), test_transferred_message_ids[1]);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(messagesender_send_batched_message_async_when_the_batched_message_is_settled_during_the_call_returns_NULL)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message = create_batched_message(message_sender, 2);
+    size_t message_count;
+    test_transfer_actions[0] = TEST_TRANSFER_SETTLE;
+
+    STRICT_EXPECTED_CALL(async_operation_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(link_transfer_async(TEST_LINK_HANDLE, MESSAGE_FORMAT_BATCHED, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, TEST_TIMEOUT));
+    STRICT_EXPECTED_CALL(async_operation_destroy(IGNORED_PTR_ARG));
+
+    // act
+    ASYNC_OPERATION_HANDLE result = messagesender_send_batched_message_async(batched_message, test_on_message_send_complete, NULL, TEST_TIMEOUT);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, test_send_complete_call_count);
+    ASSERT_ARE_EQUAL(MESSAGE_SEND_RESULT, MESSAGE_SEND_OK, test_send_complete_result);
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_count(batched_message, &message_count));
+    ASSERT_ARE_EQUAL(size_t, 0, message_count);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+TEST_FUNCTION(a_batched_message_can_be_filled_again_after_it_is_sent)
+{
+    // arrange
+    MESSAGE_SENDER_HANDLE message_sender = create_open_message_sender();
+    BATCHED_MESSAGE_HANDLE batched_message;
+    uint64_t encoded_size;
+    test_peer_max_message_size = 2 * TEST_DATA_SECTION_SIZE;
+    batched_message = create_batched_message(message_sender, 2);
+    ASSERT_IS_NOT_NULL(messagesender_send_batched_message_async(batched_message, NULL, NULL, TEST_TIMEOUT));
+    umock_c_reset_all_calls();
+
+    setup_batched_message_add_expectations(TEST_MESSAGE_3, true);
+
+    // act
+    BATCHED_MESSAGE_ADD_RESULT result = messagesender_batched_message_add(batched_message, TEST_MESSAGE_3);
+
+    // assert
+    ASSERT_ARE_EQUAL(BATCHED_MESSAGE_ADD_RESULT, BATCHED_MESSAGE_ADD_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, messagesender_batched_message_get_size(batched_message, &encoded_size));
+    ASSERT_ARE_EQUAL(uint64_t, TEST_DATA_SECTION_SIZE, encoded_size);
+
+    // only the new message goes in the next send
+    ASSERT_IS_NOT_NULL(messagesender_send_batched_message_async(batched_message, NULL, NULL, TEST_TIMEOUT));
+    ASSERT_ARE_EQUAL(size_t, 2, test_transfer_count);
+    ASSERT_ARE_EQUAL(size_t, TEST_DATA_SECTION_SIZE, test_transferred_sizes[1]);
+    ASSERT_ARE_EQUAL(int, test_message_id(TEST_MESSAGE_3), test_transferred_message_ids[1]);
+
+    // cleanup
+    messagesender_batched_message_destroy(batched_message);
+    messagesender_destroy(message_sender);
+}
+
+END_TEST_SUITE(message_sender_ut)
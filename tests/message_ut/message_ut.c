@@ -2952,6 +2952,88 @@ TEST_FUNCTION(when_reallocating_memory_for_the_data_array_fails_message_add_body
     message_destroy(message);
 }
 
+/* message_add_body_amqp_data_borrowed */
+
+/* Tests_SRS_MESSAGE_01_161: [ `message_add_body_amqp_data_borrowed` shall behave like `message_add_body_amqp_data`, except for how the bytes of `amqp_data` are stored. ]*/
+/* Tests_SRS_MESSAGE_01_162: [ `message_add_body_amqp_data_borrowed` shall reference the bytes of `amqp_data` instead of copying them. ]*/
+TEST_FUNCTION(message_add_body_amqp_data_borrowed_references_the_amqp_data_bytes)
+{
+    // arrange
+    int result;
+    unsigned char amqp_data_bytes[] = { 0x42 };
+    BINARY_DATA amqp_data = payload_create();
+    MESSAGE_HANDLE message = message_create();
+    umock_c_reset_all_calls();
+
+    payload_append_data(amqp_data, amqp_data_bytes, sizeof(amqp_data_bytes));
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+    // act
+    result = message_add_body_amqp_data_borrowed(message, amqp_data);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(payload_has_borrowed_data(message_get_body_amqp_data_in_place(message, 0)));
+    ASSERT_IS_TRUE(payload_are_equal(amqp_data, message_get_body_amqp_data_in_place(message, 0)));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    message_destroy(message);
+    payload_destroy(&amqp_data);
+}
+
+/* Tests_SRS_MESSAGE_01_161: [ `message_add_body_amqp_data_borrowed` shall behave like `message_add_body_amqp_data`, except for how the bytes of `amqp_data` are stored. ]*/
+TEST_FUNCTION(message_add_body_amqp_data_borrowed_with_NULL_message_fails)
+{
+    // arrange
+    int result;
+    unsigned char amqp_data_bytes[] = { 0x42 };
+    BINARY_DATA amqp_data = payload_create();
+
+    payload_append_data(amqp_data, amqp_data_bytes, sizeof(amqp_data_bytes));
+
+    // act
+    result = message_add_body_amqp_data_borrowed(NULL, amqp_data);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    payload_destroy(&amqp_data);
+}
+
+/* Tests_SRS_MESSAGE_01_011: [If an AMQP data has been set as message body on the source message it shall be cloned by allocating memory for the binary payload.] */
+TEST_FUNCTION(message_clone_copies_borrowed_amqp_data_bytes)
+{
+    // arrange
+    unsigned char amqp_data_bytes[] = { 0x42 };
+    BINARY_DATA amqp_data = payload_create();
+    MESSAGE_HANDLE message = message_create();
+    MESSAGE_HANDLE cloned_message;
+
+    payload_append_data(amqp_data, amqp_data_bytes, sizeof(amqp_data_bytes));
+    (void)message_add_body_amqp_data_borrowed(message, amqp_data);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreAllCalls();
+
+    // act
+    cloned_message = message_clone(message);
+
+    // assert
+    ASSERT_IS_NOT_NULL(cloned_message);
+    ASSERT_IS_FALSE(payload_has_borrowed_data(message_get_body_amqp_data_in_place(cloned_message, 0)));
+    ASSERT_IS_TRUE(payload_are_equal(amqp_data, message_get_body_amqp_data_in_place(cloned_message, 0)));
+
+    // cleanup
+    message_destroy(cloned_message);
+    message_destroy(message);
+    payload_destroy(&amqp_data);
+}
+
 /* message_get_body_amqp_data_in_place */
 
 /* Tests_SRS_MESSAGE_01_092: [ `message_get_body_amqp_data_in_place` shall place the contents of the `index`th AMQP data for the message instance identified by `message` into the argument `amqp_data`, without copying the binary payload memory. ]*/
@@ -0,0 +1,773 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#endif
+
+#include "testrunnerswitcher.h"
+
+#include "azure_uamqp_c/payload.h"
+
+static const unsigned char test_document[] = "{\"temperature\":21}";
+static size_t test_producer_call_count;
+
+static bool test_producer(void* user_context, PAYLOAD_WRITE_FUNCTION* stream_writer, void* stream_context)
+{
+    (void)user_context;
+    test_producer_call_count++;
+    return stream_writer(stream_context, test_document, sizeof(test_document) - 1);
+}
+
+static size_t test_size_query_call_count;
+
+static size_t test_size_query(void* user_context)
+{
+    test_size_query_call_count++;
+    return *(const size_t*)user_context;
+}
+
+static bool test_failing_producer(void* user_context, PAYLOAD_WRITE_FUNCTION* stream_writer, void* stream_context)
+{
+    (void)user_context;
+    (void)stream_writer;
+    (void)stream_context;
+    test_producer_call_count++;
+    return false;
+}
+
+static PAYLOAD* create_materialized_payload(PAYLOAD_CAPTURE_POOL* pool)
+{
+    PAYLOAD* payload = payload_create();
+    ASSERT_IS_NOT_NULL(payload);
+    payload_append_callback_materialized(payload, test_producer, NULL, pool);
+    return payload;
+}
+
+/* number of payload parts and byte segments alive, kept by payload.c */
+extern int32_t payloadCount;
+extern int32_t payloadSegmentCount;
+
+static void assert_payload_bytes(const PAYLOAD* payload, const char* expected)
+{
+    unsigned char* bytes;
+    size_t length = payload_stream_to_heap(payload, &bytes);
+    ASSERT_ARE_EQUAL(size_t, strlen(expected), length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(bytes, expected, length));
+    free(bytes);
+}
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+BEGIN_TEST_SUITE(payload_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+}
+
+TEST_FUNCTION_INITIALIZE(test_function_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    test_producer_call_count = 0;
+    test_size_query_call_count = 0;
+}
+
+TEST_FUNCTION_CLEANUP(test_function_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* payload_append_callback_with_size */
+
+TEST_FUNCTION(payload_get_length_of_a_callback_with_size_returns_the_hint_without_running_the_producer)
+{
+    // arrange
+    PAYLOAD* payload = payload_create();
+    payload_append_callback_with_size(payload, test_producer, NULL, sizeof(test_document) - 1);
+
+    // act
+    size_t length = payload_get_length(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, length);
+    ASSERT_ARE_EQUAL(size_t, 0, test_producer_call_count);
+
+    // cleanup
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(a_callback_with_size_keeps_the_hint_when_the_producer_writes_more)
+{
+    // arrange
+    PAYLOAD* payload = payload_create();
+    unsigned char* bytes;
+    size_t length;
+    payload_append_callback_with_size(payload, test_producer, NULL, 4);
+
+    // act
+    length = payload_stream_to_heap(payload, &bytes);
+
+    // assert
+    /* the payload does not check the producer against the hint, the heap copy is cut to the hint */
+    ASSERT_ARE_EQUAL(size_t, 1, test_producer_call_count);
+    ASSERT_ARE_EQUAL(size_t, 4, payload_get_length(payload));
+    ASSERT_ARE_EQUAL(size_t, 4, length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(bytes, test_document, 4));
+
+    // cleanup
+    free(bytes);
+    payload_destroy(&payload);
+}
+
+/* payload_append_callback_with_size_query */
+
+TEST_FUNCTION(payload_get_length_of_a_callback_with_size_query_asks_the_query_once_without_running_the_producer)
+{
+    // arrange
+    size_t size = sizeof(test_document) - 1;
+    PAYLOAD* payload = payload_create();
+    size_t first_length;
+    size_t second_length;
+    payload_append_callback_with_size_query(payload, test_producer, test_size_query, &size);
+
+    // act
+    first_length = payload_get_length(payload);
+    second_length = payload_get_length(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, first_length);
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, second_length);
+    ASSERT_ARE_EQUAL(size_t, 1, test_size_query_call_count);
+    ASSERT_ARE_EQUAL(size_t, 0, test_producer_call_count);
+
+    // cleanup
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(the_size_query_is_asked_when_the_size_is_first_needed_not_when_the_part_is_appended)
+{
+    // arrange
+    size_t size = 4;
+    PAYLOAD* payload = payload_create();
+    payload_append_callback_with_size_query(payload, test_producer, test_size_query, &size);
+    ASSERT_ARE_EQUAL(size_t, 0, test_size_query_call_count);
+
+    // act
+    size = sizeof(test_document) - 1;
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, payload_get_length(payload));
+    size = 4;
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, payload_get_length(payload));
+    ASSERT_ARE_EQUAL(size_t, 1, test_size_query_call_count);
+
+    // cleanup
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(a_clone_of_a_callback_with_size_query_keeps_the_answer_of_the_source)
+{
+    // arrange
+    size_t size = sizeof(test_document) - 1;
+    PAYLOAD* payload = payload_create();
+    PAYLOAD* clone;
+    payload_append_callback_with_size_query(payload, test_producer, test_size_query, &size);
+    (void)payload_get_length(payload);
+
+    // act
+    clone = payload_clone(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, payload_get_length(clone));
+    ASSERT_ARE_EQUAL(size_t, 1, test_size_query_call_count);
+    ASSERT_ARE_EQUAL(size_t, 0, test_producer_call_count);
+
+    // cleanup
+    payload_destroy(&clone);
+    payload_destroy(&payload);
+}
+
+/* payload_append_callback_materialized */
+
+TEST_FUNCTION(payload_append_callback_materialized_runs_the_producer_once)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool = payload_capture_pool_create();
+    PAYLOAD* payload = create_materialized_payload(pool);
+    PAYLOAD* clone;
+    unsigned char* bytes;
+    size_t length;
+
+    // act
+    length = payload_get_length(payload);
+    clone = payload_clone(payload);
+    (void)payload_stream_to_heap(clone, &bytes);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, length);
+    ASSERT_ARE_EQUAL(size_t, 1, test_producer_call_count);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(bytes, test_document, length));
+
+    // cleanup
+    free(bytes);
+    payload_destroy(&clone);
+    payload_destroy(&payload);
+    payload_capture_pool_destroy(&pool);
+}
+
+TEST_FUNCTION(payload_append_callback_materialized_with_NULL_pool_captures_into_the_heap)
+{
+    // arrange
+    PAYLOAD* payload = create_materialized_payload(NULL);
+
+    // act
+    size_t length = payload_get_length(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, length);
+    ASSERT_ARE_EQUAL(size_t, 1, test_producer_call_count);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(payload_peek_bytes(payload), test_document, length));
+
+    // cleanup
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(payload_append_callback_materialized_with_failing_producer_reports_no_bytes)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool = payload_capture_pool_create();
+    PAYLOAD* payload = payload_create();
+    payload_append_callback_materialized(payload, test_failing_producer, NULL, pool);
+
+    // act
+    size_t length = payload_get_length(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, length);
+    ASSERT_ARE_EQUAL(size_t, 1, test_producer_call_count);
+
+    // cleanup
+    payload_destroy(&payload);
+    payload_capture_pool_destroy(&pool);
+}
+
+static PAYLOAD* create_owned_payload(size_t capacity, unsigned char value, size_t length)
+{
+    unsigned char bytes[128];
+    PAYLOAD* payload = payload_create_and_reserve(capacity);
+    ASSERT_IS_TRUE(length <= sizeof(bytes));
+    (void)memset(bytes, value, length);
+    payload_append_data(payload, bytes, length);
+    return payload;
+}
+
+/* payload_clone */
+
+TEST_FUNCTION(payload_clone_of_a_part_at_the_share_threshold_shares_its_segment)
+{
+    // arrange
+    PAYLOAD* payload = create_owned_payload(64, 'a', 64);
+    int32_t segments = payloadSegmentCount;
+
+    // act
+    PAYLOAD* clone = payload_clone(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, segments, payloadSegmentCount);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)payload_peek_bytes(payload), (void*)payload_peek_bytes(clone));
+    ASSERT_IS_TRUE(payload_are_equal(payload, clone));
+
+    // cleanup
+    payload_destroy(&clone);
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(payload_clone_of_a_part_below_the_share_threshold_copies_it)
+{
+    // arrange
+    PAYLOAD* payload = create_owned_payload(63, 'a', 63);
+    int32_t segments = payloadSegmentCount;
+
+    // act
+    PAYLOAD* clone = payload_clone(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, segments + 1, payloadSegmentCount);
+    ASSERT_ARE_NOT_EQUAL(void_ptr, (void*)payload_peek_bytes(payload), (void*)payload_peek_bytes(clone));
+    ASSERT_IS_TRUE(payload_are_equal(payload, clone));
+
+    // cleanup
+    payload_destroy(&clone);
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(appending_to_a_clone_sharing_a_segment_never_writes_into_the_segment)
+{
+    // arrange
+    PAYLOAD* payload = create_owned_payload(128, 'a', 64);
+    PAYLOAD* clone = payload_clone(payload);
+    unsigned char* bytes;
+    size_t length;
+
+    // act
+    payload_append_data(clone, (const unsigned char*)"bbbb", 4);
+    payload_append_data(payload, (const unsigned char*)"cccc", 4);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, payload_get_parts(clone));
+    ASSERT_ARE_EQUAL(size_t, 1, payload_get_parts(payload));
+    length = payload_stream_to_heap(clone, &bytes);
+    ASSERT_ARE_EQUAL(size_t, 68, length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(bytes + 64, "bbbb", 4));
+    free(bytes);
+    length = payload_stream_to_heap(payload, &bytes);
+    ASSERT_ARE_EQUAL(size_t, 68, length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(bytes + 64, "cccc", 4));
+    free(bytes);
+
+    // cleanup
+    payload_destroy(&clone);
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(a_clone_sharing_a_segment_has_no_spare_capacity)
+{
+    // arrange
+    PAYLOAD* payload = create_owned_payload(128, 'a', 64);
+
+    // act
+    PAYLOAD* clone = payload_clone(payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 64, payload_get_spare_capacity(payload));
+    ASSERT_ARE_EQUAL(size_t, 0, payload_get_spare_capacity(clone));
+
+    // cleanup
+    payload_destroy(&clone);
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(appending_to_the_owner_of_a_shared_segment_leaves_the_clone_unchanged)
+{
+    // arrange
+    PAYLOAD* payload = create_owned_payload(128, 'a', 64);
+    PAYLOAD* clone = payload_clone(payload);
+    PAYLOAD* expected = create_owned_payload(64, 'a', 64);
+
+    // act
+    payload_append_data(payload, (const unsigned char*)"cccc", 4);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 68, payload_get_length(payload));
+    ASSERT_ARE_EQUAL(size_t, 64, payload_get_length(clone));
+    ASSERT_IS_TRUE(payload_are_equal(expected, clone));
+
+    // cleanup
+    payload_destroy(&expected);
+    payload_destroy(&clone);
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(a_shared_segment_is_freed_once_when_the_owner_goes_before_the_clone)
+{
+    // arrange
+    int32_t segments = payloadSegmentCount;
+    int32_t parts = payloadCount;
+    PAYLOAD* payload = create_owned_payload(64, 'a', 64);
+    PAYLOAD* clone = payload_clone(payload);
+
+    // act
+    payload_destroy(&payload);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, segments + 1, payloadSegmentCount);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(payload_peek_bytes(clone), "aaaa", 4));
+    payload_destroy(&clone);
+    ASSERT_ARE_EQUAL(int, segments, payloadSegmentCount);
+    ASSERT_ARE_EQUAL(int, parts, payloadCount);
+}
+
+/* payload_capture_pool */
+
+TEST_FUNCTION(a_released_capture_segment_is_reused_by_the_same_pool)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool = payload_capture_pool_create();
+    PAYLOAD* first = create_materialized_payload(pool);
+    const unsigned char* first_bytes;
+    PAYLOAD* second;
+
+    (void)payload_get_length(first);
+    first_bytes = payload_peek_bytes(first);
+    payload_destroy(&first);
+
+    // act
+    second = create_materialized_payload(pool);
+    (void)payload_get_length(second);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, first_bytes, payload_peek_bytes(second));
+
+    // cleanup
+    payload_destroy(&second);
+    payload_capture_pool_destroy(&pool);
+}
+
+TEST_FUNCTION(a_capture_segment_released_by_one_owner_is_not_handed_to_another_owner)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool_1 = payload_capture_pool_create();
+    PAYLOAD_CAPTURE_POOL* pool_2 = payload_capture_pool_create();
+    PAYLOAD* payload_1 = create_materialized_payload(pool_1);
+    const unsigned char* bytes_1;
+    PAYLOAD* payload_2;
+    PAYLOAD* payload_3;
+
+    (void)payload_get_length(payload_1);
+    bytes_1 = payload_peek_bytes(payload_1);
+    payload_destroy(&payload_1);
+
+    // act
+    payload_2 = create_materialized_payload(pool_2);
+    (void)payload_get_length(payload_2);
+    payload_3 = create_materialized_payload(pool_1);
+    (void)payload_get_length(payload_3);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(void_ptr, bytes_1, payload_peek_bytes(payload_2));
+    ASSERT_ARE_EQUAL(void_ptr, bytes_1, payload_peek_bytes(payload_3));
+
+    // cleanup
+    payload_destroy(&payload_2);
+    payload_destroy(&payload_3);
+    payload_capture_pool_destroy(&pool_1);
+    payload_capture_pool_destroy(&pool_2);
+}
+
+TEST_FUNCTION(a_copy_into_a_payload_of_another_owner_keeps_the_segment_of_the_first_owner)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool_1 = payload_capture_pool_create();
+    PAYLOAD_CAPTURE_POOL* pool_2 = payload_capture_pool_create();
+    PAYLOAD* payload_1 = create_materialized_payload(pool_1);
+    PAYLOAD* copy = payload_create();
+    const unsigned char* bytes_1;
+    PAYLOAD* payload_2;
+
+    payload_append_payload_as_copy(copy, payload_1);
+    bytes_1 = payload_peek_bytes(payload_1);
+    payload_destroy(&payload_1);
+
+    // act
+    payload_2 = create_materialized_payload(pool_2);
+    (void)payload_get_length(payload_2);
+    payload_destroy(&copy);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(void_ptr, bytes_1, payload_peek_bytes(payload_2));
+
+    // cleanup
+    payload_destroy(&payload_2);
+    payload_capture_pool_destroy(&pool_1);
+    payload_capture_pool_destroy(&pool_2);
+}
+
+TEST_FUNCTION(payload_capture_pool_destroy_with_segments_in_use_leaves_them_valid)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool = payload_capture_pool_create();
+    PAYLOAD* payload = create_materialized_payload(pool);
+    (void)payload_get_length(payload);
+
+    // act
+    payload_capture_pool_destroy(&pool);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(payload_peek_bytes(payload), test_document, sizeof(test_document) - 1));
+
+    // cleanup
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(payload_capture_pool_destroy_before_the_producer_runs_leaves_the_part_usable)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool = payload_capture_pool_create();
+    PAYLOAD* payload = create_materialized_payload(pool);
+
+    // act
+    payload_capture_pool_destroy(&pool);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, sizeof(test_document) - 1, payload_get_length(payload));
+    ASSERT_ARE_EQUAL(size_t, 1, test_producer_call_count);
+
+    // cleanup
+    payload_destroy(&payload);
+}
+
+TEST_FUNCTION(payload_capture_pool_destroy_with_NULL_does_nothing)
+{
+    // arrange
+    PAYLOAD_CAPTURE_POOL* pool = NULL;
+
+    // act
+    payload_capture_pool_destroy(&pool);
+    payload_capture_pool_destroy(NULL);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+}
+
+/* payload_move_to_payload_end */
+
+TEST_FUNCTION(payload_move_to_payload_end_chains_every_source_part_without_leaking_one)
+{
+    // arrange
+    static const unsigned char borrowed_bytes[] = { 'e', 'f' };
+    int32_t payload_count_before = payloadCount;
+    PAYLOAD* destination = payload_create();
+    PAYLOAD* source = payload_create();
+    unsigned char* bytes;
+    size_t length;
+    payload_append_data(destination, (const unsigned char*)"ab", 2);
+    payload_append_data(source, (const unsigned char*)"cd", 2);
+    payload_append_borrowed_data(source, borrowed_bytes, sizeof(borrowed_bytes));
+
+    // act
+    payload_move_to_payload_end(destination, &source);
+
+    // assert
+    ASSERT_IS_NULL(source);
+    length = payload_stream_to_heap(destination, &bytes);
+    ASSERT_ARE_EQUAL(size_t, 6, length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(bytes, "abcdef", 6));
+    free(bytes);
+
+    // cleanup
+    payload_destroy(&destination);
+    ASSERT_ARE_EQUAL(int, payload_count_before, payloadCount);
+}
+
+TEST_FUNCTION(payload_move_to_payload_end_into_an_empty_payload_takes_the_source_part)
+{
+    // arrange
+    int32_t payload_count_before = payloadCount;
+    PAYLOAD* destination = payload_create_and_reserve(64);
+    PAYLOAD* source = payload_create();
+    unsigned char* bytes;
+    size_t length;
+    payload_append_data(source, (const unsigned char*)"cd", 2);
+
+    // act
+    payload_move_to_payload_end(destination, &source);
+
+    // assert
+    ASSERT_IS_NULL(source);
+    ASSERT_ARE_EQUAL(size_t, 1, payload_get_parts(destination));
+    length = payload_stream_to_heap(destination, &bytes);
+    ASSERT_ARE_EQUAL(size_t, 2, length);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(bytes, "cd", 2));
+    free(bytes);
+
+    // cleanup
+    payload_destroy(&destination);
+    ASSERT_ARE_EQUAL(int, payload_count_before, payloadCount);
+}
+
+/* payload_append_slice_as_borrowed */
+
+TEST_FUNCTION(payload_append_slice_as_borrowed_crossing_parts_borrows_from_each_part)
+{
+    // arrange
+    static const unsigned char first_part[] = { 'a', 'b', 'c' };
+    static const unsigned char second_part[] = { 'd', 'e', 'f', 'g' };
+    PAYLOAD* source = payload_create();
+    PAYLOAD* slice = payload_create();
+    bool result;
+    payload_append_borrowed_data(source, first_part, sizeof(first_part));
+    payload_append_borrowed_data(source, second_part, sizeof(second_part));
+
+    // act
+    result = payload_append_slice_as_borrowed(slice, source, 2, 3);
+
+    // assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_ARE_EQUAL(size_t, 2, payload_get_parts(slice));
+    ASSERT_ARE_EQUAL(void_ptr, (void*)(first_part + 2), (void*)payload_peek_bytes(slice));
+    assert_payload_bytes(slice, "cde");
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+TEST_FUNCTION(payload_append_slice_as_borrowed_beyond_the_source_size_fails_and_appends_nothing)
+{
+    // arrange
+    PAYLOAD* source = payload_create();
+    PAYLOAD* slice = payload_create();
+    bool result;
+    payload_append_data(source, (const unsigned char*)"abc", 3);
+    payload_append_borrowed_data(source, (const unsigned char*)"defg", 4);
+
+    // act
+    result = payload_append_slice_as_borrowed(slice, source, 2, 6);
+
+    // assert
+    ASSERT_IS_FALSE(result);
+    ASSERT_IS_TRUE(payload_is_empty(slice));
+    ASSERT_ARE_EQUAL(size_t, 1, payload_get_parts(slice));
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+TEST_FUNCTION(payload_append_slice_as_borrowed_with_an_offset_beyond_the_source_size_fails)
+{
+    // arrange
+    PAYLOAD* source = payload_create();
+    PAYLOAD* slice = payload_create();
+    payload_append_data(source, (const unsigned char*)"abc", 3);
+
+    // act
+    bool result = payload_append_slice_as_borrowed(slice, source, 4, 0);
+
+    // assert
+    ASSERT_IS_FALSE(result);
+    ASSERT_IS_TRUE(payload_is_empty(slice));
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+TEST_FUNCTION(payload_append_slice_as_borrowed_with_zero_length_succeeds_and_appends_nothing)
+{
+    // arrange
+    PAYLOAD* source = payload_create();
+    PAYLOAD* slice = payload_create();
+    payload_append_data(source, (const unsigned char*)"abc", 3);
+
+    // act
+    bool result = payload_append_slice_as_borrowed(slice, source, 3, 0);
+
+    // assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_IS_TRUE(payload_is_empty(slice));
+    ASSERT_ARE_EQUAL(size_t, 1, payload_get_parts(slice));
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+TEST_FUNCTION(payload_append_slice_as_borrowed_over_a_callback_part_fails_and_appends_nothing)
+{
+    // arrange
+    PAYLOAD* source = payload_create();
+    PAYLOAD* slice = payload_create();
+    bool result;
+    payload_append_data(source, (const unsigned char*)"abc", 3);
+    payload_append_callback(source, test_producer, NULL);
+
+    // act
+    result = payload_append_slice_as_borrowed(slice, source, 1, 4);
+
+    // assert
+    ASSERT_IS_FALSE(result);
+    ASSERT_IS_TRUE(payload_is_empty(slice));
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+TEST_FUNCTION(payload_append_slice_as_borrowed_before_a_callback_part_succeeds)
+{
+    // arrange
+    PAYLOAD* source = payload_create();
+    PAYLOAD* slice = payload_create();
+    bool result;
+    payload_append_data(source, (const unsigned char*)"abc", 3);
+    payload_append_callback(source, test_producer, NULL);
+
+    // act
+    result = payload_append_slice_as_borrowed(slice, source, 1, 2);
+
+    // assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_IS_FALSE(payload_has_callback_data(slice));
+    assert_payload_bytes(slice, "bc");
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+TEST_FUNCTION(payload_append_slice_as_borrowed_over_a_materialized_callback_part_borrows_its_captured_output)
+{
+    // arrange
+    PAYLOAD* source = payload_create();
+    PAYLOAD* slice = payload_create();
+    bool result;
+    payload_append_data(source, (const unsigned char*)"abc", 3);
+    payload_append_callback_materialized(source, test_producer, NULL, NULL);
+
+    // act
+    result = payload_append_slice_as_borrowed(slice, source, 2, 3);
+
+    // assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_ARE_EQUAL(size_t, 1, test_producer_call_count);
+    ASSERT_IS_FALSE(payload_has_callback_data(slice));
+    assert_payload_bytes(slice, "c{\"");
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+TEST_FUNCTION(a_borrowed_slice_is_unaffected_by_appending_to_its_source)
+{
+    // arrange
+    PAYLOAD* source = payload_create_and_reserve(64);
+    PAYLOAD* slice = payload_create();
+    payload_append_data(source, (const unsigned char*)"abcdef", 6);
+    ASSERT_IS_TRUE(payload_append_slice_as_borrowed(slice, source, 0, 6));
+
+    // act
+    payload_append_data(source, (const unsigned char*)"ghij", 4);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 10, payload_get_length(source));
+    assert_payload_bytes(slice, "abcdef");
+
+    // cleanup
+    payload_destroy(&slice);
+    payload_destroy(&source);
+}
+
+END_TEST_SUITE(payload_ut)
@@ -54,6 +54,7 @@ static void* my_gballoc_realloc(void* ptr, size_t size)
 #undef ENABLE_MOCKS
 
 #include "azure_uamqp_c/saslclientio.h"
+#include "azure_uamqp_c/xio_sendv.h"
 
 static XIO_HANDLE test_underlying_io = (XIO_HANDLE)0x4242;
 static SASL_MECHANISM_HANDLE test_sasl_mechanism = (SASL_MECHANISM_HANDLE)0x4243;
@@ -354,6 +355,8 @@ MOCK_FUNCTION_WITH_CODE(, void, test_on_send_complete, void*, context, IO_SEND_R
 MOCK_FUNCTION_END()
 MOCK_FUNCTION_WITH_CODE(, void, test_on_io_close_complete, void*, context)
 MOCK_FUNCTION_END()
+MOCK_FUNCTION_WITH_CODE(, int, test_underlying_sendv, void*, sendv_context, const XIO_SEND_BUFFER*, buffers, size_t, buffer_count)
+MOCK_FUNCTION_END(0)
 
 static TEST_MUTEX_HANDLE g_testByTest;
 
@@ -680,6 +683,7 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(OPTIONHANDLER_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(SASL_CHALLENGE_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(SASL_RESPONSE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(const XIO_SEND_BUFFER*, void*);
 
     REGISTER_TYPE(IO_OPEN_RESULT, IO_OPEN_RESULT);
     REGISTER_TYPE(OPTIONHANDLER_RESULT, OPTIONHANDLER_RESULT);
@@ -1771,6 +1775,108 @@ TEST_FUNCTION(saslclientio_setoption_with_logtrace_false_succeeds)
     saslclientio_get_interface_description()->concrete_io_destroy(sasl_client_io);
 }
 
+/* Tests_SRS_SASLCLIENTIO_01_145: [ - xio_sendv - XIO_SENDV_QUERY*. ]*/
+/* Tests_SRS_SASLCLIENTIO_01_149: [ Otherwise `saslclientio_setoption` shall fill in the query with a sendv function that forwards to the underlying one while the SASL client IO is open. ]*/
+/* Tests_SRS_SASLCLIENTIO_01_146: [ The sendv function shall pass the buffers to the sendv function of the underlying IO. ]*/
+TEST_FUNCTION(saslclientio_setoption_with_xio_sendv_returns_a_sendv_that_forwards_to_the_underlying_io)
+{
+    // arrange
+    SASLCLIENTIO_CONFIG sasl_client_io_config;
+    CONCRETE_IO_HANDLE sasl_client_io;
+    int result;
+    XIO_SENDV_QUERY underlying_query = { test_underlying_sendv, (void*)0x4245 };
+    XIO_SENDV_QUERY sendv_query = { NULL, NULL };
+    unsigned char test_bytes[] = { 0x42, 0x43 };
+    XIO_SEND_BUFFER send_buffers[1];
+    send_buffers[0].buffer = test_bytes;
+    send_buffers[0].size = sizeof(test_bytes);
+    sasl_client_io_config.underlying_io = test_underlying_io;
+    sasl_client_io_config.sasl_mechanism = test_sasl_mechanism;
+    sasl_client_io = saslclientio_get_interface_description()->concrete_io_create(&sasl_client_io_config);
+    (void)saslclientio_get_interface_description()->concrete_io_open(sasl_client_io, test_on_io_open_complete, (void*)0x4242, test_on_bytes_received, (void*)0x4243, test_on_io_error, (void*)0x4244);
+    setup_successful_sasl_handshake();
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(xio_setoption(test_underlying_io, OPTION_XIO_SENDV, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(3, &underlying_query, sizeof(underlying_query));
+    STRICT_EXPECTED_CALL(test_underlying_sendv((void*)0x4245, send_buffers, 1));
+
+    // act
+    result = saslclientio_get_interface_description()->concrete_io_setoption(sasl_client_io, OPTION_XIO_SENDV, &sendv_query);
+    ASSERT_IS_NOT_NULL(sendv_query.sendv);
+    (void)sendv_query.sendv(sendv_query.sendv_context, send_buffers, 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    // cleanup
+    saslclientio_get_interface_description()->concrete_io_destroy(sasl_client_io);
+}
+
+/* Tests_SRS_SASLCLIENTIO_01_148: [ If the underlying IO does not provide a sendv function, `saslclientio_setoption` shall fail and return a non-zero value without logging an error, as this only tells the caller to keep sending with `xio_send`. ]*/
+TEST_FUNCTION(when_the_underlying_io_has_no_sendv_saslclientio_setoption_with_xio_sendv_fails)
+{
+    // arrange
+    SASLCLIENTIO_CONFIG sasl_client_io_config;
+    CONCRETE_IO_HANDLE sasl_client_io;
+    int result;
+    XIO_SENDV_QUERY sendv_query = { NULL, NULL };
+    sasl_client_io_config.underlying_io = test_underlying_io;
+    sasl_client_io_config.sasl_mechanism = test_sasl_mechanism;
+    sasl_client_io = saslclientio_get_interface_description()->concrete_io_create(&sasl_client_io_config);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(xio_setoption(test_underlying_io, OPTION_XIO_SENDV, IGNORED_PTR_ARG))
+        .SetReturn(MU_FAILURE);
+
+    // act
+    result = saslclientio_get_interface_description()->concrete_io_setoption(sasl_client_io, OPTION_XIO_SENDV, &sendv_query);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_NULL(sendv_query.sendv);
+
+    // cleanup
+    saslclientio_get_interface_description()->concrete_io_destroy(sasl_client_io);
+}
+
+/* Tests_SRS_SASLCLIENTIO_01_147: [ The sendv function shall fail and return a non-zero value if the SASL client IO state is not `IO_STATE_OPEN`. ]*/
+TEST_FUNCTION(sendv_obtained_through_xio_sendv_fails_when_the_sasl_client_io_is_in_error)
+{
+    // arrange
+    SASLCLIENTIO_CONFIG sasl_client_io_config;
+    CONCRETE_IO_HANDLE sasl_client_io;
+    int result;
+    XIO_SENDV_QUERY underlying_query = { test_underlying_sendv, (void*)0x4245 };
+    XIO_SENDV_QUERY sendv_query = { NULL, NULL };
+    unsigned char test_bytes[] = { 0x42 };
+    XIO_SEND_BUFFER send_buffers[1];
+    send_buffers[0].buffer = test_bytes;
+    send_buffers[0].size = sizeof(test_bytes);
+    sasl_client_io_config.underlying_io = test_underlying_io;
+    sasl_client_io_config.sasl_mechanism = test_sasl_mechanism;
+    sasl_client_io = saslclientio_get_interface_description()->concrete_io_create(&sasl_client_io_config);
+    (void)saslclientio_get_interface_description()->concrete_io_open(sasl_client_io, test_on_io_open_complete, (void*)0x4242, test_on_bytes_received, (void*)0x4243, test_on_io_error, (void*)0x4244);
+    setup_successful_sasl_handshake();
+    STRICT_EXPECTED_CALL(xio_setoption(test_underlying_io, OPTION_XIO_SENDV, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(3, &underlying_query, sizeof(underlying_query));
+    (void)saslclientio_get_interface_description()->concrete_io_setoption(sasl_client_io, OPTION_XIO_SENDV, &sendv_query);
+    saved_on_io_error(saved_on_io_error_context);
+    umock_c_reset_all_calls();
+
+    // act
+    result = sendv_query.sendv(sendv_query.sendv_context, send_buffers, 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    saslclientio_get_interface_description()->concrete_io_destroy(sasl_client_io);
+}
+
 /* saslclientio_retrieveoptions */
 
 /* Tests_SRS_SASLCLIENTIO_01_133: [ `saslclientio_retrieveoptions` shall create an option handler by calling `OptionHandler_Create`. ]*/
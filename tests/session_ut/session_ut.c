@@ -4,15 +4,19 @@
 #ifdef __cplusplus
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
 #else
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #endif
 
 #include "azure_macro_utils/macro_utils.h"
 #include "testrunnerswitcher.h"
 #include "umock_c/umock_c.h"
 #include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_bool.h"
+#include "umock_c/umocktypes_stdint.h"
 
 static void* my_gballoc_malloc(size_t size)
 {
@@ -54,6 +58,7 @@ static void my_gballoc_free(void* ptr)
 #define TEST_CONTEXT                    (void*)0x4444
 #define TEST_ATTACH_PERFORMATIVE        (AMQP_VALUE)0x5000
 #define TEST_BEGIN_PERFORMATIVE            (AMQP_VALUE)0x5001
+#define TEST_TIMER_QUEUE_HANDLE            (TIMER_QUEUE_HANDLE)0x5002
 
 static TRANSFER_HANDLE test_transfer_handle = (TRANSFER_HANDLE)0x6001;
 static ON_ENDPOINT_FRAME_RECEIVED saved_frame_received_callback;
@@ -88,9 +93,197 @@ static int my_connection_start_endpoint(ENDPOINT_HANDLE endpoint, ON_ENDPOINT_FR
     return 0;
 }
 
+static BEGIN_HANDLE test_begin_handle = (BEGIN_HANDLE)0x6002;
+static AMQP_VALUE test_begin_amqp_value = (AMQP_VALUE)0x6003;
+static DISPOSITION_HANDLE test_disposition_handle = (DISPOSITION_HANDLE)0x6004;
+static AMQP_VALUE test_disposition_amqp_value = (AMQP_VALUE)0x6005;
+
+/* accepted and other_accepted are different values holding the same delivery state */
+#define TEST_BEGIN_DESCRIPTOR           (AMQP_VALUE)0x5003
+#define TEST_ACCEPTED_STATE             (AMQP_VALUE)0x5010
+#define TEST_OTHER_ACCEPTED_STATE       (AMQP_VALUE)0x5011
+#define TEST_RELEASED_STATE             (AMQP_VALUE)0x5012
+#define TEST_OVERSIZED_STATE            (AMQP_VALUE)0x5013
+#define TEST_ACCEPTED_DESCRIPTOR        (AMQP_VALUE)0x5020
+#define TEST_RELEASED_DESCRIPTOR        (AMQP_VALUE)0x5021
+#define TEST_OVERSIZED_STATE_SIZE       45
+#define TEST_MAX_SENT_FRAMES            8
+
+static const unsigned char test_accepted_state_bytes[] = { 0x00, 0x53, 0x24, 0x45 };
+static const unsigned char test_released_state_bytes[] = { 0x00, 0x53, 0x26, 0x45 };
+static size_t test_encoded_delivery_state_count;
+
+typedef struct TEST_SENT_FRAME_TAG
+{
+    unsigned char performative_bytes[128];
+    size_t performative_size;
+    size_t payload_size;
+    size_t payload_parts;
+    void* payload_bytes;
+    ON_SEND_COMPLETE on_send_complete;
+    void* callback_context;
+} TEST_SENT_FRAME;
+
+static TEST_SENT_FRAME test_sent_frames[TEST_MAX_SENT_FRAMES];
+static size_t test_sent_frame_count;
+
+static bool test_write_1000_bytes(void* user_context, PAYLOAD_WRITE_FUNCTION* stream_writer, void* stream_context)
+{
+    unsigned char bytes[100];
+    size_t i;
+    bool result = true;
+    (void)user_context;
+    (void)memset(bytes, 0x42, sizeof(bytes));
+    for (i = 0; result && (i < 10); i++)
+    {
+        result = stream_writer(stream_context, bytes, sizeof(bytes));
+    }
+    return result;
+}
+
+/* calls the on_send_complete callbacks of the sent frames the way the connection does once each frame is sent */
+static void complete_sent_frames(IO_SEND_RESULT send_result)
+{
+    size_t i;
+    for (i = 0; i < test_sent_frame_count; i++)
+    {
+        if (test_sent_frames[i].on_send_complete != NULL)
+        {
+            test_sent_frames[i].on_send_complete(test_sent_frames[i].callback_context, send_result);
+        }
+    }
+}
+
+static AMQP_VALUE my_amqpvalue_get_inplace_descriptor(AMQP_VALUE value)
+{
+    AMQP_VALUE result;
+
+    if (value == TEST_BEGIN_PERFORMATIVE)
+    {
+        result = TEST_BEGIN_DESCRIPTOR;
+    }
+    else if ((value == TEST_ACCEPTED_STATE) || (value == TEST_OTHER_ACCEPTED_STATE))
+    {
+        result = TEST_ACCEPTED_DESCRIPTOR;
+    }
+    else if (value == TEST_RELEASED_STATE)
+    {
+        result = TEST_RELEASED_DESCRIPTOR;
+    }
+    else
+    {
+        result = TEST_DESCRIPTOR_AMQP_VALUE;
+    }
+
+    return result;
+}
+
+static bool my_is_begin_type_by_descriptor(AMQP_VALUE descriptor)
+{
+    return descriptor == TEST_BEGIN_DESCRIPTOR;
+}
+
+static int my_begin_get_incoming_window(BEGIN_HANDLE begin, uint32_t* incoming_window_value)
+{
+    (void)begin;
+    *incoming_window_value = 1000;
+    return 0;
+}
+
+static int my_connection_get_remote_max_frame_size(CONNECTION_HANDLE connection, uint32_t* remote_max_frame_size)
+{
+    (void)connection;
+    *remote_max_frame_size = some_remote_max_frame_size;
+    return 0;
+}
+
+static int my_connection_encode_frame_bytes(ENDPOINT_HANDLE endpoint, const unsigned char* performative_bytes, size_t performative_size, PAYLOAD* payloads, ON_SEND_COMPLETE on_send_complete, void* callback_context)
+{
+    (void)endpoint;
+
+    ASSERT_IS_TRUE(test_sent_frame_count < TEST_MAX_SENT_FRAMES);
+    ASSERT_IS_TRUE(performative_size <= sizeof(test_sent_frames[0].performative_bytes));
+    (void)memcpy(test_sent_frames[test_sent_frame_count].performative_bytes, performative_bytes, performative_size);
+    test_sent_frames[test_sent_frame_count].performative_size = performative_size;
+    test_sent_frames[test_sent_frame_count].payload_size = payload_get_length(payloads);
+    test_sent_frames[test_sent_frame_count].payload_parts = payload_get_parts(payloads);
+    test_sent_frames[test_sent_frame_count].payload_bytes = (void*)payload_peek_bytes(payloads);
+    test_sent_frames[test_sent_frame_count].on_send_complete = on_send_complete;
+    test_sent_frames[test_sent_frame_count].callback_context = callback_context;
+    test_sent_frame_count++;
+
+    return 0;
+}
+
+static const unsigned char* get_test_delivery_state_bytes(AMQP_VALUE value, size_t* size)
+{
+    const unsigned char* result;
+
+    if ((value == TEST_ACCEPTED_STATE) || (value == TEST_OTHER_ACCEPTED_STATE))
+    {
+        result = test_accepted_state_bytes;
+        *size = sizeof(test_accepted_state_bytes);
+    }
+    else if (value == TEST_RELEASED_STATE)
+    {
+        result = test_released_state_bytes;
+        *size = sizeof(test_released_state_bytes);
+    }
+    else
+    {
+        result = NULL;
+        *size = (value == TEST_OVERSIZED_STATE) ? TEST_OVERSIZED_STATE_SIZE : 0;
+    }
+
+    return result;
+}
+
+static int my_amqpvalue_get_encoded_size(AMQP_VALUE value, size_t* encoded_size)
+{
+    (void)get_test_delivery_state_bytes(value, encoded_size);
+    return 0;
+}
+
+static int my_amqpvalue_encode_to_payload(AMQP_VALUE value, PAYLOAD* payload)
+{
+    size_t size;
+    const unsigned char* bytes = get_test_delivery_state_bytes(value, &size);
+
+    payload_append_data(payload, bytes, size);
+    test_encoded_delivery_state_count++;
+    return 0;
+}
+
+static bool my_amqpvalue_are_equal(AMQP_VALUE value1, AMQP_VALUE value2)
+{
+    return value1 == value2;
+}
+
+static AMQP_VALUE my_amqpvalue_clone(AMQP_VALUE value)
+{
+    return value;
+}
+
+/* a session that got its BEGIN answered, with one link endpoint using output handle 0 */
+static void create_mapped_session_with_link_endpoint(SESSION_HANDLE* session, LINK_ENDPOINT_HANDLE* link_endpoint)
+{
+    *session = session_create(TEST_CONNECTION_HANDLE, NULL, NULL);
+    ASSERT_IS_NOT_NULL(*session);
+    *link_endpoint = session_create_link_endpoint(*session, "1");
+    ASSERT_IS_NOT_NULL(*link_endpoint);
+    ASSERT_ARE_EQUAL(int, 0, session_begin(*session));
+    saved_connection_state_changed_callback(saved_callback_context, CONNECTION_STATE_OPENED, CONNECTION_STATE_OPEN_SENT);
+    saved_frame_received_callback(saved_callback_context, TEST_BEGIN_PERFORMATIVE, 0, NULL);
+    umock_c_reset_all_calls();
+    test_sent_frame_count = 0;
+    test_encoded_delivery_state_count = 0;
+}
+
 static TEST_MUTEX_HANDLE g_testByTest;
 
 MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+TEST_DEFINE_ENUM_TYPE(IO_SEND_RESULT, IO_SEND_RESULT_VALUES);
+IMPLEMENT_UMOCK_C_ENUM_TYPE(IO_SEND_RESULT, IO_SEND_RESULT_VALUES);
 
 static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
 {
@@ -110,6 +303,11 @@ TEST_SUITE_INITIALIZE(suite_init)
 
     result = umocktypes_charptr_register_types();
     ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_bool_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    REGISTER_TYPE(IO_SEND_RESULT, IO_SEND_RESULT);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_calloc, my_gballoc_calloc);
@@ -117,22 +315,55 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
     REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_ulong, my_amqpvalue_get_ulong);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_uint, 0);
-    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_inplace_descriptor, TEST_DESCRIPTOR_AMQP_VALUE);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_inplace_descriptor, my_amqpvalue_get_inplace_descriptor);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_string, 0);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_list_item, TEST_LIST_ITEM_AMQP_VALUE);
     REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_inplace_described_value, TEST_DESCRIBED_AMQP_VALUE);
-    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_encoded_size, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_get_encoded_size, my_amqpvalue_get_encoded_size);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_encode_to_payload, my_amqpvalue_encode_to_payload);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_are_equal, my_amqpvalue_are_equal);
+    REGISTER_GLOBAL_MOCK_HOOK(amqpvalue_clone, my_amqpvalue_clone);
+    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_get_type, AMQP_TYPE_DESCRIBED);
+    REGISTER_GLOBAL_MOCK_HOOK(is_begin_type_by_descriptor, my_is_begin_type_by_descriptor);
+    REGISTER_GLOBAL_MOCK_RETURN(begin_create, test_begin_handle);
+    REGISTER_GLOBAL_MOCK_HOOK(begin_get_incoming_window, my_begin_get_incoming_window);
+    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_begin, test_begin_amqp_value);
+    REGISTER_GLOBAL_MOCK_RETURN(disposition_create, test_disposition_handle);
+    REGISTER_GLOBAL_MOCK_RETURN(amqpvalue_create_disposition, test_disposition_amqp_value);
     REGISTER_GLOBAL_MOCK_RETURN(connection_open, 0);
     REGISTER_GLOBAL_MOCK_RETURN(connection_close, 0);
     REGISTER_GLOBAL_MOCK_RETURN(connection_create_endpoint, TEST_ENDPOINT_HANDLE);
     REGISTER_GLOBAL_MOCK_RETURN(connection_endpoint_get_incoming_channel, 0);
     REGISTER_GLOBAL_MOCK_RETURN(connection_encode_frame, 0);
-    REGISTER_GLOBAL_MOCK_RETURN(connection_get_remote_max_frame_size, 0);
+    REGISTER_GLOBAL_MOCK_HOOK(connection_get_remote_max_frame_size, my_connection_get_remote_max_frame_size);
+    REGISTER_GLOBAL_MOCK_HOOK(connection_encode_frame_bytes, my_connection_encode_frame_bytes);
+    REGISTER_GLOBAL_MOCK_RETURN(connection_get_timer_queue, TEST_TIMER_QUEUE_HANDLE);
     REGISTER_GLOBAL_MOCK_HOOK(connection_start_endpoint, my_connection_start_endpoint);
 
     REGISTER_UMOCK_ALIAS_TYPE(SESSION_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(CONNECTION_HANDLE, void*);
     REGISTER_UMOCK_ALIAS_TYPE(ENDPOINT_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TIMER_QUEUE_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(LINK_ENDPOINT_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(AMQP_VALUE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(BEGIN_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(BEGIN_HANDLE*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(DISPOSITION_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ERROR_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PAYLOAD*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_SEND_COMPLETE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_ENDPOINT_FRAME_RECEIVED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(ON_CONNECTION_STATE_CHANGED, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(const unsigned char*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(size_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(uint16_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(uint32_t*, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(AMQP_TYPE, int);
+    REGISTER_UMOCK_ALIAS_TYPE(role, bool);
+    REGISTER_UMOCK_ALIAS_TYPE(handle, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(delivery_number, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(transfer_number, uint32_t);
+    REGISTER_UMOCK_ALIAS_TYPE(transfer_number*, void*);
 }
 
 TEST_SUITE_CLEANUP(suite_cleanup)
@@ -150,6 +381,8 @@ TEST_FUNCTION_INITIALIZE(method_init)
     }
 
     umock_c_reset_all_calls();
+    test_sent_frame_count = 0;
+    test_encoded_delivery_state_count = 0;
 }
 
 TEST_FUNCTION_CLEANUP(method_cleanup)
@@ -476,9 +709,102 @@ TEST_FUNCTION(session_destroy_link_endpoint_when_2_endpoints_are_there_frees_the
     session_destroy_link_endpoint(link_endpoint2);
     session_destroy(session);
 }
+#endif
+
+/* session_set_max_transfer_frame_size */
+
+/* Tests_S_R_S_SESSION_01_080: [If session is NULL or max_transfer_frame_size is neither 0 nor at least 512, session_set_max_transfer_frame_size shall fail and return a non-zero value.] */
+TEST_FUNCTION(session_set_max_transfer_frame_size_with_NULL_session_fails)
+{
+    // arrange
+
+    // act
+    int result = session_set_max_transfer_frame_size(NULL, 65536);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_S_R_S_SESSION_01_080: [If session is NULL or max_transfer_frame_size is neither 0 nor at least 512, session_set_max_transfer_frame_size shall fail and return a non-zero value.] */
+TEST_FUNCTION(session_set_max_transfer_frame_size_with_511_bytes_fails)
+{
+    // arrange
+    int result;
+    SESSION_HANDLE session = session_create(TEST_CONNECTION_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    result = session_set_max_transfer_frame_size(session, 511);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_081: [session_set_max_transfer_frame_size shall set the size up to which transfer frames are filled, 0 meaning the remote max frame size.] */
+TEST_FUNCTION(session_set_max_transfer_frame_size_sets_the_value)
+{
+    // arrange
+    int result;
+    uint32_t max_transfer_frame_size;
+    SESSION_HANDLE session = session_create(TEST_CONNECTION_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    result = session_set_max_transfer_frame_size(session, 262144);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, session_get_max_transfer_frame_size(session, &max_transfer_frame_size));
+    ASSERT_ARE_EQUAL(uint32_t, 262144, max_transfer_frame_size);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    session_destroy(session);
+}
+
+/* session_get_timer_queue */
+
+/* Tests_S_R_S_SESSION_01_084: [If session is NULL, session_get_timer_queue shall return NULL.] */
+TEST_FUNCTION(session_get_timer_queue_with_NULL_session_returns_NULL)
+{
+    // arrange
+
+    // act
+    TIMER_QUEUE_HANDLE result = session_get_timer_queue(NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_SESSION_01_083: [session_get_timer_queue shall return the timer queue of the connection the session was created on, obtained by calling connection_get_timer_queue.] */
+TEST_FUNCTION(session_get_timer_queue_returns_the_connection_timer_queue)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE result;
+    SESSION_HANDLE session = session_create(TEST_CONNECTION_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(connection_get_timer_queue(TEST_CONNECTION_HANDLE));
+
+    // act
+    result = session_get_timer_queue(session);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, TEST_TIMER_QUEUE_HANDLE, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    session_destroy(session);
+}
 
 /* session_send_transfer */
 
+#if 0
 /* Tests_S_R_S_SESSION_01_051: [session_send_transfer shall send a transfer frame with the performative indicated in the transfer argument.] */
 /* Tests_S_R_S_SESSION_01_053: [On success, session_send_transfer shall return 0.] */
 /* Tests_S_R_S_SESSION_01_055: [The encoding of the frame shall be done by calling connection_encode_frame and passing as arguments: the connection handle associated with the session, the transfer performative and the payload chunks passed to session_send_transfer.] */
@@ -516,6 +842,62 @@ TEST_FUNCTION(session_transfer_sends_the_frame_to_the_connection)
 }
 #endif
 
+/* session_get_next_delivery_id */
+
+/* Tests_S_R_S_SESSION_01_086: [If session or next_delivery_id is NULL, session_get_next_delivery_id shall fail and return a non-zero value.] */
+TEST_FUNCTION(session_get_next_delivery_id_with_NULL_session_fails)
+{
+    // arrange
+    delivery_number next_delivery_id;
+
+    // act
+    int result = session_get_next_delivery_id(NULL, &next_delivery_id);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_SESSION_01_086: [If session or next_delivery_id is NULL, session_get_next_delivery_id shall fail and return a non-zero value.] */
+TEST_FUNCTION(session_get_next_delivery_id_with_NULL_next_delivery_id_fails)
+{
+    // arrange
+    int result;
+    SESSION_HANDLE session = session_create(TEST_CONNECTION_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    result = session_get_next_delivery_id(session, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_085: [session_get_next_delivery_id shall return in next_delivery_id the delivery id that the next transfer sent on the session will take, and return 0.] */
+TEST_FUNCTION(session_get_next_delivery_id_on_a_new_session_returns_0)
+{
+    // arrange
+    int result;
+    delivery_number next_delivery_id = 42;
+    SESSION_HANDLE session = session_create(TEST_CONNECTION_HANDLE, NULL, NULL);
+    umock_c_reset_all_calls();
+
+    // act
+    result = session_get_next_delivery_id(session, &next_delivery_id);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(uint32_t, 0, next_delivery_id);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    session_destroy(session);
+}
+
 /* Tests_S_R_S_SESSION_01_054: [If link_endpoint or transfer is NULL, session_send_transfer shall fail and return a non-zero value.] */
 TEST_FUNCTION(session_transfer_with_NULL_transfer_fails)
 {
@@ -527,7 +909,7 @@ TEST_FUNCTION(session_transfer_with_NULL_transfer_fails)
     umock_c_reset_all_calls();
 
     // act
-    result = session_send_transfer(link_endpoint, NULL, NULL, 0, &delivery_id, test_on_send_complete, (void*)0x4242);
+    result = session_send_transfer(link_endpoint, NULL, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
 
     // assert
     ASSERT_ARE_NOT_EQUAL(int, 0, result);
@@ -545,7 +927,7 @@ TEST_FUNCTION(session_transfer_with_NULL_link_endpoint_fails)
 
     // act
     delivery_number delivery_id;
-    int result = session_send_transfer(NULL, test_transfer_handle, NULL, 0, &delivery_id, test_on_send_complete, (void*)0x4242);
+    int result = session_send_transfer(NULL, test_transfer_handle, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
 
     // assert
     ASSERT_ARE_NOT_EQUAL(int, 0, result);
@@ -659,7 +1041,670 @@ TEST_FUNCTION(when_session_is_not_MAPPED_the_transfer_fails)
     umock_c_reset_all_calls();
 
     // act
-    result = session_send_transfer(link_endpoint, test_transfer_handle, NULL, 0, &delivery_id, test_on_send_complete, (void*)0x4242);
+    result = session_send_transfer(link_endpoint, test_transfer_handle, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* session_send_link_transfer */
+
+/* Tests_S_R_S_SESSION_01_073: [If link_endpoint or delivery_id is NULL, or delivery_tag is NULL while delivery_tag_size is not 0, session_send_link_transfer shall fail and return SESSION_SEND_TRANSFER_ERROR.] */
+TEST_FUNCTION(session_send_link_transfer_with_NULL_link_endpoint_fails)
+{
+    // arrange
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+
+    // act
+    SESSION_SEND_TRANSFER_RESULT result = session_send_link_transfer(NULL, delivery_tag, sizeof(delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_ERROR, (int)result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_SESSION_01_073: [If link_endpoint or delivery_id is NULL, or delivery_tag is NULL while delivery_tag_size is not 0, session_send_link_transfer shall fail and return SESSION_SEND_TRANSFER_ERROR.] */
+TEST_FUNCTION(session_send_link_transfer_with_NULL_delivery_tag_and_non_zero_size_fails)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+
+    // act
+    result = session_send_link_transfer(link_endpoint, NULL, 4, 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_ERROR, (int)result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, test_sent_frame_count);
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_074: [If delivery_tag_size is greater than 32, session_send_link_transfer shall fail and return SESSION_SEND_TRANSFER_ERROR.] */
+TEST_FUNCTION(session_send_link_transfer_with_a_33_bytes_delivery_tag_fails)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[33] = { 0 };
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_ERROR, (int)result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, test_sent_frame_count);
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_074: [If delivery_tag_size is greater than 32, session_send_link_transfer shall fail and return SESSION_SEND_TRANSFER_ERROR.] */
+TEST_FUNCTION(session_send_link_transfer_with_a_32_bytes_delivery_tag_succeeds)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[32];
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)memset(delivery_tag, 0x5A, sizeof(delivery_tag));
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(size_t, 1, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, 59, test_sent_frames[0].performative_size);
+    ASSERT_ARE_EQUAL(int, 0x20, test_sent_frames[0].performative_bytes[17]);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[0].performative_bytes + 18, delivery_tag, sizeof(delivery_tag)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_075: [session_send_link_transfer shall send the same frames as session_send_transfer would for a transfer performative with the link endpoint handle, delivery_tag, message_format and settled set, encoding them with connection_encode_frame_bytes.] */
+/* Tests_S_R_S_SESSION_01_057: [The delivery ids shall be assigned starting at 0.] */
+TEST_FUNCTION(session_send_link_transfer_sends_the_transfer_performative_bytes)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    unsigned char expected_bytes[] =
+    {
+        0x00, 0x53, 0x14, 0xC0, 0x1A, 0x06,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0xA0, 0x04, 0x01, 0x02, 0x03, 0x04,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0x56, 0x01,
+        0x56, 0x00
+    };
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+
+    STRICT_EXPECTED_CALL(connection_get_remote_max_frame_size(TEST_CONNECTION_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(connection_encode_frame_bytes(TEST_ENDPOINT_HANDLE, IGNORED_PTR_ARG, sizeof(expected_bytes), NULL, test_on_send_complete, (void*)0x4242));
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(uint32_t, 0, delivery_id);
+    ASSERT_ARE_EQUAL(size_t, 1, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_bytes), test_sent_frames[0].performative_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[0].performative_bytes, expected_bytes, sizeof(expected_bytes)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_076: [The transfer performative bytes shall be kept by the link endpoint and only be rebuilt when the delivery tag size changes.] */
+TEST_FUNCTION(session_send_link_transfer_patches_the_delivery_id_message_format_and_settled_into_the_kept_bytes)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    unsigned char other_delivery_tag[] = { 0x05, 0x06, 0x07, 0x08 };
+    unsigned char expected_bytes[] =
+    {
+        0x00, 0x53, 0x14, 0xC0, 0x1A, 0x06,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0x70, 0x00, 0x00, 0x00, 0x01,
+        0xA0, 0x04, 0x05, 0x06, 0x07, 0x08,
+        0x70, 0x80, 0x01, 0x37, 0x00,
+        0x56, 0x00,
+        0x56, 0x00
+    };
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // act
+    result = session_send_link_transfer(link_endpoint, other_delivery_tag, sizeof(other_delivery_tag), 0x80013700, false, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(uint32_t, 1, delivery_id);
+    ASSERT_ARE_EQUAL(size_t, 2, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_bytes), test_sent_frames[1].performative_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[1].performative_bytes, expected_bytes, sizeof(expected_bytes)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_076: [The transfer performative bytes shall be kept by the link endpoint and only be rebuilt when the delivery tag size changes.] */
+TEST_FUNCTION(session_send_link_transfer_rebuilds_the_kept_bytes_when_the_delivery_tag_size_changes)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    unsigned char long_delivery_tag[] = { 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18 };
+    unsigned char expected_bytes[] =
+    {
+        0x00, 0x53, 0x14, 0xC0, 0x1E, 0x06,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0x70, 0x00, 0x00, 0x00, 0x01,
+        0xA0, 0x08, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0x56, 0x01,
+        0x56, 0x00
+    };
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // act
+    result = session_send_link_transfer(link_endpoint, long_delivery_tag, sizeof(long_delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(size_t, 2, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_bytes), test_sent_frames[1].performative_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[1].performative_bytes, expected_bytes, sizeof(expected_bytes)));
+    (void)session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+    ASSERT_ARE_EQUAL(size_t, 31, test_sent_frames[2].performative_size);
+    ASSERT_ARE_EQUAL(int, 0x1A, test_sent_frames[2].performative_bytes[4]);
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_077: [When the payload does not fit in one frame, it shall be sent as several transfer frames, each filled up to the transfer frame size.] */
+/* Tests_S_R_S_SESSION_01_078: [All frames of a multi-frame transfer shall reuse the same encoded transfer performative, only the more field shall differ between them.] */
+TEST_FUNCTION(session_send_link_transfer_sets_more_on_all_frames_but_the_last_of_a_multi_frame_transfer)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    unsigned char payload_bytes[1000];
+    PAYLOAD* payload = payload_create();
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)memset(payload_bytes, 0x42, sizeof(payload_bytes));
+    payload_append_data(payload, payload_bytes, sizeof(payload_bytes));
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, false, payload, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    /* 512 byte frames leave 512 - 31 - 8 = 473 bytes for the payload */
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(size_t, 3, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, 473, test_sent_frames[0].payload_size);
+    ASSERT_ARE_EQUAL(size_t, 473, test_sent_frames[1].payload_size);
+    ASSERT_ARE_EQUAL(size_t, 54, test_sent_frames[2].payload_size);
+    ASSERT_ARE_EQUAL(int, 0x01, test_sent_frames[0].performative_bytes[30]);
+    ASSERT_ARE_EQUAL(int, 0x01, test_sent_frames[1].performative_bytes[30]);
+    ASSERT_ARE_EQUAL(int, 0x00, test_sent_frames[2].performative_bytes[30]);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[0].performative_bytes, test_sent_frames[1].performative_bytes, 30));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[0].performative_bytes, test_sent_frames[2].performative_bytes, 30));
+    (void)session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, false, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+    ASSERT_ARE_EQUAL(int, 0x00, test_sent_frames[3].performative_bytes[30]);
+
+    // cleanup
+    payload_destroy(&payload);
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_082: [If the payload has no callback parts, each transfer frame shall carry a borrowed slice of the payload instead of a copy.] */
+TEST_FUNCTION(session_send_link_transfer_of_a_multi_part_payload_sends_frames_borrowing_slices_of_each_part)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    unsigned char first_part[600];
+    unsigned char second_part[400];
+    PAYLOAD* payload = payload_create();
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)memset(first_part, 0x41, sizeof(first_part));
+    (void)memset(second_part, 0x42, sizeof(second_part));
+    payload_append_borrowed_data(payload, first_part, sizeof(first_part));
+    payload_append_borrowed_data(payload, second_part, sizeof(second_part));
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, false, payload, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    /* frames of 473 bytes: the first within the first part, the second across both parts, the third ending the second part */
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(size_t, 3, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, 473, test_sent_frames[0].payload_size);
+    ASSERT_ARE_EQUAL(size_t, 1, test_sent_frames[0].payload_parts);
+    ASSERT_ARE_EQUAL(void_ptr, first_part, test_sent_frames[0].payload_bytes);
+    ASSERT_ARE_EQUAL(int, 0x01, test_sent_frames[0].performative_bytes[30]);
+    ASSERT_ARE_EQUAL(size_t, 473, test_sent_frames[1].payload_size);
+    ASSERT_ARE_EQUAL(size_t, 2, test_sent_frames[1].payload_parts);
+    ASSERT_ARE_EQUAL(void_ptr, first_part + 473, test_sent_frames[1].payload_bytes);
+    ASSERT_ARE_EQUAL(int, 0x01, test_sent_frames[1].performative_bytes[30]);
+    ASSERT_ARE_EQUAL(size_t, 54, test_sent_frames[2].payload_size);
+    ASSERT_ARE_EQUAL(size_t, 1, test_sent_frames[2].payload_parts);
+    ASSERT_ARE_EQUAL(void_ptr, second_part + 346, test_sent_frames[2].payload_bytes);
+    ASSERT_ARE_EQUAL(int, 0x00, test_sent_frames[2].performative_bytes[30]);
+
+    // cleanup
+    payload_destroy(&payload);
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_082: [If the payload has no callback parts, each transfer frame shall carry a borrowed slice of the payload instead of a copy.] */
+TEST_FUNCTION(session_send_link_transfer_of_a_payload_filling_whole_frames_clears_more_on_the_last_full_frame)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    unsigned char payload_bytes[946];
+    PAYLOAD* payload = payload_create();
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)memset(payload_bytes, 0x42, sizeof(payload_bytes));
+    payload_append_borrowed_data(payload, payload_bytes, sizeof(payload_bytes));
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, false, payload, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(size_t, 2, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, 473, test_sent_frames[0].payload_size);
+    ASSERT_ARE_EQUAL(void_ptr, payload_bytes, test_sent_frames[0].payload_bytes);
+    ASSERT_ARE_EQUAL(int, 0x01, test_sent_frames[0].performative_bytes[30]);
+    ASSERT_ARE_EQUAL(size_t, 473, test_sent_frames[1].payload_size);
+    ASSERT_ARE_EQUAL(void_ptr, payload_bytes + 473, test_sent_frames[1].payload_bytes);
+    ASSERT_ARE_EQUAL(int, 0x00, test_sent_frames[1].performative_bytes[30]);
+
+    // cleanup
+    payload_destroy(&payload);
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_087: [Only the last frame of a multi-frame transfer shall carry on_send_complete, so that it is called once per transfer.] */
+TEST_FUNCTION(session_send_link_transfer_passes_on_send_complete_with_the_last_frame_of_a_multi_frame_transfer_only)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    unsigned char payload_bytes[1000];
+    PAYLOAD* payload = payload_create();
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)memset(payload_bytes, 0x42, sizeof(payload_bytes));
+    payload_append_data(payload, payload_bytes, sizeof(payload_bytes));
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, false, payload, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_ARE_EQUAL(size_t, 3, test_sent_frame_count);
+    ASSERT_IS_NULL(test_sent_frames[0].on_send_complete);
+    ASSERT_IS_NULL(test_sent_frames[1].on_send_complete);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)test_on_send_complete, (void*)test_sent_frames[2].on_send_complete);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)0x4242, test_sent_frames[2].callback_context);
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(test_on_send_complete((void*)0x4242, IO_SEND_OK));
+    complete_sent_frames(IO_SEND_OK);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    payload_destroy(&payload);
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_087: [Only the last frame of a multi-frame transfer shall carry on_send_complete, so that it is called once per transfer.] */
+TEST_FUNCTION(session_send_link_transfer_of_a_callback_payload_passes_on_send_complete_with_the_last_frame_only)
+{
+    // arrange
+    SESSION_SEND_TRANSFER_RESULT result;
+    delivery_number delivery_id;
+    unsigned char delivery_tag[] = { 0x01, 0x02, 0x03, 0x04 };
+    PAYLOAD* payload = payload_create();
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    size_t i;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    payload_append_callback_with_size(payload, test_write_1000_bytes, NULL, 1000);
+
+    // act
+    result = session_send_link_transfer(link_endpoint, delivery_tag, sizeof(delivery_tag), 0, false, payload, &delivery_id, test_on_send_complete, (void*)0x4242);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, (int)SESSION_SEND_TRANSFER_OK, (int)result);
+    ASSERT_IS_TRUE(test_sent_frame_count > 1);
+    for (i = 0; i < test_sent_frame_count - 1; i++)
+    {
+        ASSERT_IS_NULL(test_sent_frames[i].on_send_complete);
+    }
+    ASSERT_ARE_EQUAL(void_ptr, (void*)test_on_send_complete, (void*)test_sent_frames[test_sent_frame_count - 1].on_send_complete);
+
+    // cleanup
+    payload_destroy(&payload);
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* session_send_link_flow */
+
+/* Tests_S_R_S_SESSION_01_064: [If link_endpoint is NULL, session_send_link_flow shall fail and return a non-zero value.] */
+TEST_FUNCTION(session_send_link_flow_with_NULL_link_endpoint_fails)
+{
+    // arrange
+
+    // act
+    int result = session_send_link_flow(NULL, 5, 300);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_SESSION_01_065: [session_send_link_flow shall send a flow frame carrying the session's next-incoming-id, incoming-window, next-outgoing-id and outgoing-window, the link endpoint handle, delivery_count and link_credit, by patching those fields into the flow performative bytes kept by the link endpoint.] */
+/* Tests_S_R_S_SESSION_01_066: [The frame shall be encoded by calling connection_encode_frame_bytes.] */
+TEST_FUNCTION(session_send_link_flow_sends_the_flow_performative_bytes)
+{
+    // arrange
+    int result;
+    delivery_number delivery_id;
+    unsigned char expected_bytes[] =
+    {
+        0x00, 0x53, 0x13, 0xC0, 0x24, 0x07,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0x70, 0x00, 0x00, 0x00, 0x64,
+        0x70, 0x00, 0x00, 0x00, 0x01,
+        0x70, 0x00, 0x00, 0x00, 0xC7,
+        0x70, 0x00, 0x00, 0x00, 0x00,
+        0x70, 0x00, 0x00, 0x00, 0x05,
+        0x70, 0x00, 0x00, 0x01, 0x2C
+    };
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)session_set_incoming_window(session, 100);
+    (void)session_set_outgoing_window(session, 200);
+    (void)session_send_link_transfer(link_endpoint, NULL, 0, 0, true, NULL, &delivery_id, test_on_send_complete, (void*)0x4242);
+    umock_c_reset_all_calls();
+    test_sent_frame_count = 0;
+
+    STRICT_EXPECTED_CALL(connection_encode_frame_bytes(TEST_ENDPOINT_HANDLE, IGNORED_PTR_ARG, sizeof(expected_bytes), NULL, NULL, NULL));
+
+    // act
+    result = session_send_link_flow(link_endpoint, 5, 300);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[0].performative_bytes, expected_bytes, sizeof(expected_bytes)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_067: [If connection_encode_frame_bytes fails, session_send_link_flow shall fail and return a non-zero value.] */
+TEST_FUNCTION(when_connection_encode_frame_bytes_fails_session_send_link_flow_fails)
+{
+    // arrange
+    int result;
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+
+    STRICT_EXPECTED_CALL(connection_encode_frame_bytes(TEST_ENDPOINT_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, NULL, NULL, NULL))
+        .SetReturn(1);
+
+    // act
+    result = session_send_link_flow(link_endpoint, 5, 300);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* session_send_link_disposition */
+
+/* Tests_S_R_S_SESSION_01_068: [If link_endpoint is NULL, session_send_link_disposition shall fail and return a non-zero value.] */
+TEST_FUNCTION(session_send_link_disposition_with_NULL_link_endpoint_fails)
+{
+    // arrange
+
+    // act
+    int result = session_send_link_disposition(NULL, role_receiver, 3, 7, true, TEST_ACCEPTED_STATE);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_S_R_S_SESSION_01_069: [session_send_link_disposition shall send a disposition frame carrying role, first, last, settled and delivery_state, encoded with connection_encode_frame_bytes.] */
+TEST_FUNCTION(session_send_link_disposition_sends_the_disposition_performative_bytes)
+{
+    // arrange
+    int result;
+    unsigned char expected_bytes[] =
+    {
+        0x00, 0x53, 0x15, 0xC0, 0x13, 0x05,
+        0x56, 0x01,
+        0x70, 0x00, 0x00, 0x00, 0x03,
+        0x70, 0x00, 0x00, 0x00, 0x07,
+        0x56, 0x01,
+        0x00, 0x53, 0x24, 0x45
+    };
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+
+    // act
+    result = session_send_link_disposition(link_endpoint, role_receiver, 3, 7, true, TEST_ACCEPTED_STATE);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_bytes), test_sent_frames[0].performative_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[0].performative_bytes, expected_bytes, sizeof(expected_bytes)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_069: [session_send_link_disposition shall send a disposition frame carrying role, first, last, settled and delivery_state, encoded with connection_encode_frame_bytes.] */
+TEST_FUNCTION(session_send_link_disposition_without_a_delivery_state_leaves_the_state_out)
+{
+    // arrange
+    int result;
+    unsigned char expected_bytes[] =
+    {
+        0x00, 0x53, 0x15, 0xC0, 0x0F, 0x04,
+        0x56, 0x00,
+        0x70, 0x00, 0x00, 0x00, 0x03,
+        0x70, 0x00, 0x00, 0x00, 0x03,
+        0x56, 0x00
+    };
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)session_send_link_disposition(link_endpoint, role_receiver, 1, 2, true, TEST_ACCEPTED_STATE);
+
+    // act
+    result = session_send_link_disposition(link_endpoint, role_sender, 3, 3, false, NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 2, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected_bytes), test_sent_frames[1].performative_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[1].performative_bytes, expected_bytes, sizeof(expected_bytes)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_070: [The encoded delivery_state shall be kept by the link endpoint and shall only be encoded again when delivery_state differs from the previous one.] */
+TEST_FUNCTION(session_send_link_disposition_with_an_equal_delivery_state_does_not_encode_it_again)
+{
+    // arrange
+    int result;
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)session_send_link_disposition(link_endpoint, role_receiver, 1, 1, true, TEST_ACCEPTED_STATE);
+
+    // act
+    result = session_send_link_disposition(link_endpoint, role_receiver, 2, 2, true, TEST_OTHER_ACCEPTED_STATE);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, test_encoded_delivery_state_count);
+    ASSERT_ARE_EQUAL(size_t, 2, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, 24, test_sent_frames[1].performative_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[1].performative_bytes + 20, test_accepted_state_bytes, sizeof(test_accepted_state_bytes)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_070: [The encoded delivery_state shall be kept by the link endpoint and shall only be encoded again when delivery_state differs from the previous one.] */
+TEST_FUNCTION(session_send_link_disposition_with_a_different_delivery_state_encodes_it_again)
+{
+    // arrange
+    int result;
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+    (void)session_send_link_disposition(link_endpoint, role_receiver, 1, 1, true, TEST_ACCEPTED_STATE);
+
+    // act
+    result = session_send_link_disposition(link_endpoint, role_receiver, 2, 2, true, TEST_RELEASED_STATE);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 2, test_encoded_delivery_state_count);
+    ASSERT_ARE_EQUAL(size_t, 2, test_sent_frame_count);
+    ASSERT_ARE_EQUAL(size_t, 24, test_sent_frames[1].performative_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(test_sent_frames[1].performative_bytes + 20, test_released_state_bytes, sizeof(test_released_state_bytes)));
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_071: [If the delivery_state cannot be kept encoded, session_send_link_disposition shall send the disposition by creating a disposition performative and calling session_send_disposition.] */
+TEST_FUNCTION(session_send_link_disposition_with_a_delivery_state_too_large_for_the_kept_bytes_sends_a_disposition_performative)
+{
+    // arrange
+    int result;
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+
+    STRICT_EXPECTED_CALL(amqpvalue_get_encoded_size(TEST_OVERSIZED_STATE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(disposition_create(role_receiver, 3));
+    STRICT_EXPECTED_CALL(disposition_set_last(test_disposition_handle, 7));
+    STRICT_EXPECTED_CALL(disposition_set_settled(test_disposition_handle, true));
+    STRICT_EXPECTED_CALL(disposition_set_state(test_disposition_handle, TEST_OVERSIZED_STATE));
+    STRICT_EXPECTED_CALL(amqpvalue_create_disposition(test_disposition_handle));
+    STRICT_EXPECTED_CALL(connection_encode_frame(TEST_ENDPOINT_HANDLE, test_disposition_amqp_value, NULL, NULL, NULL));
+    STRICT_EXPECTED_CALL(amqpvalue_destroy(test_disposition_amqp_value));
+    STRICT_EXPECTED_CALL(disposition_destroy(test_disposition_handle));
+
+    // act
+    result = session_send_link_disposition(link_endpoint, role_receiver, 3, 7, true, TEST_OVERSIZED_STATE);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, test_sent_frame_count);
+
+    // cleanup
+    session_destroy_link_endpoint(link_endpoint);
+    session_destroy(session);
+}
+
+/* Tests_S_R_S_SESSION_01_072: [If connection_encode_frame_bytes fails, session_send_link_disposition shall fail and return a non-zero value.] */
+TEST_FUNCTION(when_connection_encode_frame_bytes_fails_session_send_link_disposition_fails)
+{
+    // arrange
+    int result;
+    SESSION_HANDLE session;
+    LINK_ENDPOINT_HANDLE link_endpoint;
+    create_mapped_session_with_link_endpoint(&session, &link_endpoint);
+
+    STRICT_EXPECTED_CALL(connection_encode_frame_bytes(TEST_ENDPOINT_HANDLE, IGNORED_PTR_ARG, IGNORED_NUM_ARG, NULL, NULL, NULL))
+        .SetReturn(1);
+
+    // act
+    result = session_send_link_disposition(link_endpoint, role_receiver, 3, 7, true, NULL);
 
     // assert
     ASSERT_ARE_NOT_EQUAL(int, 0, result);
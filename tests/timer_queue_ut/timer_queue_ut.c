@@ -0,0 +1,735 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#include "azure_macro_utils/macro_utils.h"
+#include "testrunnerswitcher.h"
+#include "umock_c/umock_c.h"
+#include "umock_c/umocktypes_charptr.h"
+#include "umock_c/umocktypes_bool.h"
+#include "umock_c/umocktypes_stdint.h"
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#define ENABLE_MOCKS
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/tickcounter.h"
+
+#undef ENABLE_MOCKS
+
+#include "azure_uamqp_c/timer_queue.h"
+
+static TICK_COUNTER_HANDLE test_tick_counter = (TICK_COUNTER_HANDLE)0x4242;
+static tickcounter_ms_t test_current_ms;
+static TIMER_QUEUE_HANDLE test_restart_timer_queue;
+static TIMER* test_timer_to_restart;
+
+static int my_tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, tickcounter_ms_t* current_ms)
+{
+    (void)tick_counter;
+    *current_ms = test_current_ms;
+    return 0;
+}
+
+MOCK_FUNCTION_WITH_CODE(, void, test_on_timer_expired, void*, context)
+    if (test_timer_to_restart != NULL)
+    {
+        (void)timer_start(test_restart_timer_queue, test_timer_to_restart, 0);
+    }
+MOCK_FUNCTION_END()
+
+static TEST_MUTEX_HANDLE g_testByTest;
+
+MU_DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    ASSERT_FAIL("umock_c reported error :%" PRI_MU_ENUM "", MU_ENUM_VALUE(UMOCK_C_ERROR_CODE, error_code));
+}
+
+BEGIN_TEST_SUITE(timer_queue_ut)
+
+TEST_SUITE_INITIALIZE(suite_init)
+{
+    int result;
+
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_bool_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_get_current_ms, my_tickcounter_get_current_ms);
+
+    REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(tickcounter_ms_t, unsigned long long);
+}
+
+TEST_SUITE_CLEANUP(suite_cleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+}
+
+TEST_FUNCTION_INITIALIZE(test_function_init)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    test_current_ms = 1000;
+    test_restart_timer_queue = NULL;
+    test_timer_to_restart = NULL;
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(test_function_cleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* timer_queue_create */
+
+/* Tests_SRS_TIMER_QUEUE_01_001: [ `timer_queue_create` shall create a new timer queue that reads the current time from `tick_counter` and return a non-NULL handle to it.]*/
+TEST_FUNCTION(timer_queue_create_succeeds)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE result;
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    result = timer_queue_create(test_tick_counter);
+
+    // assert
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(result);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_002: [ If `tick_counter` is NULL, `timer_queue_create` shall fail and return NULL.]*/
+TEST_FUNCTION(timer_queue_create_with_NULL_tick_counter_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE result;
+
+    // act
+    result = timer_queue_create(NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_003: [ If allocating memory for the timer queue fails, `timer_queue_create` shall fail and return NULL.]*/
+TEST_FUNCTION(when_allocating_memory_fails_timer_queue_create_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE result;
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = timer_queue_create(test_tick_counter);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* timer_queue_destroy */
+
+/* Tests_SRS_TIMER_QUEUE_01_004: [ `timer_queue_destroy` shall free all resources associated with the timer queue.]*/
+TEST_FUNCTION(timer_queue_destroy_frees_the_timer_queue)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    (void)timer_start(timer_queue, &timer, 10);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(timer_queue));
+
+    // act
+    timer_queue_destroy(timer_queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_005: [ Timers still running on the queue shall be stopped without calling their `on_timer_expired`.]*/
+TEST_FUNCTION(timer_queue_destroy_stops_running_timers)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer_1;
+    TIMER timer_2;
+    timer_init(&timer_1, test_on_timer_expired, (void*)0x1);
+    timer_init(&timer_2, test_on_timer_expired, (void*)0x2);
+    (void)timer_start(timer_queue, &timer_1, 10);
+    (void)timer_start(timer_queue, &timer_2, 0);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(timer_queue));
+
+    // act
+    timer_queue_destroy(timer_queue);
+
+    // assert
+    ASSERT_IS_FALSE(timer_is_running(&timer_1));
+    ASSERT_IS_FALSE(timer_is_running(&timer_2));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_006: [ If `timer_queue` is NULL, `timer_queue_destroy` shall do nothing.]*/
+TEST_FUNCTION(timer_queue_destroy_with_NULL_timer_queue_does_nothing)
+{
+    // arrange
+
+    // act
+    timer_queue_destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* timer_init */
+
+/* Tests_SRS_TIMER_QUEUE_01_007: [ `timer_init` shall initialize `timer` as not running, to call `on_timer_expired` with `context` when it expires.]*/
+/* Tests_SRS_TIMER_QUEUE_01_017: [ `timer_is_running` shall return true if `timer` has been started and has neither expired nor been stopped since.]*/
+TEST_FUNCTION(timer_init_initializes_a_stopped_timer)
+{
+    // arrange
+    TIMER timer;
+
+    // act
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+
+    // assert
+    ASSERT_IS_FALSE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_008: [ If `timer` is NULL, `timer_init` shall do nothing.]*/
+TEST_FUNCTION(timer_init_with_NULL_timer_does_nothing)
+{
+    // arrange
+
+    // act
+    timer_init(NULL, test_on_timer_expired, (void*)0x1);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* timer_start */
+
+/* Tests_SRS_TIMER_QUEUE_01_009: [ `timer_start` shall start `timer` on `timer_queue` so that it expires `timeout` milliseconds after the current time read from the tick counter of the queue.]*/
+/* Tests_SRS_TIMER_QUEUE_01_014: [ On success `timer_start` shall return 0.]*/
+/* Tests_SRS_TIMER_QUEUE_01_017: [ `timer_is_running` shall return true if `timer` has been started and has neither expired nor been stopped since.]*/
+TEST_FUNCTION(timer_start_starts_the_timer)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    tickcounter_ms_t time_to_next_deadline;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, IGNORED_NUM_ARG));
+
+    // act
+    result = timer_start(timer_queue, &timer, 10);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    (void)timer_queue_get_time_to_next_deadline(timer_queue, &time_to_next_deadline);
+    ASSERT_ARE_EQUAL(uint64_t, 10, (uint64_t)time_to_next_deadline);
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_010: [ If `timer` is already running, `timer_start` shall restart it with the new timeout.]*/
+TEST_FUNCTION(timer_start_on_a_running_timer_restarts_it)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    tickcounter_ms_t time_to_next_deadline;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    (void)timer_start(timer_queue, &timer, 10);
+    test_current_ms += 5;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    result = timer_start(timer_queue, &timer, 20);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    (void)timer_queue_get_time_to_next_deadline(timer_queue, &time_to_next_deadline);
+    ASSERT_ARE_EQUAL(uint64_t, 20, (uint64_t)time_to_next_deadline);
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_011: [ If `timer_queue` or `timer` is NULL, or `timer` was initialized with a NULL `on_timer_expired`, `timer_start` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(timer_start_with_NULL_timer_queue_fails)
+{
+    // arrange
+    TIMER timer;
+    int result;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+
+    // act
+    result = timer_start(NULL, &timer, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_FALSE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_011: [ If `timer_queue` or `timer` is NULL, or `timer` was initialized with a NULL `on_timer_expired`, `timer_start` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(timer_start_with_NULL_timer_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    int result;
+    umock_c_reset_all_calls();
+
+    // act
+    result = timer_start(timer_queue, NULL, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_011: [ If `timer_queue` or `timer` is NULL, or `timer` was initialized with a NULL `on_timer_expired`, `timer_start` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(timer_start_with_NULL_on_timer_expired_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    timer_init(&timer, NULL, (void*)0x1);
+    umock_c_reset_all_calls();
+
+    // act
+    result = timer_start(timer_queue, &timer, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_FALSE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_012: [ If getting the current time fails, `timer_start` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(when_getting_the_current_time_fails_timer_start_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG))
+        .SetReturn(1);
+
+    // act
+    result = timer_start(timer_queue, &timer, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_FALSE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_013: [ If making room for the timer in the queue fails, `timer_start` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(when_growing_the_queue_fails_timer_start_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    result = timer_start(timer_queue, &timer, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_FALSE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* timer_stop */
+
+/* Tests_SRS_TIMER_QUEUE_01_015: [ `timer_stop` shall remove `timer` from its queue so that it does not expire.]*/
+TEST_FUNCTION(timer_stop_stops_the_timer)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer_1;
+    TIMER timer_2;
+    tickcounter_ms_t time_to_next_deadline;
+    timer_init(&timer_1, test_on_timer_expired, (void*)0x1);
+    timer_init(&timer_2, test_on_timer_expired, (void*)0x2);
+    (void)timer_start(timer_queue, &timer_1, 10);
+    (void)timer_start(timer_queue, &timer_2, 20);
+    umock_c_reset_all_calls();
+
+    // act
+    timer_stop(&timer_1);
+
+    // assert
+    ASSERT_IS_FALSE(timer_is_running(&timer_1));
+    ASSERT_IS_TRUE(timer_is_running(&timer_2));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    (void)timer_queue_get_time_to_next_deadline(timer_queue, &time_to_next_deadline);
+    ASSERT_ARE_EQUAL(uint64_t, 20, (uint64_t)time_to_next_deadline);
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_016: [ If `timer` is NULL or not running, `timer_stop` shall do nothing.]*/
+TEST_FUNCTION(timer_stop_on_a_stopped_timer_does_nothing)
+{
+    // arrange
+    TIMER timer;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+
+    // act
+    timer_stop(&timer);
+    timer_stop(NULL);
+
+    // assert
+    ASSERT_IS_FALSE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* timer_is_running */
+
+/* Tests_SRS_TIMER_QUEUE_01_018: [ If `timer` is NULL, `timer_is_running` shall return false.]*/
+TEST_FUNCTION(timer_is_running_with_NULL_timer_returns_false)
+{
+    // arrange
+
+    // act
+    bool result = timer_is_running(NULL);
+
+    // assert
+    ASSERT_IS_FALSE(result);
+}
+
+/* timer_queue_dowork */
+
+/* Tests_SRS_TIMER_QUEUE_01_019: [ `timer_queue_dowork` shall call `on_timer_expired` for each timer whose deadline is not after the current time, in order of deadline and, for equal deadlines, in the order the timers were started.]*/
+/* Tests_SRS_TIMER_QUEUE_01_024: [ On success `timer_queue_dowork` shall return 0.]*/
+TEST_FUNCTION(timer_queue_dowork_expires_due_timers_in_deadline_order)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer_1;
+    TIMER timer_2;
+    TIMER timer_3;
+    int result;
+    timer_init(&timer_1, test_on_timer_expired, (void*)0x1);
+    timer_init(&timer_2, test_on_timer_expired, (void*)0x2);
+    timer_init(&timer_3, test_on_timer_expired, (void*)0x3);
+    (void)timer_start(timer_queue, &timer_1, 30);
+    (void)timer_start(timer_queue, &timer_2, 10);
+    (void)timer_start(timer_queue, &timer_3, 20);
+    test_current_ms += 20;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_on_timer_expired((void*)0x2));
+    STRICT_EXPECTED_CALL(test_on_timer_expired((void*)0x3));
+
+    // act
+    result = timer_queue_dowork(timer_queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(timer_is_running(&timer_1));
+    ASSERT_IS_FALSE(timer_is_running(&timer_2));
+    ASSERT_IS_FALSE(timer_is_running(&timer_3));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_019: [ `timer_queue_dowork` shall call `on_timer_expired` for each timer whose deadline is not after the current time, in order of deadline and, for equal deadlines, in the order the timers were started.]*/
+TEST_FUNCTION(timer_queue_dowork_expires_timers_with_the_same_deadline_in_start_order)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timers[20];
+    size_t i;
+    for (i = 0; i < 20; i++)
+    {
+        timer_init(&timers[i], test_on_timer_expired, (void*)(i + 1));
+        (void)timer_start(timer_queue, &timers[i], 5);
+    }
+    test_current_ms += 5;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    for (i = 0; i < 20; i++)
+    {
+        STRICT_EXPECTED_CALL(test_on_timer_expired((void*)(i + 1)));
+    }
+
+    // act
+    (void)timer_queue_dowork(timer_queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_020: [ A timer shall no longer be running when its `on_timer_expired` is called, so that the callback can start it again.]*/
+/* Tests_SRS_TIMER_QUEUE_01_021: [ Timers started while `timer_queue_dowork` is running shall not expire before the next call to `timer_queue_dowork`.]*/
+TEST_FUNCTION(a_timer_restarted_from_its_callback_expires_on_the_next_dowork)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    (void)timer_start(timer_queue, &timer, 0);
+    test_restart_timer_queue = timer_queue;
+    test_timer_to_restart = &timer;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_on_timer_expired((void*)0x1));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    (void)timer_queue_dowork(timer_queue);
+
+    // assert
+    ASSERT_IS_TRUE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_022: [ If `timer_queue` is NULL, `timer_queue_dowork` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(timer_queue_dowork_with_NULL_timer_queue_fails)
+{
+    // arrange
+    int result;
+
+    // act
+    result = timer_queue_dowork(NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_023: [ If getting the current time fails, `timer_queue_dowork` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(when_getting_the_current_time_fails_timer_queue_dowork_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    (void)timer_start(timer_queue, &timer, 0);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG))
+        .SetReturn(1);
+
+    // act
+    result = timer_queue_dowork(timer_queue);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(timer_is_running(&timer));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* timer_queue_get_time_to_next_deadline */
+
+/* Tests_SRS_TIMER_QUEUE_01_025: [ `timer_queue_get_time_to_next_deadline` shall set `time_to_next_deadline` to the number of milliseconds until the earliest running timer expires, or 0 if it is already due.]*/
+/* Tests_SRS_TIMER_QUEUE_01_029: [ On success `timer_queue_get_time_to_next_deadline` shall return 0.]*/
+TEST_FUNCTION(timer_queue_get_time_to_next_deadline_returns_0_for_a_due_timer)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    tickcounter_ms_t time_to_next_deadline;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    (void)timer_start(timer_queue, &timer, 10);
+    test_current_ms += 15;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG));
+
+    // act
+    result = timer_queue_get_time_to_next_deadline(timer_queue, &time_to_next_deadline);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(uint64_t, 0, (uint64_t)time_to_next_deadline);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_026: [ If no timer is running, `timer_queue_get_time_to_next_deadline` shall set `time_to_next_deadline` to the largest `tickcounter_ms_t` value.]*/
+TEST_FUNCTION(timer_queue_get_time_to_next_deadline_with_no_running_timers_returns_the_largest_value)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    int result;
+    tickcounter_ms_t time_to_next_deadline;
+    umock_c_reset_all_calls();
+
+    // act
+    result = timer_queue_get_time_to_next_deadline(timer_queue, &time_to_next_deadline);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(time_to_next_deadline == (tickcounter_ms_t)-1);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_027: [ If `timer_queue` or `time_to_next_deadline` is NULL, `timer_queue_get_time_to_next_deadline` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(timer_queue_get_time_to_next_deadline_with_NULL_arguments_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    tickcounter_ms_t time_to_next_deadline;
+    int result_1;
+    int result_2;
+    umock_c_reset_all_calls();
+
+    // act
+    result_1 = timer_queue_get_time_to_next_deadline(NULL, &time_to_next_deadline);
+    result_2 = timer_queue_get_time_to_next_deadline(timer_queue, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result_1);
+    ASSERT_ARE_NOT_EQUAL(int, 0, result_2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+/* Tests_SRS_TIMER_QUEUE_01_028: [ If getting the current time fails, `timer_queue_get_time_to_next_deadline` shall fail and return a non-zero value.]*/
+TEST_FUNCTION(when_getting_the_current_time_fails_timer_queue_get_time_to_next_deadline_fails)
+{
+    // arrange
+    TIMER_QUEUE_HANDLE timer_queue = timer_queue_create(test_tick_counter);
+    TIMER timer;
+    int result;
+    tickcounter_ms_t time_to_next_deadline;
+    timer_init(&timer, test_on_timer_expired, (void*)0x1);
+    (void)timer_start(timer_queue, &timer, 10);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(test_tick_counter, IGNORED_PTR_ARG))
+        .SetReturn(1);
+
+    // act
+    result = timer_queue_get_time_to_next_deadline(timer_queue, &time_to_next_deadline);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timer_queue_destroy(timer_queue);
+}
+
+END_TEST_SUITE(timer_queue_ut)